@@ -1,5 +1,5 @@
 /*
- * Copyright 2001-2008, Haiku Inc. All Rights Reserved.
+ * Copyright 2001-2010, Haiku Inc. All Rights Reserved.
  * Distributed under the terms of the MIT License.
  *
  * Authors:
@@ -141,6 +141,9 @@ private:
 			void*			ReadRawFromPort(int32* code,
 								bigtime_t tout = B_INFINITE_TIMEOUT);
 			BMessage*		ReadMessageFromPort(bigtime_t tout = B_INFINITE_TIMEOUT);
+			status_t		_ReadMessageFromPort(void* buffer,
+								size_t bufferSize, bigtime_t timeout,
+								BMessage*& _message);
 	virtual	BMessage*		ConvertToMessage(void* raw, int32 code);
 	virtual	void			task_looper();
 			void			_QuitRequested(BMessage* msg);
@@ -1,5 +1,5 @@
 /*
- * Copyright 2001-2007, Haiku, Inc. All Rights Reserved.
+ * Copyright 2001-2010, Haiku, Inc. All Rights Reserved.
  * Distributed under the terms of the MIT License.
  */
 #ifndef	_MESSAGE_QUEUE_H
@@ -45,13 +45,16 @@ class BMessageQueue {
 			// this needs to be exported for R5 compatibility and should
 			// be dropped as soon as possible
 
+		void _MoveIncomingMessages();
+
 	private:	
 		BMessage* fHead;
 		BMessage* fTail;
 		int32 fMessageCount;
 		mutable BLocker fLock;
+		BMessage* fIncoming;
 
-		uint32 _reserved[3];
+		uint32 _reserved[2];
 };
 
 #endif	// _MESSAGE_QUEUE_H
@@ -1,5 +1,5 @@
 /*
- * Copyright 2003-2008, Haiku Inc. All Rights Reserved.
+ * Copyright 2003-2010, Haiku Inc. All Rights Reserved.
  * Distributed under the terms of the MIT License.
  */
 #ifndef _NODE_MONITOR_H
@@ -24,7 +24,11 @@ enum {
 	B_WATCH_ALL				= 0x000f,
 
 	B_WATCH_MOUNT			= 0x0010,
-	B_WATCH_INTERIM_STAT	= 0x0020
+	B_WATCH_INTERIM_STAT	= 0x0020,
+
+	B_WATCH_BATCHED			= 0x0040
+		// collect the events over a short period, and deliver them in a
+		// single B_BATCHED_EVENTS message (Haiku only)
 };
 
 
@@ -41,6 +45,7 @@ enum {
 #define	B_ATTR_CHANGED		5
 #define	B_DEVICE_MOUNTED	6
 #define	B_DEVICE_UNMOUNTED	7
+#define	B_BATCHED_EVENTS	8	// Haiku only
 
 
 // More specific info in the "cause" field of B_ATTR_CHANGED notification
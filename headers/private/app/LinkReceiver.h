@@ -1,5 +1,5 @@
 /*
- * Copyright 2001-2006, Haiku.
+ * Copyright 2001-2010, Haiku.
  * Distributed under the terms of the MIT License.
  *
  * Authors:
@@ -21,6 +21,8 @@ class BRegion;
 
 namespace BPrivate {
 
+class LinkRing;
+
 class LinkReceiver {
 	public:
 		LinkReceiver(port_id port);
@@ -29,10 +31,14 @@ class LinkReceiver {
 		void SetPort(port_id port);
 		port_id	Port(void) const { return fReceivePort; }
 
+		void SetRing(LinkRing* ring);
+		LinkRing* Ring() const { return fRing; }
+
 		status_t GetNextMessage(int32& code, bigtime_t timeout = B_INFINITE_TIMEOUT);
-		bool HasMessages() const;
+		bool HasMessages();
 		bool NeedsReply() const;
 		int32 Code() const;
+		status_t RewindMessage();
 
 		virtual status_t Read(void* data, ssize_t size);
 		status_t ReadString(char** _string, size_t* _length = NULL);
@@ -50,8 +56,10 @@ class LinkReceiver {
 		void ResetBuffer();
 
 		port_id fReceivePort;
+		LinkRing* fRing;
 
 		char*	fRecvBuffer;
+		char*	fPortBuffer;	// our own buffer while reading from the ring
 		int32	fRecvPosition;	//current read position
 		int32	fRecvStart;	//start of current message
 		int32	fRecvBufferSize;
@@ -60,6 +68,11 @@ class LinkReceiver {
 		int32	fReplySize;	//size of current reply message
 
 		status_t fReadError;	//Read failed for current message
+		bool	fReadArea;	//an area was read for current message
+		bool	fReadingRing;	//fRecvBuffer points into the ring
+
+	private:
+		bool _ReadFromRing();
 };
 
 }	// namespace BPrivate
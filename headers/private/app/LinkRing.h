@@ -0,0 +1,53 @@
+/*
+ * Copyright 2010, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef _LINK_RING_H
+#define _LINK_RING_H
+
+
+#include <OS.h>
+
+
+namespace BPrivate {
+
+struct link_ring_header;
+
+class LinkRing {
+	public:
+		LinkRing();
+		~LinkRing();
+
+		status_t InitProducer(size_t size);
+		status_t InitConsumer(area_id area, sem_id spaceSemaphore);
+
+		area_id Area() const { return fArea; }
+		sem_id SpaceSemaphore() const { return fSpaceSemaphore; }
+
+		// producer
+		status_t Write(const void* data, size_t size, port_id doorbellPort,
+			bigtime_t timeout = B_INFINITE_TIMEOUT);
+
+		// consumer
+		bool HasData() const;
+		const char* NextBatch(int32& _size);
+		void ReleaseBatch();
+
+		bool PrepareToWait();
+
+	private:
+		status_t _WaitForSpace(int32 read, bigtime_t timeout);
+
+		area_id				fArea;
+		sem_id				fSpaceSemaphore;
+		link_ring_header*	fHeader;
+		char*				fData;
+		int32				fSize;
+		int32				fBatchEnd;
+		bool				fProducer;
+		bool				fBroken;
+};
+
+}	// namespace BPrivate
+
+#endif	/* _LINK_RING_H */
@@ -1,5 +1,5 @@
 /*
- * Copyright 2001-2005, Haiku.
+ * Copyright 2001-2010, Haiku.
  * Distributed under the terms of the MIT License.
  *
  * Authors:
@@ -15,7 +15,9 @@
 
 
 namespace BPrivate {
-	
+
+class LinkRing;
+
 class LinkSender {
 	public:
 		LinkSender(port_id sendport);
@@ -27,6 +29,9 @@ class LinkSender {
 		team_id TargetTeam() const;
 		void SetTargetTeam(team_id team);
 
+		void SetRing(LinkRing* ring);
+		LinkRing* Ring() const { return fRing; }
+
 		status_t StartMessage(int32 code, size_t minSize = 0);
 		void CancelMessage(void);
 		status_t EndMessage(bool needsReply = false);
@@ -49,6 +54,7 @@ class LinkSender {
 
 		port_id	fPort;
 		team_id fTargetTeam;
+		LinkRing* fRing;
 
 		char	*fBuffer;
 		size_t	fBufferSize;
@@ -1,5 +1,5 @@
 /*
- * Copyright 2001-2009, Haiku.
+ * Copyright 2001-2010, Haiku.
  * Distributed under the terms of the MIT License.
  *
  * Authors:
@@ -65,6 +65,7 @@ enum {
 	AS_DELETE_BITMAP,
 	AS_GET_BITMAP_OVERLAY_RESTRICTIONS,
 	AS_GET_BITMAP_SUPPORT_FLAGS,
+	AS_GET_CLIENT_MEMORY_STATISTICS,
 
 	// Cursor commands
 	AS_SET_CURSOR,
@@ -111,6 +112,7 @@ enum {
 	AS_SET_SIZE_LIMITS,
 	AS_ACTIVATE_WINDOW,
 	AS_IS_FRONT_WINDOW,
+	AS_ENABLE_LINK_RING,
 
 	// BPicture definitions
 	AS_CREATE_PICTURE,
@@ -146,6 +148,7 @@ enum {
 	AS_GET_HAS_GLYPHS,
 	AS_GET_GLYPH_SHAPES,
 	AS_GET_TRUNCATED_STRINGS,
+	AS_GET_GLYPH_CACHE_STATISTICS,
 
 	// Screen methods
 	AS_VALID_SCREEN_ID,
@@ -209,6 +212,7 @@ enum {
 	AS_GET_DECORATOR_SETTINGS,
 	AS_GET_SHOW_ALL_DRAGGERS,
 	AS_SET_SHOW_ALL_DRAGGERS,
+	AS_GET_REDRAW_STATISTICS,
 
 	// Subpixel antialiasing & hinting
 	AS_SET_SUBPIXEL_ANTIALIASING,
@@ -342,6 +346,7 @@ enum {
 	kFramebuffer		= 0x2,
 	kHeap				= 0x4,
 	kNewAllocatorArea	= 0x8,
+	kSoftwareOverlay	= 0x10,
 };
 
 #endif	// APP_SERVER_PROTOCOL_H
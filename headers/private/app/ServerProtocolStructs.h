@@ -1,5 +1,5 @@
 /*
- * Copyright 2009, Haiku. All rights reserved.
+ * Copyright 2009-2010, Haiku. All rights reserved.
  * Distributed under the terms of the MIT License.
  *
  * Authors:
@@ -107,4 +107,36 @@ struct ViewLineArrayInfo {
 };
 
 
+struct GlyphCacheStatisticsInfo {
+	int64						hits;
+	int64						misses;
+	int64						evictedGlyphs;
+	int64						evictedEntries;
+	uint64						glyphMemory;
+	uint64						glyphMemoryBudget;
+	uint64						atlasMemory;
+	int32						entryCount;
+};
+
+
+struct RedrawStatisticsInfo {
+	int64						updateMessages;
+	int64						exposedPixels;
+	int64						backingStorePixels;
+	int64						displayListPixels;
+};
+
+
+struct ClientMemoryStatisticsInfo {
+	int64						allocatedBytes;
+	int64						areaBytes;
+	int64						peakAreaBytes;
+	int64						releasedBytes;
+	int32						allocations;
+	int32						frees;
+	int32						areaCount;
+	int32						freeBlockCount;
+};
+
+
 #endif	// APP_SERVER_PROTOCOL_STRUCTS_H
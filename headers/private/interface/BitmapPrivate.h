@@ -1,5 +1,5 @@
 /*
- * Copyright 2006, Haiku, Inc.
+ * Copyright 2006-2010, Haiku, Inc.
  * Distributed under the terms of the MIT License.
  */
 #ifndef _BITMAP_PRIVATE_H
@@ -13,7 +13,13 @@
 
 struct overlay_client_data {
 	sem_id	lock;
+	int32	change_count;
+		// incremented by the client whenever it unlocks the buffer
 	uint8*	buffer;
 };
 
+// The buffer of a software emulated overlay follows its overlay_client_data
+// at this offset, which must not be smaller than the structure.
+static const size_t kSoftwareOverlayBufferOffset = 16;
+
 #endif // _BITMAP_PRIVATE_H
@@ -235,7 +235,6 @@ struct thread {
 	int32			flags;			// summary of events relevant in interrupt
 									// handlers (signals pending, user debugging
 									// enabled, etc.)
-	struct thread	*all_next;
 	struct thread	*team_next;
 	struct thread	*queue_next;	/* i.e. run queue, release queue, etc. */
 	timer			alarm;
@@ -0,0 +1,647 @@
+/*
+ * Copyright 2010, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef _KERNEL_UTIL_PROBING_HASH_TABLE_H
+#define _KERNEL_UTIL_PROBING_HASH_TABLE_H
+
+
+#include <util/OpenHashTable.h>
+
+
+/*!
+	An open addressing hash table using Robin Hood hashing with linear
+	probing. The elements are stored in a flat array of slots, together with
+	their hash values, so that a lookup usually only touches a single cache
+	line, and doesn't have to call the definition's Compare() method for
+	elements with a different hash value.
+
+	The Definition template is the same as the one of BOpenHashTable, except
+	that `GetLink' is not needed, as the elements don't need to be linked:
+
+	struct HashTableDefinition {
+		typedef int		KeyType;
+		typedef	Foo		ValueType;
+
+		size_t HashKey(int key) const
+		{
+			return key >> 1;
+		}
+
+		size_t Hash(Foo* value) const
+		{
+			return HashKey(value->bar);
+		}
+
+		bool Compare(int key, Foo* value) const
+		{
+			return value->bar == key;
+		}
+	};
+
+	The table is resized incrementally: when it has to grow or shrink, a new
+	array is allocated, and every following Insert() and Remove() moves a few
+	elements from the old array over, while lookups search both arrays.
+
+	If \c AutoExpand is \c false, the table never allocates or frees memory
+	on its own, and can be used with interrupts disabled. The caller has to
+	check ResizeNeeded() before inserting, and pass a new allocation to
+	Resize() when needed; Insert() fails when the table is full. The array
+	that has been replaced is handed back by the next Resize() call.
+*/
+template<typename Definition, bool AutoExpand = true,
+	bool CheckDuplicates = false, typename Allocator = MallocAllocator>
+class BProbingHashTable {
+public:
+	typedef BProbingHashTable<Definition, AutoExpand, CheckDuplicates,
+		Allocator> HashTable;
+	typedef typename Definition::KeyType	KeyType;
+	typedef typename Definition::ValueType	ValueType;
+
+	static const size_t kMinimumSize = 8;
+	static const size_t kMigrationSteps = 8;
+		// slots of the old array that are processed per Insert()/Remove()
+
+	// All allocations are of power of 2 lengths.
+
+	// regrowth factor: 200 / 256 = 78.125%
+	//                   50 / 256 = 19.53125%
+
+	struct Slot {
+		uint32		hash;
+		ValueType*	value;
+	};
+
+	struct Table {
+		Slot*		slots;
+		size_t		size;
+		size_t		count;
+		uint32		shift;
+	};
+
+	BProbingHashTable()
+		:
+		fItemCount(0),
+		fMigrationIndex(0),
+		fRetiredTable(NULL)
+	{
+		_InitTable(fTable);
+		_InitTable(fOldTable);
+	}
+
+	BProbingHashTable(const Definition& definition)
+		:
+		fDefinition(definition),
+		fItemCount(0),
+		fMigrationIndex(0),
+		fRetiredTable(NULL)
+	{
+		_InitTable(fTable);
+		_InitTable(fOldTable);
+	}
+
+	BProbingHashTable(const Definition& definition, const Allocator& allocator)
+		:
+		fDefinition(definition),
+		fAllocator(allocator),
+		fItemCount(0),
+		fMigrationIndex(0),
+		fRetiredTable(NULL)
+	{
+		_InitTable(fTable);
+		_InitTable(fOldTable);
+	}
+
+	~BProbingHashTable()
+	{
+		fAllocator.Free(fTable.slots);
+		fAllocator.Free(fOldTable.slots);
+		fAllocator.Free(fRetiredTable);
+	}
+
+	status_t Init(size_t initialSize = kMinimumSize)
+	{
+		if (initialSize > 0 && !_Resize(_SizeFor(initialSize)))
+			return B_NO_MEMORY;
+		return B_OK;
+	}
+
+	size_t TableSize() const
+	{
+		return fTable.size;
+	}
+
+	size_t CountElements() const
+	{
+		return fItemCount;
+	}
+
+	ValueType* Lookup(const KeyType& key) const
+	{
+		uint32 hash = fDefinition.HashKey(key);
+
+		ssize_t index = _Find(fTable, key, hash);
+		if (index >= 0)
+			return fTable.slots[index].value;
+
+		index = _Find(fOldTable, key, hash);
+		if (index >= 0)
+			return fOldTable.slots[index].value;
+
+		return NULL;
+	}
+
+	status_t Insert(ValueType* value)
+	{
+		if (AutoExpand) {
+			// only grow here, shrinking is left to Remove()
+			size_t size = _NeededSize();
+			if (size > fTable.size && !_Resize(size)
+				&& fItemCount + 1 >= fTable.size)
+				return B_NO_MEMORY;
+		} else if (fItemCount + 1 >= fTable.size)
+			return B_NO_MEMORY;
+
+		InsertUnchecked(value);
+		return B_OK;
+	}
+
+	/*!	Inserts the value without checking whether the table has room for
+		it; there must always be at least one free slot left.
+	*/
+	void InsertUnchecked(ValueType* value)
+	{
+		if (CheckDuplicates && _ExhaustiveSearch(value)) {
+#ifdef _KERNEL_MODE
+			panic("Hash Table: value already in table.");
+#else
+			debugger("Hash Table: value already in table.");
+#endif
+		}
+
+		_Insert(fTable, fDefinition.Hash(value), value);
+		fItemCount++;
+
+		_Migrate(kMigrationSteps);
+	}
+
+	bool Remove(ValueType* value)
+	{
+		if (!RemoveUnchecked(value))
+			return false;
+
+		if (AutoExpand) {
+			size_t size = _NeededSize();
+			if (size < fTable.size)
+				_Resize(size);
+		}
+
+		return true;
+	}
+
+	bool RemoveUnchecked(ValueType* value)
+	{
+		uint32 hash = fDefinition.Hash(value);
+
+		ssize_t index = _FindValue(fTable, value, hash);
+		if (index >= 0)
+			_RemoveAt(fTable, index);
+		else {
+			index = _FindValue(fOldTable, value, hash);
+			if (index < 0)
+				return false;
+
+			_RemoveAt(fOldTable, index);
+		}
+
+		fItemCount--;
+
+		if (CheckDuplicates && _ExhaustiveSearch(value)) {
+#ifdef _KERNEL_MODE
+			panic("Hash Table: duplicate detected.");
+#else
+			debugger("Hash Table: duplicate detected.");
+#endif
+		}
+
+		_Migrate(kMigrationSteps);
+		return true;
+	}
+
+	/*!	Removes all elements from the hash table. No resizing happens, and
+		the elements are not deleted; use an Iterator before calling this
+		method if they need to be freed.
+	*/
+	void Clear()
+	{
+		if (fTable.slots != NULL)
+			memset(fTable.slots, 0, sizeof(Slot) * fTable.size);
+		fTable.count = 0;
+
+		if (fOldTable.slots != NULL) {
+			memset(fOldTable.slots, 0, sizeof(Slot) * fOldTable.size);
+			fOldTable.count = 0;
+			_FinishMigration();
+		}
+
+		fItemCount = 0;
+	}
+
+	/*!	If the table needs resizing, the number of bytes for the required
+		allocation is returned. If no resizing is needed, 0 is returned.
+	*/
+	size_t ResizeNeeded() const
+	{
+		size_t size = _NeededSize();
+		if (size == fTable.size)
+			return 0;
+
+		return size * sizeof(Slot);
+	}
+
+	/*!	Resizes the table using the given allocation. The allocation must not
+		be \c NULL. It must be of size \a size, which must a value returned
+		earlier by ResizeNeeded(). If the size requirements have changed in the
+		meantime, the method frees the given allocation and returns \c false,
+		unless \a force is \c true, in which case the supplied allocation is
+		used in any event.
+		Otherwise \c true is returned.
+		The elements are moved over to the new allocation incrementally. The
+		array of an earlier resize, whose elements have all been moved, is
+		freed, or, if \a oldTable is non-null, returned via this parameter
+		instead (\c NULL if there is none).
+	*/
+	bool Resize(void* allocation, size_t size, bool force = false,
+		void** oldTable = NULL)
+	{
+		if (!force && size != ResizeNeeded()) {
+			fAllocator.Free(allocation);
+			return false;
+		}
+
+		_Resize((Slot*)allocation, size / sizeof(Slot), oldTable);
+		return true;
+	}
+
+	/*!	Iterates over all elements. Every array is walked starting with the
+		first slot that can't be part of a cluster wrapping around its end, so
+		that removing elements through RemoveCurrent() only moves elements
+		that have not been visited yet.
+	*/
+	class Iterator {
+	public:
+		Iterator(const HashTable* table)
+			: fTable(table)
+		{
+			Rewind();
+		}
+
+		bool HasNext() const { return fNext != NULL; }
+
+		ValueType* Next()
+		{
+			ValueType* current = fNext;
+			fCurrentIndex = fNextIndex;
+			_GetNext();
+			return current;
+		}
+
+		void Rewind()
+		{
+			// get the first one
+			fStart = _ClusterStart(fTable->fTable);
+			fOldStart = _ClusterStart(fTable->fOldTable);
+			fIndex = 0;
+			fCurrentIndex = 0;
+			fNext = NULL;
+			_GetNext();
+		}
+
+	protected:
+		Iterator() {}
+
+		static size_t _ClusterStart(const Table& table)
+		{
+			for (size_t i = 0; i < table.size; i++) {
+				const Slot& slot = table.slots[i];
+				if (slot.value == NULL || _Distance(table, slot.hash, i) == 0)
+					return i;
+			}
+			return 0;
+		}
+
+		size_t _SlotIndex(size_t index) const
+		{
+			const Table& table = fTable->fTable;
+			if (index < table.size)
+				return (fStart + index) & (table.size - 1);
+
+			const Table& oldTable = fTable->fOldTable;
+			return (fOldStart + index - table.size) & (oldTable.size - 1);
+		}
+
+		void _GetNext()
+		{
+			const Table& table = fTable->fTable;
+			const Table& oldTable = fTable->fOldTable;
+
+			fNext = NULL;
+			while (fNext == NULL && fIndex < table.size + oldTable.size) {
+				fNextIndex = fIndex++;
+				if (fNextIndex < table.size)
+					fNext = table.slots[_SlotIndex(fNextIndex)].value;
+				else
+					fNext = oldTable.slots[_SlotIndex(fNextIndex)].value;
+			}
+		}
+
+		friend class BProbingHashTable;
+
+		const HashTable* fTable;
+		size_t fStart;
+		size_t fOldStart;
+		size_t fIndex;
+		size_t fNextIndex;
+		size_t fCurrentIndex;
+		ValueType* fNext;
+	};
+
+	/*!	Removes the element that has last been returned by the iterator's
+		Next() method. Unlike Remove(), this keeps the iterator valid; the
+		table is neither resized, nor are any elements migrated.
+	*/
+	void RemoveCurrent(Iterator& iterator)
+	{
+		Table& table = iterator.fCurrentIndex < fTable.size ? fTable : fOldTable;
+		size_t index = iterator._SlotIndex(iterator.fCurrentIndex);
+
+		_RemoveAt(table, index);
+		fItemCount--;
+
+		// the following elements have been moved back, so continue with
+		// the slot of the removed one
+		iterator.fIndex = iterator.fCurrentIndex;
+		iterator._GetNext();
+	}
+
+	Iterator GetIterator() const
+	{
+		return Iterator(this);
+	}
+
+protected:
+	// for g++ 2.95
+	friend class Iterator;
+
+	static void _InitTable(Table& table)
+	{
+		table.slots = NULL;
+		table.size = 0;
+		table.count = 0;
+		table.shift = 32;
+	}
+
+	static size_t _SizeFor(size_t count)
+	{
+		size_t size = kMinimumSize;
+		while (count >= size * 200 / 256)
+			size <<= 1;
+		return size;
+	}
+
+	/*!	Spreads the hash values over the table (Fibonacci hashing), so that
+		patterns in the lower bits of the hash don't lead to long clusters.
+	*/
+	static size_t _Index(const Table& table, uint32 hash)
+	{
+		return (uint32)(hash * 2654435769UL) >> table.shift;
+	}
+
+	static size_t _Distance(const Table& table, uint32 hash, size_t index)
+	{
+		return (index - _Index(table, hash)) & (table.size - 1);
+	}
+
+	size_t _NeededSize() const
+	{
+		size_t size = fTable.size;
+
+		if (fOldTable.slots != NULL) {
+			// don't start another resize before the elements have been
+			// moved over, unless the table is getting full
+			if (fItemCount < size * 240 / 256)
+				return size;
+			return size << 1;
+		}
+
+		if (size == 0 || fItemCount >= size * 200 / 256) {
+			// grow table
+			if (size == 0)
+				size = kMinimumSize;
+			while (fItemCount >= size * 200 / 256)
+				size <<= 1;
+		} else if (size > kMinimumSize && fItemCount < size * 50 / 256) {
+			// shrink table
+			while (fItemCount < size * 50 / 256)
+				size >>= 1;
+			if (size < kMinimumSize)
+				size = kMinimumSize;
+		}
+
+		return size;
+	}
+
+	ssize_t _Find(const Table& table, const KeyType& key, uint32 hash) const
+	{
+		if (table.count == 0)
+			return -1;
+
+		size_t mask = table.size - 1;
+		size_t index = _Index(table, hash);
+
+		for (size_t distance = 0;; distance++) {
+			const Slot& slot = table.slots[index];
+			if (slot.value == NULL
+				|| _Distance(table, slot.hash, index) < distance)
+				return -1;
+
+			if (slot.hash == hash && fDefinition.Compare(key, slot.value))
+				return index;
+
+			index = (index + 1) & mask;
+		}
+	}
+
+	ssize_t _FindValue(const Table& table, ValueType* value, uint32 hash) const
+	{
+		if (table.count == 0)
+			return -1;
+
+		size_t mask = table.size - 1;
+		size_t index = _Index(table, hash);
+
+		for (size_t distance = 0;; distance++) {
+			const Slot& slot = table.slots[index];
+			if (slot.value == NULL
+				|| _Distance(table, slot.hash, index) < distance)
+				return -1;
+
+			if (slot.value == value)
+				return index;
+
+			index = (index + 1) & mask;
+		}
+	}
+
+	void _Insert(Table& table, uint32 hash, ValueType* value)
+	{
+		size_t mask = table.size - 1;
+		size_t index = _Index(table, hash);
+		size_t distance = 0;
+
+		while (true) {
+			Slot& slot = table.slots[index];
+			if (slot.value == NULL) {
+				slot.hash = hash;
+				slot.value = value;
+				table.count++;
+				return;
+			}
+
+			size_t slotDistance = _Distance(table, slot.hash, index);
+			if (slotDistance < distance) {
+				// the element in this slot is closer to its home, so it has
+				// to make room for ours, and we continue with it instead
+				uint32 slotHash = slot.hash;
+				ValueType* slotValue = slot.value;
+				slot.hash = hash;
+				slot.value = value;
+				hash = slotHash;
+				value = slotValue;
+				distance = slotDistance;
+			}
+
+			index = (index + 1) & mask;
+			distance++;
+		}
+	}
+
+	void _RemoveAt(Table& table, size_t index)
+	{
+		size_t mask = table.size - 1;
+
+		// move the following elements back, until we reach one that is
+		// in its home slot
+		while (true) {
+			size_t next = (index + 1) & mask;
+			const Slot& nextSlot = table.slots[next];
+			if (nextSlot.value == NULL
+				|| _Distance(table, nextSlot.hash, next) == 0)
+				break;
+
+			table.slots[index] = nextSlot;
+			index = next;
+		}
+
+		table.slots[index].value = NULL;
+		table.count--;
+	}
+
+	/*!	Moves the elements of the next \a steps slots of the old array over
+		to the current one. Removing an element from the old array moves the
+		following ones of its cluster back, so the slot is emptied completely
+		before moving on; the slots before fMigrationIndex always stay empty.
+	*/
+	void _Migrate(size_t steps)
+	{
+		while (fOldTable.slots != NULL && steps-- > 0) {
+			while (true) {
+				Slot& slot = fOldTable.slots[fMigrationIndex];
+				if (slot.value == NULL)
+					break;
+
+				_Insert(fTable, slot.hash, slot.value);
+				_RemoveAt(fOldTable, fMigrationIndex);
+			}
+			fMigrationIndex++;
+
+			if (fOldTable.count == 0 || fMigrationIndex == fOldTable.size)
+				_FinishMigration();
+		}
+	}
+
+	void _FinishMigration()
+	{
+		if (AutoExpand)
+			fAllocator.Free(fOldTable.slots);
+		else
+			fRetiredTable = fOldTable.slots;
+
+		_InitTable(fOldTable);
+		fMigrationIndex = 0;
+	}
+
+	bool _Resize(size_t newSize)
+	{
+		Slot* newTable = (Slot*)fAllocator.Allocate(sizeof(Slot) * newSize);
+		if (newTable == NULL)
+			return false;
+
+		_Resize(newTable, newSize);
+		return true;
+	}
+
+	void _Resize(Slot* newTable, size_t newSize, void** oldTable = NULL)
+	{
+		// an earlier resize must be completed first
+		if (fOldTable.slots != NULL)
+			_Migrate(~(size_t)0);
+
+		if (oldTable != NULL)
+			*oldTable = fRetiredTable;
+		else
+			fAllocator.Free(fRetiredTable);
+		fRetiredTable = NULL;
+
+		memset(newTable, 0, sizeof(Slot) * newSize);
+
+		fOldTable = fTable;
+		fMigrationIndex = 0;
+
+		fTable.slots = newTable;
+		fTable.size = newSize;
+		fTable.count = 0;
+		fTable.shift = 32;
+		for (size_t size = newSize; size > 1; size >>= 1)
+			fTable.shift--;
+
+		if (fOldTable.slots != NULL && fOldTable.count == 0)
+			_FinishMigration();
+		else if (fOldTable.slots == NULL)
+			_InitTable(fOldTable);
+	}
+
+	bool _ExhaustiveSearch(ValueType* value) const
+	{
+		for (size_t i = 0; i < fTable.size; i++) {
+			if (fTable.slots[i].value == value)
+				return true;
+		}
+		for (size_t i = 0; i < fOldTable.size; i++) {
+			if (fOldTable.slots[i].value == value)
+				return true;
+		}
+
+		return false;
+	}
+
+	Definition		fDefinition;
+	Allocator		fAllocator;
+	Table			fTable;
+	Table			fOldTable;
+	size_t			fItemCount;
+	size_t			fMigrationIndex;
+	Slot*			fRetiredTable;
+};
+
+#endif	// _KERNEL_UTIL_PROBING_HASH_TABLE_H
@@ -1,5 +1,5 @@
 /*
- * Copyright 2006-2007, Haiku, Inc. All Rights Reserved.
+ * Copyright 2006-2009, Haiku, Inc. All Rights Reserved.
  * Distributed under the terms of the MIT License.
  */
 #ifndef NET_DEVICE_H
@@ -59,6 +59,11 @@ struct net_device_module_info {
 					const struct sockaddr *address);
 	status_t	(*remove_multicast)(struct net_device *device,
 					const struct sockaddr *address);
+
+	// optional; retrieves up to *_count buffers, but waits for the first one
+	// only - *_count is set to the number of buffers actually received
+	status_t	(*receive_data_batch)(struct net_device *device,
+					struct net_buffer **buffers, uint32 *_count);
 };
 
 #endif	// NET_DEVICE_H
@@ -123,6 +123,8 @@ struct net_stack_module_info {
 
 	// checksum
 	uint16 (*checksum)(uint8 *buffer, size_t length);
+	uint16 (*update_checksum)(uint16 checksum, uint16 oldValue,
+					uint16 newValue);
 
 	// fifo
 	status_t (*init_fifo)(struct net_fifo *fifo, const char *name,
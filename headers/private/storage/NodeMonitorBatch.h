@@ -0,0 +1,35 @@
+/*
+ * Copyright 2010, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef _NODE_MONITOR_BATCH_H
+#define _NODE_MONITOR_BATCH_H
+
+
+#include <Message.h>
+
+#include <node_monitor_defs.h>
+
+
+namespace BPrivate {
+namespace Storage {
+
+class NodeMonitorBatch {
+public:
+								NodeMonitorBatch(const BMessage* message);
+
+			int32				CountEvents() const;
+			status_t			GetNextEvent(BMessage* event);
+
+private:
+			const BMessage*		fMessage;
+			int32				fEventCount;
+			int32				fEventIndex;
+			bool				fNested;
+			int32				fFieldIndices[NODE_MONITOR_BATCH_FIELD_COUNT];
+};
+
+}	// namespace Storage
+}	// namespace BPrivate
+
+#endif	// _NODE_MONITOR_BATCH_H
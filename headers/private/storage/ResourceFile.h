@@ -26,6 +26,7 @@ namespace Storage {
 
 
 class Exception;
+struct MappedResourceFile;
 struct MemArea;
 class ResourceItem;
 struct resource_parse_info;
@@ -50,6 +51,16 @@ class ResourcesContainer;
 	In particular it is nice, that at any time we can write an arbitrary set
 	of resources to the file.
 
+	If the file has been opened read-only, it is mapped into memory, and the
+	ResourceItems returned by InitContainer() point directly to their data in
+	the mapping. The mapping and the parsed resource index are shared by all
+	ResourceFiles set to the same, unchanged file. ReadResource() and
+	ReadResources() copy the data out of the mapping, so that the resources
+	read can be written to any file, including the mapped one. Data that
+	are still mapped reflect changes other teams make to the file later on,
+	and should therefore only be used for files that are not rewritten in
+	place, like applications and libraries.
+
 	\author <a href='mailto:bonefish@users.sf.net'>Ingo Weinhold</a>
 
 	\version 0.0.0
@@ -72,6 +83,8 @@ public:
 
 private:
 			void				_InitFile(BFile& file, bool clobber);
+			bool				_InitFromMappedFile(BFile& file);
+			void				_MapFile(ResourcesContainer& container);
 
 			void				_InitELFFile(BFile& file);
 
@@ -110,6 +123,7 @@ private:
 			uint32				fFileType;
 			bool				fHostEndianess;
 			bool				fEmptyResources;
+			MappedResourceFile*	fMappedFile;
 };
 
 
@@ -13,6 +13,8 @@
 #include <DataIO.h>
 #include <String.h>
 
+class BReferenceable;
+
 namespace BPrivate {
 namespace Storage {
 
@@ -35,6 +37,10 @@ namespace Storage {
 	The memory for the resource data is owned by the ResourceItem object and
 	freed on destruction.
 
+	Alternatively the data may live in a memory mapped resource file
+	(SetMappedData()). The item then keeps a reference to the owner of the
+	mapping, and copies the data only when they are modified.
+
 	\author <a href='mailto:bonefish@users.sf.net'>Ingo Weinhold</a>
 	
 	\version 0.0.0
@@ -44,6 +50,7 @@ public:
 	ResourceItem();
 	virtual ~ResourceItem();
 
+	virtual ssize_t ReadAt(off_t pos, void *buffer, size_t size);
 	virtual ssize_t WriteAt(off_t pos, const void *buffer, size_t size);
 	virtual status_t SetSize(off_t size);
 
@@ -67,6 +74,10 @@ public:
 
 	void *Data() const;
 
+	void SetMappedData(const void *data, BReferenceable *owner);
+	bool IsMapped() const;
+	status_t CopyMappedData();
+
 	void SetLoaded(bool loaded);
 	bool IsLoaded() const;
 
@@ -74,13 +85,15 @@ public:
 	bool IsModified() const;
 
 private:
-	int32		fOffset;
-	size_t		fInitialSize;
-	type_code	fType;
-	int32		fID;
-	BString		fName;
-	bool		fIsLoaded;
-	bool		fIsModified;
+	int32			fOffset;
+	size_t			fInitialSize;
+	type_code		fType;
+	int32			fID;
+	BString			fName;
+	bool			fIsLoaded;
+	bool			fIsModified;
+	const void		*fMappedData;
+	BReferenceable	*fMappedDataOwner;
 };
 
 };	// namespace Storage
@@ -0,0 +1,84 @@
+/*
+ * Copyright 2010, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef _MIME_DATABASE_INDEX_H
+#define _MIME_DATABASE_INDEX_H
+
+
+#include <OS.h>
+
+struct attr_info;
+
+
+namespace BPrivate {
+namespace Storage {
+namespace Mime {
+
+/*!	The registrar keeps a copy of all attributes of the MIME database in an
+	area, which the clients clone read-only. The area consists of this
+	header, a hash table with the offsets of the newest entry in each slot,
+	and the entries themselves.
+
+	Entries are only ever appended: when a type changes, all of its
+	attributes are appended again, followed by a new type entry with a new
+	serial number. Readers only accept attribute entries with the serial
+	number of the newest type entry, and so always see a consistent
+	snapshot of a type. When the area is full, the registrar builds a new
+	one, and stores its ID in the \c replacement field of the old one.
+	If that fails, it clears the \c magic field of the old one instead,
+	and the clients have to read the database files.
+*/
+
+#define MIME_DATABASE_INDEX_AREA_NAME	"mime database index"
+
+static const uint32 kDatabaseIndexMagic = 'MdbI';
+
+struct database_index_header {
+	uint32		magic;
+	uint32		size;
+	uint32		used;
+	uint32		hash_size;
+	vint32		replacement;
+	uint32		table[0];
+		// hash_size entries, followed by the entries
+};
+
+struct database_index_entry {
+	uint32		next;
+	uint32		hash;
+	uint32		serial;
+	type_code	type;
+	int32		size;
+		// < 0 for a type entry of a removed type
+	uint16		type_length;
+	uint16		attribute_length;
+		// both including the terminating null; type entries have an
+		// empty attribute name
+	uint32		data_offset;
+		// relative to the start of the entry
+	char		name[0];
+
+	const char* Type() const
+		{ return name; }
+	const char* Attribute() const
+		{ return name + type_length; }
+	const void* Data() const
+		{ return (const uint8*)this + data_offset; }
+};
+
+uint32 database_index_hash(const char* type, const char* attribute);
+const database_index_entry* database_index_find(
+	const database_index_header* header, const char* type,
+	const char* attribute);
+
+ssize_t read_indexed_mime_attr(const char* type, const char* attribute,
+	void* data, size_t length, attr_info* info = NULL);
+status_t read_indexed_mime_attr(const char* type, const char* attribute,
+	void** _data, attr_info* info);
+
+} // namespace Mime
+} // namespace Storage
+} // namespace BPrivate
+
+#endif	// _MIME_DATABASE_INDEX_H
@@ -0,0 +1,69 @@
+/*
+ * Copyright 2010, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef _SNIFFER_MATCHER_H
+#define _SNIFFER_MATCHER_H
+
+
+#include <SupportDefs.h>
+
+#include <string>
+#include <vector>
+
+
+namespace BPrivate {
+namespace Storage {
+namespace Sniffer {
+
+class Pattern;
+class Range;
+class Rule;
+
+/*! \brief A list of rules compiled into a single automaton, that finds the
+	first of the rules matching a buffer in one pass over it.
+*/
+class Matcher {
+public:
+	Matcher();
+	~Matcher();
+
+	void MakeEmpty();
+
+	status_t AddRule(const Rule* rule);
+	status_t Compile();
+
+	int32 CountRules() const;
+	int32 Match(const void* data, size_t length) const;
+
+	// used by DisjList::AddTo()
+	void AddPattern(const Pattern& pattern, const Range& range,
+		bool caseInsensitive);
+
+private:
+	struct term;
+	struct node;
+
+	int32 _Next(int32 state, uint8 c) const;
+	bool _MatchesAt(const term& term, const uint8* data, size_t length,
+		int32 start) const;
+	bool _MatchesInRange(const term& term, const uint8* data,
+		size_t length) const;
+
+	std::vector<term>	fTerms;
+	std::vector<int32>	fDisjLists;
+		// index of the first term of each disjunction list
+	std::vector<int32>	fRules;
+		// index of the first disjunction list of each rule
+	std::vector<node>	fNodes;
+	std::vector<int32>	fUnanchoredTerms;
+	int32				fRootTransitions[256];
+	size_t				fScanLength;
+	bool				fCompiled;
+};
+
+};	// namespace Sniffer
+};	// namespace Storage
+};	// namespace BPrivate
+
+#endif	// _SNIFFER_MATCHER_H
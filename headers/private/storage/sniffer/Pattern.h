@@ -34,6 +34,9 @@ public:
 	
 	bool Sniff(Range range, BPositionIO *data, bool caseInsensitive) const;
 	ssize_t BytesNeeded() const;
+
+	const std::string& String() const;
+	const std::string& Mask() const;
 	
 	status_t SetTo(const std::string &string, const std::string &mask);
 private:
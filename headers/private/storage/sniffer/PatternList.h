@@ -35,6 +35,7 @@ public:
 	
 	virtual bool Sniff(BPositionIO *data) const;
 	virtual ssize_t BytesNeeded() const;
+	virtual void AddTo(Matcher& matcher) const;
 	
 	void Add(Pattern *pattern);
 private:
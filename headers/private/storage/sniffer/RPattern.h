@@ -18,6 +18,7 @@ namespace Storage {
 namespace Sniffer {
 
 class Err;
+class Matcher;
 class Pattern;
 
 //! A Pattern and a Range, bundled into one.
@@ -31,6 +32,7 @@ public:
 	
 	bool Sniff(BPositionIO *data, bool caseInsensitive) const;
 	ssize_t BytesNeeded() const;
+	void AddTo(Matcher& matcher, bool caseInsensitive) const;
 private:
 	Range fRange;
 	Pattern *fPattern;
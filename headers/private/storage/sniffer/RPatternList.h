@@ -32,6 +32,7 @@ public:
 	
 	virtual bool Sniff(BPositionIO *data) const;
 	virtual ssize_t BytesNeeded() const;
+	virtual void AddTo(Matcher& matcher) const;
 	void Add(RPattern *rpattern);
 private:
 	std::vector<RPattern*> fList;
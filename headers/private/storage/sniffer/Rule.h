@@ -36,6 +36,7 @@ public:
 	ssize_t BytesNeeded() const;
 private:
 	friend class Parser;
+	friend class Matcher;
 
 	void Unset();
 	void SetTo(double priority, std::vector<DisjList*>* list);
@@ -0,0 +1,61 @@
+/*
+ * Copyright 2010, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef _SYSTEM_NODE_MONITOR_DEFS_H
+#define _SYSTEM_NODE_MONITOR_DEFS_H
+
+
+#include <NodeMonitor.h>
+#include <TypeConstants.h>
+
+
+/* Layout of the B_BATCHED_EVENTS notification messages.
+ *
+ * The "opcodes" field contains the opcode of every event in the batch, in
+ * order. All other fields are the ones of the single event messages, and
+ * contain one element for every event that has them, in the order of the
+ * events. Which events have a field is defined by the table below; the
+ * kernel writes, and the Storage Kit reads the batches according to it.
+ */
+
+#define NODE_MONITOR_BATCH_OPCODES_FIELD	"opcodes"
+
+#define NODE_MONITOR_OPCODE_MASK(opcode)	(1UL << (opcode))
+#define NODE_MONITOR_ENTRY_OPCODES \
+	(NODE_MONITOR_OPCODE_MASK(B_ENTRY_CREATED) \
+		| NODE_MONITOR_OPCODE_MASK(B_ENTRY_REMOVED))
+#define NODE_MONITOR_NODE_OPCODES \
+	(NODE_MONITOR_ENTRY_OPCODES | NODE_MONITOR_OPCODE_MASK(B_ENTRY_MOVED) \
+		| NODE_MONITOR_OPCODE_MASK(B_STAT_CHANGED) \
+		| NODE_MONITOR_OPCODE_MASK(B_ATTR_CHANGED))
+
+typedef struct node_monitor_batch_field {
+	const char*	name;
+	type_code	type;
+	uint32		opcodes;	/* mask of the events that have this field */
+} node_monitor_batch_field;
+
+static const node_monitor_batch_field kNodeMonitorBatchFields[] = {
+	{"device", B_INT32_TYPE, NODE_MONITOR_NODE_OPCODES
+		| NODE_MONITOR_OPCODE_MASK(B_DEVICE_MOUNTED)
+		| NODE_MONITOR_OPCODE_MASK(B_DEVICE_UNMOUNTED)},
+	{"new device", B_INT32_TYPE, NODE_MONITOR_OPCODE_MASK(B_DEVICE_MOUNTED)},
+	{"node device", B_INT32_TYPE, NODE_MONITOR_OPCODE_MASK(B_ENTRY_MOVED)},
+	{"directory", B_INT64_TYPE, NODE_MONITOR_ENTRY_OPCODES
+		| NODE_MONITOR_OPCODE_MASK(B_DEVICE_MOUNTED)},
+	{"from directory", B_INT64_TYPE, NODE_MONITOR_OPCODE_MASK(B_ENTRY_MOVED)},
+	{"to directory", B_INT64_TYPE, NODE_MONITOR_OPCODE_MASK(B_ENTRY_MOVED)},
+	{"node", B_INT64_TYPE, NODE_MONITOR_NODE_OPCODES},
+	{"name", B_STRING_TYPE, NODE_MONITOR_ENTRY_OPCODES
+		| NODE_MONITOR_OPCODE_MASK(B_ENTRY_MOVED)},
+	{"from name", B_STRING_TYPE, NODE_MONITOR_OPCODE_MASK(B_ENTRY_MOVED)},
+	{"fields", B_INT32_TYPE, NODE_MONITOR_OPCODE_MASK(B_STAT_CHANGED)},
+	{"attr", B_STRING_TYPE, NODE_MONITOR_OPCODE_MASK(B_ATTR_CHANGED)},
+	{"cause", B_INT32_TYPE, NODE_MONITOR_OPCODE_MASK(B_ATTR_CHANGED)},
+};
+
+#define NODE_MONITOR_BATCH_FIELD_COUNT \
+	(sizeof(kNodeMonitorBatchFields) / sizeof(kNodeMonitorBatchFields[0]))
+
+#endif	/* _SYSTEM_NODE_MONITOR_DEFS_H */
@@ -33,6 +33,7 @@
 struct ethernet_device : net_device, DoublyLinkedListLinkImpl<ethernet_device> {
 	int		fd;
 	uint32	frame_size;
+	bool	supports_nonblocking;
 };
 
 static const bigtime_t kLinkCheckInterval = 1000000;
@@ -180,6 +181,13 @@ ethernet_up(net_device *_device)
 		device->frame_size = ETHER_MAX_FRAME_SIZE;
 	}
 
+	{
+		// batched receiving needs non-blocking reads (which are optional, too)
+		int32 value = 0;
+		device->supports_nonblocking
+			= ioctl(device->fd, ETHER_NONBLOCK, &value, sizeof(value)) == 0;
+	}
+
 	if (update_link_state(device, false) == B_OK) {
 		// device supports retrieval of the link state
 
@@ -291,14 +299,9 @@ ethernet_send_data(net_device *_device, net_buffer *buffer)
 }
 
 
-status_t
-ethernet_receive_data(net_device *_device, net_buffer **_buffer)
+static status_t
+receive_frame(ethernet_device *device, net_buffer **_buffer)
 {
-	ethernet_device *device = (ethernet_device *)_device;
-
-	if (device->fd == -1)
-		return B_FILE_ERROR;
-
 	// TODO: better header space
 	net_buffer *buffer = gBufferModule->create(256);
 	if (buffer == NULL)
@@ -322,7 +325,8 @@ ethernet_receive_data(net_device *_device, net_buffer **_buffer)
 
 	bytesRead = read(device->fd, data, device->frame_size);
 	if (bytesRead < 0) {
-		device->stats.receive.errors++;
+		if (bytesRead != B_WOULD_BLOCK)
+			device->stats.receive.errors++;
 		status = bytesRead;
 		goto err;
 	}
@@ -345,6 +349,55 @@ err:
 }
 
 
+status_t
+ethernet_receive_data(net_device *_device, net_buffer **_buffer)
+{
+	ethernet_device *device = (ethernet_device *)_device;
+
+	if (device->fd == -1)
+		return B_FILE_ERROR;
+
+	return receive_frame(device, _buffer);
+}
+
+
+/*!	Waits for the first frame to arrive, and then collects all further frames
+	that are already pending in the driver without blocking again.
+*/
+status_t
+ethernet_receive_data_batch(net_device *_device, net_buffer **buffers,
+	uint32 *_count)
+{
+	ethernet_device *device = (ethernet_device *)_device;
+
+	if (device->fd == -1)
+		return B_FILE_ERROR;
+	if (*_count == 0)
+		return B_BAD_VALUE;
+
+	status_t status = receive_frame(device, &buffers[0]);
+	if (status != B_OK)
+		return status;
+
+	uint32 count = 1;
+
+	if (*_count > 1 && device->supports_nonblocking) {
+		int32 value = 1;
+		if (ioctl(device->fd, ETHER_NONBLOCK, &value, sizeof(value)) == 0) {
+			while (count < *_count
+				&& receive_frame(device, &buffers[count]) == B_OK)
+				count++;
+
+			value = 0;
+			ioctl(device->fd, ETHER_NONBLOCK, &value, sizeof(value));
+		}
+	}
+
+	*_count = count;
+	return B_OK;
+}
+
+
 status_t
 ethernet_set_mtu(net_device *_device, size_t mtu)
 {
@@ -474,6 +527,7 @@ net_device_module_info sEthernetModule = {
 	ethernet_set_media,
 	ethernet_add_multicast,
 	ethernet_remove_multicast,
+	ethernet_receive_data_batch,
 };
 
 module_info *modules[] = {
@@ -612,6 +612,8 @@ send_fragments(ipv4_protocol* protocol, struct net_route* route,
 		return originalHeader.Status();
 
 	uint16 headerLength = originalHeader->HeaderLength();
+	bool headerIncluded = protocol != NULL
+		&& (protocol->flags & IP_FLAG_HEADER_INCLUDED) != 0;
 	uint32 bytesLeft = buffer->size - headerLength;
 	uint32 fragmentOffset = 0;
 	status_t status = B_OK;
@@ -636,13 +638,27 @@ send_fragments(ipv4_protocol* protocol, struct net_route* route,
 		bytesLeft -= fragmentLength;
 		bool lastFragment = bytesLeft == 0;
 
-		header->total_length = htons(fragmentLength + headerLength);
-		header->fragment_offset = htons((lastFragment ? 0 : IP_MORE_FRAGMENTS)
+		// only the length and offset differ between the fragments, so we
+		// can just update the checksum of the original header -- unless the
+		// header was supplied by the user, as its checksum cannot be trusted
+		uint16 totalLength = htons(fragmentLength + headerLength);
+		uint16 offset = htons((lastFragment ? 0 : IP_MORE_FRAGMENTS)
 			| (fragmentOffset >> 3));
-		header->checksum = 0;
-		header->checksum = gStackModule->checksum((uint8*)header,
-			headerLength);
-			// TODO: compute the checksum only for those parts that changed?
+
+		if (headerIncluded) {
+			header->total_length = totalLength;
+			header->fragment_offset = offset;
+			header->checksum = 0;
+			header->checksum = gStackModule->checksum((uint8*)header,
+				headerLength);
+		} else {
+			header->checksum = gStackModule->update_checksum(header->checksum,
+				header->total_length, totalLength);
+			header->checksum = gStackModule->update_checksum(header->checksum,
+				header->fragment_offset, offset);
+			header->total_length = totalLength;
+			header->fragment_offset = offset;
+		}
 
 		TRACE("  send fragment of %ld bytes (%ld bytes left)", fragmentLength,
 			bytesLeft);
@@ -1559,8 +1575,11 @@ ipv4_receive_data(net_buffer* buffer)
 		|| headerLength < sizeof(ipv4_header))
 		return B_BAD_DATA;
 
-	// TODO: would be nice to have a direct checksum function somewhere
-	if (gBufferModule->checksum(buffer, 0, headerLength, true) != 0)
+	if (headerLength == sizeof(ipv4_header)) {
+		// the header without options is available to us already
+		if (gStackModule->checksum((uint8*)&header, headerLength) != 0)
+			return B_BAD_DATA;
+	} else if (gBufferModule->checksum(buffer, 0, headerLength, true) != 0)
 		return B_BAD_DATA;
 
 	// lower layers notion of Broadcast or Multicast have no relevance to us
@@ -217,15 +217,24 @@ EndpointHashDefinition::GetLink(TCPEndpoint* endpoint) const
 EndpointManager::EndpointManager(net_domain* domain)
 	:
 	fDomain(domain),
-	fConnectionHash(this),
 	fLastPort(kFirstEphemeralPort)
 {
 	rw_lock_init(&fLock, "TCP endpoint manager");
+
+	for (int32 i = 0; i < CONNECTION_HASH_SHARDS; i++) {
+		rw_lock_init(&fConnectionShards[i].lock, "TCP connection shard");
+		fConnectionShards[i].table = NULL;
+	}
 }
 
 
 EndpointManager::~EndpointManager()
 {
+	for (int32 i = 0; i < CONNECTION_HASH_SHARDS; i++) {
+		delete fConnectionShards[i].table;
+		rw_lock_destroy(&fConnectionShards[i].lock);
+	}
+
 	rw_lock_destroy(&fLock);
 }
 
@@ -233,25 +242,67 @@ EndpointManager::~EndpointManager()
 status_t
 EndpointManager::Init()
 {
-	status_t status = fConnectionHash.Init();
-	if (status == B_OK)
-		status = fEndpointHash.Init();
+	for (int32 i = 0; i < CONNECTION_HASH_SHARDS; i++) {
+		ConnectionTable* table = new(std::nothrow) ConnectionTable(
+			ConnectionHashDefinition(this));
+		if (table == NULL)
+			return B_NO_MEMORY;
 
-	return status;
+		fConnectionShards[i].table = table;
+
+		status_t status = table->Init();
+		if (status != B_OK)
+			return status;
+	}
+
+	return fEndpointHash.Init();
 }
 
 
 //	#pragma mark - connections
 
 
+/*!	Returns the shard of the connection hash that is responsible for the
+	given address pair.
+*/
+EndpointManager::ConnectionShard&
+EndpointManager::_ShardFor(const sockaddr* local, const sockaddr* peer)
+{
+	// the tables use the lower bits of the hash, so we use the upper ones
+	uint32 hash = ConstSocketAddress(AddressModule(), local).HashPair(peer);
+	hash *= 2654435761U;
+	return fConnectionShards[(hash >> 28) & (CONNECTION_HASH_SHARDS - 1)];
+}
+
+
 /*!	Returns the endpoint matching the connection.
-	You must hold the manager's lock when calling this method (either read or
+	You must hold the shard's lock when calling this method (either read or
 	write).
 */
 TCPEndpoint*
-EndpointManager::_LookupConnection(const sockaddr* local, const sockaddr* peer)
+EndpointManager::_LookupConnection(ConnectionShard& shard,
+	const sockaddr* local, const sockaddr* peer)
 {
-	return fConnectionHash.Lookup(std::make_pair(local, peer));
+	return shard.table->Lookup(std::make_pair(local, peer));
+}
+
+
+/*!	Looks up the endpoint matching the connection, and acquires a reference
+	to its socket. Only the lock of the responsible shard is held during the
+	lookup.
+*/
+TCPEndpoint*
+EndpointManager::_AcquireConnection(const sockaddr* local,
+	const sockaddr* peer)
+{
+	ConnectionShard& shard = _ShardFor(local, peer);
+	ReadLocker _(shard.lock);
+
+	TCPEndpoint* endpoint = _LookupConnection(shard, local, peer);
+	if (endpoint != NULL && gSocketModule->acquire_socket(endpoint->socket))
+		return endpoint;
+
+	return NULL;
 }
 
 
@@ -261,6 +312,8 @@ EndpointManager::SetConnection(TCPEndpoint* endpoint, const sockaddr* _local,
 {
 	TRACE(("EndpointManager::SetConnection(%p)\n", endpoint));
 
+	// The local address is also seen by everyone walking the endpoint hash,
+	// so changing it needs the write lock.
 	WriteLocker _(fLock);
 
 	SocketAddressStorage local(AddressModule());
@@ -272,15 +325,17 @@ EndpointManager::SetConnection(TCPEndpoint* endpoint, const sockaddr* _local,
 		local.SetPort(port);
 	}
 
-	if (_LookupConnection(*local, peer) != NULL)
+	ConnectionShard& shard = _ShardFor(*local, peer);
+	WriteLocker shardLocker(shard.lock);
+
+	if (_LookupConnection(shard, *local, peer) != NULL)
 		return EADDRINUSE;
 
 	endpoint->LocalAddress().SetTo(*local);
 	endpoint->PeerAddress().SetTo(peer);
 	T(Connect(endpoint));
 
-	fConnectionHash.Insert(endpoint);
-	return B_OK;
+	return shard.table->Insert(endpoint);
 }
 
 
@@ -302,26 +357,25 @@ EndpointManager::SetPassive(TCPEndpoint* endpoint)
 	SocketAddressStorage passive(AddressModule());
 	passive.SetToEmpty();
 
-	if (_LookupConnection(*endpoint->LocalAddress(), *passive))
+	ConnectionShard& shard = _ShardFor(*endpoint->LocalAddress(), *passive);
+	WriteLocker shardLocker(shard.lock);
+
+	if (_LookupConnection(shard, *endpoint->LocalAddress(), *passive))
 		return EADDRINUSE;
 
 	endpoint->PeerAddress().SetTo(*passive);
-	fConnectionHash.Insert(endpoint);
-	return B_OK;
+	return shard.table->Insert(endpoint);
 }
 
 
 TCPEndpoint*
 EndpointManager::FindConnection(sockaddr* local, sockaddr* peer)
 {
-	ReadLocker _(fLock);
-
-	TCPEndpoint *endpoint = _LookupConnection(local, peer);
+	TCPEndpoint *endpoint = _AcquireConnection(local, peer);
 	if (endpoint != NULL) {
 		TRACE(("TCP: Received packet corresponds to explicit endpoint %p\n",
 			endpoint));
-		if (gSocketModule->acquire_socket(endpoint->socket))
-			return endpoint;
+		return endpoint;
 	}
 
 	// no explicit endpoint exists, check for wildcard endpoints
@@ -329,24 +383,22 @@ EndpointManager::FindConnection(sockaddr* local, sockaddr* peer)
 	SocketAddressStorage wildcard(AddressModule());
 	wildcard.SetToEmpty();
 
-	endpoint = _LookupConnection(local, *wildcard);
+	endpoint = _AcquireConnection(local, *wildcard);
 	if (endpoint != NULL) {
 		TRACE(("TCP: Received packet corresponds to wildcard endpoint %p\n",
 			endpoint));
-		if (gSocketModule->acquire_socket(endpoint->socket))
-			return endpoint;
+		return endpoint;
 	}
 
 	SocketAddressStorage localWildcard(AddressModule());
 	localWildcard.SetToEmpty();
 	localWildcard.SetPort(AddressModule()->get_port(local));
 
-	endpoint = _LookupConnection(*localWildcard, *wildcard);
+	endpoint = _AcquireConnection(*localWildcard, *wildcard);
 	if (endpoint != NULL) {
 		TRACE(("TCP: Received packet corresponds to local wildcard endpoint "
 			"%p\n", endpoint));
-		if (gSocketModule->acquire_socket(endpoint->socket))
-			return endpoint;
+		return endpoint;
 	}
 
 	// no matching endpoint exists
@@ -520,7 +572,12 @@ EndpointManager::Unbind(TCPEndpoint* endpoint)
 	if (!fEndpointHash.Remove(endpoint))
 		panic("bound endpoint %p not in hash!", endpoint);
 
-	fConnectionHash.Remove(endpoint);
+	{
+		ConnectionShard& shard = _ShardFor(*endpoint->LocalAddress(),
+			*endpoint->PeerAddress());
+		WriteLocker shardLocker(shard.lock);
+		shard.table->Remove(endpoint);
+	}
 
 	(*endpoint->LocalAddress())->sa_len = 0;
 
@@ -573,18 +630,25 @@ EndpointManager::Dump() const
 	kprintf("%10s %21s %21s %8s %8s %12s\n", "address", "local", "peer",
 		"recv-q", "send-q", "state");
 
-	ConnectionTable::Iterator iterator = fConnectionHash.GetIterator();
+	for (int32 i = 0; i < CONNECTION_HASH_SHARDS; i++) {
+		if (fConnectionShards[i].table == NULL)
+			continue;
 
-	while (iterator.HasNext()) {
-		TCPEndpoint *endpoint = iterator.Next();
+		ConnectionTable::Iterator iterator
+			= fConnectionShards[i].table->GetIterator();
 
-		char localBuf[64], peerBuf[64];
-		endpoint->LocalAddress().AsString(localBuf, sizeof(localBuf), true);
-		endpoint->PeerAddress().AsString(peerBuf, sizeof(peerBuf), true);
+		while (iterator.HasNext()) {
+			TCPEndpoint *endpoint = iterator.Next();
 
-		kprintf("%p %21s %21s %8lu %8lu %12s\n", endpoint, localBuf, peerBuf,
-			endpoint->fReceiveQueue.Available(), endpoint->fSendQueue.Used(),
-			name_for_state(endpoint->State()));
+			char localBuf[64], peerBuf[64];
+			endpoint->LocalAddress().AsString(localBuf, sizeof(localBuf),
+				true);
+			endpoint->PeerAddress().AsString(peerBuf, sizeof(peerBuf), true);
+
+			kprintf("%p %21s %21s %8lu %8lu %12s\n", endpoint, localBuf,
+				peerBuf, endpoint->fReceiveQueue.Available(),
+				endpoint->fSendQueue.Used(), name_for_state(endpoint->State()));
+		}
 	}
 }
 
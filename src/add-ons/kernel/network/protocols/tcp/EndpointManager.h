@@ -28,6 +28,9 @@ struct net_domain;
 class EndpointManager;
 class TCPEndpoint;
 
+#define CONNECTION_HASH_SHARDS	16
+	// must be a power of two
+
 
 struct ConnectionHashDefinition {
 public:
@@ -95,7 +98,19 @@ public:
 			void			Dump() const;
 
 private:
-			TCPEndpoint*	_LookupConnection(const sockaddr* local,
+	typedef BOpenHashTable<ConnectionHashDefinition> ConnectionTable;
+	typedef MultiHashTable<EndpointHashDefinition> EndpointTable;
+
+	struct ConnectionShard {
+		rw_lock				lock;
+		ConnectionTable*	table;
+	};
+
+			ConnectionShard& _ShardFor(const sockaddr* local,
+								const sockaddr* peer);
+			TCPEndpoint*	_LookupConnection(ConnectionShard& shard,
+								const sockaddr* local, const sockaddr* peer);
+			TCPEndpoint*	_AcquireConnection(const sockaddr* local,
 								const sockaddr* peer);
 			status_t		_Bind(TCPEndpoint* endpoint,
 								const sockaddr* address);
@@ -104,12 +119,12 @@ private:
 			status_t		_BindToEphemeral(TCPEndpoint* endpoint,
 								const sockaddr* address);
 
-	typedef BOpenHashTable<ConnectionHashDefinition> ConnectionTable;
-	typedef MultiHashTable<EndpointHashDefinition> EndpointTable;
-
 	rw_lock					fLock;
+		// protects fEndpointHash, and the local addresses of bound endpoints
 	net_domain*				fDomain;
-	ConnectionTable			fConnectionHash;
+	ConnectionShard			fConnectionShards[CONNECTION_HASH_SHARDS];
+		// each shard has its own lock, so that lookups for incoming
+		// segments never need to acquire fLock
 	EndpointTable			fEndpointHash;
 	uint16					fLastPort;
 };
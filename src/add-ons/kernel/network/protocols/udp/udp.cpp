@@ -16,6 +16,7 @@
 #include <lock.h>
 #include <util/AutoLock.h>
 #include <util/DoublyLinkedList.h>
+#include <util/MultiHashTable.h>
 #include <util/OpenHashTable.h>
 
 #include <KernelExport.h>
@@ -35,6 +36,8 @@
 //      lock before holding a child UdpEndpoint's lock. This restriction
 //      is dictated by the receive path as blind access to the endpoint
 //      hash is required when holding the DomainSupport's lock.
+//      The receive path only read locks the UdpEndpointManager and the
+//      UdpDomainSupport, so incoming datagrams can be delivered in parallel.
 
 
 //#define TRACE_UDP
@@ -98,6 +101,7 @@ public:
 	void					SetActive(bool newValue) { fActive = newValue; }
 
 	UdpEndpoint				*&HashTableLink() { return fLink; }
+	UdpEndpoint				*&PortHashTableLink() { return fPortLink; }
 
 private:
 	UdpDomainSupport		*fManager;
@@ -107,6 +111,7 @@ private:
 								// connected)
 
 	UdpEndpoint				*fLink;
+	UdpEndpoint				*fPortLink;
 };
 
 
@@ -155,6 +160,37 @@ struct UdpHashDefinition {
 };
 
 
+struct UdpPortHashDefinition {
+	typedef uint16 KeyType;
+	typedef UdpEndpoint ValueType;
+
+	size_t HashKey(uint16 port) const
+	{
+		return port;
+	}
+
+	size_t Hash(UdpEndpoint *endpoint) const
+	{
+		return endpoint->LocalAddress().Port();
+	}
+
+	bool Compare(uint16 port, UdpEndpoint *endpoint) const
+	{
+		return endpoint->LocalAddress().Port() == port;
+	}
+
+	bool CompareValues(UdpEndpoint *first, UdpEndpoint *second) const
+	{
+		return first->LocalAddress().Port() == second->LocalAddress().Port();
+	}
+
+	UdpEndpoint *&GetLink(UdpEndpoint *endpoint) const
+	{
+		return endpoint->PortHashTableLink();
+	}
+};
+
+
 class UdpDomainSupport : public DoublyLinkedListLinkImpl<UdpDomainSupport> {
 public:
 	UdpDomainSupport(net_domain *domain);
@@ -181,6 +217,9 @@ private:
 	status_t _BindToEphemeral(UdpEndpoint *endpoint, const sockaddr *address);
 	status_t _FinishBind(UdpEndpoint *endpoint, const sockaddr *address);
 
+	void _Activate(UdpEndpoint *endpoint);
+	void _Deactivate(UdpEndpoint *endpoint);
+
 	UdpEndpoint *_FindActiveEndpoint(const sockaddr *ourAddress,
 		const sockaddr *peerAddress);
 	status_t _DemuxBroadcast(net_buffer *buffer);
@@ -193,11 +232,15 @@ private:
 		{ return fDomain->address_module; }
 
 	typedef BOpenHashTable<UdpHashDefinition, false> EndpointTable;
+	typedef MultiHashTable<UdpPortHashDefinition> PortTable;
 
-	mutex			fLock;
+	rw_lock			fLock;
 	net_domain		*fDomain;
 	uint16			fLastUsedEphemeral;
 	EndpointTable	fActiveEndpoints;
+	PortTable		fActivePorts;
+						// contains the same endpoints as fActiveEndpoints,
+						// but hashed by local port only
 	uint32			fEndpointCount;
 
 	static const uint16		kFirst = 49152;
@@ -229,9 +272,10 @@ public:
 private:
 	UdpDomainSupport *_GetDomain(net_domain *domain, bool create);
 
-	mutex			fLock;
+	rw_lock			fLock;
 	status_t		fStatus;
 	UdpDomainList	fDomains;
+	UdpDomainSupport *fDomainsByFamily[AF_MAX];
 };
 
 
@@ -251,7 +295,7 @@ UdpDomainSupport::UdpDomainSupport(net_domain *domain)
 	fActiveEndpoints(domain->address_module),
 	fEndpointCount(0)
 {
-	mutex_init(&fLock, "udp domain");
+	rw_lock_init(&fLock, "udp domain");
 
 	fLastUsedEphemeral = kFirst + rand() % (kLast - kFirst);
 }
@@ -259,14 +303,18 @@ UdpDomainSupport::UdpDomainSupport(net_domain *domain)
 
 UdpDomainSupport::~UdpDomainSupport()
 {
-	mutex_destroy(&fLock);
+	rw_lock_destroy(&fLock);
 }
 
 
 status_t
 UdpDomainSupport::Init()
 {
-	return fActiveEndpoints.Init(kNumHashBuckets);
+	status_t status = fActiveEndpoints.Init(kNumHashBuckets);
+	if (status == B_OK)
+		status = fActivePorts.Init();
+
+	return status;
 }
 
 
@@ -275,7 +323,7 @@ UdpDomainSupport::DemuxIncomingBuffer(net_buffer *buffer)
 {
 	// NOTE multicast is delivered directly to the endpoint
 
-	MutexLocker _(fLock);
+	ReadLocker _(fLock);
 
 	if (buffer->flags & MSG_BCAST)
 		return _DemuxBroadcast(buffer);
@@ -293,7 +341,7 @@ UdpDomainSupport::BindEndpoint(UdpEndpoint *endpoint,
 	if (!AddressModule()->is_same_family(address))
 		return EAFNOSUPPORT;
 
-	MutexLocker _(fLock);
+	WriteLocker _(fLock);
 
 	if (endpoint->IsActive())
 		return EINVAL;
@@ -306,12 +354,10 @@ status_t
 UdpDomainSupport::ConnectEndpoint(UdpEndpoint *endpoint,
 	const sockaddr *address)
 {
-	MutexLocker _(fLock);
+	WriteLocker _(fLock);
 
-	if (endpoint->IsActive()) {
-		fActiveEndpoints.Remove(endpoint);
-		endpoint->SetActive(false);
-	}
+	if (endpoint->IsActive())
+		_Deactivate(endpoint);
 
 	if (address->sa_family == AF_UNSPEC) {
 		// [Stevens-UNP1, p226]: specifying AF_UNSPEC requests a "disconnect",
@@ -354,12 +400,10 @@ UdpDomainSupport::ConnectEndpoint(UdpEndpoint *endpoint,
 status_t
 UdpDomainSupport::UnbindEndpoint(UdpEndpoint *endpoint)
 {
-	MutexLocker _(fLock);
+	WriteLocker _(fLock);
 
 	if (endpoint->IsActive())
-		fActiveEndpoints.Remove(endpoint);
-
-	endpoint->SetActive(false);
+		_Deactivate(endpoint);
 
 	return B_OK;
 }
@@ -402,10 +446,12 @@ UdpDomainSupport::_Bind(UdpEndpoint *endpoint, const sockaddr *address)
 {
 	int socketOptions = endpoint->Socket()->options;
 
-	EndpointTable::Iterator it = fActiveEndpoints.GetIterator();
+	PortTable::ValueIterator it = fActivePorts.Lookup(
+		AddressModule()->get_port(address));
 
-	// Iterate over all active UDP-endpoints and check if the requested bind
-	// is allowed (see figure 22.24 in [Stevens - TCP2, p735]):
+	// Iterate over all active UDP-endpoints using the same port and check if
+	// the requested bind is allowed (see figure 22.24 in
+	// [Stevens - TCP2, p735]):
 	TRACE_DOMAIN("CheckBindRequest() for %s...", AddressString(fDomain,
 		address, true).Data());
 
@@ -415,19 +461,17 @@ UdpDomainSupport::_Bind(UdpEndpoint *endpoint, const sockaddr *address)
 		TRACE_DOMAIN("  ...checking endpoint %p (port=%u)...", otherEndpoint,
 			ntohs(otherEndpoint->LocalAddress().Port()));
 
-		if (otherEndpoint->LocalAddress().EqualPorts(address)) {
-			// port is already bound, SO_REUSEADDR or SO_REUSEPORT is required:
-			if ((otherEndpoint->Socket()->options
-					& (SO_REUSEADDR | SO_REUSEPORT)) == 0
-				|| (socketOptions & (SO_REUSEADDR | SO_REUSEPORT)) == 0)
-				return EADDRINUSE;
-
-			// if both addresses are the same, SO_REUSEPORT is required:
-			if (otherEndpoint->LocalAddress().EqualTo(address, false)
-				&& ((otherEndpoint->Socket()->options & SO_REUSEPORT) == 0
-					|| (socketOptions & SO_REUSEPORT) == 0))
-				return EADDRINUSE;
-		}
+		// port is already bound, SO_REUSEADDR or SO_REUSEPORT is required:
+		if ((otherEndpoint->Socket()->options
+				& (SO_REUSEADDR | SO_REUSEPORT)) == 0
+			|| (socketOptions & (SO_REUSEADDR | SO_REUSEPORT)) == 0)
+			return EADDRINUSE;
+
+		// if both addresses are the same, SO_REUSEPORT is required:
+		if (otherEndpoint->LocalAddress().EqualTo(address, false)
+			&& ((otherEndpoint->Socket()->options & SO_REUSEPORT) == 0
+				|| (socketOptions & SO_REUSEPORT) == 0))
+			return EADDRINUSE;
 	}
 
 	return _FinishBind(endpoint, address);
@@ -460,10 +504,29 @@ UdpDomainSupport::_FinishBind(UdpEndpoint *endpoint, const sockaddr *address)
 	if (status < B_OK)
 		return status;
 
+	_Activate(endpoint);
+	return B_OK;
+}
+
+
+/*!	Adds the \a endpoint to the hash tables used for demultiplexing.
+	You must hold the write lock when calling this method.
+*/
+void
+UdpDomainSupport::_Activate(UdpEndpoint *endpoint)
+{
 	fActiveEndpoints.Insert(endpoint);
+	fActivePorts.Insert(endpoint);
 	endpoint->SetActive(true);
+}
 
-	return B_OK;
+
+void
+UdpDomainSupport::_Deactivate(UdpEndpoint *endpoint)
+{
+	fActiveEndpoints.Remove(endpoint);
+	fActivePorts.Remove(endpoint);
+	endpoint->SetActive(false);
 }
 
 
@@ -492,7 +555,8 @@ UdpDomainSupport::_DemuxBroadcast(net_buffer *buffer)
 
 	uint16 incomingPort = AddressModule()->get_port(broadcastAddr);
 
-	EndpointTable::Iterator it = fActiveEndpoints.GetIterator();
+	// only endpoints bound to the incoming port are of interest
+	PortTable::ValueIterator it = fActivePorts.Lookup(incomingPort);
 
 	while (it.HasNext()) {
 		UdpEndpoint *endpoint = it.Next();
@@ -500,11 +564,6 @@ UdpDomainSupport::_DemuxBroadcast(net_buffer *buffer)
 		TRACE_DOMAIN("  _DemuxBroadcast(): checking endpoint %s...",
 			AddressString(fDomain, *endpoint->LocalAddress(), true).Data());
 
-		if (endpoint->LocalAddress().Port() != incomingPort) {
-			// ports don't match, so we do not dispatch to this endpoint...
-			continue;
-		}
-
 		if (!endpoint->PeerAddress().IsEmpty(true)) {
 			// endpoint is connected to a specific destination, we check if
 			// this datagram is from there:
@@ -578,8 +637,6 @@ UdpDomainSupport::_GetNextEphemeral()
 	TRACE_DOMAIN("_GetNextEphemeral(), last %hu, curr %hu, stop %hu",
 		fLastUsedEphemeral, curr, stop);
 
-	// TODO: a free list could be used to avoid the impact of these two
-	//        nested loops most of the time... let's see how bad this really is
 	for (; curr != stop; curr = (curr < kLast) ? (curr + 1) : kFirst) {
 		TRACE_DOMAIN("  _GetNextEphemeral(): trying port %hu...", curr);
 
@@ -597,13 +654,9 @@ UdpDomainSupport::_GetNextEphemeral()
 UdpEndpoint *
 UdpDomainSupport::_EndpointWithPort(uint16 port) const
 {
-	EndpointTable::Iterator it = fActiveEndpoints.GetIterator();
-
-	while (it.HasNext()) {
-		UdpEndpoint *endpoint = it.Next();
-		if (endpoint->LocalAddress().Port() == port)
-			return endpoint;
-	}
+	PortTable::ValueIterator it = fActivePorts.Lookup(port);
+	if (it.HasNext())
+		return it.Next();
 
 	return NULL;
 }
@@ -614,14 +667,15 @@ UdpDomainSupport::_EndpointWithPort(uint16 port) const
 
 UdpEndpointManager::UdpEndpointManager()
 {
-	mutex_init(&fLock, "UDP endpoints");
+	rw_lock_init(&fLock, "UDP endpoints");
+	memset(fDomainsByFamily, 0, sizeof(fDomainsByFamily));
 	fStatus = B_OK;
 }
 
 
 UdpEndpointManager::~UdpEndpointManager()
 {
-	mutex_destroy(&fLock);
+	rw_lock_destroy(&fLock);
 }
 
 
@@ -658,18 +712,11 @@ UdpEndpointManager::ReceiveData(net_buffer *buffer)
 
 	net_domain *domain = buffer->interface->domain;
 
-	UdpDomainSupport *domainSupport = NULL;
-
-	{
-		MutexLocker _(fLock);
-		domainSupport = _GetDomain(domain, false);
-		// TODO we don't want to hold to the manager's lock
-		//      during the whole RX path, we may not hold an
-		//      endpoint's lock with the manager lock held.
-		//      But we should increase the domain's refcount
-		//      here.
-	}
+	// We hold the read lock during the whole RX path; it only excludes
+	// creating and deleting domain supports, not other receivers.
+	ReadLocker _(fLock);
 
+	UdpDomainSupport *domainSupport = _GetDomain(domain, false);
 	if (domainSupport == NULL) {
 		// we don't instantiate domain supports in the
 		// RX path as we are only interested in delivering
@@ -748,7 +795,7 @@ UdpEndpointManager::Deframe(net_buffer *buffer)
 UdpDomainSupport *
 UdpEndpointManager::OpenEndpoint(UdpEndpoint *endpoint)
 {
-	MutexLocker _(fLock);
+	WriteLocker _(fLock);
 
 	UdpDomainSupport *domain = _GetDomain(endpoint->Domain(), true);
 	if (domain)
@@ -760,10 +807,11 @@ UdpEndpointManager::OpenEndpoint(UdpEndpoint *endpoint)
 status_t
 UdpEndpointManager::FreeEndpoint(UdpDomainSupport *domain)
 {
-	MutexLocker _(fLock);
+	WriteLocker _(fLock);
 
 	if (domain->Put()) {
 		fDomains.Remove(domain);
+		fDomainsByFamily[domain->Domain()->family] = NULL;
 		delete domain;
 	}
 
@@ -777,31 +825,21 @@ UdpEndpointManager::FreeEndpoint(UdpDomainSupport *domain)
 UdpDomainSupport *
 UdpEndpointManager::_GetDomain(net_domain *domain, bool create)
 {
-	UdpDomainList::Iterator it = fDomains.GetIterator();
-
-	// TODO convert this into a Hashtable or install per-domain
-	//      receiver handlers that forward the requests to the
-	//      appropriate DemuxIncomingBuffer(). For instance, while
-	//      being constructed UdpDomainSupport could call
-	//      register_domain_receiving_protocol() with the right
-	//      family.
-	while (it.HasNext()) {
-		UdpDomainSupport *domainSupport = it.Next();
-		if (domainSupport->Domain() == domain)
-			return domainSupport;
-	}
-
-	if (!create)
+	if (domain->family < 0 || domain->family >= AF_MAX)
 		return NULL;
 
-	UdpDomainSupport *domainSupport =
-		new (std::nothrow) UdpDomainSupport(domain);
+	UdpDomainSupport *domainSupport = fDomainsByFamily[domain->family];
+	if (domainSupport != NULL || !create)
+		return domainSupport;
+
+	domainSupport = new (std::nothrow) UdpDomainSupport(domain);
 	if (domainSupport == NULL || domainSupport->Init() < B_OK) {
 		delete domainSupport;
 		return NULL;
 	}
 
 	fDomains.Add(domainSupport);
+	fDomainsByFamily[domain->family] = domainSupport;
 	return domainSupport;
 }
 
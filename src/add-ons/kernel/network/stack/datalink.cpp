@@ -41,15 +41,20 @@ struct interface_protocol : net_datalink_protocol {
 };
 
 
+#define MAX_RECEIVE_BATCH	16
+
+
 /*!	A service thread for each device interface. It just reads as many packets
-	as availabe, deframes them, and puts them into the receive queue of the
+	as availabe, deframes them, and puts them into the receive queues of the
 	device interface.
+	If the device supports it, several packets are retrieved at once.
 */
 static status_t
 device_reader_thread(void* _interface)
 {
 	net_device_interface* interface = (net_device_interface*)_interface;
 	net_device* device = interface->device;
+	net_buffer* buffers[MAX_RECEIVE_BATCH];
 	status_t status = B_OK;
 
 	RecursiveLocker locker(interface->receive_lock);
@@ -57,27 +62,35 @@ device_reader_thread(void* _interface)
 	while ((device->flags & IFF_UP) != 0) {
 		locker.Unlock();
 
-		net_buffer* buffer;
-		status = device->module->receive_data(device, &buffer);
+		uint32 count = 1;
+		if (device->module->receive_data_batch != NULL) {
+			count = MAX_RECEIVE_BATCH;
+			status = device->module->receive_data_batch(device, buffers,
+				&count);
+		} else
+			status = device->module->receive_data(device, &buffers[0]);
 
 		locker.Lock();
 
 		if (status == B_OK) {
-			// feed device monitors
-			DeviceMonitorList::Iterator iterator =
-				interface->monitor_funcs.GetIterator();
-			while (net_device_monitor* monitor = iterator.Next()) {
-				monitor->receive(monitor, buffer);
-			}
+			for (uint32 i = 0; i < count; i++) {
+				net_buffer* buffer = buffers[i];
+
+				// feed device monitors
+				DeviceMonitorList::Iterator iterator =
+					interface->monitor_funcs.GetIterator();
+				while (net_device_monitor* monitor = iterator.Next()) {
+					monitor->receive(monitor, buffer);
+				}
 
-			buffer->interface = NULL;
-			buffer->type = interface->deframe_func(interface->device, buffer);
-			if (buffer->type < 0) {
-				gNetBufferModule.free(buffer);
-				continue;
+				buffer->interface = NULL;
+				buffer->type = interface->deframe_func(interface->device,
+					buffer);
+				if (buffer->type < 0
+					|| device_interface_enqueue_buffer(interface, buffer)
+						!= B_OK)
+					gNetBufferModule.free(buffer);
 			}
-
-			fifo_enqueue_buffer(&interface->receive_queue, buffer);
 		} else {
 			// In case of error, give the other threads some
 			// time to run since this is a high priority time thread.
@@ -354,8 +367,8 @@ datalink_send_data(struct net_route* route, net_buffer* buffer)
 		// to the domain in interfaces.cpp:device_consumer_thread()
 		buffer->interface = interface;
 		// this one goes back to the domain directly
-		return fifo_enqueue_buffer(
-			&interface->device_interface->receive_queue, buffer);
+		return device_interface_enqueue_buffer(interface->device_interface,
+			buffer);
 	}
 
 	if (route->flags & RTF_GATEWAY) {
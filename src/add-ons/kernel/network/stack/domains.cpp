@@ -316,6 +316,22 @@ domain_interface_went_down(net_interface* interface)
 }
 
 
+/*!	Called when the link state of \a device changed; since the routing
+	decisions depend on the link state, all cached routes are invalidated.
+*/
+void
+domain_device_link_changed(net_device* device)
+{
+	MutexLocker locker(sDomainLock);
+
+	DomainList::Iterator iterator = sDomains.GetIterator();
+	while (net_domain_private* domain = iterator.Next()) {
+		RecursiveLocker locker(domain->lock);
+		invalidate_route_caches(domain);
+	}
+}
+
+
 void
 domain_removed_device_interface(net_device_interface* deviceInterface)
 {
@@ -359,6 +375,13 @@ register_domain(int family, const char* name,
 	domain->module = module;
 	domain->address_module = addressModule;
 
+	status_t status = init_route_caches(domain);
+	if (status != B_OK) {
+		recursive_lock_destroy(&domain->lock);
+		delete domain;
+		return status;
+	}
+
 	list_init(&domain->interfaces);
 
 	sDomains.Add(domain);
@@ -389,6 +412,7 @@ unregister_domain(net_domain* _domain)
 		delete_interface(interface);
 	}
 
+	uninit_route_caches(domain);
 	recursive_lock_destroy(&domain->lock);
 	delete domain;
 	return B_OK;
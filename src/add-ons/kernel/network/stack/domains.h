@@ -16,6 +16,7 @@
 #include "routes.h"
 
 
+struct net_device;
 struct net_device_interface;
 
 
@@ -25,6 +26,10 @@ struct net_domain_private : net_domain,
 
 	RouteList			routes;
 	RouteInfoList		route_infos;
+
+	route_cache*		route_caches;
+	int32				route_cache_count;
+	vint32				route_generation;
 };
 
 
@@ -37,6 +42,7 @@ status_t add_interface_to_domain(net_domain* domain, struct ifreq& request);
 status_t remove_interface_from_domain(net_interface* interface);
 void domain_interface_went_down(net_interface* interface);
 void domain_removed_device_interface(net_device_interface* interface);
+void domain_device_link_changed(struct net_device* device);
 status_t domain_interface_control(net_domain_private* domain, int32 option,
 	struct ifreq* request);
 
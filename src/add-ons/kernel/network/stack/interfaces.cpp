@@ -20,6 +20,7 @@
 #include <KernelExport.h>
 
 #include <net/if_dl.h>
+#include <netinet/in.h>
 #include <new>
 #include <stdio.h>
 #include <stdlib.h>
@@ -36,54 +37,106 @@
 #define ENABLE_DEBUGGER_COMMANDS	1
 
 
+#define MAX_CONSUMER_BATCH		16
+#define RECEIVE_QUEUE_SIZE		(16 * 1024 * 1024)
+
+
 static mutex sInterfaceLock;
 static DeviceInterfaceList sInterfaces;
 static uint32 sInterfaceIndex;
 static uint32 sDeviceIndex;
 
 
+static void
+deliver_buffer(net_device_interface* interface, net_buffer* buffer)
+{
+	if (buffer->interface != NULL) {
+		// if the interface is already specified, this buffer was
+		// delivered locally.
+		if (buffer->interface->domain->module->receive_data(buffer) == B_OK)
+			return;
+	} else {
+		// find handler for this packet
+		DeviceHandlerList::Iterator iterator =
+			interface->receive_funcs.GetIterator();
+		while (iterator.HasNext()) {
+			net_device_handler* handler = iterator.Next();
+
+			// if the handler returns B_OK, it consumed the buffer
+			if (handler->type == buffer->type
+				&& handler->func(handler->cookie, interface->device,
+					buffer) == B_OK)
+				return;
+		}
+	}
+
+	gNetBufferModule.free(buffer);
+}
+
+
+/*!	One of these threads is running per CPU and device interface; it takes
+	all buffers that are pending in its queue at once, and passes them on to
+	the protocol layer.
+*/
 static status_t
-device_consumer_thread(void* _interface)
+device_consumer_thread(void* _consumer)
 {
-	net_device_interface* interface = (net_device_interface*)_interface;
-	net_device* device = interface->device;
-	net_buffer* buffer;
+	net_device_consumer* consumer = (net_device_consumer*)_consumer;
+	net_device_interface* interface = consumer->interface;
+	net_buffer* buffers[MAX_CONSUMER_BATCH];
 
 	while (true) {
-		ssize_t status = fifo_dequeue_buffer(&interface->receive_queue, 0,
-			B_INFINITE_TIMEOUT, &buffer);
-		if (status == B_INTERRUPTED)
+		ssize_t count = fifo_dequeue_buffers(&consumer->queue, buffers,
+			MAX_CONSUMER_BATCH, B_INFINITE_TIMEOUT);
+		if (count == B_INTERRUPTED)
 			continue;
-		else if (status < B_OK)
+		else if (count < B_OK)
 			break;
 
-		if (buffer->interface != NULL) {
-			// if the interface is already specified, this buffer was
-			// delivered locally.
-			if (buffer->interface->domain->module->receive_data(buffer) == B_OK)
-				buffer = NULL;
-		} else {
-			// find handler for this packet
-			DeviceHandlerList::Iterator iterator =
-				interface->receive_funcs.GetIterator();
-			while (buffer && iterator.HasNext()) {
-				net_device_handler* handler = iterator.Next();
-
-				// if the handler returns B_OK, it consumed the buffer
-				if (handler->type == buffer->type
-					&& handler->func(handler->cookie, device, buffer) == B_OK)
-					buffer = NULL;
-			}
-		}
-
-		if (buffer != NULL)
-			gNetBufferModule.free(buffer);
+		for (ssize_t i = 0; i < count; i++)
+			deliver_buffer(interface, buffers[i]);
 	}
 
 	return B_OK;
 }
 
 
+/*!	Computes a hash value that is identical for all buffers of the same
+	flow, so that they are always processed in order by the same consumer.
+	Only IPv4 is looked at, all other traffic will end up in the first queue.
+*/
+static uint32
+flow_hash(net_buffer* buffer)
+{
+	uint8 header[24];
+	if (buffer->size < 20
+		|| gNetBufferModule.read(buffer, 0, header, 20) != B_OK
+		|| (header[0] >> 4) != 4)
+		return 0;
+
+	uint32 hash = (header[12] << 24 | header[13] << 16 | header[14] << 8
+			| header[15])
+		^ (header[16] << 24 | header[17] << 16 | header[18] << 8
+			| header[19])
+		^ header[9];
+
+	// add the ports of unfragmented TCP and UDP packets
+	size_t headerLength = (header[0] & 0xf) << 2;
+	bool fragmented = (header[6] & 0x3f) != 0 || header[7] != 0;
+	if (!fragmented && (header[9] == IPPROTO_TCP || header[9] == IPPROTO_UDP)
+		&& buffer->size >= headerLength + 4
+		&& gNetBufferModule.read(buffer, headerLength, header + 20, 4)
+			== B_OK) {
+		hash ^= (header[20] << 24 | header[21] << 16 | header[22] << 8
+			| header[23]);
+	}
+
+	hash ^= hash >> 16;
+	hash ^= hash >> 8;
+	return hash;
+}
+
+
 static net_device_interface*
 find_device_interface(const char* name)
 {
@@ -111,6 +164,69 @@ domain_receive_adapter(void* cookie, net_device* device, net_buffer* buffer)
 }
 
 
+static void
+stop_device_consumers(net_device_interface* interface)
+{
+	for (uint32 i = 0; i < interface->consumer_count; i++) {
+		net_device_consumer& consumer = interface->consumers[i];
+
+		uninit_fifo(&consumer.queue);
+		status_t status;
+		wait_for_thread(consumer.thread, &status);
+	}
+
+	interface->consumer_count = 0;
+}
+
+
+/*!	Starts one consumer thread per CPU (up to MAX_DEVICE_CONSUMERS) for the
+	given interface; each of them has its own receive queue.
+*/
+static status_t
+start_device_consumers(net_device_interface* interface)
+{
+	system_info info;
+	get_system_info(&info);
+
+	uint32 count = max_c(1, min_c(info.cpu_count, MAX_DEVICE_CONSUMERS));
+	interface->consumer_count = 0;
+
+	for (uint32 i = 0; i < count; i++) {
+		net_device_consumer& consumer = interface->consumers[i];
+		consumer.interface = interface;
+
+		char name[128];
+		snprintf(name, sizeof(name), "%s receive queue %" B_PRIu32,
+			interface->device->name, i);
+
+		status_t status = init_fifo(&consumer.queue, name,
+			RECEIVE_QUEUE_SIZE / count);
+		if (status < B_OK) {
+			stop_device_consumers(interface);
+			return status;
+		}
+
+		snprintf(name, sizeof(name), "%s consumer %" B_PRIu32,
+			interface->device->name, i);
+
+		consumer.thread = spawn_kernel_thread(device_consumer_thread, name,
+			B_DISPLAY_PRIORITY, &consumer);
+		if (consumer.thread < B_OK) {
+			uninit_fifo(&consumer.queue);
+			stop_device_consumers(interface);
+			return consumer.thread;
+		}
+
+		interface->consumer_count++;
+	}
+
+	for (uint32 i = 0; i < count; i++)
+		resume_thread(interface->consumers[i].thread);
+
+	return B_OK;
+}
+
+
 static net_device_interface*
 allocate_device_interface(net_device* device, net_device_module_info* module)
 {
@@ -120,26 +236,18 @@ allocate_device_interface(net_device* device, net_device_module_info* module)
 
 	recursive_lock_init(&interface->receive_lock, "interface receive lock");
 
-	char name[128];
-	snprintf(name, sizeof(name), "%s receive queue", device->name);
-
-	if (init_fifo(&interface->receive_queue, name, 16 * 1024 * 1024) < B_OK)
-		goto error1;
-
 	interface->device = device;
 	interface->up_count = 0;
 	interface->ref_count = 1;
 	interface->deframe_func = NULL;
 	interface->deframe_ref_count = 0;
+	interface->reader_thread = -1;
 
-	snprintf(name, sizeof(name), "%s consumer", device->name);
-
-	interface->reader_thread   = -1;
-	interface->consumer_thread = spawn_kernel_thread(device_consumer_thread,
-		name, B_DISPLAY_PRIORITY, interface);
-	if (interface->consumer_thread < B_OK)
-		goto error2;
-	resume_thread(interface->consumer_thread);
+	if (start_device_consumers(interface) < B_OK) {
+		recursive_lock_destroy(&interface->receive_lock);
+		delete interface;
+		return NULL;
+	}
 
 	// TODO: proper interface index allocation
 	device->index = ++sDeviceIndex;
@@ -147,14 +255,6 @@ allocate_device_interface(net_device* device, net_device_module_info* module)
 
 	sInterfaces.Add(interface);
 	return interface;
-
-error2:
-	uninit_fifo(&interface->receive_queue);
-error1:
-	recursive_lock_destroy(&interface->receive_lock);
-	delete interface;
-
-	return NULL;
 }
 
 
@@ -236,9 +336,12 @@ dump_device_interface(int argc, char** argv)
 	kprintf("deframe_ref_count: %" B_PRId32 "\n", interface->ref_count);
 	kprintf("monitor_funcs:\n");
 	kprintf("receive_funcs:\n");
-	kprintf("consumer_thread:   %ld\n", interface->consumer_thread);
 	kprintf("receive_lock:      %p\n", &interface->receive_lock);
-	kprintf("receive_queue:     %p\n", &interface->receive_queue);
+	kprintf("consumers:\n");
+	for (uint32 i = 0; i < interface->consumer_count; i++) {
+		kprintf("  thread %ld, queue %p\n", interface->consumers[i].thread,
+			&interface->consumers[i].queue);
+	}
 
 	DeviceMonitorList::Iterator monitorIterator
 		= interface->monitor_funcs.GetIterator();
@@ -525,9 +628,7 @@ put_device_interface(struct net_device_interface* interface)
 		sInterfaces.Remove(interface);
 	}
 
-	uninit_fifo(&interface->receive_queue);
-	status_t status;
-	wait_for_thread(interface->consumer_thread, &status);
+	stop_device_consumers(interface);
 
 	net_device* device = interface->device;
 	const char* moduleName = device->module->info.name;
@@ -643,6 +744,21 @@ down_device_interface(net_device_interface* interface)
 }
 
 
+/*!	Puts the \a buffer into the receive queue of the consumer responsible
+	for its flow.
+*/
+status_t
+device_interface_enqueue_buffer(net_device_interface* interface,
+	net_buffer* buffer)
+{
+	uint32 index = 0;
+	if (interface->consumer_count > 1)
+		index = flow_hash(buffer) % interface->consumer_count;
+
+	return fifo_enqueue_buffer(&interface->consumers[index].queue, buffer);
+}
+
+
 //	#pragma mark - devices stack API
 
 
@@ -830,6 +946,7 @@ unregister_device_monitor(net_device* device, net_device_monitor* monitor)
 status_t
 device_link_changed(net_device* device)
 {
+	domain_device_link_changed(device);
 	notify_link_changed(device);
 	return B_OK;
 }
@@ -878,7 +995,7 @@ device_enqueue_buffer(net_device* device, net_buffer* buffer)
 	if (interface == NULL)
 		return ENODEV;
 
-	status_t status = fifo_enqueue_buffer(&interface->receive_queue, buffer);
+	status_t status = device_interface_enqueue_buffer(interface, buffer);
 
 	put_device_interface(interface);
 	return status;
@@ -26,6 +26,14 @@ typedef DoublyLinkedList<net_device_handler> DeviceHandlerList;
 typedef DoublyLinkedList<net_device_monitor,
 	DoublyLinkedListCLink<net_device_monitor> > DeviceMonitorList;
 
+#define MAX_DEVICE_CONSUMERS	8
+
+struct net_device_consumer {
+	struct net_device_interface* interface;
+	thread_id			thread;
+	net_fifo			queue;
+};
+
 struct net_device_interface : DoublyLinkedListLinkImpl<net_device_interface> {
 	struct net_device*	device;
 	thread_id			reader_thread;
@@ -41,8 +49,9 @@ struct net_device_interface : DoublyLinkedListLinkImpl<net_device_interface> {
 
 	recursive_lock		receive_lock;
 
-	thread_id			consumer_thread;
-	net_fifo			receive_queue;
+	net_device_consumer	consumers[MAX_DEVICE_CONSUMERS];
+	uint32				consumer_count;
+		// received buffers are distributed over the consumers by flow
 };
 
 typedef DoublyLinkedList<net_device_interface> DeviceInterfaceList;
@@ -81,6 +90,8 @@ struct net_device_interface* get_device_interface(uint32 index);
 struct net_device_interface* get_device_interface(const char* name,
 	bool create = true);
 void down_device_interface(net_device_interface* interface);
+status_t device_interface_enqueue_buffer(net_device_interface* interface,
+	net_buffer* buffer);
 
 // devices
 status_t unregister_device_deframer(net_device* device);
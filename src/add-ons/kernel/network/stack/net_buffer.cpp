@@ -132,6 +132,14 @@ struct net_buffer_private : net_buffer {
 		// the current place where we allocate header space (nodes, ...)
 	ancillary_data_container*	ancillary_data;
 
+	struct {
+		uint32					offset;
+		uint32					size;
+		uint16					sum;
+	} data_checksum;
+		// the checksum of the data appended last, computed while copying
+		// it in; only valid if size is not 0
+
 	struct {
 		struct sockaddr_storage	source;
 		struct sockaddr_storage	destination;
@@ -156,6 +164,8 @@ static status_t append_cloned_data(net_buffer* _buffer, net_buffer* _source,
 					uint32 offset, size_t bytes);
 static status_t read_data(net_buffer* _buffer, size_t offset, void* data,
 					size_t size);
+static int32 checksum_data(net_buffer* _buffer, uint32 offset, size_t size,
+					bool finalize);
 
 
 #if ENABLE_STATS
@@ -1042,6 +1052,48 @@ copy_metadata(net_buffer* destination, const net_buffer* source)
 }
 
 
+/*!	Forgets the cached checksum of the buffer's data, if it covers any of the
+	\a size bytes at \a offset. This must be called whenever the data of the
+	buffer might be changed in place.
+*/
+static inline void
+invalidate_data_checksum(net_buffer_private* buffer, size_t offset,
+	size_t size)
+{
+	if (buffer->data_checksum.size != 0
+		&& offset < buffer->data_checksum.offset + buffer->data_checksum.size
+		&& offset + size > buffer->data_checksum.offset)
+		buffer->data_checksum.size = 0;
+}
+
+
+/*!	Adds the checksum \a sum of \a size bytes that have just been appended at
+	\a offset to the buffer's cached checksum. If the cached data does not
+	end there, the cache is started anew.
+*/
+static void
+add_data_checksum(net_buffer_private* buffer, size_t offset, size_t size,
+	uint16 sum)
+{
+	if (buffer->data_checksum.size == 0
+		|| buffer->data_checksum.offset + buffer->data_checksum.size
+			!= offset) {
+		buffer->data_checksum.offset = offset;
+		buffer->data_checksum.size = 0;
+		buffer->data_checksum.sum = 0;
+	}
+
+	// the sum has to be swapped if it starts at an uneven offset relative
+	// to the cached data
+	if (((offset - buffer->data_checksum.offset) & 1) != 0)
+		sum = __swap_int16(sum);
+
+	uint32 total = (uint32)buffer->data_checksum.sum + sum;
+	buffer->data_checksum.sum = (uint16)((total & 0xffff) + (total >> 16));
+	buffer->data_checksum.size += size;
+}
+
+
 //	#pragma mark - module API
 
 
@@ -1074,6 +1126,7 @@ create_buffer(size_t headerSpace)
 	list_add_item(&buffer->buffers, node);
 
 	buffer->ancillary_data = NULL;
+	buffer->data_checksum.size = 0;
 
 	buffer->source = (sockaddr*)&buffer->storage.source;
 	buffer->destination = (sockaddr*)&buffer->storage.destination;
@@ -1349,6 +1402,8 @@ merge_buffer(net_buffer* _buffer, net_buffer* _with, bool after)
 	// in a list, so we can easily clean up, if necessary.
 
 	if (!after) {
+		buffer->data_checksum.offset += with->size;
+
 		// change offset of all nodes already in the buffer
 		data_node* node = NULL;
 		while (true) {
@@ -1430,6 +1485,8 @@ write_data(net_buffer* _buffer, size_t offset, const void* data, size_t size)
 	if (size == 0)
 		return B_OK;
 
+	invalidate_data_checksum(buffer, offset, size);
+
 	// find first node to write into
 	data_node* node = get_node_at_offset(buffer, offset);
 	if (node == NULL)
@@ -1534,6 +1591,7 @@ prepend_size(net_buffer* _buffer, size_t size, void** _contiguousBuffer)
 				size_t headerSpace = MAX_FREE_BUFFER_SIZE;
 				data_header* header = create_data_header(headerSpace);
 				if (header == NULL) {
+					buffer->data_checksum.size = 0;
 					remove_header(buffer, sizePrepended);
 					return B_NO_MEMORY;
 				}
@@ -1587,6 +1645,7 @@ prepend_size(net_buffer* _buffer, size_t size, void** _contiguousBuffer)
 	}
 
 	buffer->size += size;
+	buffer->data_checksum.offset += size;
 
 	SET_PARANOIA_CHECK(PARANOIA_SUSPICIOUS, buffer, &buffer->size,
 		sizeof(buffer->size));
@@ -1715,25 +1774,47 @@ append_size(net_buffer* _buffer, size_t size, void** _contiguousBuffer)
 }
 
 
+/*!	Appends \a size bytes of \a data to the buffer. The checksum of the data
+	is computed while it is copied, so that checksum_data() does not have to
+	touch it again.
+*/
 static status_t
-append_data(net_buffer* buffer, const void* data, size_t size)
+append_data(net_buffer* _buffer, const void* data, size_t size)
 {
+	net_buffer_private* buffer = (net_buffer_private*)_buffer;
 	size_t used = buffer->size;
 
+	if (size == 0)
+		return B_OK;
+
 	void* contiguousBuffer;
 	status_t status = append_size(buffer, size, &contiguousBuffer);
 	if (status < B_OK)
 		return status;
 
+	uint16 sum;
 	if (contiguousBuffer) {
 		if (IS_USER_ADDRESS(data)) {
 			if (user_memcpy(contiguousBuffer, data, size) != B_OK)
 				return B_BAD_ADDRESS;
-		} else
-			memcpy(contiguousBuffer, data, size);
-	} else
-		write_data(buffer, used, data, size);
+			sum = compute_checksum((uint8*)contiguousBuffer, size);
+		} else {
+			sum = compute_checksum_copy((uint8*)contiguousBuffer,
+				(const uint8*)data, size);
+		}
+	} else {
+		status = write_data(buffer, used, data, size);
+		if (status != B_OK)
+			return status;
+		sum = (uint16)checksum_data(buffer, used, size, false);
 
+		// checksum_data() sums relative to the start of the buffer, but
+		// add_data_checksum() expects the sum relative to the data itself
+		if ((used & 1) != 0)
+			sum = __swap_int16(sum);
+	}
+
+	add_data_checksum(buffer, used, size, sum);
 	return B_OK;
 }
 
@@ -1796,6 +1877,11 @@ remove_header(net_buffer* _buffer, size_t bytes)
 		node = (data_node*)list_get_next_item(&buffer->buffers, node);
 	}
 
+	if (bytes <= buffer->data_checksum.offset)
+		buffer->data_checksum.offset -= bytes;
+	else
+		buffer->data_checksum.size = 0;
+
 	buffer->size -= bytes;
 	SET_PARANOIA_CHECK(PARANOIA_SUSPICIOUS, buffer, &buffer->size,
 		sizeof(buffer->size));
@@ -1836,6 +1922,8 @@ trim_data(net_buffer* _buffer, size_t newSize)
 	if (newSize == buffer->size)
 		return B_OK;
 
+	invalidate_data_checksum(buffer, newSize, buffer->size - newSize);
+
 	data_node* node = get_node_at_offset(buffer, newSize);
 	if (node == NULL) {
 		// trim size greater than buffer size
@@ -1891,6 +1979,9 @@ append_cloned_data(net_buffer* _buffer, net_buffer* _source, uint32 offset,
 	if (source->size < offset + bytes || source->size < offset)
 		return B_BAD_VALUE;
 
+	// the data is shared from now on, and could be changed through the clone
+	invalidate_data_checksum(source, offset, bytes);
+
 	// find data_node to start with from the source buffer
 	data_node* node = get_node_at_offset(source, offset);
 	if (node == NULL) {
@@ -2021,18 +2112,22 @@ direct_access(net_buffer* _buffer, uint32 offset, size_t size,
 	if (size > node->used - offset)
 		return B_ERROR;
 
+	// the caller might change the data
+	invalidate_data_checksum(buffer, node->offset + offset, size);
+
 	*_contiguousBuffer = node->start + offset;
 	return B_OK;
 }
 
 
-static int32
-checksum_data(net_buffer* _buffer, uint32 offset, size_t size, bool finalize)
+/*!	Adds the one's complement sum of the \a size bytes at \a offset to
+	\a sum; the data may span any number of nodes.
+*/
+static status_t
+sum_data(net_buffer_private* buffer, uint32 offset, size_t size, uint32& sum)
 {
-	net_buffer_private* buffer = (net_buffer_private*)_buffer;
-
-	if (offset + size > buffer->size || size == 0)
-		return B_BAD_VALUE;
+	if (size == 0)
+		return B_OK;
 
 	// find first node to read from
 	data_node* node = get_node_at_offset(buffer, offset);
@@ -2044,7 +2139,6 @@ checksum_data(net_buffer* _buffer, uint32 offset, size_t size, bool finalize)
 	// Since the maximum buffer size is 65536 bytes, it's impossible
 	// to overlap 32 bit - we don't need to handle this overlap in
 	// the loop, we can safely do it afterwards
-	uint32 sum = 0;
 
 	while (true) {
 		size_t bytes = min_c(size, node->used - offset);
@@ -2065,6 +2159,43 @@ checksum_data(net_buffer* _buffer, uint32 offset, size_t size, bool finalize)
 			return B_ERROR;
 	}
 
+	return B_OK;
+}
+
+
+static int32
+checksum_data(net_buffer* _buffer, uint32 offset, size_t size, bool finalize)
+{
+	net_buffer_private* buffer = (net_buffer_private*)_buffer;
+
+	if (offset + size > buffer->size || size == 0)
+		return B_BAD_VALUE;
+
+	uint32 sum = 0;
+	status_t status;
+
+	uint32 cachedOffset = buffer->data_checksum.offset;
+	uint32 cachedEnd = cachedOffset + buffer->data_checksum.size;
+
+	if (buffer->data_checksum.size != 0 && offset <= cachedOffset
+		&& offset + size >= cachedEnd) {
+		// we only need to look at the data around the cached part
+		if ((cachedOffset & 1) != 0)
+			sum = __swap_int16(buffer->data_checksum.sum);
+		else
+			sum = buffer->data_checksum.sum;
+
+		status = sum_data(buffer, offset, cachedOffset - offset, sum);
+		if (status == B_OK) {
+			status = sum_data(buffer, cachedEnd, offset + size - cachedEnd,
+				sum);
+		}
+	} else
+		status = sum_data(buffer, offset, size, sum);
+
+	if (status != B_OK)
+		return status;
+
 	while (sum >> 16) {
 		sum = (sum & 0xffff) + (sum >> 16);
 	}
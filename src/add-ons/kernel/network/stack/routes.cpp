@@ -17,6 +17,7 @@
 #include <NetUtilities.h>
 
 #include <lock.h>
+#include <smp.h>
 #include <util/AutoLock.h>
 
 #include <KernelExport.h>
@@ -36,6 +37,8 @@
 #	define TRACE(x) ;
 #endif
 
+#define MAX_MULTIPATH_ROUTES	8
+
 
 net_route_private::net_route_private()
 {
@@ -154,8 +157,45 @@ find_route(struct net_domain* _domain, const net_route* description)
 }
 
 
+/*!	Folds the high bits of an address \a hash into its low bits. The address
+	modules just combine the addresses and ports in network byte order, so
+	on little endian machines, reducing their hashes to a small range would
+	only look at the first byte of the address, which rarely differs.
+*/
+static inline uint32
+mix_hash(uint32 hash)
+{
+	hash ^= hash >> 16;
+	hash ^= hash >> 8;
+	return hash;
+}
+
+
+/*!	Returns whether or not \a a and \a b can be used interchangeably to
+	reach a destination both of them match.
+*/
+static bool
+is_equal_cost_route(net_domain_private* domain, net_route_private* a,
+	net_route_private* b)
+{
+	if (((a->flags | b->flags) & (RTF_HOST | RTF_LOCAL)) != 0
+		|| (a->flags & RTF_DEFAULT) != (b->flags & RTF_DEFAULT))
+		return false;
+
+	return domain->address_module->first_mask_bit(a->mask)
+			== domain->address_module->first_mask_bit(b->mask)
+		&& a->interface->device->link_speed
+			== b->interface->device->link_speed;
+}
+
+
+/*!	Finds the most specific route to \a address. If there are several equal
+	cost routes to the destination, \a flowHash decides which one is used;
+	\a _multipath is set accordingly.
+*/
 static net_route_private*
-find_route(net_domain* _domain, const sockaddr* address)
+find_route(net_domain* _domain, const sockaddr* address, uint32 flowHash = 0,
+	bool* _multipath = NULL)
 {
 	net_domain_private* domain = (net_domain_private*)_domain;
 
@@ -163,12 +203,12 @@ find_route(net_domain* _domain, const sockaddr* address)
 
 	RouteList::Iterator iterator = domain->routes.GetIterator();
 	net_route_private* candidate = NULL;
+	net_route_private* routes[MAX_MULTIPATH_ROUTES];
+	uint32 count = 0;
 
 	TRACE(("test address %s for routes...\n",
 		AddressString(domain, address).Data()));
 
-	// TODO: alternate equal default routes
-
 	while (iterator.HasNext()) {
 		net_route_private* route = iterator.Next();
 
@@ -193,13 +233,27 @@ find_route(net_domain* _domain, const sockaddr* address)
 			continue;
 		}
 
+		// the routes are sorted by the completeness of their mask, so any
+		// other equal cost route must follow the first match
+		if (count > 0 && !is_equal_cost_route(domain, routes[0], route))
+			break;
+
 		TRACE(("  found route: %s, flags %lx\n",
 			AddressString(domain, route->destination).Data(), route->flags));
 
-		return route;
+		routes[count++] = route;
+		if (count == MAX_MULTIPATH_ROUTES)
+			break;
 	}
 
-	return candidate;
+	if (_multipath != NULL)
+		*_multipath = count > 1;
+
+	if (count == 0)
+		return candidate;
+
+	// spread the flows over all equal cost routes
+	return routes[mix_hash(flowHash) % count];
 }
 
 
@@ -219,7 +273,8 @@ put_route_internal(struct net_domain_private* domain, net_route* _route)
 
 static struct net_route*
 get_route_internal(struct net_domain_private* domain,
-	const struct sockaddr* address)
+	const struct sockaddr* address, uint32 flowHash = 0,
+	bool* _multipath = NULL)
 {
 	ASSERT_LOCKED_RECURSIVE(&domain->lock);
 	net_route_private* route = NULL;
@@ -243,7 +298,7 @@ get_route_internal(struct net_domain_private* domain,
 				break;
 		}
 	} else
-		route = find_route(domain, address);
+		route = find_route(domain, address, flowHash, _multipath);
 
 	if (route != NULL && atomic_add(&route->ref_count, 1) == 0) {
 		// route has been deleted already
@@ -254,6 +309,107 @@ get_route_internal(struct net_domain_private* domain,
 }
 
 
+/*!	Computes the destination cache key of \a address, ie. the address
+	without its port, and its hash.
+	Returns \c false if \a address cannot be cached.
+*/
+static bool
+route_cache_key(net_domain_private* domain, const sockaddr* address,
+	sockaddr_storage& key, uint32& hash)
+{
+	if (domain->route_caches == NULL || address == NULL
+		|| address->sa_family == AF_LINK
+		|| address->sa_len > sizeof(sockaddr_storage))
+		return false;
+
+	memcpy(&key, address, address->sa_len);
+	domain->address_module->set_port((sockaddr*)&key, 0);
+
+	hash = mix_hash(domain->address_module->hash_address_pair(NULL,
+		(sockaddr*)&key));
+	return true;
+}
+
+
+/*!	Looks up \a address in the destination cache of the current CPU, and
+	returns the cached route with a reference acquired, or \c NULL in case
+	the cache has no valid entry for it.
+	If \a source is not \c NULL, it is updated to the address of the route's
+	interface.
+*/
+static net_route_private*
+lookup_cached_route(net_domain_private* domain, const sockaddr* address,
+	uint32 flowHash, sockaddr* source)
+{
+	sockaddr_storage key;
+	uint32 hash;
+	if (!route_cache_key(domain, address, key, hash))
+		return NULL;
+
+	route_cache& cache = domain->route_caches[
+		smp_get_current_cpu() % domain->route_cache_count];
+	route_cache_entry& entry = cache.entries[hash % ROUTE_CACHE_SIZE];
+
+	MutexLocker locker(cache.lock);
+
+	if (entry.route == NULL || entry.generation != domain->route_generation
+		|| (entry.multipath && entry.flow_hash != flowHash)
+		|| !domain->address_module->equal_addresses(
+			(sockaddr*)&entry.destination, (sockaddr*)&key))
+		return NULL;
+
+	if (source != NULL && entry.source.ss_len != 0
+		&& domain->address_module->update_to(source,
+			(sockaddr*)&entry.source) != B_OK)
+		return NULL;
+
+	// The route cannot go away while we hold the cache lock, as it is
+	// removed from the table before the generation is changed.
+	net_route_private* route = entry.route;
+	atomic_add(&route->ref_count, 1);
+
+	return route;
+}
+
+
+/*!	Stores \a route in the destination cache of the current CPU. The cache
+	does not own a reference to the route, its entries are invalidated by
+	invalidate_route_caches() instead.
+	You must hold the domain lock when calling this function.
+*/
+static void
+cache_route(net_domain_private* domain, const sockaddr* address,
+	uint32 flowHash, bool multipath, net_route_private* route)
+{
+	ASSERT_LOCKED_RECURSIVE(&domain->lock);
+
+	sockaddr_storage key;
+	uint32 hash;
+	if (!route_cache_key(domain, address, key, hash))
+		return;
+
+	route_cache& cache = domain->route_caches[
+		smp_get_current_cpu() % domain->route_cache_count];
+	route_cache_entry& entry = cache.entries[hash % ROUTE_CACHE_SIZE];
+
+	MutexLocker locker(cache.lock);
+
+	memcpy(&entry.destination, &key, key.ss_len);
+
+	const sockaddr* source = route->interface != NULL
+		? route->interface->address : NULL;
+	if (source != NULL && source->sa_len <= sizeof(sockaddr_storage))
+		memcpy(&entry.source, source, source->sa_len);
+	else
+		entry.source.ss_len = 0;
+
+	entry.route = route;
+	entry.generation = domain->route_generation;
+	entry.flow_hash = flowHash;
+	entry.multipath = multipath;
+}
+
+
 static void
 update_route_infos(struct net_domain_private* domain)
 {
@@ -300,6 +456,72 @@ fill_route_entry(route_entry* target, void* _buffer, size_t bufferSize,
 //	#pragma mark - exported functions
 
 
+status_t
+init_route_caches(net_domain_private* domain)
+{
+	domain->route_caches = NULL;
+	domain->route_cache_count = 0;
+	domain->route_generation = 1;
+
+	if (domain->address_module == NULL
+		|| domain->address_module->set_port == NULL
+		|| domain->address_module->hash_address_pair == NULL) {
+		// this domain does not support routing
+		return B_OK;
+	}
+
+	int32 count = smp_get_num_cpus();
+
+	domain->route_caches = new(std::nothrow) route_cache[count];
+	if (domain->route_caches == NULL)
+		return B_NO_MEMORY;
+
+	for (int32 i = 0; i < count; i++) {
+		route_cache& cache = domain->route_caches[i];
+		mutex_init(&cache.lock, "route cache");
+
+		for (int32 j = 0; j < ROUTE_CACHE_SIZE; j++)
+			cache.entries[j].route = NULL;
+	}
+
+	domain->route_cache_count = count;
+	return B_OK;
+}
+
+
+void
+uninit_route_caches(net_domain_private* domain)
+{
+	for (int32 i = 0; i < domain->route_cache_count; i++)
+		mutex_destroy(&domain->route_caches[i].lock);
+
+	delete[] domain->route_caches;
+	domain->route_caches = NULL;
+	domain->route_cache_count = 0;
+}
+
+
+/*!	Invalidates all cached routes of the \a domain. When this function
+	returns, no route lookup will use a route from before the call anymore,
+	and it is safe to remove routes from the routing table.
+	You must hold the domain lock when calling this function, so that no
+	route that was looked up before can be cached with the new generation.
+*/
+void
+invalidate_route_caches(net_domain_private* domain)
+{
+	ASSERT_LOCKED_RECURSIVE(&domain->lock);
+
+	atomic_add(&domain->route_generation, 1);
+
+	// wait for lookups that might still use the previous generation
+	for (int32 i = 0; i < domain->route_cache_count; i++) {
+		mutex_lock(&domain->route_caches[i].lock);
+		mutex_unlock(&domain->route_caches[i].lock);
+	}
+}
+
+
 /*!	Determines the size of a buffer large enough to contain the whole
 	routing table.
 */
@@ -509,6 +731,7 @@ add_route(struct net_domain* _domain, const struct net_route* newRoute)
 	}
 
 	domain->routes.Insert(before, route);
+	invalidate_route_caches(domain);
 	update_route_infos(domain);
 
 	return B_OK;
@@ -534,6 +757,7 @@ remove_route(struct net_domain* _domain, const struct net_route* removeRoute)
 		return B_ENTRY_NOT_FOUND;
 
 	domain->routes.Remove(route);
+	invalidate_route_caches(domain);
 
 	put_route_internal(domain, route);
 	update_route_infos(domain);
@@ -596,9 +820,26 @@ struct net_route*
 get_route(struct net_domain* _domain, const struct sockaddr* address)
 {
 	struct net_domain_private* domain = (net_domain_private*)_domain;
+
+	uint32 flowHash = 0;
+	if (domain->route_caches != NULL) {
+		flowHash = domain->address_module->hash_address_pair(NULL, address);
+
+		net_route_private* route = lookup_cached_route(domain, address,
+			flowHash, NULL);
+		if (route != NULL)
+			return route;
+	}
+
 	RecursiveLocker locker(domain->lock);
 
-	return get_route_internal(domain, address);
+	bool multipath = false;
+	net_route_private* route = (net_route_private*)get_route_internal(domain,
+		address, flowHash, &multipath);
+	if (route != NULL)
+		cache_route(domain, address, flowHash, multipath, route);
+
+	return route;
 }
 
 
@@ -633,9 +874,24 @@ get_buffer_route(net_domain* _domain, net_buffer* buffer, net_route** _route)
 {
 	net_domain_private* domain = (net_domain_private*)_domain;
 
+	uint32 flowHash = 0;
+	if (domain->route_caches != NULL) {
+		flowHash = domain->address_module->hash_address_pair(buffer->source,
+			buffer->destination);
+
+		net_route_private* route = lookup_cached_route(domain,
+			buffer->destination, flowHash, buffer->source);
+		if (route != NULL) {
+			*_route = route;
+			return B_OK;
+		}
+	}
+
 	RecursiveLocker _(domain->lock);
 
-	net_route* route = get_route_internal(domain, buffer->destination);
+	bool multipath = false;
+	net_route* route = get_route_internal(domain, buffer->destination,
+		flowHash, &multipath);
 	if (route == NULL)
 		return ENETUNREACH;
 
@@ -652,20 +908,27 @@ get_buffer_route(net_domain* _domain, net_buffer* buffer, net_route** _route)
 
 	if (status != B_OK)
 		put_route_internal(domain, route);
-	else
+	else {
+		cache_route(domain, buffer->destination, flowHash, multipath,
+			(net_route_private*)route);
 		*_route = route;
+	}
 
 	return status;
 }
 
 
 void
-put_route(struct net_domain* _domain, net_route* route)
+put_route(struct net_domain* _domain, net_route* _route)
 {
-	struct net_domain_private* domain = (net_domain_private*)_domain;
-	RecursiveLocker locker(domain->lock);
+	// A route is only deleted after it has been removed from the routing
+	// table, and the cache has been invalidated, so we can safely release
+	// the reference without holding the domain lock.
+	net_route_private* route = (net_route_private*)_route;
+	if (route == NULL || atomic_add(&route->ref_count, -1) != 1)
+		return;
 
-	put_route_internal(domain, (net_route*)route);
+	delete route;
 }
 
 
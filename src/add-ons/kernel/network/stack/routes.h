@@ -1,5 +1,5 @@
 /*
- * Copyright 2006-2009, Haiku, Inc. All Rights Reserved.
+ * Copyright 2006-2010, Haiku, Inc. All Rights Reserved.
  * Distributed under the terms of the MIT License.
  *
  * Authors:
@@ -12,9 +12,14 @@
 #include <net_datalink.h>
 #include <net_stack.h>
 
+#include <lock.h>
 #include <util/DoublyLinkedList.h>
 
 
+#define ROUTE_CACHE_SIZE	32
+	// number of destinations cached per CPU
+
+
 struct net_route_private
 	: net_route, DoublyLinkedListLinkImpl<net_route_private> {
 	int32	ref_count;
@@ -24,10 +29,29 @@ struct net_route_private
 };
 
 typedef DoublyLinkedList<net_route_private> RouteList;
+
+struct route_cache_entry {
+	sockaddr_storage	destination;
+	sockaddr_storage	source;
+	net_route_private*	route;
+	int32				generation;
+	uint32				flow_hash;
+	bool				multipath;
+};
+
+struct route_cache {
+	mutex				lock;
+	route_cache_entry	entries[ROUTE_CACHE_SIZE];
+};
+
 typedef DoublyLinkedList<net_route_info,
 	DoublyLinkedListCLink<net_route_info> > RouteInfoList;
 
 
+status_t init_route_caches(struct net_domain_private* domain);
+void uninit_route_caches(struct net_domain_private* domain);
+void invalidate_route_caches(struct net_domain_private* domain);
+
 uint32 route_table_size(struct net_domain_private* domain);
 status_t list_routes(struct net_domain_private* domain, void* buffer,
 				size_t size);
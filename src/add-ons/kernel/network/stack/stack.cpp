@@ -926,6 +926,7 @@ net_stack_module_info gNetStackModule = {
 	notify_socket,
 
 	checksum,
+	update_checksum,
 
 	init_fifo,
 	uninit_fifo,
@@ -1,5 +1,5 @@
 /*
- * Copyright 2006-2009, Haiku, Inc. All Rights Reserved.
+ * Copyright 2006-2010, Haiku, Inc. All Rights Reserved.
  * Distributed under the terms of the MIT License.
  *
  * Authors:
@@ -17,6 +17,8 @@
 #include <syscall_restart.h>
 #include <util/AutoLock.h>
 
+#include <string.h>
+
 #include "stack_private.h"
 
 
@@ -154,36 +156,130 @@ UserBuffer::Copy(void* source, size_t length)
 }
 
 
-uint16
-compute_checksum(uint8* _buffer, size_t length)
+static inline uint16
+fold_checksum(uint64 sum)
+{
+	while (sum >> 16) {
+		sum = (sum & 0xffff) + (sum >> 16);
+	}
+
+	return (uint16)sum;
+}
+
+
+static inline uint32
+checksum_tail(const uint8* buffer, size_t length)
 {
-	uint16* buffer = (uint16*)_buffer;
 	uint32 sum = 0;
 
-	// TODO: unfold loop for speed
-	// TODO: write processor dependent version for speed
-	while (length >= 2) {
-		sum += *buffer++;
+	if (length >= 2) {
+		sum += *(const uint16*)buffer;
+		buffer += 2;
 		length -= 2;
 	}
 
 	if (length) {
 		// give the last byte it's proper endian-aware treatment
 #if B_HOST_IS_LENDIAN
-		sum += *(uint8*)buffer;
+		sum += *buffer;
 #else
 		uint8 ordered[2];
-		ordered[0] = *(uint8*)buffer;
+		ordered[0] = *buffer;
 		ordered[1] = 0;
 		sum += *(uint16*)ordered;
 #endif
 	}
 
-	while (sum >> 16) {
-		sum = (sum & 0xffff) + (sum >> 16);
+	return sum;
+}
+
+
+/*!	Computes the one's complement sum of the \a length bytes at \a _buffer.
+	Since 2^16 equals 1 modulo 2^16 - 1, the sum can be computed over whole
+	32 bit words, and only needs to be folded to 16 bits once at the end.
+*/
+uint16
+compute_checksum(uint8* _buffer, size_t length)
+{
+	uint64 sum = 0;
+
+	if (((addr_t)_buffer & 2) != 0 && length >= 2) {
+		// align the buffer to 32 bit
+		sum += *(uint16*)_buffer;
+		_buffer += 2;
+		length -= 2;
 	}
 
-	return sum;
+	const uint32* buffer = (const uint32*)_buffer;
+
+	while (length >= 16) {
+		sum += buffer[0];
+		sum += buffer[1];
+		sum += buffer[2];
+		sum += buffer[3];
+		buffer += 4;
+		length -= 16;
+	}
+
+	while (length >= 4) {
+		sum += *buffer++;
+		length -= 4;
+	}
+
+	sum += checksum_tail((const uint8*)buffer, length);
+	return fold_checksum(sum);
+}
+
+
+/*!	Copies \a length bytes from \a source to \a target, and returns the
+	one's complement sum of the data as computed by compute_checksum().
+	The data only has to be touched once this way.
+*/
+uint16
+compute_checksum_copy(uint8* target, const uint8* source, size_t length)
+{
+	uint64 sum = 0;
+
+	if (((addr_t)source & 2) != 0 && length >= 2) {
+		uint16 value = *(const uint16*)source;
+		*(uint16*)target = value;
+		sum += value;
+		source += 2;
+		target += 2;
+		length -= 2;
+	}
+
+	while (length >= 16) {
+		uint32 a = ((const uint32*)source)[0];
+		uint32 b = ((const uint32*)source)[1];
+		uint32 c = ((const uint32*)source)[2];
+		uint32 d = ((const uint32*)source)[3];
+		((uint32*)target)[0] = a;
+		((uint32*)target)[1] = b;
+		((uint32*)target)[2] = c;
+		((uint32*)target)[3] = d;
+		sum += a;
+		sum += b;
+		sum += c;
+		sum += d;
+		source += 16;
+		target += 16;
+		length -= 16;
+	}
+
+	while (length >= 4) {
+		uint32 value = *(const uint32*)source;
+		*(uint32*)target = value;
+		sum += value;
+		source += 4;
+		target += 4;
+		length -= 4;
+	}
+
+	memcpy(target, source, length);
+	sum += checksum_tail(source, length);
+
+	return fold_checksum(sum);
 }
 
 
@@ -194,6 +290,18 @@ checksum(uint8* buffer, size_t length)
 }
 
 
+/*!	Updates the Internet \a checksum of some data after one of its 16 bit
+	words has been changed from \a oldValue to \a newValue, as described in
+	RFC 1624. All values are expected in network byte order.
+*/
+uint16
+update_checksum(uint16 checksum, uint16 oldValue, uint16 newValue)
+{
+	uint32 sum = (uint16)~checksum + (uint16)~oldValue + newValue;
+	return ~fold_checksum(sum);
+}
+
+
 //	#pragma mark - Notifications
 
 
@@ -395,6 +503,48 @@ fifo_dequeue_buffer(net_fifo* fifo, uint32 flags, bigtime_t timeout,
 }
 
 
+/*!	Removes up to \a maxCount buffers from the FIFO at once, and stores them
+	in \a buffers. If the FIFO is empty, it will wait up to \a timeout for
+	a buffer to arrive.
+	Returns the number of buffers retrieved, or an error code.
+*/
+ssize_t
+fifo_dequeue_buffers(net_fifo* fifo, net_buffer** buffers, size_t maxCount,
+	bigtime_t timeout)
+{
+	MutexLocker locker(fifo->lock);
+
+	while (list_is_empty(&fifo->buffers)) {
+		if (timeout == 0)
+			return B_WOULD_BLOCK;
+
+		fifo->waiting++;
+		locker.Unlock();
+
+		// we need to wait until a new buffer becomes available
+		status_t status = acquire_sem_etc(fifo->notify, 1,
+			B_CAN_INTERRUPT | B_RELATIVE_TIMEOUT, timeout);
+		if (status < B_OK)
+			return status;
+
+		locker.Lock();
+	}
+
+	size_t count = 0;
+	while (count < maxCount) {
+		net_buffer* buffer
+			= (net_buffer*)list_remove_head_item(&fifo->buffers);
+		if (buffer == NULL)
+			break;
+
+		fifo->current_bytes -= buffer->size;
+		buffers[count++] = buffer;
+	}
+
+	return count;
+}
+
+
 status_t
 clear_fifo(net_fifo* fifo)
 {
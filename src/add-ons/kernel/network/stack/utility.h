@@ -54,7 +54,10 @@ UserBuffer::ConsumedAmount() const
 
 // checksums
 uint16		compute_checksum(uint8* _buffer, size_t length);
+uint16		compute_checksum_copy(uint8* target, const uint8* source,
+				size_t length);
 uint16		checksum(uint8* buffer, size_t length);
+uint16		update_checksum(uint16 checksum, uint16 oldValue, uint16 newValue);
 
 // notifications
 status_t	notify_socket(net_socket* socket, uint8 event, int32 value);
@@ -65,6 +68,8 @@ void		uninit_fifo(net_fifo* fifo);
 status_t	fifo_enqueue_buffer(net_fifo* fifo, struct net_buffer* buffer);
 ssize_t		fifo_dequeue_buffer(net_fifo* fifo, uint32 flags, bigtime_t timeout,
 				struct net_buffer** _buffer);
+ssize_t		fifo_dequeue_buffers(net_fifo* fifo, struct net_buffer** buffers,
+				size_t maxCount, bigtime_t timeout);
 status_t	clear_fifo(net_fifo* fifo);
 status_t	fifo_socket_enqueue_buffer(net_fifo* fifo, net_socket* socket,
 				uint8 event, net_buffer* buffer);
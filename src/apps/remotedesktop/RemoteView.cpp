@@ -1,5 +1,5 @@
 /*
- * Copyright 2009, Haiku, Inc.
+ * Copyright 2009-2010, Haiku, Inc.
  * Distributed under the terms of the MIT License.
  *
  * Authors:
@@ -20,6 +20,7 @@
 #include <Region.h>
 #include <Shape.h>
 #include <Window.h>
+#include <utf8_functions.h>
 
 #include <new>
 #include <stdio.h>
@@ -71,7 +72,9 @@ RemoteView::RemoteView(BRect frame, uint16 listenPort)
 	fCursorBitmap(NULL),
 	fCursorVisible(false)
 {
-	fReceiveBuffer = new(std::nothrow) StreamingRingBuffer(16 * 1024);
+	memset(fBitmapCache, 0, sizeof(fBitmapCache));
+
+	fReceiveBuffer = new(std::nothrow) StreamingRingBuffer(256 * 1024);
 	if (fReceiveBuffer == NULL) {
 		fInitStatus = B_NO_MEMORY;
 		return;
@@ -166,6 +169,8 @@ RemoteView::~RemoteView()
 
 	int32 result;
 	wait_for_thread(fDrawThread, &result);
+
+	_EmptyBitmapCache();
 }
 
 
@@ -480,6 +485,9 @@ RemoteView::_DrawThread()
 					continue;
 				}
 
+				// the server starts out with an empty bitmap cache as well
+				_EmptyBitmapCache();
+
 				BRect bounds = fOffscreenBitmap->Bounds();
 				reply.Start(RP_UPDATE_DISPLAY_MODE);
 				reply.Add(bounds.IntegerWidth() + 1);
@@ -755,20 +763,52 @@ RemoteView::_DrawThread()
 			}
 
 			case RP_DRAW_BITMAP:
+			case RP_DRAW_CACHED_BITMAP:
 			{
 				BBitmap *bitmap;
 				BRect bitmapRect, viewRect;
 				uint32 options;
+				int32 slot;
 
 				message.Read(bitmapRect);
 				message.Read(viewRect);
 				message.Read(options);
-				if (message.ReadBitmap(&bitmap) != B_OK || bitmap == NULL)
+				if (message.Read(slot) != B_OK)
 					continue;
 
+				bool validSlot = slot >= 0
+					&& slot < RemoteBitmapCache::kSlotCount;
+
+				if (code == RP_DRAW_CACHED_BITMAP) {
+					if (!validSlot || fBitmapCache[slot] == NULL) {
+						TRACE_ERROR("invalid cached bitmap %ld\n", slot);
+						continue;
+					}
+
+					bitmap = fBitmapCache[slot];
+				} else {
+					if (message.ReadBitmap(&bitmap) != B_OK || bitmap == NULL) {
+						// the server assumes the slot holds this bitmap now,
+						// so don't keep drawing the previous one from it
+						if (validSlot) {
+							delete fBitmapCache[slot];
+							fBitmapCache[slot] = NULL;
+						}
+						continue;
+					}
+				}
+
 				offscreen->DrawBitmap(bitmap, bitmapRect, viewRect, options);
 				invalidRegion.Include(viewRect);
-				delete bitmap;
+
+				if (code == RP_DRAW_BITMAP) {
+					if (validSlot) {
+						// keep it, the server may draw it again
+						delete fBitmapCache[slot];
+						fBitmapCache[slot] = bitmap;
+					} else
+						delete bitmap;
+				}
 				break;
 			}
 
@@ -1184,10 +1224,9 @@ RemoteView::_DrawThread()
 					offscreen->DrawString(string, point);
 
 				free(string);
-				reply.Start(RP_DRAW_STRING_RESULT);
-				reply.Add(token);
-				reply.Add(offscreen->PenLocation());
-				reply.Flush();
+
+				// the server computes the pen location itself, there is
+				// no need for a reply
 
 				font_height height;
 				offscreen->GetFontHeight(&height);
@@ -1199,6 +1238,42 @@ RemoteView::_DrawThread()
 				break;
 			}
 
+			case RP_DRAW_STRING_WITH_OFFSETS:
+			{
+				size_t length;
+				char *string;
+				message.ReadString(&string, length);
+				int32 count = UTF8CountChars(string, length);
+				if (count <= 0) {
+					free(string);
+					continue;
+				}
+
+				BPoint offsets[count];
+				if (message.ReadList(offsets, count) != B_OK) {
+					free(string);
+					continue;
+				}
+
+				offscreen->DrawString(string, offsets, count);
+				free(string);
+
+				font_height height;
+				offscreen->GetFontHeight(&height);
+
+				BFont font;
+				offscreen->GetFont(&font);
+
+				// the last character can be at most about as wide as the
+				// font size
+				BRect bounds = _BuildInvalidateRect(offsets, count);
+				bounds.top -= height.ascent;
+				bounds.bottom += height.descent;
+				bounds.right += font.Size();
+				invalidRegion.Include(bounds);
+				break;
+			}
+
 			case RP_READ_BITMAP:
 			{
 				BRect bounds;
@@ -1247,3 +1322,13 @@ RemoteView::_BuildInvalidateRect(BPoint *points, int32 pointCount)
 
 	return bounds;
 }
+
+
+void
+RemoteView::_EmptyBitmapCache()
+{
+	for (int32 i = 0; i < RemoteBitmapCache::kSlotCount; i++) {
+		delete fBitmapCache[i];
+		fBitmapCache[i] = NULL;
+	}
+}
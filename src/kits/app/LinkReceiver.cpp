@@ -1,5 +1,5 @@
 /*
- * Copyright 2001-2008, Haiku.
+ * Copyright 2001-2010, Haiku.
  * Distributed under the terms of the MIT License.
  *
  * Authors:
@@ -17,6 +17,7 @@
 #include <string.h>
 #include <new>
 
+#include <LinkRing.h>
 #include <ServerProtocol.h>
 #include <String.h>
 #include <Region.h>
@@ -49,16 +50,18 @@ namespace BPrivate {
 
 LinkReceiver::LinkReceiver(port_id port)
 	:
-	fReceivePort(port), fRecvBuffer(NULL), fRecvPosition(0), fRecvStart(0),
-	fRecvBufferSize(0), fDataSize(0),
-	fReplySize(0), fReadError(B_OK)
+	fReceivePort(port), fRing(NULL), fRecvBuffer(NULL), fPortBuffer(NULL),
+	fRecvPosition(0), fRecvStart(0), fRecvBufferSize(0), fDataSize(0),
+	fReplySize(0), fReadError(B_OK), fReadArea(false), fReadingRing(false)
 {
 }
 
 
 LinkReceiver::~LinkReceiver()
 {
+	ResetBuffer();
 	free(fRecvBuffer);
+	delete fRing;
 }
 
 
@@ -69,10 +72,30 @@ LinkReceiver::SetPort(port_id port)
 }
 
 
+/*!	Lets the receiver read the messages of a LinkSender that writes into
+	\a ring, in addition to those arriving at the port. The receiver takes
+	over ownership of the ring.
+*/
+void
+LinkReceiver::SetRing(LinkRing* ring)
+{
+	if (ring == fRing)
+		return;
+
+	if (fReadingRing) {
+		// the rest of the current batch is lost
+		ResetBuffer();
+	}
+	delete fRing;
+	fRing = ring;
+}
+
+
 status_t
 LinkReceiver::GetNextMessage(int32 &code, bigtime_t timeout)
 {
 	fReadError = B_OK;
+	fReadArea = false;
 
 	int32 remaining = fDataSize - (fRecvStart + fReplySize);
 	STRACE(("info: LinkReceiver GetNextReply() reports %ld bytes remaining in buffer.\n", remaining));
@@ -117,10 +140,25 @@ LinkReceiver::GetNextMessage(int32 &code, bigtime_t timeout)
 
 
 bool
-LinkReceiver::HasMessages() const
+LinkReceiver::HasMessages()
 {
-	return fDataSize - (fRecvStart + fReplySize) > 0
-		|| port_count(fReceivePort) > 0;
+	if (fDataSize - (fRecvStart + fReplySize) > 0)
+		return true;
+
+	if (fRing != NULL) {
+		if (fRing->HasData())
+			return true;
+
+		// Drop doorbells that were rung while we didn't wait; they would
+		// otherwise let the caller block in GetNextMessage()
+		while (port_count(fReceivePort) > 0
+			&& port_buffer_size_etc(fReceivePort, B_RELATIVE_TIMEOUT, 0) == 0) {
+			int32 code;
+			read_port_etc(fReceivePort, &code, NULL, 0, B_RELATIVE_TIMEOUT, 0);
+		}
+	}
+
+	return port_count(fReceivePort) > 0;
 }
 
 
@@ -146,9 +184,36 @@ LinkReceiver::Code() const
 }
 
 
+/*!	Starts reading the current message from its beginning again, so that
+	its data can be read a second time.
+	This is not possible if the message passed data in an area that has
+	already been read, since the area is deleted after reading it.
+*/
+status_t
+LinkReceiver::RewindMessage()
+{
+	if (fReplySize == 0)
+		return B_NO_INIT;
+	if (fReadArea)
+		return B_NOT_ALLOWED;
+
+	fRecvPosition = fRecvStart + sizeof(message_header);
+	fReadError = B_OK;
+	return B_OK;
+}
+
+
 void
 LinkReceiver::ResetBuffer()
 {
+	if (fReadingRing) {
+		// give the space of the messages we just read back to the sender
+		fRing->ReleaseBatch();
+		fRecvBuffer = fPortBuffer;
+		fPortBuffer = NULL;
+		fReadingRing = false;
+	}
+
 	fRecvPosition = 0;
 	fRecvStart = 0;
 	fDataSize = 0;
@@ -217,15 +282,22 @@ LinkReceiver::ReadFromPort(bigtime_t timeout)
 	// we are here so it means we finished reading the buffer contents
 	ResetBuffer();
 
-	status_t err = AdjustReplyBuffer(timeout);
-	if (err < B_OK)
-		return err;
-
 	int32 code;
 	ssize_t bytesRead;
 
 	STRACE(("info: LinkReceiver reading port %ld.\n", fReceivePort));
 	while (true) {
+		if (fRing != NULL) {
+			if (_ReadFromRing())
+				return B_OK;
+			if (!fRing->PrepareToWait())
+				continue;
+		}
+
+		status_t err = AdjustReplyBuffer(timeout);
+		if (err < B_OK)
+			return err;
+
 		if (timeout != B_INFINITE_TIMEOUT) {
 			do {
 				bytesRead = read_port_etc(fReceivePort, &code, fRecvBuffer,
@@ -242,7 +314,8 @@ LinkReceiver::ReadFromPort(bigtime_t timeout)
 		if (bytesRead < B_OK)
 			return bytesRead;
 
-		// we just ignore incorrect messages, and don't bother our caller
+		// we just ignore incorrect messages, and don't bother our caller;
+		// a doorbell means there is new data in the ring
 
 		if (code != kLinkCode) {
 			STRACE(("wrong port message %lx received.\n", code));
@@ -258,6 +331,25 @@ LinkReceiver::ReadFromPort(bigtime_t timeout)
 }
 
 
+/*!	Makes the next batch of messages in the ring the current buffer,
+	without copying it.
+*/
+bool
+LinkReceiver::_ReadFromRing()
+{
+	int32 size;
+	const char* batch = fRing->NextBatch(size);
+	if (batch == NULL)
+		return false;
+
+	fPortBuffer = fRecvBuffer;
+	fRecvBuffer = (char*)batch;
+	fDataSize = size;
+	fReadingRing = true;
+	return true;
+}
+
+
 status_t
 LinkReceiver::Read(void *data, ssize_t passedSize)
 {
@@ -288,6 +380,8 @@ LinkReceiver::Read(void *data, ssize_t passedSize)
 	}
 
 	if (useArea) {
+		fReadArea = true;
+
 		area_id sourceArea;
 		memcpy((void*)&sourceArea, fRecvBuffer + fRecvPosition, size);
 
@@ -0,0 +1,298 @@
+/*
+ * Copyright 2010, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+/*!	A ring buffer in an area shared between a LinkSender and a LinkReceiver,
+	used instead of writing the sender's buffer to a port.
+
+	The producer appends each flushed buffer as one record, the consumer
+	parses the records in place, and only gives their space back when it is
+	done with them. Neither side needs a system call as long as the consumer
+	is busy; only when it is about to sleep in read_port(), it sets a flag
+	so that the next write "rings the doorbell" by sending an empty message
+	to its port. The producer likewise waits on a semaphore when the ring
+	is full.
+*/
+
+
+#include <LinkRing.h>
+
+#include <string.h>
+
+#include "link_message.h"
+
+
+namespace BPrivate {
+
+struct link_ring_header {
+	vint32	read;
+	vint32	write;
+	vint32	consumerWaiting;
+	vint32	producerWaiting;
+	int32	size;
+};
+
+static const int32 kRecordHeaderSize = 8;
+static const int32 kWrapMarker = -1;
+	// the rest of the ring is unused, the next record starts at offset 0
+
+
+static inline int32
+record_size(int32 size)
+{
+	return (kRecordHeaderSize + size + 7) & ~7;
+}
+
+
+LinkRing::LinkRing()
+	:
+	fArea(-1),
+	fSpaceSemaphore(-1),
+	fHeader(NULL),
+	fData(NULL),
+	fSize(0),
+	fBatchEnd(-1),
+	fProducer(false),
+	fBroken(false)
+{
+}
+
+
+LinkRing::~LinkRing()
+{
+	if (fArea >= 0)
+		delete_area(fArea);
+	if (fProducer && fSpaceSemaphore >= 0)
+		delete_sem(fSpaceSemaphore);
+}
+
+
+status_t
+LinkRing::InitProducer(size_t size)
+{
+	size_t areaSize = (sizeof(link_ring_header) + size + B_PAGE_SIZE - 1)
+		& ~(B_PAGE_SIZE - 1);
+
+	fArea = create_area("link ring", (void**)&fHeader, B_ANY_ADDRESS,
+		areaSize, B_NO_LOCK, B_READ_AREA | B_WRITE_AREA);
+	if (fArea < B_OK)
+		return fArea;
+
+	fSpaceSemaphore = create_sem(0, "link ring space");
+	if (fSpaceSemaphore < B_OK)
+		return fSpaceSemaphore;
+
+	fProducer = true;
+	fData = (char*)(fHeader + 1);
+	fSize = (areaSize - sizeof(link_ring_header)) & ~7;
+
+	fHeader->read = 0;
+	fHeader->write = 0;
+	fHeader->consumerWaiting = 0;
+	fHeader->producerWaiting = 0;
+	fHeader->size = fSize;
+	return B_OK;
+}
+
+
+status_t
+LinkRing::InitConsumer(area_id area, sem_id spaceSemaphore)
+{
+	fArea = clone_area("link ring", (void**)&fHeader, B_ANY_ADDRESS,
+		B_READ_AREA | B_WRITE_AREA, area);
+	if (fArea < B_OK)
+		return fArea;
+
+	area_info info;
+	status_t status = get_area_info(fArea, &info);
+	if (status != B_OK)
+		return status;
+
+	// don't trust the producer more than needed
+	int32 size = fHeader->size;
+	if (size <= 0 || (size & 7) != 0
+		|| size > (int32)(info.size - sizeof(link_ring_header)))
+		return B_BAD_DATA;
+
+	fSpaceSemaphore = spaceSemaphore;
+	fData = (char*)(fHeader + 1);
+	fSize = size;
+	fBatchEnd = -1;
+	return B_OK;
+}
+
+
+/*!	Appends the \a size bytes of \a data as a single record. If the
+	consumer is waiting for data, an empty message is written to
+	\a doorbellPort to wake it up.
+*/
+status_t
+LinkRing::Write(const void* data, size_t size, port_id doorbellPort,
+	bigtime_t timeout)
+{
+	int32 recordSize = record_size(size);
+	if (recordSize > fSize / 2)
+		return B_BUFFER_OVERFLOW;
+
+	int32 write = fHeader->write;
+	int32 offset;
+
+	while (true) {
+		int32 read = atomic_get(&fHeader->read);
+
+		if (write >= read) {
+			// the free space is at the end, and before the read position;
+			// the ring must never become completely full, as it would look
+			// empty then
+			if (fSize - write >= recordSize + (read == 0 ? 1 : 0)) {
+				offset = write;
+				break;
+			}
+			if (read > recordSize) {
+				*(int32*)(fData + write) = kWrapMarker;
+				offset = 0;
+				break;
+			}
+		} else if (read - write > recordSize) {
+			offset = write;
+			break;
+		}
+
+		status_t status = _WaitForSpace(read, timeout);
+		if (status != B_OK)
+			return status;
+	}
+
+	memcpy(fData + offset + kRecordHeaderSize, data, size);
+	*(int32*)(fData + offset) = size;
+
+	write = offset + recordSize;
+	if (write == fSize)
+		write = 0;
+
+	atomic_set(&fHeader->write, write);
+
+	if (atomic_and(&fHeader->consumerWaiting, 0) != 0) {
+		write_port_etc(doorbellPort, kLinkRingDoorbellCode, NULL, 0,
+			B_RELATIVE_TIMEOUT, 0);
+	}
+
+	return B_OK;
+}
+
+
+bool
+LinkRing::HasData() const
+{
+	if (fBroken)
+		return false;
+
+	int32 read = fBatchEnd >= 0 ? fBatchEnd : fHeader->read;
+	return read != atomic_get(&fHeader->write);
+}
+
+
+/*!	Returns the next record in the ring, or \c NULL if there is none, or
+	if the ring has been corrupted. The record stays valid until
+	ReleaseBatch() is called.
+*/
+const char*
+LinkRing::NextBatch(int32& _size)
+{
+	if (fBatchEnd >= 0)
+		ReleaseBatch();
+	if (fBroken)
+		return NULL;
+
+	int32 read = fHeader->read;
+	int32 write = atomic_get(&fHeader->write);
+	if (read == write)
+		return NULL;
+
+	if (read < 0 || read >= fSize || (read & 7) != 0
+		|| write < 0 || write >= fSize || (write & 7) != 0) {
+		fBroken = true;
+		return NULL;
+	}
+
+	int32 size = *(int32*)(fData + read);
+	if (size == kWrapMarker) {
+		read = 0;
+		atomic_set(&fHeader->read, 0);
+		if (read == write)
+			return NULL;
+
+		size = *(int32*)fData;
+	}
+
+	if (size <= 0 || record_size(size) > fSize - read) {
+		fBroken = true;
+		return NULL;
+	}
+
+	fBatchEnd = read + record_size(size);
+	if (fBatchEnd == fSize)
+		fBatchEnd = 0;
+
+	_size = size;
+	return fData + read + kRecordHeaderSize;
+}
+
+
+/*!	Gives the space of the record last returned by NextBatch() back to the
+	producer.
+*/
+void
+LinkRing::ReleaseBatch()
+{
+	if (fBatchEnd < 0)
+		return;
+
+	atomic_set(&fHeader->read, fBatchEnd);
+	fBatchEnd = -1;
+
+	if (atomic_and(&fHeader->producerWaiting, 0) != 0)
+		release_sem_etc(fSpaceSemaphore, 1, B_DO_NOT_RESCHEDULE);
+}
+
+
+/*!	Tells the producer that the consumer is going to wait on its port.
+	Returns \c false if there already is new data in the ring, in which case
+	the consumer must not wait.
+*/
+bool
+LinkRing::PrepareToWait()
+{
+	atomic_or(&fHeader->consumerWaiting, 1);
+
+	if (HasData()) {
+		atomic_and(&fHeader->consumerWaiting, 0);
+		return false;
+	}
+
+	return true;
+}
+
+
+status_t
+LinkRing::_WaitForSpace(int32 read, bigtime_t timeout)
+{
+	atomic_or(&fHeader->producerWaiting, 1);
+
+	if (atomic_get(&fHeader->read) != read) {
+		// the consumer made progress in the mean time
+		atomic_and(&fHeader->producerWaiting, 0);
+		return B_OK;
+	}
+
+	status_t status;
+	do {
+		status = acquire_sem_etc(fSpaceSemaphore, 1, B_RELATIVE_TIMEOUT,
+			timeout);
+	} while (status == B_INTERRUPTED);
+
+	return status;
+}
+
+}	// namespace BPrivate
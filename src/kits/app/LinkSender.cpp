@@ -1,5 +1,5 @@
 /*
- * Copyright 2001-2005, Haiku.
+ * Copyright 2001-2010, Haiku.
  * Distributed under the terms of the MIT License.
  *
  * Authors:
@@ -15,6 +15,7 @@
 #include <new>
 
 #include <ServerProtocol.h>
+#include <LinkRing.h>
 #include <LinkSender.h>
 
 #include "link_message.h"
@@ -38,6 +39,7 @@ LinkSender::LinkSender(port_id port)
 	:
 	fPort(port),
 	fTargetTeam(-1),
+	fRing(NULL),
 	fBuffer(NULL),
 	fBufferSize(0),
 
@@ -51,6 +53,7 @@ LinkSender::LinkSender(port_id port)
 LinkSender::~LinkSender()
 {
 	free(fBuffer);
+	delete fRing;
 }
 
 
@@ -61,6 +64,21 @@ LinkSender::SetPort(port_id port)
 }
 
 
+/*!	Lets Flush() write into \a ring instead of the port, which is then only
+	used to wake up the receiver. The sender takes over ownership of the
+	ring.
+*/
+void
+LinkSender::SetRing(LinkRing* ring)
+{
+	if (ring == fRing)
+		return;
+
+	delete fRing;
+	fRing = ring;
+}
+
+
 status_t
 LinkSender::StartMessage(int32 code, size_t minSize)
 {
@@ -306,7 +324,9 @@ LinkSender::Flush(bigtime_t timeout, bool needsReply)
 		fCurrentEnd, fPort));
 
 	status_t err;
-	if (timeout != B_INFINITE_TIMEOUT) {
+	if (fRing != NULL)
+		err = fRing->Write(fBuffer, fCurrentEnd, fPort, timeout);
+	else if (timeout != B_INFINITE_TIMEOUT) {
 		do {
 			err = write_port_etc(fPort, kLinkCode, fBuffer,
 				fCurrentEnd, B_RELATIVE_TIMEOUT, timeout);
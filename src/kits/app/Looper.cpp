@@ -1,5 +1,5 @@
 /*
- * Copyright 2001-2008, Haiku.
+ * Copyright 2001-2010, Haiku.
  * Distributed under the terms of the MIT License.
  *
  * Authors:
@@ -12,6 +12,7 @@
 /*!	BLooper class spawns a thread that runs a message loop. */
 
 #include <AppMisc.h>
+#include <AutoDeleter.h>
 #include <AutoLocker.h>
 #include <DirectMessageTarget.h>
 #include <LooperList.h>
@@ -51,6 +52,11 @@ static BLocker sDebugPrintLocker("BLooper debug print");
 #define FILTER_LIST_BLOCK_SIZE	5
 #define DATA_BLOCK_SIZE			5
 
+static const size_t kPortReadBufferSize = 4096;
+	// messages up to this size are read without allocating a buffer
+static const int32 kMaxMessagesPerWakeup = B_LOOPER_PORT_DEFAULT_CAPACITY;
+	// bounds the time spent reading before dispatching again
+
 // Globals ---------------------------------------------------------------------
 using BPrivate::gDefaultTokens;
 using BPrivate::gLooperList;
@@ -1084,6 +1090,49 @@ BLooper::ConvertToMessage(void* buffer, int32 code)
 }
 
 
+/*!	Reads the next message from the port, and returns it in \a _message.
+	Messages that fit into \a buffer are read into it directly, larger ones
+	into a temporary buffer. \a _message is set to \c NULL for messages
+	without any content (like the ones used to wake up the looper), and for
+	those that could not be unflattened.
+*/
+status_t
+BLooper::_ReadMessageFromPort(void* buffer, size_t bufferSize,
+	bigtime_t timeout, BMessage*& _message)
+{
+	_message = NULL;
+
+	ssize_t size;
+	do {
+		size = port_buffer_size_etc(fMsgPort, B_RELATIVE_TIMEOUT, timeout);
+	} while (size == B_INTERRUPTED);
+
+	if (size < B_OK)
+		return size;
+
+	void* readBuffer = buffer;
+	if ((size_t)size > bufferSize)
+		readBuffer = malloc(size);
+	if (readBuffer == NULL)
+		size = 0;
+
+	// we don't want to wait again here, since that can only mean
+	// that someone else has read our message and our size is now
+	// probably wrong
+	int32 code;
+	size = read_port_etc(fMsgPort, &code, readBuffer, size, B_RELATIVE_TIMEOUT,
+		0);
+
+	if (size > 0)
+		_message = ConvertToMessage(readBuffer, code);
+
+	if (readBuffer != buffer)
+		free(readBuffer);
+
+	return size < B_OK ? size : B_OK;
+}
+
+
 void
 BLooper::task_looper()
 {
@@ -1096,28 +1145,31 @@ BLooper::task_looper()
 	if (IsLocked())
 		debugger("looper must not be locked!");
 
+	void* readBuffer = malloc(kPortReadBufferSize);
+	size_t readBufferSize = readBuffer != NULL ? kPortReadBufferSize : 0;
+	MemoryDeleter readBufferDeleter(readBuffer);
+
 	// loop: As long as we are not terminating.
 	while (!fTerminating) {
 		PRINT(("LOOPER: outer loop\n"));
 		// TODO: timeout determination algo
 		//	Read from message port (how do we determine what the timeout is?)
-		PRINT(("LOOPER: MessageFromPort()...\n"));
-		BMessage *msg = MessageFromPort();
-		PRINT(("LOOPER: ...done\n"));
+		// Wait for the first message, and then read everything that is
+		// already waiting in the port without blocking again
+		PRINT(("LOOPER: reading messages from port...\n"));
+		bigtime_t timeout = B_INFINITE_TIMEOUT;
+		for (int32 i = 0; i < kMaxMessagesPerWakeup; i++) {
+			BMessage* message;
+			if (_ReadMessageFromPort(readBuffer, readBufferSize, timeout,
+					message) != B_OK)
+				break;
 
-		//	Did we get a message?
-		if (msg)
-			_AddMessagePriv(msg);
-
-		// Get message count from port
-		int32 msgCount = port_count(fMsgPort);
-		for (int32 i = 0; i < msgCount; ++i) {
-			// Read 'count' messages from port (so we will not block)
-			// We use zero as our timeout since we know there is stuff there
-			msg = MessageFromPort(0);
-			if (msg)
-				_AddMessagePriv(msg);
+			if (message != NULL)
+				_AddMessagePriv(message);
+
+			timeout = 0;
 		}
+		PRINT(("LOOPER: ...done\n"));
 
 		// loop: As long as there are messages in the queue and the port is
 		//		 empty... and we are not terminating, of course.
@@ -13,6 +13,7 @@
 #include <MessageUtils.h>
 
 #include <DirectMessageTarget.h>
+#include <locks.h>
 #include <MessengerPrivate.h>
 #include <TokenSpace.h>
 #include <util/KMessage.h>
@@ -80,6 +81,27 @@ port_id BMessage::sReplyPorts[sNumReplyPorts];
 long BMessage::sReplyPortInUse[sNumReplyPorts];
 
 
+// message areas we received, and can reuse for sending; only a few small
+// ones are kept, and not for long, so that they don't pile up in a team
+struct cached_message_area {
+	area_id		area;
+	uint8*		address;
+	size_t		size;
+	bigtime_t	released;
+};
+
+static const int32 kMaxCachedMessageAreas = 4;
+static const size_t kMaxCachedMessageAreaSize = 256 * 1024;
+static const size_t kMaxCachedMessageAreaMemory = 512 * 1024;
+static const bigtime_t kCachedMessageAreaTimeout = 10000000;
+	// 10 seconds
+
+static mutex sMessageAreaCacheLock = MUTEX_INITIALIZER("message area cache");
+static cached_message_area sMessageAreaCache[kMaxCachedMessageAreas];
+static int32 sCachedMessageAreaCount = 0;
+static size_t sCachedMessageAreaMemory = 0;
+
+
 template<typename Type>
 static void
 print_to_stream_type(uint8 *pointer)
@@ -140,6 +162,123 @@ handle_reply(port_id replyPort, int32 *_code, bigtime_t timeout,
 }
 
 
+/*!	Removes the cached message areas that have not been used for a while
+	from the cache, and returns them in \a expired; the caller needs to
+	delete them after unlocking the cache.
+	The message area cache lock must be held.
+*/
+static int32
+remove_expired_message_areas(area_id* expired)
+{
+	bigtime_t now = system_time();
+	int32 count = 0;
+
+	for (int32 i = sCachedMessageAreaCount - 1; i >= 0; i--) {
+		if (now - sMessageAreaCache[i].released < kCachedMessageAreaTimeout)
+			continue;
+
+		expired[count++] = sMessageAreaCache[i].area;
+		sCachedMessageAreaMemory -= sMessageAreaCache[i].size;
+		sMessageAreaCache[i] = sMessageAreaCache[--sCachedMessageAreaCount];
+	}
+
+	return count;
+}
+
+
+/*!	Returns an area of at least \a size bytes for sending a message, and
+	makes it writable. A cached area is used if possible, as its pages are
+	already mapped; it is shrunk to \a size so that no stale data from
+	a previous message is passed on.
+*/
+static area_id
+acquire_message_area(size_t size, uint8** _address)
+{
+	cached_message_area cached;
+	cached.area = -1;
+	area_id expired[kMaxCachedMessageAreas];
+
+	mutex_lock(&sMessageAreaCacheLock);
+
+	int32 expiredCount = remove_expired_message_areas(expired);
+
+	int32 best = -1;
+	for (int32 i = 0; i < sCachedMessageAreaCount; i++) {
+		if (sMessageAreaCache[i].size >= size && (best < 0
+				|| sMessageAreaCache[i].size < sMessageAreaCache[best].size))
+			best = i;
+	}
+	if (best >= 0) {
+		cached = sMessageAreaCache[best];
+		sCachedMessageAreaMemory -= cached.size;
+		sMessageAreaCache[best]
+			= sMessageAreaCache[--sCachedMessageAreaCount];
+	}
+
+	mutex_unlock(&sMessageAreaCacheLock);
+
+	for (int32 i = 0; i < expiredCount; i++)
+		delete_area(expired[i]);
+
+	if (cached.area >= 0) {
+		if ((cached.size == size || resize_area(cached.area, size) == B_OK)
+			&& set_area_protection(cached.area,
+				B_READ_AREA | B_WRITE_AREA) == B_OK) {
+			*_address = cached.address;
+			return cached.area;
+		}
+
+		delete_area(cached.area);
+	}
+
+	return create_area("BMessage data", (void **)_address, B_ANY_ADDRESS,
+		size, B_NO_LOCK, B_READ_AREA | B_WRITE_AREA);
+}
+
+
+/*!	Keeps a message area that is no longer needed for later use by
+	acquire_message_area(), or deletes it if it is too large, or the cache
+	is full.
+*/
+static void
+release_message_area(area_id area)
+{
+	area_info info;
+	if (get_area_info(area, &info) != B_OK)
+		return;
+
+	if (info.size <= kMaxCachedMessageAreaSize
+		&& info.team == BPrivate::current_team()) {
+		area_id expired[kMaxCachedMessageAreas];
+
+		mutex_lock(&sMessageAreaCacheLock);
+
+		int32 expiredCount = remove_expired_message_areas(expired);
+
+		if (sCachedMessageAreaCount < kMaxCachedMessageAreas
+			&& sCachedMessageAreaMemory + info.size
+				<= kMaxCachedMessageAreaMemory) {
+			cached_message_area& cached
+				= sMessageAreaCache[sCachedMessageAreaCount++];
+			cached.area = area;
+			cached.address = (uint8*)info.address;
+			cached.size = info.size;
+			cached.released = system_time();
+			sCachedMessageAreaMemory += info.size;
+			area = -1;
+		}
+
+		mutex_unlock(&sMessageAreaCacheLock);
+
+		for (int32 i = 0; i < expiredCount; i++)
+			delete_area(expired[i]);
+	}
+
+	if (area >= 0)
+		delete_area(area);
+}
+
+
 //	#pragma mark -
 
 
@@ -1041,6 +1180,17 @@ BMessage::Flatten(BDataIO *stream, ssize_t *size) const
 	Additionally we save us the reference counting with the use of areas that
 	are reference counted internally. So we don't have to worry about leaving
 	an area behind or deleting one that is still in use.
+	The area is made read-only before it is transferred, so that the receiver
+	cannot accidentally write into it instead of copying it first. Once the
+	receiver is done with it, it keeps the area around for a few seconds to
+	send its own large messages with it, so that going back and forth between
+	two teams, as with the clipboard or drag&drop, does not need to create,
+	map, and clear new pages every time. Only small areas are kept, and their
+	total size is limited.
+	The sender still copies its fields into the area once. Building them in
+	the area directly would not help: transferring an area takes it away
+	from the sender, which must keep its message, and there is no way to
+	map an area copy-on-write into another team.
 */
 
 status_t
@@ -1060,12 +1210,11 @@ BMessage::_FlattenToArea(message_header **_header) const
 	if (header->field_count == 0 && header->data_size == 0)
 		return B_OK;
 
-	char *address = NULL;
+	uint8 *address = NULL;
 	size_t fieldsSize = header->field_count * sizeof(field_header);
-	size_t size = fieldsSize + header->data_size;
-	size = (size + B_PAGE_SIZE) & ~(B_PAGE_SIZE - 1);
-	area_id area = create_area("BMessage data", (void **)&address,
-		B_ANY_ADDRESS, size, B_NO_LOCK, B_READ_AREA | B_WRITE_AREA);
+	size_t usedSize = fieldsSize + header->data_size;
+	size_t size = (usedSize + B_PAGE_SIZE - 1) & ~(B_PAGE_SIZE - 1);
+	area_id area = acquire_message_area(size, &address);
 
 	if (area < 0) {
 		free(header);
@@ -1075,6 +1224,10 @@ BMessage::_FlattenToArea(message_header **_header) const
 
 	memcpy(address, fFields, fieldsSize);
 	memcpy(address + fieldsSize, fData, fHeader->data_size);
+	// a reused area still contains the end of an older message
+	memset(address + usedSize, 0, size - usedSize);
+	set_area_protection(area, B_READ_AREA);
+
 	header->flags |= MESSAGE_FLAG_PASS_BY_AREA;
 	header->message_area = area;
 	return B_OK;
@@ -1108,7 +1261,7 @@ status_t
 BMessage::_Dereference()
 {
 	DEBUG_FUNCTION_ENTER;
-	delete_area(fHeader->message_area);
+	release_message_area(fHeader->message_area);
 	fHeader->message_area = -1;
 	fFields = NULL;
 	fData = NULL;
@@ -1980,6 +2133,11 @@ BMessage::_StaticReInitForkedChild()
 	sReplyPortInUse[0] = 0;
 	sReplyPortInUse[1] = 0;
 	sReplyPortInUse[2] = 0;
+
+	// the cached message areas have different IDs in the child
+	mutex_init(&sMessageAreaCacheLock, "message area cache");
+	sCachedMessageAreaCount = 0;
+	sCachedMessageAreaMemory = 0;
 }
 
 
@@ -1987,6 +2145,11 @@ void
 BMessage::_StaticCleanup()
 {
 	DEBUG_FUNCTION_ENTER2;
+	for (int32 i = 0; i < sCachedMessageAreaCount; i++)
+		delete_area(sMessageAreaCache[i].area);
+	sCachedMessageAreaCount = 0;
+	sCachedMessageAreaMemory = 0;
+
 	delete_port(sReplyPorts[0]);
 	sReplyPorts[0] = -1;
 	delete_port(sReplyPorts[1]);
@@ -2080,7 +2243,7 @@ BMessage::_SendMessage(port_id port, team_id portOwner, int32 token,
 			area_id transfered = _kern_transfer_area(header->message_area,
 				&address, B_ANY_ADDRESS, target);
 			if (transfered < 0) {
-				delete_area(header->message_area);
+				release_message_area(header->message_area);
 				free(header);
 				return transfered;
 			}
@@ -1,5 +1,5 @@
 /*
- * Copyright 2001-2007, Haiku, Inc. All Rights Reserved.
+ * Copyright 2001-2010, Haiku, Inc. All Rights Reserved.
  * Distributed under the terms of the MIT License.
  *
  * Authors:
@@ -9,18 +9,29 @@
 
 /**	Queue for holding BMessages */
 
+/*!	Adding messages does not need to lock the queue: the producers push
+	them onto a lock-free stack (fIncoming), and whoever holds the lock
+	moves them over to the ordered list in fHead/fTail before looking at
+	it. This way, the threads posting messages to a looper never compete
+	with each other, nor with the looper thread for its queue lock.
+*/
+
 
 #include <MessageQueue.h>
+
 #include <Autolock.h>
 #include <Message.h>
 
+#include <util/atomic.h>
+
 
 BMessageQueue::BMessageQueue()
 	:
 	fHead(NULL),
  	fTail(NULL),
  	fMessageCount(0),
- 	fLock("BMessageQueue Lock")
+ 	fLock("BMessageQueue Lock"),
+	fIncoming(NULL)
 {
 }
 
@@ -30,6 +41,8 @@ BMessageQueue::~BMessageQueue()
 	if (!Lock())
 		return;
 
+	_MoveIncomingMessages();
+
 	BMessage* message = fHead;
 	while (message != NULL) {
 		BMessage *next = message->fQueueLink;
@@ -46,24 +59,15 @@ BMessageQueue::AddMessage(BMessage* message)
 	if (message == NULL)
 		return;
 
-	BAutolock _(fLock);
-	if (!IsLocked())
-		return;
+	// The count is updated first, so that it never drops below zero when
+	// the message is removed again before we're done here.
+	atomic_add(&fMessageCount, 1);
 
-	// The message passed in will be the last message on the queue so its
-	// link member should be set to null.
-	message->fQueueLink = NULL;
-
-	fMessageCount++;
-
-	if (fTail == NULL) {
-		// there are no messages in the queue yet
-		fHead = fTail = message;
-	} else {
-		// just add it after the tail
-		fTail->fQueueLink = message;
-		fTail = message;
-	}
+	BMessage* head;
+	do {
+		head = atomic_pointer_get(&fIncoming);
+		message->fQueueLink = head;
+	} while (atomic_pointer_test_and_set(&fIncoming, message, head) != head);
 }
 
 
@@ -77,6 +81,8 @@ BMessageQueue::RemoveMessage(BMessage* message)
 	if (!IsLocked())
 		return;
 
+	_MoveIncomingMessages();
+
 	BMessage* last = NULL;
 	for (BMessage* entry = fHead; entry != NULL; entry = entry->fQueueLink) {
 		if (entry == message) {
@@ -89,7 +95,7 @@ BMessageQueue::RemoveMessage(BMessage* message)
 			if (entry == fTail)
 				fTail = last;
 
-			fMessageCount--;
+			atomic_add(&fMessageCount, -1);
 			return;
 		}
 		last = entry;
@@ -118,9 +124,11 @@ BMessageQueue::FindMessage(int32 index) const
 	if (!IsLocked())
 		return NULL;
 
-	if (index < 0 || index >= fMessageCount)
+	if (index < 0)
 		return NULL;
-	
+
+	const_cast<BMessageQueue*>(this)->_MoveIncomingMessages();
+
 	for (BMessage* message = fHead; message != NULL; message = message->fQueueLink) {
 		// If the index reaches zero, then we have found a match.
 		if (index == 0)
@@ -140,9 +148,11 @@ BMessageQueue::FindMessage(uint32 what, int32 index) const
 	if (!IsLocked())
 		return NULL;
 
-	if (index < 0 || index >= fMessageCount)
+	if (index < 0)
 		return NULL;
 
+	const_cast<BMessageQueue*>(this)->_MoveIncomingMessages();
+
 	for (BMessage* message = fHead; message != NULL; message = message->fQueueLink) {
 		if (message->what == what) {
 			// If the index reaches zero, then we have found a match.
@@ -185,13 +195,16 @@ BMessageQueue::NextMessage()
 	if (!IsLocked())
 		return NULL;
 
+	if (fHead == NULL)
+		_MoveIncomingMessages();
+
 	// remove the head of the queue, if any, and return it
 
 	BMessage* head = fHead;
 	if (head == NULL)
 		return NULL;
 
-	fMessageCount--;
+	atomic_add(&fMessageCount, -1);
 	fHead = head->fQueueLink;
 
 	if (fHead == NULL) {
@@ -209,6 +222,10 @@ bool
 BMessageQueue::IsNextMessage(const BMessage* message) const
 {
 	BAutolock _(fLock);
+
+	if (fHead == NULL)
+		const_cast<BMessageQueue*>(this)->_MoveIncomingMessages();
+
 	return fHead == message;
 }
 
@@ -224,7 +241,35 @@ BMessageQueue::IsLocked()
 }
 
 
+/*!	Appends all messages that have been added since the last call to the
+	end of the queue. The queue must be locked.
+*/
+void
+BMessageQueue::_MoveIncomingMessages()
+{
+	BMessage* incoming = atomic_pointer_set(&fIncoming, (BMessage*)NULL);
+	if (incoming == NULL)
+		return;
+
+	// The stack has the newest message on top, so it needs to be reversed
+	BMessage* first = NULL;
+	BMessage* last = incoming;
+	while (incoming != NULL) {
+		BMessage* next = incoming->fQueueLink;
+		incoming->fQueueLink = first;
+		first = incoming;
+		incoming = next;
+	}
+
+	if (fTail == NULL)
+		fHead = first;
+	else
+		fTail->fQueueLink = first;
+
+	fTail = last;
+}
+
+
 void BMessageQueue::_ReservedMessageQueue1() {}
 void BMessageQueue::_ReservedMessageQueue2() {}
 void BMessageQueue::_ReservedMessageQueue3() {}
-
@@ -1,5 +1,5 @@
 /*
- * Copyright 2005, Haiku.
+ * Copyright 2005-2010, Haiku.
  * Distributed under the terms of the MIT License.
  *
  * Authors:
@@ -13,6 +13,8 @@
 
 
 static const int32 kLinkCode = '_PTL';
+static const int32 kLinkRingDoorbellCode = '_PTR';
+	// wakes up a LinkReceiver waiting for data in its LinkRing
 
 static const size_t kInitialBufferSize = 2048;
 static const size_t kMaxBufferSize = 65536;
@@ -1,5 +1,5 @@
 /*
- * Copyright 2001-2009, Haiku Inc.
+ * Copyright 2001-2010, Haiku Inc.
  * Distributed under the terms of the MIT License.
  *
  * Authors:
@@ -455,7 +455,9 @@ BBitmap::UnlockBits()
 	if ((fFlags & B_BITMAP_WILL_OVERLAY) == 0)
 		return;
 
+	// let the app_server know that the buffer might have changed
 	overlay_client_data* data = (overlay_client_data*)fBasePointer;
+	atomic_add(&data->change_count, 1);
 	release_sem_etc(data->lock, 1, B_DO_NOT_RESCHEDULE);
 }
 
@@ -1046,6 +1048,16 @@ BBitmap::_InitObject(BRect bounds, color_space colorSpace, uint32 flags,
 					// hardware constraints
 					link.Read<int32>(&bytesPerRow);
 					size = bytesPerRow * (bounds.IntegerHeight() + 1);
+
+					if ((allocationFlags & kSoftwareOverlay) != 0
+						&& error == B_OK) {
+						// the app_server emulates the overlay, its buffer
+						// lies right behind the overlay_client_data
+						overlay_client_data* data
+							= (overlay_client_data*)fBasePointer;
+						data->buffer = (uint8*)fBasePointer
+							+ kSoftwareOverlayBufferOffset;
+					}
 				}
 
 				if (fServerArea >= B_OK) {
@@ -40,6 +40,7 @@
 #include <DirectMessageTarget.h>
 #include <input_globals.h>
 #include <InputServerTypes.h>
+#include <LinkRing.h>
 #include <MenuPrivate.h>
 #include <MessagePrivate.h>
 #include <PortLink.h>
@@ -207,6 +208,9 @@ static value_info sWindowValueInfo[] = {
 };
 
 
+static const size_t kLinkRingSize = 256 * 1024;
+
+
 void
 _set_menu_sem_(BWindow* window, sem_id sem)
 {
@@ -215,6 +219,37 @@ _set_menu_sem_(BWindow* window, sem_id sem)
 }
 
 
+/*!	Lets \a link write its messages into a ring buffer shared with the
+	server window, instead of sending them through the window's port. This
+	is only done if the LINK_RING environment variable is set.
+*/
+static void
+enable_link_ring(BPrivate::PortLink* link)
+{
+	if (getenv("LINK_RING") == NULL)
+		return;
+
+	BPrivate::LinkRing* ring = new(std::nothrow) BPrivate::LinkRing;
+	if (ring == NULL)
+		return;
+
+	if (ring->InitProducer(kLinkRingSize) != B_OK) {
+		delete ring;
+		return;
+	}
+
+	link->StartMessage(AS_ENABLE_LINK_RING);
+	link->Attach<area_id>(ring->Area());
+	link->Attach<sem_id>(ring->SpaceSemaphore());
+
+	int32 code;
+	if (link->FlushWithReply(code) == B_OK && code == B_OK)
+		link->Sender().SetRing(ring);
+	else
+		delete ring;
+}
+
+
 //	#pragma mark -
 
 
@@ -2850,6 +2885,9 @@ BWindow::_InitData(BRect frame, const char* title, window_look look,
 
 		// Redirect our link to the new window connection
 		fLink->SetSenderPort(sendPort);
+
+		if (sendPort >= 0)
+			enable_link_ring(fLink);
 	}
 
 	STRACE(("Server says that our send port is %ld\n", sendPort));
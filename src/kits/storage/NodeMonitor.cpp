@@ -1,5 +1,5 @@
 /*
- * Copyright 2001-2005, Haiku.
+ * Copyright 2001-2010, Haiku.
  * Distributed under the terms of the MIT License.
  *
  * Authors:
@@ -35,6 +35,12 @@
 	Note, that the latter two cases are not mutual exlusive, i.e. mount and
 	node watching can be requested with a single call.
 
+	If \a flags contains \c B_WATCH_BATCHED, the notifications for the target
+	are collected for a short time, and are delivered together in a single
+	message with the opcode \c B_BATCHED_EVENTS. Redundant notifications are
+	dropped from the batch. Use BPrivate::Storage::NodeMonitorBatch to get
+	the single notifications out of it.
+
 	\param node node_ref referring to the node to be watched. May be \c NULL,
 		   if only mount watching is requested.
 	\param flags Flags indicating the actions to be performed.
@@ -63,7 +69,7 @@ watch_node(const node_ref *node, uint32 flags, BMessenger target)
 	// mount watching
 	if (flags & B_WATCH_MOUNT) {
 		status_t status = _kern_start_watching((dev_t)-1, (ino_t)-1,
-			B_WATCH_MOUNT, port, token);
+			B_WATCH_MOUNT | (flags & B_WATCH_BATCHED), port, token);
 		if (status < B_OK)
 			return status;
 
@@ -71,7 +77,7 @@ watch_node(const node_ref *node, uint32 flags, BMessenger target)
 	}
 
 	// node watching
-	if (flags != 0) {
+	if ((flags & ~B_WATCH_BATCHED) != 0) {
 		if (node == NULL)
 			return B_BAD_VALUE;
 
@@ -0,0 +1,113 @@
+/*
+ * Copyright 2010, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include <NodeMonitorBatch.h>
+
+#include <string.h>
+
+#include <NodeMonitor.h>
+
+
+namespace BPrivate {
+namespace Storage {
+
+
+/*!	\class NodeMonitorBatch
+	\brief Splits a \c B_BATCHED_EVENTS notification into the single
+		   notifications it contains.
+
+	Both the batches the kernel sends to targets that asked for
+	\c B_WATCH_BATCHED, and the ones BPathMonitor forwards, are understood.
+	Any other message is treated as a batch of just itself, so that a target
+	can handle all its notifications the same way.
+*/
+
+
+NodeMonitorBatch::NodeMonitorBatch(const BMessage* message)
+	:
+	fMessage(message),
+	fEventCount(1),
+	fEventIndex(0),
+	fNested(false)
+{
+	memset(fFieldIndices, 0, sizeof(fFieldIndices));
+
+	int32 opcode;
+	if (message->FindInt32("opcode", &opcode) != B_OK
+		|| opcode != B_BATCHED_EVENTS)
+		return;
+
+	type_code type;
+	if (message->GetInfo("event", &type, &fEventCount) == B_OK
+		&& type == B_MESSAGE_TYPE) {
+		// forwarded by BPathMonitor
+		fNested = true;
+	} else if (message->GetInfo(NODE_MONITOR_BATCH_OPCODES_FIELD, &type,
+			&fEventCount) != B_OK) {
+		fEventCount = 0;
+	}
+}
+
+
+int32
+NodeMonitorBatch::CountEvents() const
+{
+	return fEventCount;
+}
+
+
+/*!	\brief Returns the next notification of the batch.
+	\return \c B_ENTRY_NOT_FOUND, when all notifications have been returned.
+*/
+status_t
+NodeMonitorBatch::GetNextEvent(BMessage* event)
+{
+	if (fEventIndex >= fEventCount)
+		return B_ENTRY_NOT_FOUND;
+
+	int32 index = fEventIndex++;
+
+	if (fNested)
+		return fMessage->FindMessage("event", index, event);
+
+	if (!fMessage->HasInt32(NODE_MONITOR_BATCH_OPCODES_FIELD)) {
+		// not a batch at all
+		*event = *fMessage;
+		return B_OK;
+	}
+
+	int32 opcode;
+	status_t status = fMessage->FindInt32(NODE_MONITOR_BATCH_OPCODES_FIELD,
+		index, &opcode);
+	if (status != B_OK)
+		return status;
+
+	event->MakeEmpty();
+	event->what = fMessage->what;
+	event->AddInt32("opcode", opcode);
+
+	for (uint32 i = 0; i < NODE_MONITOR_BATCH_FIELD_COUNT; i++) {
+		const node_monitor_batch_field& field = kNodeMonitorBatchFields[i];
+		if ((field.opcodes & NODE_MONITOR_OPCODE_MASK(opcode)) == 0)
+			continue;
+
+		const void* data;
+		ssize_t size;
+		status = fMessage->FindData(field.name, field.type,
+			fFieldIndices[i]++, &data, &size);
+		if (status == B_OK) {
+			status = event->AddData(field.name, field.type, data, size,
+				field.type != B_STRING_TYPE);
+		}
+		if (status != B_OK)
+			return status;
+	}
+
+	return B_OK;
+}
+
+}	// namespace Storage
+}	// namespace BPrivate
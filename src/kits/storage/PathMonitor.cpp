@@ -1,5 +1,5 @@
 /*
- * Copyright 2007-2008, Haiku Inc. All Rights Reserved.
+ * Copyright 2007-2010, Haiku Inc. All Rights Reserved.
  * Distributed under the terms of the MIT License.
  *
  * Authors:
@@ -21,6 +21,8 @@
 #include <Path.h>
 #include <String.h>
 
+#include <NodeMonitorBatch.h>
+
 #include <map>
 #include <new>
 #include <set>
@@ -35,6 +37,7 @@
 #endif
 
 using namespace BPrivate;
+using namespace BPrivate::Storage;
 using namespace std;
 using std::nothrow; // TODO: Remove this line if the above line is enough.
 
@@ -106,6 +109,7 @@ class PathHandler : public BHandler {
 		void _EntryCreated(BMessage* message);
 		void _EntryRemoved(BMessage* message);
 		void _EntryMoved(BMessage* message);
+		void _BatchedEvents(BMessage* message);
 
 		bool _IsContained(const node_ref& nodeRef) const;
 		bool _IsContained(BEntry& entry) const;
@@ -135,6 +139,7 @@ class PathHandler : public BHandler {
 		status_t		fStatus;
 		DirectorySet	fDirectories;
 		FileSet			fFiles;
+		BMessage*		fBatch;
 };
 
 
@@ -196,7 +201,8 @@ PathHandler::PathHandler(const char* path, uint32 flags, BMessenger target,
 		BLooper* looper)
 	: BHandler(path),
 	fTarget(target),
-	fFlags(flags)
+	fFlags(flags),
+	fBatch(NULL)
 {
 	if (path == NULL || !path[0]) {
 		fStatus = B_BAD_VALUE;
@@ -497,6 +503,29 @@ PathHandler::_EntryMoved(BMessage* message)
 }
 
 
+void
+PathHandler::_BatchedEvents(BMessage* message)
+{
+	// The target asked for batched notifications, so it gets the ones that
+	// result from this batch in a single message, too.
+	BMessage batch(B_PATH_MONITOR);
+	batch.AddInt32("opcode", B_BATCHED_EVENTS);
+	batch.AddString("watched_path", fPath.Path());
+
+	fBatch = &batch;
+
+	NodeMonitorBatch events(message);
+	BMessage event;
+	while (events.GetNextEvent(&event) == B_OK)
+		MessageReceived(&event);
+
+	fBatch = NULL;
+
+	if (batch.HasMessage("event"))
+		fTarget.SendMessage(&batch);
+}
+
+
 void
 PathHandler::MessageReceived(BMessage* message)
 {
@@ -520,6 +549,10 @@ PathHandler::MessageReceived(BMessage* message)
 					_EntryMoved(message);
 					break;
 
+				case B_BATCHED_EVENTS:
+					_BatchedEvents(message);
+					break;
+
 				default:
 					_NotifyTarget(message);
 					break;
@@ -661,7 +694,10 @@ PathHandler::_NotifyTarget(BMessage* message, const node_ref& nodeRef) const
 	// BPathMonitor::StartWatching() call the message is resulting from.
 	update.AddString("watched_path", fPath.Path());
 
-	fTarget.SendMessage(&update);
+	if (fBatch != NULL)
+		fBatch->AddMessage("event", &update);
+	else
+		fTarget.SendMessage(&update);
 }
 
 
@@ -697,7 +733,7 @@ PathHandler::_AddDirectory(BEntry& entry, bool notify)
 	if (directory.contained)
 		flags = (fFlags & WATCH_NODE_FLAG_MASK) | B_WATCH_DIRECTORY;
 	else
-		flags = B_WATCH_DIRECTORY;
+		flags = B_WATCH_DIRECTORY | (fFlags & B_WATCH_BATCHED);
 
 	status = watch_node(&directory.node, flags, this);
 	if (status != B_OK)
@@ -820,8 +856,10 @@ PathHandler::_HasFile(const node_ref& nodeRef) const
 status_t
 PathHandler::_AddFile(BEntry& entry, bool notify)
 {
-	if ((fFlags & (WATCH_NODE_FLAG_MASK & ~B_WATCH_DIRECTORY)) == 0)
+	if ((fFlags & WATCH_NODE_FLAG_MASK & ~(B_WATCH_DIRECTORY | B_WATCH_BATCHED))
+			== 0) {
 		return B_OK;
+	}
 
 #ifdef TRACE_PATH_MONITOR
 {
@@ -13,14 +13,20 @@
 #include <ResourceFile.h>
 
 #include <algorithm>
+#include <errno.h>
 #include <new>
 #include <stdio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include <AutoDeleter.h>
 
 #include <Elf.h>
 #include <Exception.h>
+#include <locks.h>
 #include <Pef.h>
+#include <Referenceable.h>
 #include <ResourceItem.h>
 #include <ResourcesContainer.h>
 #include <ResourcesDefs.h>
@@ -40,6 +46,9 @@ static const char	kELFFileMagic[4]			= { 0x7f, 'E', 'L', 'F' };
 static const uint32	kMaxResourceCount			= 10000;
 static const uint32	kELFMaxResourceAlignment	= 1024 * 1024 * 10;	// 10 MB
 
+// number of mapped files that are kept, even if they are not used anymore
+static const int32	kMaxCachedMappedFiles		= 16;
+
 
 // recognized file types (indices into kFileTypeNames)
 enum {
@@ -214,6 +223,239 @@ struct resource_parse_info {
 };
 
 
+// #pragma mark - MappedResourceFile
+
+
+/*!	A read-only resource file mapped into memory, together with its parsed
+	resource index.
+
+	It is shared by all ResourceFiles that are set to the same file, as long
+	as the file doesn't change, and it is kept alive by every ResourceItem
+	that refers to data in the mapping. The most recently used ones are kept
+	in a cache, even if they are not in use anymore.
+*/
+struct MappedResourceFile : BReferenceable {
+	MappedResourceFile(const struct stat& stat, uint32 fileType,
+		off_t resourcesOffset)
+		:
+		device(stat.st_dev),
+		node(stat.st_ino),
+		modificationTime(stat.st_mtim),
+		fileSize(stat.st_size),
+		fileType(fileType),
+		resourcesOffset(resourcesOffset),
+		address((uint8*)MAP_FAILED)
+	{
+	}
+
+	~MappedResourceFile()
+	{
+		if (address != MAP_FAILED)
+			munmap(address, fileSize);
+	}
+
+	status_t Init(BFile& file, const ResourcesContainer& container)
+	{
+		int fd = file.Dup();
+		if (fd < 0)
+			return fd;
+
+		address = (uint8*)mmap(NULL, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+		close(fd);
+		if (address == MAP_FAILED)
+			return errno;
+
+		// copy the index
+		int32 count = container.CountResources();
+		for (int32 i = 0; i < count; i++) {
+			ResourceItem* item = container.ResourceAt(i);
+			ResourceItem* indexItem = new(std::nothrow) ResourceItem;
+			if (indexItem == NULL)
+				return B_NO_MEMORY;
+
+			indexItem->SetIdentity(item->Type(), item->ID(), item->Name());
+			indexItem->SetLocation(item->Offset(), item->InitialSize());
+			if (!index.AddResource(indexItem, -1, false)) {
+				delete indexItem;
+				return B_NO_MEMORY;
+			}
+		}
+
+		return B_OK;
+	}
+
+	/*!	Returns whether the file is still the one that has been mapped.
+		The modification time is compared with its full precision, so that
+		changes within the same second are noticed as well.
+	*/
+	bool Matches(const struct stat& stat) const
+	{
+		return stat.st_dev == device && stat.st_ino == node
+			&& stat.st_mtim.tv_sec == modificationTime.tv_sec
+			&& stat.st_mtim.tv_nsec == modificationTime.tv_nsec
+			&& stat.st_size == fileSize;
+	}
+
+	const void* DataAt(const ResourceItem* item) const
+	{
+		return address + resourcesOffset + item->Offset();
+	}
+
+	//! Lets the resources of the \a container refer to the mapped data.
+	void MapResources(ResourcesContainer& container)
+	{
+		int32 count = container.CountResources();
+		for (int32 i = 0; i < count; i++) {
+			ResourceItem* item = container.ResourceAt(i);
+			item->SetMappedData(DataAt(item), this);
+		}
+	}
+
+	status_t InitContainer(ResourcesContainer& container)
+	{
+		int32 count = index.CountResources();
+		for (int32 i = 0; i < count; i++) {
+			ResourceItem* indexItem = index.ResourceAt(i);
+			ResourceItem* item = new(std::nothrow) ResourceItem;
+			if (item == NULL)
+				return B_NO_MEMORY;
+
+			item->SetIdentity(indexItem->Type(), indexItem->ID(),
+				indexItem->Name());
+			item->SetLocation(indexItem->Offset(), indexItem->InitialSize());
+			item->SetMappedData(DataAt(indexItem), this);
+			if (!container.AddResource(item, -1, false)) {
+				delete item;
+				return B_NO_MEMORY;
+			}
+		}
+
+		container.SetModified(false);
+		return B_OK;
+	}
+
+	static MappedResourceFile* Get(const struct stat& stat);
+	static void Add(MappedResourceFile* file);
+	static void Remove(dev_t device, ino_t node);
+
+	dev_t				device;
+	ino_t				node;
+	struct timespec		modificationTime;
+	off_t				fileSize;
+	uint32				fileType;
+	off_t				resourcesOffset;
+	uint8*				address;
+	ResourcesContainer	index;
+};
+
+
+static mutex sMappedFilesLock = MUTEX_INITIALIZER("mapped resource files");
+static MappedResourceFile* sMappedFiles[kMaxCachedMappedFiles];
+	// the cache, the most recently used first
+
+
+/*!	Returns the index of the given file in the cache, or -1 if it is not
+	cached. The caller must hold the cache lock.
+*/
+static int32
+find_mapped_file(dev_t device, ino_t node)
+{
+	for (int32 i = 0; i < kMaxCachedMappedFiles && sMappedFiles[i] != NULL;
+			i++) {
+		if (sMappedFiles[i]->device == device && sMappedFiles[i]->node == node)
+			return i;
+	}
+
+	return -1;
+}
+
+
+/*!	Removes the file at the given index from the cache, and releases the
+	cache's reference to it. The caller must hold the cache lock.
+*/
+static void
+remove_mapped_file(int32 index)
+{
+	MappedResourceFile* file = sMappedFiles[index];
+	memmove(sMappedFiles + index, sMappedFiles + index + 1,
+		(kMaxCachedMappedFiles - 1 - index) * sizeof(file));
+	sMappedFiles[kMaxCachedMappedFiles - 1] = NULL;
+	file->ReleaseReference();
+}
+
+
+/*!	Returns the cached MappedResourceFile for the given file, if it is still
+	up to date, with a reference acquired.
+*/
+/*static*/ MappedResourceFile*
+MappedResourceFile::Get(const struct stat& stat)
+{
+	mutex_lock(&sMappedFilesLock);
+
+	MappedResourceFile* file = NULL;
+	int32 index = find_mapped_file(stat.st_dev, stat.st_ino);
+	if (index >= 0) {
+		file = sMappedFiles[index];
+
+		if (file->Matches(stat)) {
+			// move it to the front
+			memmove(sMappedFiles + 1, sMappedFiles, index * sizeof(file));
+			sMappedFiles[0] = file;
+			file->AcquireReference();
+		} else {
+			// the file has been changed, remove the outdated mapping
+			remove_mapped_file(index);
+			file = NULL;
+		}
+	}
+
+	mutex_unlock(&sMappedFilesLock);
+	return file;
+}
+
+
+/*!	Adds the given MappedResourceFile to the cache, replacing an older
+	mapping of the same file. The cache acquires its own reference, and
+	releases the one of the least recently used file, if it is full.
+*/
+/*static*/ void
+MappedResourceFile::Add(MappedResourceFile* file)
+{
+	mutex_lock(&sMappedFilesLock);
+
+	int32 index = find_mapped_file(file->device, file->node);
+	if (index >= 0)
+		remove_mapped_file(index);
+
+	MappedResourceFile* last = sMappedFiles[kMaxCachedMappedFiles - 1];
+	memmove(sMappedFiles + 1, sMappedFiles,
+		(kMaxCachedMappedFiles - 1) * sizeof(file));
+	sMappedFiles[0] = file;
+	file->AcquireReference();
+
+	if (last != NULL)
+		last->ReleaseReference();
+
+	mutex_unlock(&sMappedFilesLock);
+}
+
+
+/*!	Removes the mapping of the given file from the cache, as the file is
+	about to be changed. ResourceItems that still refer to it keep it alive.
+*/
+/*static*/ void
+MappedResourceFile::Remove(dev_t device, ino_t node)
+{
+	mutex_lock(&sMappedFilesLock);
+
+	int32 index = find_mapped_file(device, node);
+	if (index >= 0)
+		remove_mapped_file(index);
+
+	mutex_unlock(&sMappedFilesLock);
+}
+
+
 // #pragma mark -
 
 
@@ -222,7 +464,8 @@ ResourceFile::ResourceFile()
 	fFile(),
 	fFileType(FILE_TYPE_UNKNOWN),
 	fHostEndianess(true),
-	fEmptyResources(true)
+	fEmptyResources(true),
+	fMappedFile(NULL)
 {
 }
 
@@ -238,6 +481,10 @@ ResourceFile::SetTo(BFile* file, bool clobber)
 {
 	status_t error = (file ? B_OK : B_BAD_VALUE);
 	Unset();
+	if (error == B_OK && !clobber && !file->IsWritable()
+		&& _InitFromMappedFile(*file)) {
+		return B_OK;
+	}
 	if (error == B_OK) {
 		try {
 			_InitFile(*file, clobber);
@@ -260,6 +507,11 @@ ResourceFile::Unset()
 	fFileType = FILE_TYPE_UNKNOWN;
 	fHostEndianess = true;
 	fEmptyResources = true;
+
+	if (fMappedFile != NULL) {
+		fMappedFile->ReleaseReference();
+		fMappedFile = NULL;
+	}
 }
 
 
@@ -275,6 +527,8 @@ ResourceFile::InitContainer(ResourcesContainer& container)
 {
 	container.MakeEmpty();
 	status_t error = InitCheck();
+	if (error == B_OK && fMappedFile != NULL)
+		return fMappedFile->InitContainer(container);
 	if (error == B_OK && !fEmptyResources) {
 		resource_parse_info parseInfo;
 		parseInfo.file_size = 0;
@@ -292,6 +546,7 @@ ResourceFile::InitContainer(ResourcesContainer& container)
 			_ReadIndex(parseInfo);
 			_ReadInfoTable(parseInfo);
 			container.SetModified(false);
+			_MapFile(container);
 		} catch (Exception exception) {
 			if (exception.Error() != B_OK)
 				error = exception.Error();
@@ -308,6 +563,13 @@ status_t
 ResourceFile::ReadResource(ResourceItem& resource, bool force)
 {
 	status_t error = InitCheck();
+
+	// Resources are read explicitly before they are written somewhere, which
+	// may well be this file. They must not refer to the mapping anymore
+	// then, as it would change, or even be truncated, underneath them.
+	if (error == B_OK && resource.IsMapped())
+		error = resource.CopyMappedData();
+
 	size_t size = resource.DataSize();
 	if (error == B_OK && (force || !resource.IsLoaded())) {
 		if (error == B_OK)
@@ -354,6 +616,12 @@ ResourceFile::WriteResources(ResourcesContainer& container)
 	status_t error = InitCheck();
 	if (error == B_OK && !fFile.File()->IsWritable())
 		error = B_NOT_ALLOWED;
+	if (error == B_OK) {
+		// other ResourceFiles must not use the mapping of the old contents
+		struct stat stat;
+		if (fFile.File()->GetStat(&stat) == B_OK)
+			MappedResourceFile::Remove(stat.st_dev, stat.st_ino);
+	}
 	if (error == B_OK && fFileType == FILE_TYPE_EMPTY)
 		error = _MakeEmptyResourceFile();
 	if (error == B_OK)
@@ -443,6 +711,66 @@ ResourceFile::_InitFile(BFile& file, bool clobber)
 }
 
 
+/*!	Initializes the object from the cached mapping of the given file, if
+	there is an up to date one. Returns whether that succeeded.
+*/
+bool
+ResourceFile::_InitFromMappedFile(BFile& file)
+{
+	struct stat stat;
+	if (file.GetStat(&stat) != B_OK)
+		return false;
+
+	MappedResourceFile* mappedFile = MappedResourceFile::Get(stat);
+	if (mappedFile == NULL)
+		return false;
+
+	fFile.SetTo(&file, mappedFile->resourcesOffset);
+	if (fFile.InitCheck() != B_OK) {
+		fFile.Unset();
+		mappedFile->ReleaseReference();
+		return false;
+	}
+
+	fFileType = mappedFile->fileType;
+	fHostEndianess = true;
+	fEmptyResources = false;
+	fMappedFile = mappedFile;
+	return true;
+}
+
+
+/*!	Maps the file into memory, if it has been opened read-only, lets the
+	resources of the freshly parsed \a container refer to their data in the
+	mapping, and adds the mapping to the cache.
+	Resources that need to be converted to the host's endianess cannot be
+	used in place, so those files are not mapped. Failing to map the file is
+	not an error, the data will be read from the file instead.
+*/
+void
+ResourceFile::_MapFile(ResourcesContainer& container)
+{
+	BFile* file = fFile.File();
+	struct stat stat;
+	if (!fHostEndianess || file->IsWritable() || file->GetStat(&stat) != B_OK)
+		return;
+
+	MappedResourceFile* mappedFile = new(std::nothrow) MappedResourceFile(stat,
+		fFileType, fFile.Offset());
+	if (mappedFile == NULL)
+		return;
+
+	if (mappedFile->Init(*file, container) != B_OK) {
+		mappedFile->ReleaseReference();
+		return;
+	}
+
+	mappedFile->MapResources(container);
+	MappedResourceFile::Add(mappedFile);
+	fMappedFile = mappedFile;
+}
+
+
 void
 ResourceFile::_InitELFFile(BFile& file)
 {
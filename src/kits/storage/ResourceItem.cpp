@@ -9,10 +9,12 @@
 
 #include "ResourceItem.h"
 
+#include <algorithm>
 #include <stdio.h>
 #include <string.h>
 
 #include <DataIO.h>
+#include <Referenceable.h>
 
 namespace BPrivate {
 namespace Storage {
@@ -26,7 +28,9 @@ ResourceItem::ResourceItem()
 			  fID(0),
 			  fName(),
 			  fIsLoaded(false),
-			  fIsModified(false)
+			  fIsModified(false),
+			  fMappedData(NULL),
+			  fMappedDataOwner(NULL)
 {
 	SetBlockSize(1);
 }
@@ -34,12 +38,34 @@ ResourceItem::ResourceItem()
 // destructor
 ResourceItem::~ResourceItem()
 {
+	SetMappedData(NULL, NULL);
+}
+
+// ReadAt
+ssize_t
+ResourceItem::ReadAt(off_t pos, void *buffer, size_t size)
+{
+	if (fMappedData == NULL)
+		return BMallocIO::ReadAt(pos, buffer, size);
+
+	if (buffer == NULL || pos < 0)
+		return B_BAD_VALUE;
+	if (pos >= (off_t)fInitialSize)
+		return 0;
+
+	size = std::min(size, fInitialSize - (size_t)pos);
+	memcpy(buffer, (const char *)fMappedData + pos, size);
+	return size;
 }
 
 // WriteAt
 ssize_t
 ResourceItem::WriteAt(off_t pos, const void *buffer, size_t size)
 {
+	status_t error = CopyMappedData();
+	if (error != B_OK)
+		return error;
+
 	ssize_t result = BMallocIO::WriteAt(pos, buffer, size);
 	if (result >= 0)
 		SetModified(true);
@@ -50,7 +76,9 @@ ResourceItem::WriteAt(off_t pos, const void *buffer, size_t size)
 status_t
 ResourceItem::SetSize(off_t size)
 {
-	status_t error = BMallocIO::SetSize(size);
+	status_t error = CopyMappedData();
+	if (error == B_OK)
+		error = BMallocIO::SetSize(size);
 	if (error == B_OK)
 		SetModified(true);
 	return error;
@@ -154,9 +182,37 @@ ResourceItem::Data() const
 	// the resource item still can be uniquely identified by its data pointer.
 	if (DataSize() == 0)
 		return const_cast<ResourceItem*>(this);
+	if (fMappedData != NULL)
+		return const_cast<void*>(fMappedData);
 	return const_cast<void*>(Buffer());
 }
 
+// SetMappedData
+/*!	\brief Lets the item refer to data that live in a memory mapped file.
+
+	The item acquires a reference to \a owner, which must keep the data
+	mapped as long as it is referenced. The data must have the item's
+	initial size. Passing \c NULL releases the data.
+*/
+void
+ResourceItem::SetMappedData(const void *data, BReferenceable *owner)
+{
+	if (owner != NULL)
+		owner->AcquireReference();
+	if (fMappedDataOwner != NULL)
+		fMappedDataOwner->ReleaseReference();
+
+	fMappedData = data;
+	fMappedDataOwner = owner;
+}
+
+// IsMapped
+bool
+ResourceItem::IsMapped() const
+{
+	return fMappedData != NULL;
+}
+
 // SetLoaded
 void
 ResourceItem::SetLoaded(bool loaded)
@@ -168,7 +224,7 @@ ResourceItem::SetLoaded(bool loaded)
 bool
 ResourceItem::IsLoaded() const
 {
-	return (BufferLength() > 0 || fIsLoaded);
+	return (BufferLength() > 0 || fIsLoaded || fMappedData != NULL);
 }
 
 // SetModified
@@ -185,6 +241,26 @@ ResourceItem::IsModified() const
 	return fIsModified;
 }
 
+// CopyMappedData
+/*!	\brief Copies the mapped data, if any, into the item's own buffer, so
+	that they can be modified, and don't depend on the file anymore.
+*/
+status_t
+ResourceItem::CopyMappedData()
+{
+	if (fMappedData == NULL)
+		return B_OK;
+
+	status_t error = BMallocIO::SetSize(fInitialSize);
+	if (error != B_OK)
+		return error;
+
+	memcpy(const_cast<void*>(Buffer()), fMappedData, fInitialSize);
+	SetMappedData(NULL, NULL);
+	SetLoaded(true);
+	return B_OK;
+}
+
 
 };	// namespace Storage
 };	// namespace BPrivate
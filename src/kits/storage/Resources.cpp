@@ -14,6 +14,11 @@
 	never be invalid. It always serves as a resources container, even if
 	it is not associated with a file. It is always possible to WriteTo()
 	the resources BResources contains to a file (a valid one of course).
+
+	If the file has been opened read-only, ResourceFile maps it into memory
+	and shares the mapping and the parsed resource index with all other
+	BResources objects for the same file, so that LoadResource() returns
+	pointers into the mapping instead of copies of the data.
 */
 #include <Resources.h>
 
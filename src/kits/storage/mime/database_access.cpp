@@ -1,5 +1,5 @@
 /*
- * Copyright 2002-2007, Haiku.
+ * Copyright 2002-2010, Haiku.
  * Distributed under the terms of the MIT License.
  *
  * Authors:
@@ -17,6 +17,7 @@
 #include <Directory.h>
 #include <IconUtils.h>
 #include <Message.h>
+#include <mime/database_index.h>
 #include <mime/database_support.h>
 #include <Node.h>
 #include <Path.h>
@@ -28,6 +29,8 @@
 #include <iostream>
 #include <new>			// For new(nothrow)
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <string>
 
 #include "mime/database_access.h"
@@ -383,12 +386,6 @@ get_icon_for_type(const char* type, const char* fileType, uint8** data,
 	if (!type || !data || !size)
 		return B_BAD_VALUE;
 
-	// open the node for the given type
-	BNode node;
-	ssize_t err = open_type(type, &node);
-	if (err < B_OK)
-		return (status_t)err;
-
 	// construct our attribute name
 	std::string iconAttrName;
 
@@ -397,8 +394,34 @@ get_icon_for_type(const char* type, const char* fileType, uint8** data,
 	else
 		iconAttrName = kIconAttr;
 
-	// get info about attribute for that name
+	// try the registrar's index of the database first
 	attr_info info;
+	void* indexData = NULL;
+	status_t status = read_indexed_mime_attr(type, iconAttrName.c_str(),
+		&indexData, &info);
+	if (status != B_UNSUPPORTED) {
+		if (status == B_OK && info.type != B_VECTOR_ICON_TYPE)
+			status = B_BAD_VALUE;
+		if (status == B_OK) {
+			uint8* buffer = new(std::nothrow) uint8[info.size];
+			if (buffer != NULL) {
+				memcpy(buffer, indexData, info.size);
+				*data = buffer;
+				*size = info.size;
+			} else
+				status = B_NO_MEMORY;
+		}
+		free(indexData);
+		return status;
+	}
+
+	// open the node for the given type
+	BNode node;
+	ssize_t err = open_type(type, &node);
+	if (err < B_OK)
+		return (status_t)err;
+
+	// get info about attribute for that name
 	if (!err) 
 		err = node.GetAttrInfo(iconAttrName.c_str(), &info);
 
@@ -499,6 +522,10 @@ get_supported_types(const char *type, BMessage *types)
 bool
 is_installed(const char *type)
 {
+	ssize_t status = read_indexed_mime_attr(type, NULL, (void*)NULL, 0);
+	if (status != B_UNSUPPORTED)
+		return status == B_OK;
+
 	BNode node;
 	return open_type(type, &node) == B_OK;
 }
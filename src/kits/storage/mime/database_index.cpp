@@ -0,0 +1,317 @@
+/*
+ * Copyright 2010, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+/*!
+	\file database_index.cpp
+	Read access to the registrar's in-memory copy of the MIME database
+*/
+
+
+#include "mime/database_index.h"
+
+#include <ctype.h>
+#include <fs_attr.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <AppMisc.h>
+#include <locks.h>
+#include <Mime.h>
+
+
+namespace BPrivate {
+namespace Storage {
+namespace Mime {
+
+
+static const bigtime_t kIndexLookupInterval = 1000000;
+	// how often we look for the index when there is none
+
+static mutex sIndexLock = MUTEX_INITIALIZER("mime database index");
+static area_id sIndexArea = -1;
+static const database_index_header* sIndex = NULL;
+static team_id sIndexTeam = -1;
+static bigtime_t sNextIndexLookup = 0;
+
+
+static void
+put_index_area()
+{
+	if (sIndexArea >= 0)
+		delete_area(sIndexArea);
+
+	sIndexArea = -1;
+	sIndex = NULL;
+}
+
+
+static bool
+clone_index_area(area_id source)
+{
+	area_info info;
+	if (get_area_info(source, &info) != B_OK)
+		return false;
+
+	if (info.team == BPrivate::current_team()) {
+		// this is the registrar itself, which always reads from disk
+		sNextIndexLookup = B_INFINITE_TIMEOUT;
+		return false;
+	}
+
+	database_index_header* header;
+	area_id area = clone_area(MIME_DATABASE_INDEX_AREA_NAME " clone",
+		(void**)&header, B_ANY_ADDRESS, B_READ_AREA, source);
+	if (area < B_OK)
+		return false;
+
+	if (header->magic != kDatabaseIndexMagic || header->size > info.size
+		|| header->hash_size == 0
+		|| (header->hash_size & (header->hash_size - 1)) != 0) {
+		delete_area(area);
+		return false;
+	}
+
+	sIndexArea = area;
+	sIndex = header;
+	sIndexTeam = BPrivate::current_team();
+	return true;
+}
+
+
+/*!	Makes sure sIndex points to the current index, if there is one.
+	sIndexLock must be held.
+*/
+static bool
+get_index()
+{
+	if (sIndex != NULL && sIndexTeam != BPrivate::current_team()) {
+		// we have been forked, and our copy of the area isn't updated
+		// anymore
+		put_index_area();
+		sNextIndexLookup = 0;
+	}
+
+	if (sIndex != NULL) {
+		if (sIndex->magic != kDatabaseIndexMagic) {
+			// the registrar could not keep the index up to date
+			put_index_area();
+			sNextIndexLookup = system_time() + kIndexLookupInterval;
+			return false;
+		}
+
+		area_id replacement = sIndex->replacement;
+		if (replacement < 0)
+			return true;
+
+		// the registrar moved the index into a larger area
+		put_index_area();
+		if (clone_index_area(replacement))
+			return true;
+
+		sNextIndexLookup = 0;
+	}
+
+	if (system_time() < sNextIndexLookup)
+		return false;
+
+	area_id area = find_area(MIME_DATABASE_INDEX_AREA_NAME);
+	if (area >= B_OK && clone_index_area(area))
+		return get_index();
+
+	if (sNextIndexLookup != B_INFINITE_TIMEOUT)
+		sNextIndexLookup = system_time() + kIndexLookupInterval;
+	return false;
+}
+
+
+/*!	Looks up the given attribute in the index, and calls \a copy with the
+	entry found while the index is locked. Returns \c B_UNSUPPORTED if there
+	is no index, and the database must be accessed directly.
+*/
+template<typename Copy>
+static status_t
+lookup_indexed_attr(const char* type, const char* attribute, Copy& copy)
+{
+	if (type == NULL)
+		return B_BAD_VALUE;
+
+	// the types are stored in lower case, like their file names
+	char lowerType[B_MIME_TYPE_LENGTH];
+	size_t length = strlen(type);
+	if (length >= sizeof(lowerType))
+		return B_UNSUPPORTED;
+	for (size_t i = 0; i <= length; i++)
+		lowerType[i] = tolower(type[i]);
+
+	mutex_lock(&sIndexLock);
+
+	status_t status = B_UNSUPPORTED;
+	if (get_index()) {
+		const database_index_entry* entry = database_index_find(sIndex,
+			lowerType, attribute);
+		status = entry != NULL ? copy(entry) : B_ENTRY_NOT_FOUND;
+	}
+
+	mutex_unlock(&sIndexLock);
+	return status;
+}
+
+
+struct copy_to_buffer {
+	copy_to_buffer(void* data, size_t length, attr_info* info)
+		: data(data), length(length), info(info), bytesCopied(0)
+	{
+	}
+
+	status_t operator()(const database_index_entry* entry)
+	{
+		if (data != NULL) {
+			bytesCopied = min_c(length, (size_t)entry->size);
+			memcpy(data, entry->Data(), bytesCopied);
+		}
+		if (info != NULL) {
+			info->type = entry->type;
+			info->size = entry->size;
+		}
+		return B_OK;
+	}
+
+	void*		data;
+	size_t		length;
+	attr_info*	info;
+	size_t		bytesCopied;
+};
+
+
+struct copy_to_allocation {
+	copy_to_allocation(attr_info* info)
+		: data(NULL), info(info)
+	{
+	}
+
+	status_t operator()(const database_index_entry* entry)
+	{
+		data = malloc(max_c(entry->size, 1));
+		if (data == NULL)
+			return B_NO_MEMORY;
+
+		memcpy(data, entry->Data(), entry->size);
+		info->type = entry->type;
+		info->size = entry->size;
+		return B_OK;
+	}
+
+	void*		data;
+	attr_info*	info;
+};
+
+
+// #pragma mark -
+
+
+uint32
+database_index_hash(const char* type, const char* attribute)
+{
+	uint32 hash = 0;
+	for (; type[0] != '\0'; type++)
+		hash = (hash << 5) - hash + (uint8)type[0];
+	hash = (hash << 5) - hash;
+	for (; attribute[0] != '\0'; attribute++)
+		hash = (hash << 5) - hash + (uint8)attribute[0];
+	return hash;
+}
+
+
+/*!	Returns the index entry of the given attribute of the given type, or
+	the entry of the type itself if \a attribute is \c NULL. \c NULL is
+	returned if the type is not installed, or doesn't have that attribute.
+*/
+const database_index_entry*
+database_index_find(const database_index_header* header, const char* type,
+	const char* attribute)
+{
+	const uint8* base = (const uint8*)header;
+	const database_index_entry* typeEntry = NULL;
+	bool findType = true;
+	if (attribute == NULL)
+		attribute = "";
+
+	while (true) {
+		const char* name = findType ? "" : attribute;
+		uint32 hash = database_index_hash(type, name);
+		uint32 offset = header->table[hash & (header->hash_size - 1)];
+
+		const database_index_entry* entry = NULL;
+		while (offset != 0
+			&& offset + sizeof(database_index_entry) <= header->size) {
+			const database_index_entry* candidate
+				= (const database_index_entry*)(base + offset);
+			if (candidate->hash == hash
+				&& (findType || candidate->serial == typeEntry->serial)
+				&& !strcmp(candidate->Type(), type)
+				&& !strcmp(candidate->Attribute(), name)) {
+				entry = candidate;
+				break;
+			}
+			offset = candidate->next;
+		}
+
+		if (!findType)
+			return entry;
+
+		if (entry == NULL || entry->size < 0)
+			return NULL;
+		if (attribute[0] == '\0')
+			return entry;
+
+		typeEntry = entry;
+		findType = false;
+	}
+}
+
+
+/*!	Reads up to \a length bytes of the given attribute from the index.
+	If \a data is \c NULL, only the attribute info is retrieved, and if
+	\a attribute is \c NULL, only the existence of the type is checked.
+	\return If successful, the number of bytes read is returned, otherwise
+		an error code. \c B_UNSUPPORTED is returned if there is no index,
+		and the database must be accessed directly.
+*/
+ssize_t
+read_indexed_mime_attr(const char* type, const char* attribute, void* data,
+	size_t length, attr_info* info)
+{
+	copy_to_buffer copy(data, length, info);
+	status_t status = lookup_indexed_attr(type, attribute, copy);
+	if (status != B_OK)
+		return status;
+
+	return copy.bytesCopied;
+}
+
+
+/*!	Returns a copy of the given attribute from the index. The data is
+	allocated with malloc(), and must be freed by the caller.
+	\return \c B_UNSUPPORTED if there is no index, and the database must be
+		accessed directly.
+*/
+status_t
+read_indexed_mime_attr(const char* type, const char* attribute,
+	void** _data, attr_info* info)
+{
+	if (attribute == NULL || _data == NULL || info == NULL)
+		return B_BAD_VALUE;
+
+	copy_to_allocation copy(info);
+	status_t status = lookup_indexed_attr(type, attribute, copy);
+	if (status == B_OK)
+		*_data = copy.data;
+
+	return status;
+}
+
+} // namespace Mime
+} // namespace Storage
+} // namespace BPrivate
@@ -1,5 +1,5 @@
 /*
- * Copyright 2002-2006, Haiku.
+ * Copyright 2002-2010, Haiku.
  * Distributed under the terms of the MIT License.
  *
  * Authors:
@@ -19,14 +19,17 @@
 #include <Message.h>
 #include <Node.h>
 #include <Path.h>
+#include <String.h>
 #include <storage_support.h>
 #include <TypeConstants.h>
 
 #include <fs_attr.h>	// For struct attr_info
 #include <new>			// For new(nothrow)
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
+#include "mime/database_index.h"
 #include "mime/database_support.h"
 
 //#define DBG(x) x
@@ -239,10 +242,15 @@ ssize_t
 read_mime_attr(const char *type, const char *attr, void *data,
 	size_t len, type_code datatype)
 {
+	if (!type || !attr || !data)
+		return B_BAD_VALUE;
+
+	ssize_t err = read_indexed_mime_attr(type, attr, data, len);
+	if (err != B_UNSUPPORTED)
+		return err;
+
 	BNode node;
-	ssize_t err = (type && attr && data ? B_OK : B_BAD_VALUE);
-	if (!err)
-		err = open_type(type, &node);
+	err = open_type(type, &node);
 	if (!err)
 		err = node.ReadAttr(attr, datatype, 0, data, len);
 	return err;
@@ -264,12 +272,24 @@ read_mime_attr(const char *type, const char *attr, void *data,
 status_t
 read_mime_attr_message(const char *type, const char *attr, BMessage *msg)
 {
-	BNode node;
+	if (!type || !attr || !msg)
+		return B_BAD_VALUE;
+
 	attr_info info;
+	void *data;
+	status_t status = read_indexed_mime_attr(type, attr, &data, &info);
+	if (status != B_UNSUPPORTED) {
+		if (status == B_OK) {
+			status = info.type == B_MESSAGE_TYPE
+				? msg->Unflatten((const char*)data) : B_BAD_VALUE;
+			free(data);
+		}
+		return status;
+	}
+
+	BNode node;
 	char *buffer = NULL;
-	ssize_t err = (type && attr && msg ? B_OK : B_BAD_VALUE);
-	if (!err)
-		err = open_type(type, &node);
+	ssize_t err = open_type(type, &node);
 	if (!err)
 		err = node.GetAttrInfo(attr, &info);
 	if (!err)
@@ -304,10 +324,29 @@ read_mime_attr_message(const char *type, const char *attr, BMessage *msg)
 status_t
 read_mime_attr_string(const char *type, const char *attr, BString *str)
 {
+	if (!type || !attr || !str)
+		return B_BAD_VALUE;
+
+	attr_info info;
+	void *data;
+	status_t err = read_indexed_mime_attr(type, attr, &data, &info);
+	if (err != B_UNSUPPORTED) {
+		if (!err) {
+			// like BNode::ReadAttrString(), the data is null terminated
+			char *buffer = str->LockBuffer(info.size + 1);
+			if (buffer) {
+				memcpy(buffer, data, info.size);
+				buffer[info.size] = '\0';
+				str->UnlockBuffer();
+			} else
+				err = B_NO_MEMORY;
+			free(data);
+		}
+		return err;
+	}
+
 	BNode node;
-	status_t err = (type && attr && str ? B_OK : B_BAD_VALUE);
-	if (!err)
-		err = open_type(type, &node);
+	err = open_type(type, &node);
 	if (!err)
 		err = node.ReadAttrString(attr, str);
 	return err;
@@ -0,0 +1,380 @@
+/*
+ * Copyright 2010, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+/*!
+	\file Matcher.cpp
+	MIME sniffer rule set matcher implementation
+
+	Instead of sniffing every rule on its own, which reads and compares
+	the data once for every pattern and every offset of its range, the
+	patterns of all rules are put into a single Aho-Corasick automaton.
+
+	Only the longest unmasked part of each pattern, its "anchor", is
+	stored in the automaton; the anchors are case folded, so that the
+	automaton finds both case sensitive and case insensitive patterns. For
+	every anchor found, the complete pattern is then compared at the
+	offset implied by it, exactly like Pattern::Sniff() does, and only if
+	that offset is within the pattern's range. Patterns without any
+	unmasked byte are compared at every offset of their range instead.
+
+	Once the data has been scanned, the rules are evaluated in the order
+	they have been added, and the index of the first one for which all of
+	the disjunction lists have a matching pattern is returned.
+*/
+
+#include <sniffer/DisjList.h>
+#include <sniffer/Matcher.h>
+#include <sniffer/Pattern.h>
+#include <sniffer/Range.h>
+#include <sniffer/Rule.h>
+
+#include <new>
+
+using namespace BPrivate::Storage::Sniffer;
+
+
+struct Matcher::term {
+	std::string	pattern;
+	std::string	mask;
+	int32		start;
+	int32		end;
+	int32		anchorOffset;
+	int32		anchorLength;
+	bool		caseInsensitive;
+};
+
+struct Matcher::node {
+	std::vector<std::pair<uint8, int32> >	edges;
+	std::vector<int32>						terms;
+		// the terms whose anchor ends in this node
+	int32									failure;
+	int32									output;
+		// the next node on the failure path that has terms, or -1
+
+	node()
+		: failure(0)
+		, output(-1)
+	{
+	}
+
+	int32 Child(uint8 c) const
+	{
+		for (size_t i = 0; i < edges.size(); i++) {
+			if (edges[i].first == c)
+				return edges[i].second;
+		}
+		return -1;
+	}
+};
+
+
+static inline uint8
+fold_case(uint8 c)
+{
+	if (c >= 'A' && c <= 'Z')
+		return c + ('a' - 'A');
+	return c;
+}
+
+
+Matcher::Matcher()
+	: fScanLength(0)
+	, fCompiled(false)
+{
+}
+
+Matcher::~Matcher() {
+}
+
+//! Removes all rules from the matcher.
+void
+Matcher::MakeEmpty() {
+	fTerms.clear();
+	fDisjLists.clear();
+	fRules.clear();
+	fNodes.clear();
+	fUnanchoredTerms.clear();
+	fScanLength = 0;
+	fCompiled = false;
+}
+
+/*! \brief Appends the given rule to the matcher. Compile() needs to be
+	called again before Match() can be used.
+
+	Uninitialized rules are added as well, so that the rule indices stay
+	the same, but they never match.
+*/
+status_t
+Matcher::AddRule(const Rule* rule) {
+	fCompiled = false;
+
+	try {
+		fRules.push_back(fDisjLists.size());
+
+		if (rule == NULL || rule->InitCheck() != B_OK) {
+			// a disjunction list without any patterns never matches
+			fDisjLists.push_back(fTerms.size());
+			return B_OK;
+		}
+
+		std::vector<DisjList*>::const_iterator i;
+		for (i = rule->fConjList->begin(); i != rule->fConjList->end(); i++) {
+			if (*i) {
+				fDisjLists.push_back(fTerms.size());
+				(*i)->AddTo(*this);
+			}
+		}
+	} catch (std::bad_alloc&) {
+		MakeEmpty();
+		return B_NO_MEMORY;
+	}
+
+	return B_OK;
+}
+
+//! Builds the automaton for the rules added so far.
+status_t
+Matcher::Compile() {
+	fNodes.clear();
+	fUnanchoredTerms.clear();
+	fScanLength = 0;
+
+	try {
+		fNodes.push_back(node());
+
+		// build the trie of the anchors
+
+		for (size_t i = 0; i < fTerms.size(); i++) {
+			const term& term = fTerms[i];
+			if (term.anchorLength == 0) {
+				fUnanchoredTerms.push_back(i);
+				continue;
+			}
+
+			int32 state = 0;
+			for (int32 j = 0; j < term.anchorLength; j++) {
+				uint8 c = fold_case(term.pattern[term.anchorOffset + j]);
+				int32 child = fNodes[state].Child(c);
+				if (child < 0) {
+					child = fNodes.size();
+					fNodes.push_back(node());
+					fNodes[state].edges.push_back(std::make_pair(c, child));
+				}
+				state = child;
+			}
+			fNodes[state].terms.push_back(i);
+
+			// there is no need to scan beyond the end of the last anchor
+			int64 scanLength = (int64)term.end + term.anchorOffset
+				+ term.anchorLength;
+			if (scanLength > (int64)fScanLength)
+				fScanLength = scanLength;
+		}
+
+		// compute the failure links breadth first
+
+		for (int32 c = 0; c < 256; c++)
+			fRootTransitions[c] = 0;
+
+		std::vector<int32> queue;
+		const node& root = fNodes[0];
+		for (size_t i = 0; i < root.edges.size(); i++) {
+			fRootTransitions[root.edges[i].first] = root.edges[i].second;
+			queue.push_back(root.edges[i].second);
+		}
+
+		for (size_t i = 0; i < queue.size(); i++) {
+			int32 parent = queue[i];
+			for (size_t j = 0; j < fNodes[parent].edges.size(); j++) {
+				uint8 c = fNodes[parent].edges[j].first;
+				int32 child = fNodes[parent].edges[j].second;
+
+				int32 failure = _Next(fNodes[parent].failure, c);
+				fNodes[child].failure = failure;
+				fNodes[child].output = fNodes[failure].terms.empty()
+					? fNodes[failure].output : failure;
+
+				queue.push_back(child);
+			}
+		}
+	} catch (std::bad_alloc&) {
+		fNodes.clear();
+		fUnanchoredTerms.clear();
+		return B_NO_MEMORY;
+	}
+
+	fCompiled = true;
+	return B_OK;
+}
+
+//! Returns the number of rules added to the matcher.
+int32
+Matcher::CountRules() const {
+	return fRules.size();
+}
+
+/*! \brief Returns the index of the first rule that matches the given data,
+	or -1 if none of them does.
+
+	The result is the same as when calling Rule::Sniff() for every rule in
+	order, and stopping at the first match.
+*/
+int32
+Matcher::Match(const void* _data, size_t length) const {
+	if (!fCompiled)
+		return -1;
+
+	const uint8* data = (const uint8*)_data;
+	std::vector<bool> matched(fTerms.size(), false);
+
+	// run the automaton over the data
+
+	size_t scanLength = min_c(length, fScanLength);
+	int32 state = 0;
+	for (size_t position = 0; position < scanLength; position++) {
+		state = _Next(state, fold_case(data[position]));
+
+		int32 output = fNodes[state].terms.empty()
+			? fNodes[state].output : state;
+		for (; output >= 0; output = fNodes[output].output) {
+			const std::vector<int32>& terms = fNodes[output].terms;
+			for (size_t i = 0; i < terms.size(); i++) {
+				int32 index = terms[i];
+				if (matched[index])
+					continue;
+
+				const term& term = fTerms[index];
+				int64 start = (int64)position + 1 - term.anchorLength
+					- term.anchorOffset;
+				if (start >= 0 && start >= term.start && start <= term.end
+					&& _MatchesAt(term, data, length, start))
+					matched[index] = true;
+			}
+		}
+	}
+
+	for (size_t i = 0; i < fUnanchoredTerms.size(); i++) {
+		int32 index = fUnanchoredTerms[i];
+		matched[index] = _MatchesInRange(fTerms[index], data, length);
+	}
+
+	// find the first rule for which all disjunction lists match
+
+	for (size_t rule = 0; rule < fRules.size(); rule++) {
+		size_t lastList = rule + 1 < fRules.size()
+			? fRules[rule + 1] : fDisjLists.size();
+		bool ruleMatches = true;
+
+		for (size_t list = fRules[rule]; list < lastList; list++) {
+			size_t lastTerm = list + 1 < fDisjLists.size()
+				? fDisjLists[list + 1] : fTerms.size();
+			bool listMatches = false;
+
+			for (size_t index = fDisjLists[list]; index < lastTerm; index++) {
+				if (matched[index]) {
+					listMatches = true;
+					break;
+				}
+			}
+
+			if (!listMatches) {
+				ruleMatches = false;
+				break;
+			}
+		}
+
+		if (ruleMatches)
+			return rule;
+	}
+
+	return -1;
+}
+
+/*! \brief Adds a pattern to the last disjunction list of the rule currently
+	being added, to be searched over the given range.
+*/
+void
+Matcher::AddPattern(const Pattern& pattern, const Range& range,
+	bool caseInsensitive) {
+	if (pattern.InitCheck() != B_OK || range.InitCheck() != B_OK)
+		return;
+
+	term term;
+	term.pattern = pattern.String();
+	term.mask = pattern.Mask();
+	term.start = range.Start();
+	term.end = range.End();
+	term.caseInsensitive = caseInsensitive;
+
+	// the anchor is the longest run of bytes that aren't masked
+	term.anchorOffset = 0;
+	term.anchorLength = 0;
+	int32 runStart = 0;
+	for (int32 i = 0; i < (int32)term.mask.length(); i++) {
+		if ((uint8)term.mask[i] != 0xff) {
+			runStart = i + 1;
+			continue;
+		}
+		if (i + 1 - runStart > term.anchorLength) {
+			term.anchorOffset = runStart;
+			term.anchorLength = i + 1 - runStart;
+		}
+	}
+
+	fTerms.push_back(term);
+}
+
+int32
+Matcher::_Next(int32 state, uint8 c) const {
+	while (state != 0) {
+		int32 child = fNodes[state].Child(c);
+		if (child >= 0)
+			return child;
+		state = fNodes[state].failure;
+	}
+	return fRootTransitions[c];
+}
+
+//! Compares the term's pattern with the data at the given offset.
+bool
+Matcher::_MatchesAt(const term& term, const uint8* data, size_t length,
+	int32 start) const {
+	size_t patternLength = term.pattern.length();
+	if (start + patternLength > length)
+		return false;
+
+	const char* buffer = (const char*)data + start;
+	for (size_t i = 0; i < patternLength; i++) {
+		char patternChar = term.pattern[i];
+		char mask = term.mask[i];
+		if ((patternChar & mask) == (buffer[i] & mask))
+			continue;
+		if (!term.caseInsensitive)
+			return false;
+
+		// also check the other case
+		char secondChar = patternChar;
+		if ('A' <= patternChar && patternChar <= 'Z')
+			secondChar = 'a' + (patternChar - 'A');
+		else if ('a' <= patternChar && patternChar <= 'z')
+			secondChar = 'A' + (patternChar - 'a');
+		if ((secondChar & mask) != (buffer[i] & mask))
+			return false;
+	}
+
+	return true;
+}
+
+//! Compares the term's pattern with the data at every offset of its range.
+bool
+Matcher::_MatchesInRange(const term& term, const uint8* data,
+	size_t length) const {
+	int64 end = min_c((int64)term.end, (int64)length - 1);
+	for (int64 start = max_c(term.start, 0); start <= end; start++) {
+		if (_MatchesAt(term, data, length, start))
+			return true;
+	}
+	return false;
+}
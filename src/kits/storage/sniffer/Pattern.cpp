@@ -110,6 +110,20 @@ Pattern::BytesNeeded() const
 	return result;
 }
 
+//! Returns the byte string of the pattern.
+const std::string&
+Pattern::String() const
+{
+	return fString;
+}
+
+//! Returns the mask of the pattern, which is as long as its byte string.
+const std::string&
+Pattern::Mask() const
+{
+	return fMask;
+}
+
 //#define OPTIMIZATION_IS_FOR_CHUMPS
 #if OPTIMIZATION_IS_FOR_CHUMPS
 bool
@@ -8,6 +8,7 @@
 */
 
 #include <sniffer/Err.h>
+#include <sniffer/Matcher.h>
 #include <sniffer/Pattern.h>
 #include <sniffer/PatternList.h>
 #include <DataIO.h>
@@ -91,6 +92,18 @@ PatternList::BytesNeeded() const
 	return result;	
 }
 
+//! Adds all patterns of the list to the given matcher.
+void
+PatternList::AddTo(Matcher& matcher) const {
+	if (InitCheck() != B_OK)
+		return;
+	std::vector<Pattern*>::const_iterator i;
+	for (i = fList.begin(); i != fList.end(); i++) {
+		if (*i)
+			matcher.AddPattern(**i, fRange, fCaseInsensitive);
+	}
+}
+
 void
 PatternList::Add(Pattern *pattern) {
 	if (pattern)
@@ -8,6 +8,7 @@
 */
 
 #include <sniffer/Err.h>
+#include <sniffer/Matcher.h>
 #include <sniffer/Pattern.h>
 #include <sniffer/Range.h>
 #include <sniffer/RPattern.h>
@@ -71,4 +72,9 @@ RPattern::BytesNeeded() const
 	return result;	
 }
 
-
+//! Adds the object's pattern to the given matcher, to be searched over the object's range
+void
+RPattern::AddTo(Matcher& matcher, bool caseInsensitive) const {
+	if (InitCheck() == B_OK)
+		matcher.AddPattern(*fPattern, fRange, caseInsensitive);
+}
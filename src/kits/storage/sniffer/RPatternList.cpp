@@ -84,6 +84,16 @@ RPatternList::BytesNeeded() const
 	return result;
 }
 	
+//! Adds all rpatterns of the list to the given matcher.
+void
+RPatternList::AddTo(Matcher& matcher) const {
+	std::vector<RPattern*>::const_iterator i;
+	for (i = fList.begin(); i != fList.end(); i++) {
+		if (*i)
+			(*i)->AddTo(matcher, fCaseInsensitive);
+	}
+}
+
 void
 RPatternList::Add(RPattern *rpattern) {
 	if (rpattern)
@@ -35,7 +35,14 @@
 #define REPLACE_ALL 0x7FFFFFFF
 
 
-const uint32 kPrivateDataOffset = 2 * sizeof(int32);
+// The private data is preceded by a header of capacity, reference count, and
+// length; the length has to come last, as it is accessed by the inline
+// BString::Length().
+const uint32 kPrivateDataOffset = 3 * sizeof(int32);
+
+// Buffers are grown by half of their size at least, and only shrunk once
+// less than a quarter of them is in use.
+const int32 kMinimumShrinkCapacity = 64;
 
 const char* B_EMPTY_STRING = "";
 
@@ -80,6 +87,13 @@ safestr(const char* str)
 }
 
 
+static inline int32&
+data_capacity(char* data)
+{
+	return *(((int32*)data) - 3);
+}
+
+
 static inline vint32&
 data_reference_count(char* data)
 {
@@ -94,6 +108,45 @@ data_length(char* data)
 }
 
 
+//	#pragma mark - empty string
+
+
+/*!	All empty strings share this buffer, so that constructing them does not
+	need to allocate memory. Its reference count is never changed, and is
+	always larger than one, so that it will be copied before it is written to.
+*/
+static struct {
+	int32	capacity;
+	vint32	reference_count;
+	int32	length;
+	char	data[4];
+} sEmptyString = { 0, 2, 0, "" };
+
+
+static inline bool
+is_empty_data(const char* data)
+{
+	return data == sEmptyString.data;
+}
+
+
+static inline void
+acquire_data(char* data)
+{
+	if (!is_empty_data(data))
+		atomic_add(&data_reference_count(data), 1);
+}
+
+
+//! Returns whether or not the caller was the last owner of the data.
+static inline bool
+release_data(char* data)
+{
+	return !is_empty_data(data)
+		&& atomic_add(&data_reference_count(data), -1) == 1;
+}
+
+
 //	#pragma mark - PosVect
 
 
@@ -244,7 +297,7 @@ BString::BString(const BString& string)
 	// check if source is sharable - if so, share else clone
 	if (string._IsShareable()) {
 		fPrivateData = string.fPrivateData;
-		atomic_add(&_ReferenceCount(), 1);
+		acquire_data(fPrivateData);
 			// string cannot go away right now
 	} else
 		_Init(string.String(), string.Length());
@@ -260,7 +313,7 @@ BString::BString(const char* string, int32 maxLength)
 
 BString::~BString()
 {
-	if (!_IsShareable() || atomic_add(&_ReferenceCount(), -1) == 1)
+	if (!_IsShareable() || release_data(fPrivateData))
 		_FreePrivateData();
 }
 
@@ -333,20 +386,13 @@ BString::SetTo(const BString& string)
 	if (fPrivateData == string.fPrivateData)
 		return *this;
 
-	bool freeData = true;
-
-	if (_IsShareable() && atomic_add(&_ReferenceCount(), -1) > 1) {
-		// there is still someone who shares our data
-		freeData = false;
-	}
-
-	if (freeData)
+	if (!_IsShareable() || release_data(fPrivateData))
 		_FreePrivateData();
 
 	// if source is sharable share, otherwise clone
 	if (string._IsShareable()) {
 		fPrivateData = string.fPrivateData;
-		atomic_add(&_ReferenceCount(), 1);
+		acquire_data(fPrivateData);
 			// the string cannot go away right now
 	} else
 		_Init(string.String(), string.Length());
@@ -2081,7 +2127,7 @@ BString::_MakeWritable()
 	if (atomic_get(&_ReferenceCount()) > 1) {
 		// It might be shared, and this requires special treatment
 		char* newData = _Clone(fPrivateData, Length());
-		if (atomic_add(&_ReferenceCount(), -1) == 1) {
+		if (release_data(fPrivateData)) {
 			// someone else left, we were the last owner
 			_FreePrivateData();
 		}
@@ -2116,7 +2162,7 @@ BString::_MakeWritable(int32 length, bool copy)
 		if (newData == NULL)
 			return B_NO_MEMORY;
 
-		if (atomic_add(&_ReferenceCount(), -1) == 1) {
+		if (release_data(fPrivateData)) {
 			// someone else left, we were the last owner
 			_FreePrivateData();
 		}
@@ -2133,6 +2179,17 @@ BString::_MakeWritable(int32 length, bool copy)
 }
 
 
+/*!	Returns the capacity of a buffer that can hold at least \a length bytes.
+	The slack the allocator will most likely leave anyway is used as well.
+*/
+static inline int32
+buffer_capacity(int32 length)
+{
+	return ((length + kPrivateDataOffset + 1 + 15) & ~15)
+		- kPrivateDataOffset - 1;
+}
+
+
 /*!	Allocates a new private data buffer with the space to store \a length bytes
 	(not including the terminating null).
 */
@@ -2142,14 +2199,16 @@ BString::_Allocate(int32 length)
 	if (length < 0)
 		return NULL;
 
-	char* newData = (char*)malloc(length + kPrivateDataOffset + 1);
+	int32 capacity = buffer_capacity(length);
+	char* newData = (char*)malloc(capacity + kPrivateDataOffset + 1);
 	if (newData == NULL)
 		return NULL;
 
 	newData += kPrivateDataOffset;
 	newData[length] = '\0';
 
-	// initialize reference count & length
+	// initialize capacity, reference count & length
+	data_capacity(newData) = capacity;
 	data_reference_count(newData) = 1;
 	data_length(newData) = length & 0x7fffffff;
 
@@ -2159,41 +2218,56 @@ BString::_Allocate(int32 length)
 
 /*!	Resizes the private data buffer. You must already have a writable buffer
 	when you call this method.
+	The buffer is only reallocated when \a length exceeds its capacity, or
+	when most of it would be unused.
 */
 char*
 BString::_Resize(int32 length)
 {
-	ASSERT(_ReferenceCount() == 1 || _ReferenceCount() == -1);
-
-	if (length == Length())
-		return fPrivateData;
+	ASSERT(_ReferenceCount() == 1 || _ReferenceCount() == -1
+		|| is_empty_data(fPrivateData));
 
-	char* data = fPrivateData ? fPrivateData - kPrivateDataOffset : NULL;
 	if (length < 0)
 		length = 0;
 
-	data = (char*)realloc(data, length + kPrivateDataOffset + 1);
-	if (data == NULL)
-		return NULL;
+	char* data = NULL;
+	int32 capacity = 0;
+	if (fPrivateData != NULL && !is_empty_data(fPrivateData)) {
+		data = fPrivateData - kPrivateDataOffset;
+		capacity = data_capacity(fPrivateData);
+	}
 
-	data += kPrivateDataOffset;
+	if (data == NULL || length > capacity
+		|| (capacity > kMinimumShrinkCapacity && length < capacity / 4)) {
+		int32 newCapacity = length;
+		if (length > capacity && data != NULL)
+			newCapacity = max_c(length, capacity + capacity / 2);
+		newCapacity = buffer_capacity(newCapacity);
+
+		data = (char*)realloc(data, newCapacity + kPrivateDataOffset + 1);
+		if (data == NULL)
+			return NULL;
+
+		fPrivateData = data + kPrivateDataOffset;
+		data_capacity(fPrivateData) = newCapacity;
+	}
 
-	fPrivateData = data;
 	fPrivateData[length] = '\0';
 
 	_SetLength(length);
 	_ReferenceCount() = 1;
 
-	return data;
+	return fPrivateData;
 }
 
 
 void
 BString::_Init(const char* src, int32 length)
 {
-	fPrivateData = _Clone(src, length);
-	if (fPrivateData == NULL)
-		fPrivateData = _Clone(NULL, 0);
+	if (length > 0)
+		fPrivateData = _Clone(src, length);
+	if (length <= 0 || fPrivateData == NULL)
+		fPrivateData = sEmptyString.data;
 }
 
 
@@ -2218,12 +2292,12 @@ BString::_OpenAtBy(int32 offset, int32 length)
 {
 	int32 oldLength = Length();
 
-	if (_MakeWritable() != B_OK)
+	if (_MakeWritable(oldLength + length, true) != B_OK)
 		return NULL;
 
 	memmove(fPrivateData + offset + length, fPrivateData + offset,
 		oldLength - offset);
-	return _Resize(oldLength + length);
+	return fPrivateData;
 }
 
 
@@ -2251,7 +2325,8 @@ void
 BString::_FreePrivateData()
 {
 	if (fPrivateData != NULL) {
-		free(fPrivateData - kPrivateDataOffset);
+		if (!is_empty_data(fPrivateData))
+			free(fPrivateData - kPrivateDataOffset);
 		fPrivateData = NULL;
 	}
 }
@@ -2451,12 +2526,44 @@ BString::_DoReplace(const char* findThis, const char* replaceWith,
 		replaceWith = "";
 
 	int32 replaceLen = strlen(replaceWith);
+	if (findLen == 0)
+		return *this;
+
 	int32 lastSrcPos = fromOffset;
+
+	if (replaceLen <= findLen) {
+		// The string cannot grow, so we can replace in place and in a single
+		// pass: everything is moved to the front as far as the replacements
+		// made before have made room for it.
+		int32 destPos = lastSrcPos;
+		for (int32 srcPos = 0; maxReplaceCount > 0
+			&& (srcPos = (this->*findMethod)(findThis, lastSrcPos, findLen))
+				>= 0; maxReplaceCount--) {
+			if (destPos != lastSrcPos) {
+				memmove(fPrivateData + destPos, fPrivateData + lastSrcPos,
+					srcPos - lastSrcPos);
+			}
+			destPos += srcPos - lastSrcPos;
+			memcpy(fPrivateData + destPos, replaceWith, replaceLen);
+			destPos += replaceLen;
+			lastSrcPos = srcPos + findLen;
+		}
+
+		if (destPos != lastSrcPos) {
+			int32 length = Length();
+			memmove(fPrivateData + destPos, fPrivateData + lastSrcPos,
+				length - lastSrcPos);
+			_Resize(length - (lastSrcPos - destPos));
+		}
+		return *this;
+	}
+
 	PosVect positions;
 	for (int32 srcPos = 0; maxReplaceCount > 0
 		&& (srcPos = (this->*findMethod)(findThis, lastSrcPos, findLen)) >= 0;
 			maxReplaceCount--) {
-		positions.Add(srcPos);
+		if (!positions.Add(srcPos))
+			return *this;
 		lastSrcPos = srcPos + findLen;
 	}
 	_ReplaceAtPositions(&positions, findLen, replaceWith, replaceLen);
@@ -2464,46 +2571,76 @@ BString::_DoReplace(const char* findThis, const char* replaceWith,
 }
 
 
+/*!	Replaces the \a searchLength bytes at each of the given \a positions with
+	\a with. Unless the buffer is too small, the string is moved in place,
+	starting at its end when it grows, or at its start otherwise.
+*/
 void
 BString::_ReplaceAtPositions(const PosVect* positions, int32 searchLength,
 	const char* with, int32 withLength)
 {
 	int32 length = Length();
-	uint32 count = positions->CountItems();
-	int32 newLength = length + count * (withLength - searchLength);
-	if (!newLength) {
-		_Resize(0);
+	int32 count = positions->CountItems();
+	if (count == 0)
 		return;
-	}
 
-	char* newData = _Allocate(newLength);
-	if (newData == NULL)
+	int32 newLength = length + count * (withLength - searchLength);
+
+	if (withLength <= searchLength) {
+		int32 destPos = positions->ItemAt(0);
+		for (int32 i = 0; i < count; i++) {
+			int32 pos = positions->ItemAt(i);
+			int32 end = i + 1 < count ? positions->ItemAt(i + 1) : length;
+
+			memcpy(fPrivateData + destPos, with, withLength);
+			destPos += withLength;
+			memmove(fPrivateData + destPos, fPrivateData + pos + searchLength,
+				end - pos - searchLength);
+			destPos += end - pos - searchLength;
+		}
+
+		_Resize(newLength);
 		return;
+	}
 
-	char* oldString = fPrivateData;
-	char* newString = newData;
-	int32 lastPos = 0;
+	if (newLength > data_capacity(fPrivateData)) {
+		// the buffer has to be reallocated anyway, so copy the string over
+		char* newData = _Allocate(newLength);
+		if (newData == NULL)
+			return;
 
-	for (uint32 i = 0; i < count; ++i) {
-		int32 pos = positions->ItemAt(i);
-		length = pos - lastPos;
-		if (length > 0) {
-			memcpy(newString, oldString, length);
-			oldString += length;
-			newString += length;
+		int32 destPos = 0;
+		int32 lastPos = 0;
+		for (int32 i = 0; i < count; i++) {
+			int32 pos = positions->ItemAt(i);
+			memcpy(newData + destPos, fPrivateData + lastPos, pos - lastPos);
+			destPos += pos - lastPos;
+			memcpy(newData + destPos, with, withLength);
+			destPos += withLength;
+			lastPos = pos + searchLength;
 		}
-		memcpy(newString, with, withLength);
-		oldString += searchLength;
-		newString += withLength;
-		lastPos = pos + searchLength;
+		memcpy(newData + destPos, fPrivateData + lastPos, length - lastPos);
+
+		_FreePrivateData();
+		fPrivateData = newData;
+		return;
 	}
 
-	length = Length() + 1 - lastPos;
-	if (length > 0)
-		memcpy(newString, oldString, length);
+	_SetLength(newLength);
+	fPrivateData[newLength] = '\0';
 
-	_FreePrivateData();
-	fPrivateData = newData;
+	int32 destEnd = newLength;
+	for (int32 i = count; i-- > 0;) {
+		int32 pos = positions->ItemAt(i);
+		int32 end = i + 1 < count ? positions->ItemAt(i + 1) : length;
+		int32 tailLength = end - pos - searchLength;
+
+		destEnd -= tailLength;
+		memmove(fPrivateData + destEnd, fPrivateData + pos + searchLength,
+			tailLength);
+		destEnd -= withLength;
+		memcpy(fPrivateData + destEnd, with, withLength);
+	}
 }
 
 
@@ -1,5 +1,5 @@
 /*
- * Copyright 2001-2009, Haiku, Inc.
+ * Copyright 2001-2010, Haiku, Inc.
  * Distributed under the terms of the MIT license.
  *
  * Authors:
@@ -16,11 +16,13 @@
 #include "Desktop.h"
 #include "FontManager.h"
 #include "InputManager.h"
+#include "PainterThreadPool.h"
 #include "ScreenManager.h"
 #include "ServerProtocol.h"
 
 #include <PortLink.h>
 
+#include <new>
 #include <syslog.h>
 
 
@@ -38,6 +40,7 @@ port_id gAppServerPort;
 static AppServer* sAppServer;
 BTokenSpace gTokenSpace;
 uint32 gAppServerSIMDFlags = 0;
+PainterThreadPool* gPainterThreadPool = NULL;
 
 
 /*!	Detect SIMD flags for use in AppServer. Checks all CPUs in the system
@@ -91,6 +94,11 @@ detect_simd()
 				cpuSIMD |= APPSERVER_SIMD_MMX;
 			if (edx & (1 << 25))
 				cpuSIMD |= APPSERVER_SIMD_SSE;
+			if (edx & (1 << 26))
+				cpuSIMD |= APPSERVER_SIMD_SSE2;
+			// AVX is not detected on purpose: the kernel only saves the
+			// FPU/SSE state with FXSAVE, and never enables the AVX state in
+			// XCR0, so any VEX encoded instruction would fault.
 		} else {
 			// no flags can be identified
 			cpuSIMD = 0;
@@ -102,6 +110,28 @@ detect_simd()
 }
 
 
+/*!	Creates the thread pool the Painter uses to render large drawing
+	operations on all CPUs. On single CPU machines, no pool is created.
+*/
+static void
+init_painter_thread_pool()
+{
+	system_info systemInfo;
+	if (get_system_info(&systemInfo) != B_OK || systemInfo.cpu_count < 2)
+		return;
+
+	// the drawing thread itself renders tiles as well
+	PainterThreadPool* pool
+		= new(std::nothrow) PainterThreadPool(systemInfo.cpu_count - 1);
+	if (pool == NULL || pool->InitCheck() != B_OK) {
+		delete pool;
+		return;
+	}
+
+	gPainterThreadPool = pool;
+}
+
+
 //	#pragma mark -
 
 
@@ -131,6 +161,8 @@ AppServer::AppServer()
 	// Initialize SIMD flags
 	detect_simd();
 
+	init_painter_thread_pool();
+
 	gInputManager = new InputManager();
 
 	// Create the font server and scan the proper directories.
@@ -1,5 +1,5 @@
 /*
- * Copyright 2001-2009, Haiku.
+ * Copyright 2001-2010, Haiku.
  * Distributed under the terms of the MIT License.
  *
  * Authors:
@@ -99,13 +99,22 @@ BitmapManager::CreateBitmap(ClientMemoryAllocator* allocator,
 		return NULL;
 
 	overlay_token overlayToken = NULL;
+	bool softwareOverlay = false;
 
 	if (flags & B_BITMAP_WILL_OVERLAY) {
 		if (!hwInterface.CheckOverlayRestrictions(bounds.IntegerWidth() + 1,
-				bounds.IntegerHeight() + 1, space))
-			return NULL;
+				bounds.IntegerHeight() + 1, space)) {
+			// the hardware can't do it, but we might be able to emulate it
+			if (allocator == NULL
+				|| !hwInterface.CheckSoftwareOverlayRestrictions(
+					bounds.IntegerWidth() + 1, bounds.IntegerHeight() + 1,
+					space))
+				return NULL;
+
+			softwareOverlay = true;
+		}
 
-		if (flags & B_BITMAP_RESERVE_OVERLAY_CHANNEL) {
+		if (!softwareOverlay && (flags & B_BITMAP_RESERVE_OVERLAY_CHANNEL)) {
 			overlayToken = hwInterface.AcquireOverlayChannel();
 			if (overlayToken == NULL)
 				return NULL;
@@ -124,7 +133,37 @@ BitmapManager::CreateBitmap(ClientMemoryAllocator* allocator,
 	void* cookie = NULL;
 	uint8* buffer = NULL;
 
-	if (flags & B_BITMAP_WILL_OVERLAY) {
+	if (softwareOverlay) {
+		// the overlay buffer directly follows the overlay_client_data in
+		// client memory, so that the client can write to it
+		overlay_client_data* clientData = NULL;
+		bool newArea = false;
+		cookie = allocator->Allocate(kSoftwareOverlayBufferOffset
+			+ bitmap->BitsLength(), (void**)&clientData, newArea);
+
+		Overlay* overlay = NULL;
+		if (cookie != NULL) {
+			buffer = (uint8*)clientData + kSoftwareOverlayBufferOffset;
+			overlay = new (std::nothrow) Overlay(hwInterface, bitmap, buffer);
+		}
+
+		if (overlay != NULL && overlay->InitCheck() == B_OK) {
+			overlay->SetClientData(clientData);
+
+			bitmap->fAllocator = allocator;
+			bitmap->fAllocationCookie = cookie;
+			bitmap->SetOverlay(overlay);
+
+			if (_allocationFlags) {
+				*_allocationFlags = kFramebuffer | kSoftwareOverlay
+					| (newArea ? kNewAllocatorArea : 0);
+			}
+		} else {
+			delete overlay;
+			allocator->Free(cookie);
+			buffer = NULL;
+		}
+	} else if (flags & B_BITMAP_WILL_OVERLAY) {
 		Overlay* overlay = new (std::nothrow) Overlay(hwInterface, bitmap,
 			overlayToken);
 
@@ -1,5 +1,5 @@
 /*
- * Copyright 2006-2007, Haiku, Inc. All Rights Reserved.
+ * Copyright 2006-2010, Haiku, Inc. All Rights Reserved.
  * Distributed under the terms of the MIT License.
  *
  * Authors:
@@ -17,26 +17,57 @@
 	The Lock()/Unlock() methods are needed whenever you access a pointer that
 	lies within an area allocated using this class. This is needed because an
 	area might be temporarily unavailable or might be relocated at any time.
+
+	Every area (chunk) keeps all of its blocks in a list sorted by address,
+	so that a freed block can be merged with its neighbours right away. Free
+	blocks are additionally kept in bins by the power of two of their size,
+	which makes finding a fitting block independent of the number of free
+	blocks in most cases.
+	Since the client maps the areas directly, allocated blocks can never be
+	moved. Instead, when the free space at the end of an area grows large
+	enough, the area is shrunk again; the client's clone shrinks with it, and
+	the area stays available for further allocations.
 */
 
-//	TODO: right now, areas will always stay static until they are deleted;
-//		locking is not yet done or enforced!
+//	TODO: right now, areas will always stay at their address until they are
+//		deleted; locking is not yet done or enforced!
 
 #include "ClientMemoryAllocator.h"
 #include "ServerApp.h"
 
+#include <new>
 #include <stdio.h>
 #include <stdlib.h>
 
+#include <ServerProtocolStructs.h>
+
+
+static const size_t kAlignment = 16;
+static const size_t kMinChunkSize = 32 * B_PAGE_SIZE;
+static const size_t kShrinkThreshold = 64 * B_PAGE_SIZE;
+	// a chunk is shrunk once that much memory is unused at its end
 
-typedef block_list::Iterator block_iterator;
 typedef chunk_list::Iterator chunk_iterator;
 
 
+static inline size_t
+round_to_pages(size_t size)
+{
+	return (size + B_PAGE_SIZE - 1) & ~(B_PAGE_SIZE - 1);
+}
+
+
 ClientMemoryAllocator::ClientMemoryAllocator(ServerApp* application)
 	:
 	fApplication(application),
-	fLock("client memory lock")
+	fLock("client memory lock"),
+	fAllocatedBytes(0),
+	fAreaBytes(0),
+	fPeakAreaBytes(0),
+	fReleasedBytes(0),
+	fAllocations(0),
+	fFrees(0),
+	fFreeBlocks(0)
 {
 }
 
@@ -45,21 +76,16 @@ ClientMemoryAllocator::~ClientMemoryAllocator()
 {
 	// delete all areas and chunks/blocks that are still allocated
 
-	while (true) {
-		struct block* block = fFreeBlocks.RemoveHead();
-		if (block == NULL)
-			break;
-
-		free(block);
-	}
-
 	while (true) {
 		struct chunk* chunk = fChunks.RemoveHead();
 		if (chunk == NULL)
 			break;
 
+		while (struct block* block = chunk->blocks.RemoveHead())
+			delete block;
+
 		delete_area(chunk->area);
-		free(chunk);
+		delete chunk;
 	}
 }
 
@@ -74,52 +100,47 @@ ClientMemoryAllocator::InitCheck()
 void *
 ClientMemoryAllocator::Allocate(size_t size, void** _address, bool& newArea)
 {
-	// Search best matching free block from the list
-
-	block_iterator iterator = fFreeBlocks.GetIterator();
-	struct block* block;
-	struct block* best = NULL;
-
-	while ((block = iterator.Next()) != NULL) {
-		if (block->size >= size && (best == NULL || block->size < best->size))
-			best = block;
-	}
+	size = (size + kAlignment - 1) & ~(kAlignment - 1);
+	if (size == 0)
+		size = kAlignment;
 
-	if (best == NULL) {
+	struct block* block = _FindFreeBlock(size);
+	if (block == NULL) {
 		// We didn't find a free block - we need to allocate
 		// another chunk, or resize an existing chunk
-		best = _AllocateChunk(size, newArea);
-		if (best == NULL)
+		block = _AllocateChunk(size, newArea);
+		if (block == NULL)
 			return NULL;
 	} else
 		newArea = false;
 
-	// We need to split the chunk into two parts: the one to keep
-	// and the one to give away
+	// Split the free block into the part to give away, and the part
+	// that stays free
 
-	if (best->size == size) {
-		// The simple case: the free block has exactly the size we wanted to have
-		fFreeBlocks.Remove(best);
-		*_address = best->base;
-		return best;
-	}
+	if (block->size > size) {
+		struct block* rest = new(std::nothrow) struct block;
+		if (rest == NULL)
+			return NULL;
 
-	// TODO: maybe we should have the user reserve memory in its object
-	//	for us, so we don't have to do this here...
+		rest->chunk = block->chunk;
+		rest->base = block->base + size;
+		rest->size = block->size - size;
+		rest->free = true;
 
-	struct block* usedBlock = (struct block*)malloc(sizeof(struct block));
-	if (usedBlock == NULL)
-		return NULL;
+		_RemoveFreeBlock(block);
+		block->size = size;
+		_InsertFreeBlock(rest);
+		block->chunk->blocks.InsertAfter(block, rest);
+	} else
+		_RemoveFreeBlock(block);
 
-	usedBlock->base = best->base;
-	usedBlock->size = size;
-	usedBlock->chunk = best->chunk;
+	block->free = false;
 
-	best->base += size;
-	best->size -= size;
+	fAllocatedBytes += size;
+	fAllocations++;
 
-	*_address = usedBlock->base;
-	return usedBlock;
+	*_address = block->base;
+	return block;
 }
 
 
@@ -129,47 +150,36 @@ ClientMemoryAllocator::Free(void *cookie)
 	if (cookie == NULL)
 		return;
 
-	struct block* freeBlock = (struct block*)cookie;
-
-	// search for an adjacent free block
-
-	block_iterator iterator = fFreeBlocks.GetIterator();
-	struct block* before = NULL;
-	struct block* after = NULL;
-	struct block* block;
+	struct block* block = (struct block*)cookie;
+	struct chunk* chunk = block->chunk;
 
-	// TODO: this could be done better if free blocks are sorted,
-	//	and if we had one free blocks list per chunk!
-	//	IOW this is a bit slow...
+	fAllocatedBytes -= block->size;
+	fFrees++;
 
-	while ((block = iterator.Next()) != NULL) {
-		if (block->chunk != freeBlock->chunk)
-			continue;
+	// merge with the adjacent blocks, if they are free
 
-		if (block->base + block->size == freeBlock->base)
-			before = block;
+	struct block* before = chunk->blocks.GetPrevious(block);
+	if (before != NULL && before->free) {
+		_RemoveFreeBlock(before);
+		before->size += block->size;
+		chunk->blocks.Remove(block);
+		delete block;
+		block = before;
+	}
 
-		if (block->base == freeBlock->base + freeBlock->size)
-			after = block;
+	struct block* after = chunk->blocks.GetNext(block);
+	if (after != NULL && after->free) {
+		_RemoveFreeBlock(after);
+		block->size += after->size;
+		chunk->blocks.Remove(after);
+		delete after;
 	}
 
-	if (before != NULL && after != NULL) {
-		// merge with adjacent blocks
-		before->size += after->size + freeBlock->size;
-		fFreeBlocks.Remove(after);
-		free(after);
-		free(freeBlock);
-	} else if (before != NULL) {
-		before->size += freeBlock->size;
-		free(freeBlock);
-	} else if (after != NULL) {
-		after->base -= freeBlock->size;
-		after->size += freeBlock->size;
-		free(freeBlock);
-	} else
-		fFreeBlocks.Add(freeBlock);
+	block->free = true;
+	_InsertFreeBlock(block);
 
-	// TODO: check if the whole chunk is free now (we could delete it then)
+	if (chunk->blocks.GetNext(block) == NULL)
+		_ShrinkChunk(chunk);
 }
 
 
@@ -211,87 +221,216 @@ ClientMemoryAllocator::Unlock()
 }
 
 
+void
+ClientMemoryAllocator::GetStatistics(ClientMemoryStatisticsInfo& info)
+{
+	info.allocatedBytes = fAllocatedBytes;
+	info.areaBytes = fAreaBytes;
+	info.peakAreaBytes = fPeakAreaBytes;
+	info.releasedBytes = fReleasedBytes;
+	info.allocations = fAllocations;
+	info.frees = fFrees;
+	info.areaCount = fChunks.Count();
+	info.freeBlockCount = fFreeBlocks;
+}
+
+
+/*!	Returns a free block of at least \a size bytes, or \c NULL if there is
+	none. Within the bin of \a size, the first block that fits is taken;
+	any block in one of the larger bins is always large enough.
+*/
 struct block *
-ClientMemoryAllocator::_AllocateChunk(size_t size, bool& newArea)
+ClientMemoryAllocator::_FindFreeBlock(size_t size)
 {
-	// round up to multiple of page size
-	size = (size + B_PAGE_SIZE - 1) & ~(B_PAGE_SIZE - 1);
+	int32 bin = _BinFor(size);
 
-	// At first, try to resize our existing areas
+	block_list::Iterator iterator = fFreeBins[bin].GetIterator();
+	while (struct block* block = iterator.Next()) {
+		if (block->size >= size)
+			return block;
+	}
 
-	chunk_iterator iterator = fChunks.GetIterator();
-	struct chunk* chunk;
-	while ((chunk = iterator.Next()) != NULL) {
-		status_t status = resize_area(chunk->area, chunk->size + size);
-		if (status == B_OK) {
-			newArea = false;
-			break;
-		}
+	for (bin++; bin < kBinCount; bin++) {
+		if (!fFreeBins[bin].IsEmpty())
+			return fFreeBins[bin].Head();
 	}
 
-	// TODO: resize and relocate while holding the write lock
+	return NULL;
+}
 
-	struct block* block;
-	uint8* address;
 
-	if (chunk == NULL) {
-		// TODO: temporary measurement as long as resizing areas doesn't
-		//	work the way we need (with relocating the area, if needed)
-		if (size < B_PAGE_SIZE * 32)
-			size = B_PAGE_SIZE * 32;
+void
+ClientMemoryAllocator::_InsertFreeBlock(struct block* block)
+{
+	fFreeBins[_BinFor(block->size)].Add(block);
+	fFreeBlocks++;
+}
 
-		// create new area for this allocation
-		chunk = (struct chunk*)malloc(sizeof(struct chunk));
-		if (chunk == NULL)
-			return NULL;
 
-		block = (struct block*)malloc(sizeof(struct block));
-		if (block == NULL) {
-			free(chunk);
-			return NULL;
+void
+ClientMemoryAllocator::_RemoveFreeBlock(struct block* block)
+{
+	fFreeBins[_BinFor(block->size)].Remove(block);
+	fFreeBlocks--;
+}
+
+
+/*!	Makes at least \a size bytes available as a single free block, either by
+	growing one of the existing chunks, or by creating a new one. The block
+	is returned, and has already been added to the free bins.
+*/
+struct block *
+ClientMemoryAllocator::_AllocateChunk(size_t size, bool& newArea)
+{
+	// At first, try to resize our existing areas; if a chunk ends with a
+	// free block, it only needs to grow by the missing part
+
+	chunk_iterator iterator = fChunks.GetIterator();
+	while (struct chunk* chunk = iterator.Next()) {
+		struct block* tail = chunk->blocks.Tail();
+		if (tail != NULL && !tail->free)
+			tail = NULL;
+
+		size_t growth = round_to_pages(size - (tail != NULL ? tail->size : 0));
+
+		// TODO: resize and relocate while holding the write lock
+		if (resize_area(chunk->area, chunk->size + growth) != B_OK)
+			continue;
+
+		fAreaBytes += growth;
+		if (fAreaBytes > fPeakAreaBytes)
+			fPeakAreaBytes = fAreaBytes;
+
+		if (tail != NULL) {
+			_RemoveFreeBlock(tail);
+			tail->size += growth;
+		} else {
+			tail = new(std::nothrow) struct block;
+			if (tail == NULL) {
+				resize_area(chunk->area, chunk->size);
+				fAreaBytes -= growth;
+				return NULL;
+			}
+
+			tail->chunk = chunk;
+			tail->base = chunk->base + chunk->size;
+			tail->size = growth;
+			tail->free = true;
+			chunk->blocks.Add(tail);
 		}
 
-		char name[B_OS_NAME_LENGTH];
+		chunk->size += growth;
+		_InsertFreeBlock(tail);
+
+		newArea = false;
+		return tail;
+	}
+
+	// create new area for this allocation
+
+	size = round_to_pages(size);
+	// TODO: temporary measurement as long as resizing areas doesn't
+	//	work the way we need (with relocating the area, if needed)
+	if (size < kMinChunkSize)
+		size = kMinChunkSize;
+
+	struct chunk* chunk = new(std::nothrow) struct chunk;
+	if (chunk == NULL)
+		return NULL;
+
+	struct block* block = new(std::nothrow) struct block;
+	if (block == NULL) {
+		delete chunk;
+		return NULL;
+	}
+
+	char name[B_OS_NAME_LENGTH];
 #ifdef HAIKU_TARGET_PLATFORM_LIBBE_TEST
-		strcpy(name, "client heap");
+	strcpy(name, "client heap");
 #else
-		snprintf(name, sizeof(name), "heap:%ld:%s", fApplication->ClientTeam(),
-			fApplication->SignatureLeaf());
+	snprintf(name, sizeof(name), "heap:%ld:%s", fApplication->ClientTeam(),
+		fApplication->SignatureLeaf());
 #endif
-		area_id area = create_area(name, (void**)&address, B_ANY_ADDRESS, size,
-			B_NO_LOCK, B_READ_AREA | B_WRITE_AREA);
-		if (area < B_OK) {
-			free(block);
-			free(chunk);
-			return NULL;
-		}
+	uint8* address;
+	area_id area = create_area(name, (void**)&address, B_ANY_ADDRESS, size,
+		B_NO_LOCK, B_READ_AREA | B_WRITE_AREA);
+	if (area < B_OK) {
+		delete block;
+		delete chunk;
+		return NULL;
+	}
 
-		// add chunk to list
+	// add chunk to list
 
-		chunk->area = area;
-		chunk->base = address;
-		chunk->size = size;
+	chunk->area = area;
+	chunk->base = address;
+	chunk->size = size;
 
-		fChunks.Add(chunk);
-		newArea = true;
-	} else {
-		// create new free block for this chunk
-		block = (struct block *)malloc(sizeof(struct block));
-		if (block == NULL)
-			return NULL;
+	fChunks.Add(chunk);
+	newArea = true;
 
-		address = chunk->base + chunk->size;
-		chunk->size += size;
-	}
+	fAreaBytes += size;
+	if (fAreaBytes > fPeakAreaBytes)
+		fPeakAreaBytes = fAreaBytes;
 
 	// add block to free list
 
 	block->chunk = chunk;
 	block->base = address;
 	block->size = size;
+	block->free = true;
 
-	fFreeBlocks.Add(block);
+	chunk->blocks.Add(block);
+	_InsertFreeBlock(block);
 
 	return block;
 }
 
+
+/*!	Gives the free memory at the end of \a chunk back to the system, if
+	there is enough of it. The area is never deleted, as the client
+	would keep its clone around; it is shrunk to a single page at most.
+	Since only unused memory is cut off, no pointer into the area becomes
+	invalid, and the client's clone is resized along with it.
+*/
+void
+ClientMemoryAllocator::_ShrinkChunk(struct chunk* chunk)
+{
+	struct block* tail = chunk->blocks.Tail();
+	if (tail == NULL || !tail->free || tail->size < kShrinkThreshold)
+		return;
+
+	size_t newSize = round_to_pages(tail->base - chunk->base);
+	if (newSize < B_PAGE_SIZE)
+		newSize = B_PAGE_SIZE;
+	if (newSize >= chunk->size
+		|| resize_area(chunk->area, newSize) != B_OK)
+		return;
+
+	size_t released = chunk->size - newSize;
+	fReleasedBytes += released;
+	fAreaBytes -= released;
+
+	_RemoveFreeBlock(tail);
+	chunk->size = newSize;
+	tail->size -= released;
+
+	if (tail->size == 0) {
+		chunk->blocks.Remove(tail);
+		delete tail;
+	} else
+		_InsertFreeBlock(tail);
+}
+
+
+/*static*/ int32
+ClientMemoryAllocator::_BinFor(size_t size)
+{
+	int32 bin = 0;
+	while (size > 1 && bin < kBinCount - 1) {
+		size >>= 1;
+		bin++;
+	}
+
+	return bin;
+}
@@ -1,5 +1,5 @@
 /*
- * Copyright 2006, Haiku, Inc. All Rights Reserved.
+ * Copyright 2006-2010, Haiku, Inc. All Rights Reserved.
  * Distributed under the terms of the MIT License.
  *
  * Authors:
@@ -11,26 +11,39 @@
 
 #include "MultiLocker.h"
 
+#include <Debug.h>
 #include <util/DoublyLinkedList.h>
 
 
 class ServerApp;
 struct chunk;
 struct block;
+struct ClientMemoryStatisticsInfo;
 
-struct chunk : DoublyLinkedListLinkImpl<struct chunk> {
-	area_id	area;
+struct block {
+	DoublyLinkedListLink<struct block> chunkLink;
+		// all blocks of a chunk, in address order
+	DoublyLinkedListLink<struct block> freeLink;
+		// free blocks of the same size class
+
+	struct chunk* chunk;
 	uint8*	base;
 	size_t	size;
+	bool	free;
 };
 
-struct block : DoublyLinkedListLinkImpl<struct block> {
-	struct chunk* chunk;
+typedef DoublyLinkedList<block,
+	DoublyLinkedListMemberGetLink<block, &block::chunkLink> > chunk_block_list;
+typedef DoublyLinkedList<block,
+	DoublyLinkedListMemberGetLink<block, &block::freeLink> > block_list;
+
+struct chunk : DoublyLinkedListLinkImpl<struct chunk> {
+	area_id	area;
 	uint8*	base;
 	size_t	size;
+	chunk_block_list blocks;
 };
 
-typedef DoublyLinkedList<block> block_list;
 typedef DoublyLinkedList<chunk> chunk_list;
 
 
@@ -50,13 +63,31 @@ class ClientMemoryAllocator {
 		bool Lock();
 		void Unlock();
 
+		void GetStatistics(ClientMemoryStatisticsInfo& info);
+
 	private:
+		enum { kBinCount = 32 };
+
+		struct block *_FindFreeBlock(size_t size);
+		void _InsertFreeBlock(struct block* block);
+		void _RemoveFreeBlock(struct block* block);
 		struct block *_AllocateChunk(size_t size, bool& newArea);
+		void _ShrinkChunk(struct chunk* chunk);
+
+		static int32 _BinFor(size_t size);
 
 		ServerApp*	fApplication;
 		MultiLocker	fLock;
 		chunk_list	fChunks;
-		block_list	fFreeBlocks;
+		block_list	fFreeBins[kBinCount];
+
+		size_t		fAllocatedBytes;
+		size_t		fAreaBytes;
+		size_t		fPeakAreaBytes;
+		size_t		fReleasedBytes;
+		int32		fAllocations;
+		int32		fFrees;
+		int32		fFreeBlocks;
 };
 
 #endif	/* CLIENT_MEMORY_ALLOCATOR_H */
@@ -505,6 +505,7 @@ Desktop::SetLastMouseState(const BPoint& position, int32 buttons,
 void
 Desktop::GetLastMouseState(BPoint* position, int32* buttons) const
 {
+	// The all-window-lock is at least read-locked.
 	*position = fLastMousePosition;
 	*buttons = fLastMouseButtons;
 }
@@ -2835,10 +2836,10 @@ Desktop::_RebuildClippingForAllWindows(BRegion& stillAvailableOnScreen)
 	for (Window* window = _CurrentWindows().LastWindow(); window != NULL;
 			window = window->PreviousWindow(fCurrentWorkspace)) {
 		if (!window->IsHidden()) {
-			window->SetClipping(&stillAvailableOnScreen);
+			bool changed = window->SetClipping(&stillAvailableOnScreen);
 			window->SetScreen(_DetermineScreenFor(window->Frame()));
 
-			if (window->ServerWindow()->IsDirectlyAccessing()) {
+			if (changed && window->ServerWindow()->IsDirectlyAccessing()) {
 				window->ServerWindow()->HandleDirectConnection(
 					B_DIRECT_MODIFY | B_CLIPPING_MODIFIED);
 			}
@@ -2910,10 +2911,10 @@ Desktop::_RebuildAndRedrawAfterWindowChange(Window* changedWindow,
 			if (window == changedWindow)
 				dirty.IntersectWith(&stillAvailableOnScreen);
 
-			window->SetClipping(&stillAvailableOnScreen);
+			bool changed = window->SetClipping(&stillAvailableOnScreen);
 			window->SetScreen(_DetermineScreenFor(window->Frame()));
 
-			if (window->ServerWindow()->IsDirectlyAccessing()) {
+			if (changed && window->ServerWindow()->IsDirectlyAccessing()) {
 				window->ServerWindow()->HandleDirectConnection(
 					B_DIRECT_MODIFY | B_CLIPPING_MODIFIED);
 			}
@@ -77,6 +77,16 @@ public:
 			void				BroadcastToAllWindows(int32 code);
 
 	// Locking
+	// All windows are protected by a single lock. Drawing into a window only
+	// needs it for reading, while anything that changes the window stack or
+	// the clipping of a window needs it for writing.
+	// TODO: windows still cannot draw while another one is moved or resized.
+	// Per-window snapshots of the visible regions would allow that, but
+	// moving a window copies its contents on screen, and the background is
+	// drawn from the region that no window covers. A snapshot would need to
+	// be validated against a clipping generation under the exclusive access
+	// to the frame buffer, so that neither overlaps with drawing that uses
+	// a stale region.
 #if USE_MULTI_LOCKER
 			bool				LockSingleWindow()
 									{ return fWindowLock.ReadLock(); }
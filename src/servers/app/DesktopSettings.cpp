@@ -1,5 +1,5 @@
 /*
- * Copyright 2005-2009, Haiku.
+ * Copyright 2005-2010, Haiku.
  * Distributed under the terms of the MIT License.
  *
  * Authors:
@@ -54,6 +54,8 @@ DesktopSettingsPrivate::_SetDefaults()
 	fFocusFollowsMouseMode = B_NORMAL_FOCUS_FOLLOWS_MOUSE;
 	fAcceptFirstClick = false;
 	fShowAllDraggers = true;
+	fRecordDisplayLists = false;
+	fWindowBackingStores = false;
 
 	// init scrollbar info
 	fScrollBarInfo.proportional = true;
@@ -271,6 +273,18 @@ DesktopSettingsPrivate::_Load()
 				gSubpixelOrderingRGB = subpixelOrdering;
 			}
 
+			bool recordDisplayLists;
+			if (settings.FindBool("record display lists", &recordDisplayLists)
+					== B_OK) {
+				fRecordDisplayLists = recordDisplayLists;
+			}
+
+			bool windowBackingStores;
+			if (settings.FindBool("window backing stores",
+					&windowBackingStores) == B_OK) {
+				fWindowBackingStores = windowBackingStores;
+			}
+
 			for (int32 i = 0; i < kNumColors; i++) {
 				char colorName[12];
 				snprintf(colorName, sizeof(colorName), "color%ld",
@@ -410,6 +424,8 @@ DesktopSettingsPrivate::Save(uint32 mask)
 			settings.AddBool("subpixel antialiasing", gSubpixelAntialiasing);
 			settings.AddInt8("subpixel average weight", gSubpixelAverageWeight);
 			settings.AddBool("subpixel ordering", gSubpixelOrderingRGB);
+			settings.AddBool("record display lists", fRecordDisplayLists);
+			settings.AddBool("window backing stores", fWindowBackingStores);
 
 			for (int32 i = 0; i < kNumColors; i++) {
 				char colorName[12];
@@ -575,6 +591,44 @@ DesktopSettingsPrivate::ShowAllDraggers() const
 }
 
 
+/*!	When enabled, the app_server records the drawing commands of each view
+	while the client updates it, and plays them back itself when parts of
+	the view are exposed, instead of asking the client to redraw them.
+*/
+void
+DesktopSettingsPrivate::SetRecordDisplayLists(bool record)
+{
+	fRecordDisplayLists = record;
+	Save(kAppearanceSettings);
+}
+
+
+bool
+DesktopSettingsPrivate::RecordDisplayLists() const
+{
+	return fRecordDisplayLists;
+}
+
+
+/*!	When enabled, every window keeps a copy of its contents in a backing
+	store, and exposed parts are restored from there instead of asking the
+	client to redraw them.
+*/
+void
+DesktopSettingsPrivate::SetWindowBackingStores(bool enable)
+{
+	fWindowBackingStores = enable;
+	Save(kAppearanceSettings);
+}
+
+
+bool
+DesktopSettingsPrivate::WindowBackingStores() const
+{
+	return fWindowBackingStores;
+}
+
+
 void
 DesktopSettingsPrivate::SetWorkspacesLayout(int32 columns, int32 rows)
 {
@@ -816,6 +870,20 @@ DesktopSettings::ShowAllDraggers() const
 }
 
 
+bool
+DesktopSettings::RecordDisplayLists() const
+{
+	return fSettings->RecordDisplayLists();
+}
+
+
+bool
+DesktopSettings::WindowBackingStores() const
+{
+	return fSettings->WindowBackingStores();
+}
+
+
 int32
 DesktopSettings::WorkspacesCount() const
 {
@@ -965,6 +1033,20 @@ LockedDesktopSettings::SetShowAllDraggers(bool show)
 }
 
 
+void
+LockedDesktopSettings::SetRecordDisplayLists(bool record)
+{
+	fSettings->SetRecordDisplayLists(record);
+}
+
+
+void
+LockedDesktopSettings::SetWindowBackingStores(bool enable)
+{
+	fSettings->SetWindowBackingStores(enable);
+}
+
+
 void
 LockedDesktopSettings::SetUIColor(color_which which, const rgb_color color)
 {
@@ -1,5 +1,5 @@
 /*
- * Copyright 2001-2009, Haiku.
+ * Copyright 2001-2010, Haiku.
  * Distributed under the terms of the MIT License.
  *
  * Authors:
@@ -50,6 +50,9 @@ class DesktopSettings {
 
 		bool			ShowAllDraggers() const;
 
+		bool			RecordDisplayLists() const;
+		bool			WindowBackingStores() const;
+
 		int32			WorkspacesCount() const;
 		int32			WorkspacesColumns() const;
 		int32			WorkspacesRows() const;
@@ -85,6 +88,9 @@ class LockedDesktopSettings : public DesktopSettings {
 
 		void			SetShowAllDraggers(bool show);
 
+		void			SetRecordDisplayLists(bool record);
+		void			SetWindowBackingStores(bool enable);
+
 		void			SetUIColor(color_which which, const rgb_color color);
 
 		void			SetSubpixelAntialiasing(bool subpix);
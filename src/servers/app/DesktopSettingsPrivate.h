@@ -1,5 +1,5 @@
 /*
- * Copyright 2005-2009, Haiku.
+ * Copyright 2005-2010, Haiku.
  * Distributed under the terms of the MIT License.
  *
  * Authors:
@@ -55,6 +55,11 @@ public:
 			void				SetShowAllDraggers(bool show);
 			bool				ShowAllDraggers() const;
 
+			void				SetRecordDisplayLists(bool record);
+			bool				RecordDisplayLists() const;
+			void				SetWindowBackingStores(bool enable);
+			bool				WindowBackingStores() const;
+
 			void				SetWorkspacesLayout(int32 columns, int32 rows);
 			int32				WorkspacesCount() const;
 			int32				WorkspacesColumns() const;
@@ -95,6 +100,8 @@ private:
 			mode_focus_follows_mouse	fFocusFollowsMouseMode;
 			bool				fAcceptFirstClick;
 			bool				fShowAllDraggers;
+			bool				fRecordDisplayLists;
+			bool				fWindowBackingStores;
 			int32				fWorkspacesColumns;
 			int32				fWorkspacesRows;
 			BMessage			fWorkspaceMessages[kMaxWorkspaces];
@@ -1,5 +1,5 @@
 /*
- * Copyright 2007, Haiku. All rights reserved.
+ * Copyright 2007-2010, Haiku. All rights reserved.
  * Distributed under the terms of the MIT License.
  *
  * Authors:
@@ -15,12 +15,18 @@
 #include <Entry.h>
 #include <Path.h>
 
+#include <ServerProtocolStructs.h>
+
 #include "AutoLocker.h"
 
 
 using std::nothrow;
 
 
+static const int32 kMaxEntryCount = 30;
+static const size_t kGlyphMemoryBudget = 4 * 1024 * 1024;
+
+
 FontCache
 FontCache::sDefaultInstance;
 
@@ -30,6 +36,13 @@ FontCache::sDefaultInstance;
 FontCache::FontCache()
 	: MultiLocker("FontCache lock")
 	, fFontCacheEntries()
+	, fAtlas()
+	, fGlyphMemory(0)
+	, fGlyphMemoryBudget(kGlyphMemoryBudget)
+	, fGlyphHits(0)
+	, fGlyphMisses(0)
+	, fEvictedGlyphs(0)
+	, fEvictedEntries(0)
 {
 }
 
@@ -83,7 +96,7 @@ FontCache::FontCacheEntryFor(const ServerFont& font)
 
 	if (!entry) {
 		// remove old entries, keep entries below certain count
-		_ConstrainEntryCount();
+		_ConstrainEntries(NULL, kMaxEntryCount - 1);
 		entry = new (nothrow) FontCacheEntry();
 		if (!entry || !entry->Init(font)
 			|| fFontCacheEntries.Put(signature, entry) < B_OK) {
@@ -110,7 +123,73 @@ FontCache::Recycle(FontCacheEntry* entry)
 	entry->RemoveReference();
 }
 
-static const int32 kMaxEntryCount = 30;
+// GlyphMemoryChanged
+void
+FontCache::GlyphMemoryChanged(ssize_t delta)
+{
+	atomic_add64(&fGlyphMemory, delta);
+}
+
+// GlyphMemoryExceeded
+bool
+FontCache::GlyphMemoryExceeded()
+{
+	return atomic_get64(&fGlyphMemory) > (int64)fGlyphMemoryBudget;
+}
+
+// GlyphMemoryExcess
+size_t
+FontCache::GlyphMemoryExcess()
+{
+	int64 excess = atomic_get64(&fGlyphMemory) - (int64)fGlyphMemoryBudget;
+	return excess > 0 ? (size_t)excess : 0;
+}
+
+// ConstrainGlyphMemory
+/*!	Removes the least used entries other than \a keep from the cache until
+	the glyph memory is within the budget again. Only entries that nobody
+	uses anymore are removed, as only those actually free their glyphs.
+	The caller may hold the lock of \a keep.
+*/
+void
+FontCache::ConstrainGlyphMemory(FontCacheEntry* keep)
+{
+	AutoWriteLocker locker(this);
+	if (!locker.IsLocked())
+		return;
+
+	_ConstrainEntries(keep, kMaxEntryCount);
+}
+
+// GlyphLookedUp
+void
+FontCache::GlyphLookedUp(bool hit)
+{
+	atomic_add64(hit ? &fGlyphHits : &fGlyphMisses, 1);
+}
+
+// GlyphEvicted
+void
+FontCache::GlyphEvicted()
+{
+	atomic_add64(&fEvictedGlyphs, 1);
+}
+
+// GetStatistics
+void
+FontCache::GetStatistics(GlyphCacheStatisticsInfo& info)
+{
+	AutoReadLocker locker(this);
+
+	info.hits = atomic_get64(&fGlyphHits);
+	info.misses = atomic_get64(&fGlyphMisses);
+	info.evictedGlyphs = atomic_get64(&fEvictedGlyphs);
+	info.evictedEntries = atomic_get64(&fEvictedEntries);
+	info.glyphMemory = atomic_get64(&fGlyphMemory);
+	info.glyphMemoryBudget = fGlyphMemoryBudget;
+	info.atlasMemory = fAtlas.PageMemory();
+	info.entryCount = fFontCacheEntries.Size();
+}
 
 static inline double
 usage_index(uint64 useCount, bigtime_t age)
@@ -118,44 +197,53 @@ usage_index(uint64 useCount, bigtime_t age)
 	return 100.0 * useCount / age;
 }
 
-// _ConstrainEntryCount
+// _ConstrainEntries
 void
-FontCache::_ConstrainEntryCount()
+FontCache::_ConstrainEntries(FontCacheEntry* keep, int32 maxCount)
 {
 	// this function is only ever called with the WriteLock held
-	if (fFontCacheEntries.Size() < kMaxEntryCount)
-		return;
-//printf("FontCache::_ConstrainEntryCount()\n");
-
-	FontMap::Iterator iterator = fFontCacheEntries.GetIterator();
-
-	// NOTE: if kMaxEntryCount has a sane value, there has got to be
-	// some entries, so using the iterator like that should be ok
-	FontCacheEntry* leastUsedEntry = iterator.Next().value;
-	bigtime_t now = system_time();
-	bigtime_t age = now - leastUsedEntry->LastUsed();
-	uint64 useCount = leastUsedEntry->UsedCount();
-	double leastUsageIndex = usage_index(useCount, age);
-//printf("  leastUsageIndex: %f\n", leastUsageIndex);
-
-	while (iterator.HasNext()) {
-		FontCacheEntry* entry = iterator.Next().value;
-		age = now - entry->LastUsed();
-		useCount = entry->UsedCount();
-		double usageIndex = usage_index(useCount, age);
+	while (true) {
+		bool tooMany = fFontCacheEntries.Size() > maxCount;
+		if (!tooMany && !GlyphMemoryExceeded())
+			return;
+//printf("FontCache::_ConstrainEntries()\n");
+
+		FontCacheEntry* leastUsedEntry = NULL;
+		double leastUsageIndex = 0.0;
+		bigtime_t now = system_time();
+
+		FontMap::Iterator iterator = fFontCacheEntries.GetIterator();
+		while (iterator.HasNext()) {
+			FontCacheEntry* entry = iterator.Next().value;
+			if (entry == keep)
+				continue;
+
+			// removing entries that are still in use does not free any
+			// memory until they are recycled
+			if (!tooMany && entry->CountReferences() > 1)
+				continue;
+
+			bigtime_t age = now - entry->LastUsed();
+			uint64 useCount = entry->UsedCount();
+			double usageIndex = usage_index(useCount, age);
 //printf("  usageIndex: %f\n", usageIndex);
-		if (usageIndex < leastUsageIndex) {
-			leastUsedEntry = entry;
-			leastUsageIndex = usageIndex;
+			if (leastUsedEntry == NULL || usageIndex < leastUsageIndex) {
+				leastUsedEntry = entry;
+				leastUsageIndex = usageIndex;
+			}
 		}
-	}
 
-	iterator = fFontCacheEntries.GetIterator();
-	while (iterator.HasNext()) {
-		if (iterator.Next().value == leastUsedEntry) {
-			iterator.Remove();
-			leastUsedEntry->RemoveReference();
-			break;
+		if (leastUsedEntry == NULL)
+			return;
+
+		iterator = fFontCacheEntries.GetIterator();
+		while (iterator.HasNext()) {
+			if (iterator.Next().value == leastUsedEntry) {
+				iterator.Remove();
+				leastUsedEntry->RemoveReference();
+				atomic_add64(&fEvictedEntries, 1);
+				break;
+			}
 		}
 	}
 }
@@ -1,5 +1,5 @@
 /*
- * Copyright 2007, Haiku. All rights reserved.
+ * Copyright 2007-2010, Haiku. All rights reserved.
  * Distributed under the terms of the MIT License.
  *
  * Authors:
@@ -10,12 +10,16 @@
 #define FONT_CACHE_H
 
 #include "FontCacheEntry.h"
+#include "GlyphAtlas.h"
 #include "HashMap.h"
 #include "HashString.h"
 #include "MultiLocker.h"
 #include "ServerFont.h"
 
 
+struct GlyphCacheStatisticsInfo;
+
+
 class FontCache : public MultiLocker {
  public:
 								FontCache();
@@ -27,14 +31,37 @@ class FontCache : public MultiLocker {
 			FontCacheEntry*		FontCacheEntryFor(const ServerFont& font);
 			void				Recycle(FontCacheEntry* entry);
 
+	// glyph memory, shared by all entries
+			GlyphAtlas&			Atlas()
+									{ return fAtlas; }
+			void				GlyphMemoryChanged(ssize_t delta);
+			bool				GlyphMemoryExceeded();
+			size_t				GlyphMemoryExcess();
+			void				ConstrainGlyphMemory(FontCacheEntry* keep);
+
+	// statistics
+			void				GlyphLookedUp(bool hit);
+			void				GlyphEvicted();
+			void				GetStatistics(GlyphCacheStatisticsInfo& info);
+
  private:
-			void				_ConstrainEntryCount();
+			void				_ConstrainEntries(FontCacheEntry* keep,
+									int32 maxCount);
 
 	static	FontCache			sDefaultInstance;
 
 	typedef HashMap<HashString, FontCacheEntry*> FontMap;
 
 			FontMap				fFontCacheEntries;
+
+			GlyphAtlas			fAtlas;
+			vint64				fGlyphMemory;
+			size_t				fGlyphMemoryBudget;
+
+			vint64				fGlyphHits;
+			vint64				fGlyphMisses;
+			vint64				fEvictedGlyphs;
+			vint64				fEvictedEntries;
 };
 
 #endif // FONT_CACHE_H
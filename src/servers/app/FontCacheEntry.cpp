@@ -1,5 +1,5 @@
 /*
- * Copyright 2007-2009, Haiku. All rights reserved.
+ * Copyright 2007-2010, Haiku. All rights reserved.
  * Distributed under the terms of the MIT License.
  *
  * Authors:
@@ -36,7 +36,9 @@
 #include <utf8_functions.h>
 #include <util/OpenHashTable.h>
 
+#include "FontCache.h"
 #include "GlobalSubpixelSettings.h"
+#include "GlyphAtlas.h"
 
 
 BLocker FontCacheEntry::sUsageUpdateLock("FontCacheEntry usage lock");
@@ -45,17 +47,17 @@ BLocker FontCacheEntry::sUsageUpdateLock("FontCacheEntry usage lock");
 class FontCacheEntry::GlyphCachePool {
 public:
 	GlyphCachePool()
+		:
+		fClockHand(NULL),
+		fMemory(0)
 	{
 	}
 
 	~GlyphCachePool()
 	{
-		GlyphCache* glyph = fGlyphTable.Clear(true);
-		while (glyph != NULL) {
-			GlyphCache* next = glyph->hash_link;
-			delete glyph;
-			glyph = next;
-		}
+		fGlyphTable.Clear();
+		while (GlyphCache* glyph = fGlyphs.RemoveHead())
+			_FreeGlyph(glyph);
 	}
 
 	status_t Init()
@@ -76,22 +78,87 @@ public:
 		if (glyph != NULL)
 			return NULL;
 
-		glyph = new(std::nothrow) GlyphCache(glyphIndex, dataSize, dataType,
-			bounds, advanceX, advanceY, insetLeft, insetRight);
-		if (glyph == NULL || glyph->data == NULL) {
-			delete glyph;
+		uint8* data = FontCache::Default()->Atlas().Allocate(dataSize);
+		if (data == NULL)
 			return NULL;
-		}
 
-		// TODO: The HashTable grows without bounds. We should cleanup
-		// older entries from time to time.
+		glyph = new(std::nothrow) GlyphCache(glyphIndex, data, dataSize,
+			dataType, bounds, advanceX, advanceY, insetLeft, insetRight);
+		if (glyph == NULL) {
+			FontCache::Default()->Atlas().Free(data, dataSize);
+			return NULL;
+		}
 
 		fGlyphTable.Insert(glyph);
+		fGlyphs.Add(glyph);
+
+		size_t size = _GlyphMemory(glyph);
+		fMemory += size;
+		FontCache::Default()->GlyphMemoryChanged(size);
 
 		return glyph;
 	}
 
+	/*!	Frees glyphs until at least \a size bytes have been released, or
+		there are no more glyphs to evict. The glyphs are visited like the
+		hand of a clock passes them: a glyph that has been used since the
+		hand last passed it gets a second chance, so that this approximates
+		evicting the least recently used glyphs, without having to maintain
+		a list that readers would need to update.
+		The caller must hold the write lock of the entry.
+	*/
+	size_t Evict(size_t size)
+	{
+		size_t freed = 0;
+		int32 steps = 2 * fGlyphTable.CountElements();
+
+		while (freed < size && steps-- > 0) {
+			GlyphCache* glyph = fClockHand != NULL
+				? fClockHand : fGlyphs.Head();
+			if (glyph == NULL)
+				break;
+
+			fClockHand = fGlyphs.GetNext(glyph);
+
+			if (glyph->referenced) {
+				glyph->referenced = false;
+				continue;
+			}
+
+			fGlyphTable.Remove(glyph);
+			fGlyphs.Remove(glyph);
+
+			size_t glyphSize = _GlyphMemory(glyph);
+			freed += glyphSize;
+			fMemory -= glyphSize;
+
+			_FreeGlyph(glyph);
+			FontCache::Default()->GlyphEvicted();
+		}
+
+		return freed;
+	}
+
+	size_t Memory() const
+	{
+		return fMemory;
+	}
+
 private:
+	static size_t _GlyphMemory(const GlyphCache* glyph)
+	{
+		return sizeof(GlyphCache)
+			+ GlyphAtlas::AllocationSize(glyph->data_size);
+	}
+
+	void _FreeGlyph(GlyphCache* glyph)
+	{
+		FontCache::Default()->Atlas().Free(glyph->data, glyph->data_size);
+		FontCache::Default()->GlyphMemoryChanged(
+			-(ssize_t)_GlyphMemory(glyph));
+		delete glyph;
+	}
+
 	struct GlyphHashTableDefinition {
 		typedef uint32		KeyType;
 		typedef	GlyphCache	ValueType;
@@ -118,8 +185,12 @@ private:
 	};
 
 	typedef BOpenHashTable<GlyphHashTableDefinition> GlyphTable;
+	typedef DoublyLinkedList<GlyphCache> GlyphList;
 
 	GlyphTable	fGlyphTable;
+	GlyphList	fGlyphs;
+	GlyphCache*	fClockHand;
+	size_t		fMemory;
 };
 
 
@@ -194,11 +265,29 @@ FontCacheEntry::Glyph(uint32 glyphCode)
 	uint32 glyphIndex = fEngine.GlyphIndexForGlyphCode(glyphCode);
 	if (glyphIndex == 0)
 		return NULL;
-	const GlyphCache* glyph = fGlyphCache->FindGlyph(glyphIndex);
+	FontCache* cache = FontCache::Default();
+
+	GlyphCache* glyph
+		= const_cast<GlyphCache*>(fGlyphCache->FindGlyph(glyphIndex));
 	if (glyph) {
+		// NOTE: this might happen with only the read lock held, but it is
+		// only a hint for the eviction, and races are harmless
+		glyph->referenced = true;
+		cache->GlyphLookedUp(true);
 		return glyph;
 	} else {
+		cache->GlyphLookedUp(false);
+
 		if (fEngine.PrepareGlyph(glyphIndex)) {
+			// Glyphs can only be evicted while nobody else is using this
+			// entry. If we have the read lock only, the budget is enforced
+			// by the next writer.
+			if (cache->GlyphMemoryExceeded() && IsWriteLocked()) {
+				cache->ConstrainGlyphMemory(this);
+				if (cache->GlyphMemoryExceeded())
+					fGlyphCache->Evict(cache->GlyphMemoryExcess());
+			}
+
 			glyph = fGlyphCache->CacheGlyph(glyphIndex,
 				fEngine.DataSize(), fEngine.DataType(), fEngine.Bounds(),
 				fEngine.AdvanceX(), fEngine.AdvanceY(),
@@ -246,6 +335,13 @@ FontCacheEntry::InitAdaptors(const GlyphCache* glyph,
 }
 
 
+size_t
+FontCacheEntry::GlyphMemory() const
+{
+	return fGlyphCache->Memory();
+}
+
+
 bool
 FontCacheEntry::GetKerning(uint32 glyphCode1, uint32 glyphCode2,
 	double* x, double* y)
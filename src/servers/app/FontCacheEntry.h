@@ -1,5 +1,5 @@
 /*
- * Copyright 2007-2009, Haiku. All rights reserved.
+ * Copyright 2007-2010, Haiku. All rights reserved.
  * Distributed under the terms of the MIT License.
  *
  * Authors:
@@ -33,6 +33,8 @@
 #include <agg_conv_contour.h>
 #include <agg_conv_transform.h>
 
+#include <util/DoublyLinkedList.h>
+
 #include "ServerFont.h"
 #include "FontEngine.h"
 #include "MultiLocker.h"
@@ -40,28 +42,24 @@
 #include "Transformable.h"
 
 
-struct GlyphCache {
-	GlyphCache(uint32 glyphIndex, uint32 dataSize, glyph_data_type dataType,
-			const agg::rect_i& bounds, float advanceX, float advanceY,
-			float insetLeft, float insetRight)
+struct GlyphCache : DoublyLinkedListLinkImpl<GlyphCache> {
+	GlyphCache(uint32 glyphIndex, uint8* data, uint32 dataSize,
+			glyph_data_type dataType, const agg::rect_i& bounds,
+			float advanceX, float advanceY, float insetLeft, float insetRight)
 		:
 		glyph_index(glyphIndex),
-		data((uint8*)malloc(dataSize)),
+		data(data),
 		data_size(dataSize),
 		data_type(dataType),
 		bounds(bounds),
 		advance_x(advanceX),
 		advance_y(advanceY),
 		inset_left(insetLeft),
-		inset_right(insetRight)
+		inset_right(insetRight),
+		referenced(true)
 	{
 	}
 
-	~GlyphCache()
-	{
-		free(data);
-	}
-
 	uint32			glyph_index;
 	uint8*			data;
 	uint32			data_size;
@@ -72,6 +70,9 @@ struct GlyphCache {
 	float			inset_left;
 	float			inset_right;
 
+	// set whenever the glyph is used, cleared by the eviction sweep
+	bool			referenced;
+
 	GlyphCache*		hash_link;
 };
 
@@ -125,6 +126,7 @@ class FontCacheEntry : public MultiLocker, public BReferenceable {
 									{ return fLastUsedTime; }
 			uint64				UsedCount() const
 									{ return fUseCounter; }
+			size_t				GlyphMemory() const;
 
  private:
 								FontCacheEntry(const FontCacheEntry&);
@@ -0,0 +1,198 @@
+/*
+ * Copyright 2010, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+/*!	Packs the rendered glyph data of all FontCacheEntry objects into large,
+	shared pages, instead of using a separate heap allocation for every
+	glyph.
+
+	Each page serves a single size class; the glyphs drawn by a string
+	usually come from the same one or two classes, and thus lie close to
+	each other in memory. Freed slots are reused by the next glyph of the
+	same class, and a page is given back as soon as its last slot is freed,
+	so that its memory can serve any size class again. Pages that are only
+	partially used still count fully in PageMemory(), which may therefore
+	exceed the glyph cache budget enforced by the FontCache.
+	Glyphs that do not fit into the largest size class are allocated from
+	the heap directly.
+*/
+
+
+#include "GlyphAtlas.h"
+
+#include <malloc.h>
+#include <stdlib.h>
+
+#include <Autolock.h>
+
+
+static const size_t kPageSize = 64 * 1024;
+static const uint32 kMinSlotSize = 16;
+
+
+GlyphAtlas::GlyphAtlas()
+	:
+	fLock("glyph atlas"),
+	fPageMemory(0)
+{
+	for (int32 i = 0; i < kSizeClassCount; i++)
+		fSizeClasses[i] = NULL;
+}
+
+
+GlyphAtlas::~GlyphAtlas()
+{
+	// all glyphs must have been freed already, which releases their pages
+}
+
+
+/*!	Returns storage for \a size bytes of glyph data, or \c NULL if there is
+	not enough memory. The memory must be given back with Free(), using the
+	same \a size.
+*/
+uint8*
+GlyphAtlas::Allocate(uint32 size)
+{
+	int32 index = _SizeClassFor(size);
+	if (index < 0)
+		return (uint8*)malloc(size);
+
+	BAutolock _(fLock);
+
+	page* slotPage = fSizeClasses[index];
+	if (slotPage == NULL) {
+		// start a new page for this size class
+		slotPage = (page*)memalign(kPageSize, kPageSize);
+		if (slotPage == NULL)
+			return NULL;
+
+		slotPage->free = NULL;
+		slotPage->position = (uint8*)slotPage + _PageHeaderSize();
+		slotPage->used = 0;
+		_AddPage(index, slotPage);
+		fPageMemory += kPageSize;
+	}
+
+	uint8* data;
+	if (slotPage->free != NULL) {
+		data = (uint8*)slotPage->free;
+		slotPage->free = slotPage->free->next;
+	} else {
+		data = slotPage->position;
+		slotPage->position += kMinSlotSize << index;
+	}
+
+	slotPage->used++;
+
+	// only pages with free slots are kept in their size class
+	if (_IsFull(slotPage, index))
+		_RemovePage(index, slotPage);
+
+	return data;
+}
+
+
+void
+GlyphAtlas::Free(uint8* data, uint32 size)
+{
+	if (data == NULL)
+		return;
+
+	int32 index = _SizeClassFor(size);
+	if (index < 0) {
+		free(data);
+		return;
+	}
+
+	BAutolock _(fLock);
+
+	page* slotPage = (page*)((addr_t)data & ~(addr_t)(kPageSize - 1));
+	bool wasFull = _IsFull(slotPage, index);
+
+	free_slot* slot = (free_slot*)data;
+	slot->next = slotPage->free;
+	slotPage->free = slot;
+
+	if (--slotPage->used == 0) {
+		if (!wasFull)
+			_RemovePage(index, slotPage);
+
+		free(slotPage);
+		fPageMemory -= kPageSize;
+	} else if (wasFull)
+		_AddPage(index, slotPage);
+}
+
+
+/*!	Returns the amount of memory an allocation of \a size bytes actually
+	uses, which is what counts against the glyph cache budget.
+*/
+/*static*/ uint32
+GlyphAtlas::AllocationSize(uint32 size)
+{
+	int32 index = _SizeClassFor(size);
+	if (index < 0)
+		return size;
+
+	return kMinSlotSize << index;
+}
+
+
+/*static*/ int32
+GlyphAtlas::_SizeClassFor(uint32 size)
+{
+	if (size > kMinSlotSize << (kSizeClassCount - 1))
+		return -1;
+
+	int32 index = 0;
+	uint32 slotSize = kMinSlotSize;
+	while (slotSize < size) {
+		slotSize <<= 1;
+		index++;
+	}
+
+	return index;
+}
+
+
+/*!	The slots of a page start behind its header, at a multiple of the
+	smallest slot size.
+*/
+/*static*/ size_t
+GlyphAtlas::_PageHeaderSize()
+{
+	return (sizeof(page) + kMinSlotSize - 1) & ~(size_t)(kMinSlotSize - 1);
+}
+
+
+/*static*/ bool
+GlyphAtlas::_IsFull(const page* slotPage, int32 index)
+{
+	return slotPage->free == NULL
+		&& slotPage->position + (kMinSlotSize << index)
+			> (uint8*)slotPage + kPageSize;
+}
+
+
+void
+GlyphAtlas::_AddPage(int32 index, page* slotPage)
+{
+	slotPage->previous = NULL;
+	slotPage->next = fSizeClasses[index];
+	if (slotPage->next != NULL)
+		slotPage->next->previous = slotPage;
+	fSizeClasses[index] = slotPage;
+}
+
+
+void
+GlyphAtlas::_RemovePage(int32 index, page* slotPage)
+{
+	if (slotPage->previous != NULL)
+		slotPage->previous->next = slotPage->next;
+	else
+		fSizeClasses[index] = slotPage->next;
+	if (slotPage->next != NULL)
+		slotPage->next->previous = slotPage->previous;
+}
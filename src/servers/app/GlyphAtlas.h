@@ -0,0 +1,56 @@
+/*
+ * Copyright 2010, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef GLYPH_ATLAS_H
+#define GLYPH_ATLAS_H
+
+
+#include <Locker.h>
+#include <SupportDefs.h>
+
+
+class GlyphAtlas {
+public:
+								GlyphAtlas();
+								~GlyphAtlas();
+
+			uint8*				Allocate(uint32 size);
+			void				Free(uint8* data, uint32 size);
+
+	static	uint32				AllocationSize(uint32 size);
+
+			size_t				PageMemory() const
+									{ return fPageMemory; }
+
+private:
+	static	const int32			kSizeClassCount = 8;
+									// 16 to 2048 bytes
+
+			struct free_slot {
+				free_slot*		next;
+			};
+
+			struct page {
+				page*			next;
+				page*			previous;
+				free_slot*		free;
+				uint8*			position;
+									// the first slot that was never used
+				uint32			used;
+			};
+
+	static	int32				_SizeClassFor(uint32 size);
+	static	size_t				_PageHeaderSize();
+	static	bool				_IsFull(const page* slotPage, int32 index);
+			void				_AddPage(int32 index, page* slotPage);
+			void				_RemovePage(int32 index, page* slotPage);
+
+			BLocker				fLock;
+			page*				fSizeClasses[kSizeClassCount];
+									// the pages that have free slots
+			size_t				fPageMemory;
+};
+
+
+#endif	// GLYPH_ATLAS_H
@@ -1,5 +1,5 @@
 /*
- * Copyright 2007-2009, Haiku Inc. All rights reserved.
+ * Copyright 2007-2010, Haiku Inc. All rights reserved.
  * Distributed under the terms of the MIT License.
  *
  * Authors:
@@ -45,6 +45,7 @@ string_for_message_code(uint32 code, BString& string)
 		CODE(AS_CREATE_BITMAP);
 		CODE(AS_DELETE_BITMAP);
 		CODE(AS_GET_BITMAP_OVERLAY_RESTRICTIONS);
+		CODE(AS_GET_CLIENT_MEMORY_STATISTICS);
 
 		// Cursor commands
 		CODE(AS_SET_CURSOR);
@@ -91,6 +92,7 @@ string_for_message_code(uint32 code, BString& string)
 		CODE(AS_SET_SIZE_LIMITS);
 		CODE(AS_ACTIVATE_WINDOW);
 		CODE(AS_IS_FRONT_WINDOW);
+		CODE(AS_ENABLE_LINK_RING);
 
 		// BPicture definitions
 		CODE(AS_CREATE_PICTURE);
@@ -125,6 +127,7 @@ string_for_message_code(uint32 code, BString& string)
 		CODE(AS_GET_HAS_GLYPHS);
 		CODE(AS_GET_GLYPH_SHAPES);
 		CODE(AS_GET_TRUNCATED_STRINGS);
+		CODE(AS_GET_GLYPH_CACHE_STATISTICS);
 
 		// Screen methods
 		CODE(AS_VALID_SCREEN_ID);
@@ -187,6 +190,7 @@ string_for_message_code(uint32 code, BString& string)
 		CODE(AS_GET_DECORATOR_SETTINGS);
 		CODE(AS_GET_SHOW_ALL_DRAGGERS);
 		CODE(AS_SET_SHOW_ALL_DRAGGERS);
+		CODE(AS_GET_REDRAW_STATISTICS);
 
 		// Subpixel antialiasing & hinting
 		CODE(AS_SET_SUBPIXEL_ANTIALIASING);
@@ -1,5 +1,5 @@
 /*
- * Copyright 2001-2009, Haiku.
+ * Copyright 2001-2010, Haiku.
  * Distributed under the terms of the MIT License.
  *
  * Authors:
@@ -40,6 +40,7 @@
 #include <PrivateScreen.h>
 #include <RosterPrivate.h>
 #include <ServerProtocol.h>
+#include <ServerProtocolStructs.h>
 #include <WindowPrivate.h>
 
 #include "AppServer.h"
@@ -50,6 +51,7 @@
 #include "DecorManager.h"
 #include "DrawingEngine.h"
 #include "EventStream.h"
+#include "FontCache.h"
 #include "FontManager.h"
 #include "HWInterface.h"
 #include "InputManager.h"
@@ -811,6 +813,20 @@ ServerApp::_DispatchMessage(int32 code, BPrivate::LinkReceiver& link)
 			break;
 		}
 
+		case AS_GET_CLIENT_MEMORY_STATISTICS:
+		{
+			STRACE(("ServerApp %s: get client memory statistics\n",
+				Signature()));
+
+			ClientMemoryStatisticsInfo info;
+			fMemoryAllocator.GetStatistics(info);
+
+			fLink.StartMessage(B_OK);
+			fLink.Attach<ClientMemoryStatisticsInfo>(info);
+			fLink.Flush();
+			break;
+		}
+
 		// Picture ops
 
 		case AS_CREATE_PICTURE:
@@ -1446,6 +1462,20 @@ ServerApp::_DispatchMessage(int32 code, BPrivate::LinkReceiver& link)
 			break;
 		}
 
+		case AS_GET_REDRAW_STATISTICS:
+		{
+			STRACE(("ServerApp %s: AS_GET_REDRAW_STATISTICS\n",
+				Signature()));
+
+			RedrawStatisticsInfo info;
+			Window::GetRedrawStatistics(info);
+
+			fLink.StartMessage(B_OK);
+			fLink.Attach<RedrawStatisticsInfo>(info);
+			fLink.Flush();
+			break;
+		}
+
 		case kMsgUpdateShowAllDraggers:
 		{
 			bool show = false;
@@ -1614,6 +1644,20 @@ ServerApp::_DispatchMessage(int32 code, BPrivate::LinkReceiver& link)
 			fLink.Flush();
 			break;
 		}
+
+		case AS_GET_GLYPH_CACHE_STATISTICS:
+		{
+			STRACE(("ServerApp %s: AS_GET_GLYPH_CACHE_STATISTICS\n",
+				Signature()));
+
+			GlyphCacheStatisticsInfo info;
+			FontCache::Default()->GetStatistics(info);
+
+			fLink.StartMessage(B_OK);
+			fLink.Attach<GlyphCacheStatisticsInfo>(info);
+			fLink.Flush();
+			break;
+		}
 		
 		case AS_GET_FAMILY_AND_STYLES:
 		{
@@ -108,13 +108,14 @@ ServerBitmap::ServerBitmap(const ServerBitmap* bitmap)
 
 ServerBitmap::~ServerBitmap()
 {
+	delete fOverlay;
+		// deleting the overlay will also free the overlay buffer; software
+		// overlays must be gone before their buffer is freed below
+
 	if (fAllocator != NULL)
 		fAllocator->Free(AllocationCookie());
 	else
 		delete[] fBuffer;
-
-	delete fOverlay;
-		// deleting the overlay will also free the overlay buffer
 }
 
 
@@ -978,6 +978,57 @@ ServerPicture::SyncState(View* view)
 }
 
 
+/*!	Unlike SyncState(), this writes everything of the view's drawing state
+	that a picture can contain, including its font and pattern. A picture
+	started this way can be played from a fresh state, and will always
+	produce the same result; this is used for display lists.
+	The view's state must not have been pushed, as only the topmost state
+	is written.
+*/
+void
+ServerPicture::SyncCompleteState(View* view)
+{
+	DrawState* state = view->CurrentState();
+
+	EnterStateChange();
+
+	WriteSetOrigin(state->Origin());
+	WriteSetScale(state->Scale());
+	WriteSetPenLocation(state->PenLocation());
+	WriteSetPenSize(state->UnscaledPenSize());
+	WriteSetLineMode(state->LineCapMode(), state->LineJoinMode(),
+		state->MiterLimit());
+	WriteSetPattern(state->GetPattern().GetPattern());
+	WriteSetDrawingMode(state->GetDrawingMode());
+
+	WriteSetHighColor(state->HighColor());
+	WriteSetLowColor(state->LowColor());
+
+	ExitStateChange();
+
+	// the font size is scaled with the state, but needs to be written
+	// unscaled
+	const ServerFont& font = state->Font();
+	float size = font.Size();
+	if (state->Scale() != 0.0)
+		size /= state->Scale();
+
+	BeginOp(B_PIC_ENTER_FONT_STATE);
+
+	WriteSetFontFamily(font.Family());
+	WriteSetFontStyle(font.Style());
+	WriteSetFontSize(size);
+	WriteSetFontShear(font.Shear());
+	WriteSetFontRotation(font.Rotation());
+	WriteSetFontSpacing(font.Spacing());
+	WriteSetFontEncoding(font.Encoding());
+	WriteSetFontFace(font.Face());
+	WriteSetFontFlags(font.Flags());
+
+	EndOp();
+}
+
+
 void
 ServerPicture::SetFontFromLink(BPrivate::LinkReceiver& link)
 {
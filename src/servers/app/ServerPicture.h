@@ -45,6 +45,7 @@ public:
 			void				ExitStateChange();
 
 			void				SyncState(View* view);
+			void				SyncCompleteState(View* view);
 			void				SetFontFromLink(BPrivate::LinkReceiver& link);
 
 			void				Play(View* view);
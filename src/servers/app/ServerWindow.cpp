@@ -41,6 +41,7 @@
 #include <GradientDiamond.h>
 #include <GradientConic.h>
 
+#include <LinkRing.h>
 #include <MessagePrivate.h>
 #include <PortLink.h>
 #include <ServerProtocolStructs.h>
@@ -56,6 +57,7 @@
 #include "Desktop.h"
 #include "DirectWindowInfo.h"
 #include "DrawingEngine.h"
+#include "DrawState.h"
 #include "HWInterface.h"
 #include "Overlay.h"
 #include "ProfileMessageSupport.h"
@@ -122,6 +124,10 @@ static profile sRedrawProcessingTime;
 //static profile sNextMessageTime;
 #endif
 
+// Display lists that grow larger than this are dropped, as the client
+// will most likely be faster at redrawing its view anyway.
+static const off_t kMaxDisplayListSize = 1024 * 1024;
+
 
 //	#pragma mark -
 
@@ -168,6 +174,7 @@ ServerWindow::ServerWindow(const char* title, ServerApp* app,
 	fCurrentView(NULL),
 	fCurrentDrawingRegion(),
 	fCurrentDrawingRegionValid(false),
+	fDisplayListRegion(NULL),
 
 	fDirectWindowInfo(NULL),
 	fIsDirectlyAccessing(false)
@@ -494,6 +501,46 @@ ServerWindow::ResyncDrawState()
 }
 
 
+/*!	Replays the display list of \a view, limited to \a region (in screen
+	coordinates). The list is played with a fresh drawing state, the one
+	of the client is left untouched.
+	The drawing engine must be locked by the caller.
+*/
+void
+ServerWindow::PlayDisplayList(View* view, const BRegion& region)
+{
+	ServerPicture* displayList = view->DisplayList();
+	if (displayList == NULL)
+		return;
+
+	DrawState* state = new(nothrow) DrawState;
+	if (state == NULL)
+		return;
+
+	View* previousView = fCurrentView;
+	fCurrentView = view;
+	fDisplayListRegion = &region;
+
+	DrawState* clientState = view->ExchangeState(state);
+
+	_UpdateDrawState(view);
+	_UpdateCurrentDrawingRegion();
+
+	DrawingEngine* drawingEngine = fWindow->GetDrawingEngine();
+	drawingEngine->ConstrainClippingRegion(&fCurrentDrawingRegion);
+
+	displayList->Play(view);
+
+	// this also deletes any states the display list left pushed
+	delete view->ExchangeState(clientState);
+
+	fDisplayListRegion = NULL;
+	fCurrentView = previousView;
+	fCurrentDrawingRegionValid = false;
+	_UpdateDrawState(fCurrentView);
+}
+
+
 View*
 ServerWindow::_CreateView(BPrivate::LinkReceiver& link, View** _parent)
 {
@@ -853,6 +900,34 @@ ServerWindow::_DispatchMessage(int32 code, BPrivate::LinkReceiver& link)
 			break;
 		}
 
+		case AS_ENABLE_LINK_RING:
+		{
+			// From now on, the client writes its messages into a ring
+			// buffer shared with us, and only uses our port to wake us up
+			area_id area;
+			sem_id spaceSemaphore;
+			link.Read<area_id>(&area);
+			if (link.Read<sem_id>(&spaceSemaphore) != B_OK)
+				break;
+
+			DTRACE(("ServerWindow %s: Message AS_ENABLE_LINK_RING\n",
+				Title()));
+
+			status_t status = B_NO_MEMORY;
+			BPrivate::LinkRing* ring = new(std::nothrow) BPrivate::LinkRing;
+			if (ring != NULL) {
+				status = ring->InitConsumer(area, spaceSemaphore);
+				if (status == B_OK)
+					fLink.Receiver().SetRing(ring);
+				else
+					delete ring;
+			}
+
+			fLink.StartMessage(status);
+			fLink.Flush();
+			break;
+		}
+
 		case AS_GET_WORKSPACES:
 		{
 			DTRACE(("ServerWindow %s: Message AS_GET_WORKSPACES\n", Title()));
@@ -1050,7 +1125,9 @@ ServerWindow::_DispatchMessage(int32 code, BPrivate::LinkReceiver& link)
 
 		case AS_GET_MOUSE:
 		{
-			// Has the all-window look
+			// The mouse state is only changed with all windows locked, so
+			// holding the single window lock is enough to read it; this
+			// keeps clients polling the mouse from blocking window moves
 			DTRACE(("ServerWindow %s: Message AS_GET_MOUSE\n", fTitle));
 
 			// Returns
@@ -1177,6 +1254,7 @@ ServerWindow::_DispatchMessage(int32 code, BPrivate::LinkReceiver& link)
 			}
 
 			_DispatchViewMessage(code, link);
+			_RecordDisplayListMessage(code, link);
 			break;
 	}
 }
@@ -2129,6 +2207,22 @@ void
 ServerWindow::_DispatchViewDrawingMessage(int32 code,
 	BPrivate::LinkReceiver &link)
 {
+	if (!fWindow->InUpdate()) {
+		// the view contents change outside of an update, its display list
+		// would no longer match them
+		fCurrentView->InvalidateDisplayList();
+
+		if (fDisplayListRegion == NULL) {
+			// The same goes for the backing store, and not only where the
+			// view is visible right now: the parts that are hidden or
+			// obscured are not drawn, but would otherwise be restored
+			// with their old contents once they are exposed.
+			BRegion stale((BRect)fCurrentView->Bounds());
+			fCurrentView->ConvertToScreen(&stale);
+			fWindow->MarkBackingStoreStale(stale);
+		}
+	}
+
 	if (!fCurrentView->IsVisible() || !fWindow->IsVisible()) {
 		if (link.NeedsReply()) {
 			debug_printf("ServerWindow::DispatchViewDrawingMessage() got "
@@ -2832,6 +2926,72 @@ ServerWindow::_DispatchPictureMessage(int32 code, BPrivate::LinkReceiver& link)
 	if (picture == NULL)
 		return false;
 
+	switch (code) {
+		case AS_VIEW_BEGIN_PICTURE:
+		{
+			ServerPicture* newPicture = App()->CreatePicture();
+			if (newPicture != NULL) {
+				newPicture->PushPicture(picture);
+				newPicture->SyncState(fCurrentView);
+				fCurrentView->SetPicture(newPicture);
+			}
+			break;
+		}
+
+		case AS_VIEW_APPEND_TO_PICTURE:
+		{
+			int32 token;
+			link.Read<int32>(&token);
+
+			ServerPicture* appendPicture = App()->GetPicture(token);
+			if (appendPicture != NULL) {
+				//picture->SyncState(fCurrentView);
+				appendPicture->AppendPicture(picture);
+			}
+
+			fCurrentView->SetPicture(appendPicture);
+
+			if (appendPicture != NULL)
+				appendPicture->ReleaseReference();
+			break;
+		}
+
+		case AS_VIEW_END_PICTURE:
+		{
+			ServerPicture* poppedPicture = picture->PopPicture();
+			fCurrentView->SetPicture(poppedPicture);
+			if (poppedPicture != NULL)
+				poppedPicture->ReleaseReference();
+
+			fLink.StartMessage(B_OK);
+			fLink.Attach<int32>(picture->Token());
+			fLink.Flush();
+			return true;
+		}
+		default:
+			if (!_WritePictureMessage(picture, code, link))
+				return false;
+			break;
+	}
+
+	if (link.NeedsReply()) {
+		fLink.StartMessage(B_ERROR);
+		fLink.Flush();
+	}
+	return true;
+}
+
+
+/*!	Writes the drawing message \a code, and its data from \a link, to
+	\a picture. Changes to the drawing state are applied to the current
+	view as well.
+	Returns \c false if the message cannot be written to a picture, in
+	which case \a link has not been touched.
+*/
+bool
+ServerWindow::_WritePictureMessage(ServerPicture* picture, int32 code,
+	BPrivate::LinkReceiver& link)
+{
 	switch (code) {
 		case AS_VIEW_SET_ORIGIN:
 		{
@@ -3246,47 +3406,6 @@ ServerWindow::_DispatchPictureMessage(int32 code, BPrivate::LinkReceiver& link)
 			break;
 		}
 
-		case AS_VIEW_BEGIN_PICTURE:
-		{
-			ServerPicture* newPicture = App()->CreatePicture();
-			if (newPicture != NULL) {
-				newPicture->PushPicture(picture);
-				newPicture->SyncState(fCurrentView);
-				fCurrentView->SetPicture(newPicture);
-			}
-			break;
-		}
-
-		case AS_VIEW_APPEND_TO_PICTURE:
-		{
-			int32 token;
-			link.Read<int32>(&token);
-
-			ServerPicture* appendPicture = App()->GetPicture(token);
-			if (appendPicture != NULL) {
-				//picture->SyncState(fCurrentView);
-				appendPicture->AppendPicture(picture);
-			}
-
-			fCurrentView->SetPicture(appendPicture);
-
-			if (appendPicture != NULL)
-				appendPicture->ReleaseReference();
-			break;
-		}
-
-		case AS_VIEW_END_PICTURE:
-		{
-			ServerPicture* poppedPicture = picture->PopPicture();
-			fCurrentView->SetPicture(poppedPicture);
-			if (poppedPicture != NULL)
-				poppedPicture->ReleaseReference();
-
-			fLink.StartMessage(B_OK);
-			fLink.Attach<int32>(picture->Token());
-			fLink.Flush();
-			return true;
-		}
 /*
 		case AS_VIEW_SET_BLENDING_MODE:
 		{
@@ -3308,14 +3427,69 @@ ServerWindow::_DispatchPictureMessage(int32 code, BPrivate::LinkReceiver& link)
 			return false;
 	}
 
-	if (link.NeedsReply()) {
-		fLink.StartMessage(B_ERROR);
-		fLink.Flush();
-	}
 	return true;
 }
 
 
+/*!	Adds the message that has just been dispatched to the display list the
+	current view is recording, if any. Messages that cannot be recorded
+	make the view drop its display list, so that the client will be asked
+	to redraw it on the next expose.
+*/
+void
+ServerWindow::_RecordDisplayListMessage(int32 code,
+	BPrivate::LinkReceiver& link)
+{
+	switch (code) {
+		// these do not change what the view looks like, or invalidate
+		// its display list themselves
+		case AS_VIEW_DELETE:
+		case AS_VIEW_GET_STATE:
+		case AS_VIEW_SET_EVENT_MASK:
+		case AS_VIEW_SET_MOUSE_EVENT_MASK:
+		case AS_VIEW_MOVE_TO:
+		case AS_VIEW_RESIZE_TO:
+		case AS_VIEW_GET_COORD:
+		case AS_VIEW_GET_ORIGIN:
+		case AS_VIEW_RESIZE_MODE:
+		case AS_VIEW_HIDE:
+		case AS_VIEW_SHOW:
+		case AS_VIEW_GET_LINE_MODE:
+		case AS_VIEW_GET_SCALE:
+		case AS_VIEW_GET_PEN_LOC:
+		case AS_VIEW_GET_PEN_SIZE:
+		case AS_VIEW_SET_VIEW_COLOR:
+		case AS_VIEW_GET_VIEW_COLOR:
+		case AS_VIEW_GET_HIGH_COLOR:
+		case AS_VIEW_GET_LOW_COLOR:
+		case AS_VIEW_GET_BLENDING_MODE:
+		case AS_VIEW_GET_DRAWING_MODE:
+		case AS_VIEW_SET_VIEW_BITMAP:
+		case AS_VIEW_GET_CLIP_REGION:
+		case AS_VIEW_INVALIDATE_RECT:
+		case AS_VIEW_INVALIDATE_REGION:
+		case AS_VIEW_DRAG_IMAGE:
+		case AS_VIEW_DRAG_RECT:
+		case AS_VIEW_BEGIN_RECT_TRACK:
+		case AS_VIEW_END_RECT_TRACK:
+		case AS_VIEW_SCROLL:
+		case AS_VIEW_COPY_BITS:
+			return;
+	}
+
+	ServerPicture* displayList = fCurrentView->RecordingDisplayList();
+	if (displayList == NULL)
+		return;
+
+	// While the client records a picture, the drawing commands go there
+	// instead of to the screen.
+	if (fCurrentView->Picture() != NULL || link.RewindMessage() != B_OK
+		|| !_WritePictureMessage(displayList, code, link)
+		|| displayList->DataLength() > kMaxDisplayListSize)
+		fCurrentView->InvalidateDisplayList();
+}
+
+
 /*!	\brief Message-dispatching loop for the ServerWindow
 
 	Watches the ServerWindow's message port and dispatches as necessary
@@ -3459,8 +3633,11 @@ ServerWindow::_MessageLooper()
 			// Desktop locked), but don't hold the lock longer than 10 ms
 			if (!receiver.HasMessages() || ++messagesProcessed > 70
 				|| system_time() - processingStart > 10000) {
-				if (lockedDesktop)
+				if (lockedDesktop) {
+					// read back what has been drawn outside of an update
+					fWindow->UpdateBackingStore();
 					fDesktop->UnlockSingleWindow();
+				}
 				break;
 			}
 
@@ -3610,6 +3787,18 @@ ServerWindow::_UpdateDrawState(View* view)
 void
 ServerWindow::_UpdateCurrentDrawingRegion()
 {
+	if (fDisplayListRegion != NULL) {
+		// a display list is being played, only the region it covers
+		// may be drawn to
+		BRegion content;
+		fWindow->GetContentRegion(&content);
+
+		fCurrentDrawingRegion = fCurrentView->ScreenAndUserClipping(&content);
+		fCurrentDrawingRegion.IntersectWith(fDisplayListRegion);
+		fCurrentDrawingRegionValid = true;
+		return;
+	}
+
 	if (!fCurrentDrawingRegionValid
 		|| fWindow->DrawingRegionChanged(fCurrentView)) {
 		fWindow->GetEffectiveDrawingRegion(fCurrentView, fCurrentDrawingRegion);
@@ -3637,7 +3826,6 @@ ServerWindow::_MessageNeedsAllWindowsLocked(uint32 code) const
 		case AS_SET_SIZE_LIMITS:
 		case AS_SYSTEM_FONT_CHANGED:
 		case AS_SET_DECORATOR_SETTINGS:
-		case AS_GET_MOUSE:
 		case AS_DIRECT_WINDOW_SET_FULLSCREEN:
 //		case AS_VIEW_SET_EVENT_MASK:
 //		case AS_VIEW_SET_MOUSE_EVENT_MASK:
@@ -1,5 +1,5 @@
 /*
- * Copyright 2001-2009, Haiku.
+ * Copyright 2001-2010, Haiku.
  * Distributed under the terms of the MIT License.
  *
  * Authors:
@@ -108,6 +108,8 @@ public:
 									{ return fIsDirectlyAccessing; }
 
 			void				ResyncDrawState();
+			void				PlayDisplayList(View* view,
+									const BRegion& region);
 
 						// TODO: Change this
 	inline	void				UpdateCurrentDrawingRegion()
@@ -129,6 +131,10 @@ private:
 									BPrivate::LinkReceiver &link);
 			bool				_DispatchPictureMessage(int32 code,
 									BPrivate::LinkReceiver &link);
+			bool				_WritePictureMessage(ServerPicture* picture,
+									int32 code, BPrivate::LinkReceiver &link);
+			void				_RecordDisplayListMessage(int32 code,
+									BPrivate::LinkReceiver &link);
 			void				_MessageLooper();
 	virtual void				_PrepareQuit();
 	virtual void				_GetLooperName(char* name, size_t size);
@@ -174,6 +180,7 @@ private:
 			View*				fCurrentView;
 			BRegion				fCurrentDrawingRegion;
 			bool				fCurrentDrawingRegionValid;
+			const BRegion*		fDisplayListRegion;
 
 			DirectWindowInfo*	fDirectWindowInfo;
 			bool				fIsDirectlyAccessing;
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2001-2008, Haiku, Inc.
+ * Copyright (c) 2001-2010, Haiku, Inc.
  * Distributed under the terms of the MIT license.
  *
  * Authors:
@@ -112,6 +112,8 @@ View::View(IntRect frame, IntPoint scrollingOffset, const char* name,
 
 	fCursor(NULL),
 	fPicture(NULL),
+	fDisplayList(NULL),
+	fRecordingDisplayList(NULL),
 
 	fLocalClipping((BRect)Bounds()),
 	fScreenClipping(),
@@ -139,6 +141,8 @@ View::~View()
 	if (fCursor)
 		fCursor->ReleaseReference();
 
+	InvalidateDisplayList();
+
 	// iterate over children and delete each one
 	View* view = fFirstChild;
 	while (view) {
@@ -1027,6 +1031,9 @@ View::ResizeBy(int32 x, int32 y, BRegion* dirtyRegion)
 	if (x == 0 && y == 0)
 		return;
 
+	// the client might draw differently at the new size
+	InvalidateDisplayList();
+
 	fFrame.right += x;
 	fFrame.bottom += y;
 
@@ -1116,6 +1123,8 @@ View::ParentResized(int32 x, int32 y, BRegion* dirtyRegion)
 void
 View::ScrollBy(int32 x, int32 y, BRegion* dirtyRegion)
 {
+	InvalidateDisplayList();
+
 	if (!fVisible || !fWindow) {
 		fScrollingOffset.x += x;
 		fScrollingOffset.y += y;
@@ -1177,6 +1186,9 @@ View::CopyBits(IntRect src, IntRect dst, BRegion& windowContentClipping)
 	if (!fVisible || !fWindow)
 		return;
 
+	// the copied contents are not part of the display list
+	InvalidateDisplayList();
+
 	// TODO: confirm that in R5 this call is affected by origin and scale
 
 	// blitting version
@@ -1282,6 +1294,26 @@ View::PopState()
 }
 
 
+/*!	Replaces the view's complete state stack with \a state, and returns
+	the previous one. This is used to play a display list without being
+	influenced by, or changing, the state the client has set up.
+*/
+DrawState*
+View::ExchangeState(DrawState* state)
+{
+	DrawState* previous = fDrawState;
+	bool rebuildClipping = previous->HasClipping() || state->HasClipping();
+
+	fDrawState = state;
+	fDrawState->SetSubPixelPrecise(fFlags & B_SUBPIXEL_PRECISE);
+
+	if (rebuildClipping)
+		RebuildClipping(false);
+
+	return previous;
+}
+
+
 void
 View::SetEventMask(uint32 eventMask, uint32 options)
 {
@@ -1322,6 +1354,138 @@ View::SetPicture(ServerPicture* picture)
 }
 
 
+// #pragma mark - display lists
+
+
+/*!	Throws away the display list of this view, as well as the one that is
+	currently being recorded, if any. This must be done whenever the
+	contents of the view change in a way that is not recorded.
+*/
+void
+View::InvalidateDisplayList()
+{
+	if (fDisplayList != NULL) {
+		fDisplayList->ReleaseReference();
+		fDisplayList = NULL;
+	}
+	if (fRecordingDisplayList != NULL) {
+		fRecordingDisplayList->ReleaseReference();
+		fRecordingDisplayList = NULL;
+	}
+}
+
+
+/*!	Called when the client starts to update the \a dirty region (in screen
+	coordinates). This view and all of its children that will be redrawn
+	completely start recording a new display list, while those that will
+	only be redrawn partially lose their display list.
+	Only views in a simple state are recorded, ie. without any pushed
+	states, clipping, or a blending mode that cannot be part of a picture.
+*/
+void
+View::StartDisplayLists(const BRegion& dirty, BRegion* windowContentClipping)
+{
+	if (!fVisible)
+		return;
+
+	IntRect screenBounds(Bounds());
+	ConvertToScreen(&screenBounds);
+	if (!dirty.Intersects((clipping_rect)screenBounds))
+		return;
+
+	BRegion* redrawn = fWindow->GetRegion(
+		_ScreenClipping(windowContentClipping));
+	BRegion* notRedrawn = fWindow->GetRegion(
+		_ScreenClipping(windowContentClipping));
+	if (redrawn == NULL || notRedrawn == NULL) {
+		InvalidateDisplayList();
+		if (redrawn != NULL)
+			fWindow->RecycleRegion(redrawn);
+		return;
+	}
+
+	redrawn->IntersectWith(&dirty);
+	notRedrawn->Exclude(&dirty);
+
+	if (redrawn->CountRects() > 0) {
+		InvalidateDisplayList();
+
+		if (notRedrawn->CountRects() == 0
+			&& (fFlags & B_DRAW_ON_CHILDREN) == 0
+			&& fPicture == NULL
+			&& fDrawState->PreviousState() == NULL
+			&& !fDrawState->HasClipping()
+			&& fDrawState->AlphaSrcMode() == B_PIXEL_ALPHA
+			&& fDrawState->AlphaFncMode() == B_ALPHA_OVERLAY
+			&& !fDrawState->ForceFontAliasing()) {
+			fRecordingDisplayList = new(nothrow) ServerPicture();
+			if (fRecordingDisplayList != NULL)
+				fRecordingDisplayList->SyncCompleteState(this);
+		}
+	}
+
+	fWindow->RecycleRegion(redrawn);
+	fWindow->RecycleRegion(notRedrawn);
+
+	for (View* child = FirstChild(); child; child = child->NextSibling())
+		child->StartDisplayLists(dirty, windowContentClipping);
+}
+
+
+/*!	Called when the client has finished its update: the display lists that
+	were recorded completely replace the previous ones.
+*/
+void
+View::FinishDisplayLists()
+{
+	if (fRecordingDisplayList != NULL) {
+		if (fDisplayList != NULL)
+			fDisplayList->ReleaseReference();
+
+		fDisplayList = fRecordingDisplayList;
+		fRecordingDisplayList = NULL;
+	}
+
+	for (View* child = FirstChild(); child; child = child->NextSibling())
+		child->FinishDisplayLists();
+}
+
+
+/*!	Adds this view and all of its children that have a display list, and
+	that intersect \a region, to \a views, in drawing order. The part of
+	\a region that these views cover is added to \a displayListRegion.
+*/
+void
+View::FindDisplayLists(const BRegion& region, BRegion* windowContentClipping,
+	BObjectList<View>& views, BRegion& displayListRegion)
+{
+	if (!fVisible)
+		return;
+
+	IntRect screenBounds(Bounds());
+	ConvertToScreen(&screenBounds);
+	if (!region.Intersects((clipping_rect)screenBounds))
+		return;
+
+	if (fDisplayList != NULL && fRecordingDisplayList == NULL) {
+		BRegion* covered = fWindow->GetRegion(
+			_ScreenClipping(windowContentClipping));
+		if (covered != NULL) {
+			covered->IntersectWith(&region);
+			if (covered->CountRects() > 0 && views.AddItem(this))
+				displayListRegion.Include(covered);
+
+			fWindow->RecycleRegion(covered);
+		}
+	}
+
+	for (View* child = FirstChild(); child; child = child->NextSibling()) {
+		child->FindDisplayLists(region, windowContentClipping, views,
+			displayListRegion);
+	}
+}
+
+
 void
 View::Draw(DrawingEngine* drawingEngine, BRegion* effectiveClipping,
 	BRegion* windowContentClipping, bool deep)
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2001-2008, Haiku, Inc.
+ * Copyright (c) 2001-2010, Haiku, Inc.
  * Distributed under the terms of the MIT license.
  *
  * Authors:
@@ -175,6 +175,7 @@ class View {
 			void			PushState();
 			void			PopState();
 			DrawState*		CurrentState() const { return fDrawState; }
+			DrawState*		ExchangeState(DrawState* state);
 
 			void			SetEventMask(uint32 eventMask, uint32 options);
 			uint32			EventMask() const
@@ -189,6 +190,20 @@ class View {
 			ServerPicture*	Picture() const
 								{ return fPicture; }
 
+			// display lists
+			ServerPicture*	DisplayList() const
+								{ return fDisplayList; }
+			ServerPicture*	RecordingDisplayList() const
+								{ return fRecordingDisplayList; }
+			void			InvalidateDisplayList();
+			void			StartDisplayLists(const BRegion& dirty,
+								BRegion* windowContentClipping);
+			void			FinishDisplayLists();
+			void			FindDisplayLists(const BRegion& region,
+								BRegion* windowContentClipping,
+								BObjectList<View>& views,
+								BRegion& displayListRegion);
+
 			// for background clearing
 			virtual void	Draw(DrawingEngine* drawingEngine,
 								BRegion* effectiveClipping,
@@ -286,6 +301,8 @@ class View {
 
 			ServerCursor*	fCursor;
 			ServerPicture*	fPicture;
+			ServerPicture*	fDisplayList;
+			ServerPicture*	fRecordingDisplayList;
 
 			// clipping
 			BRegion			fLocalClipping;
@@ -16,11 +16,14 @@
 #include "Decorator.h"
 #include "DecorManager.h"
 #include "Desktop.h"
+#include "DesktopSettings.h"
 #include "DrawingEngine.h"
 #include "HWInterface.h"
 #include "MessagePrivate.h"
 #include "PortLink.h"
 #include "ServerApp.h"
+#include "ServerBitmap.h"
+#include "ServerProtocolStructs.h"
 #include "ServerWindow.h"
 #include "Workspace.h"
 #include "WorkspacesView.h"
@@ -57,6 +60,26 @@
 
 using std::nothrow;
 
+// redraw statistics, see Window::GetRedrawStatistics()
+static vint64 sUpdateMessages = 0;
+static vint64 sExposedPixels = 0;
+static vint64 sBackingStorePixels = 0;
+static vint64 sDisplayListPixels = 0;
+
+
+static int64
+region_area(const BRegion& region)
+{
+	int64 area = 0;
+	for (int32 i = 0; i < region.CountRects(); i++) {
+		clipping_rect rect = region.RectAtInt(i);
+		area += (int64)(rect.right - rect.left + 1)
+			* (rect.bottom - rect.top + 1);
+	}
+	return area;
+}
+
+
 // if the background clearing is delayed until
 // the client draws the view, we have less flickering
 // when contents have to be redrawn because of resizing
@@ -136,7 +159,9 @@ Window::Window(const BRect& frame, const char *name,
 	fMinHeight(1),
 	fMaxHeight(32768),
 
-	fWorkspacesViewCount(0)
+	fWorkspacesViewCount(0),
+
+	fBackingStore(NULL)
 {
 	// make sure our arguments are valid
 	if (!IsValidLook(fLook))
@@ -189,6 +214,8 @@ Window::~Window()
 
 	delete fDecorator;
 
+	_ReleaseBackingStore();
+
 	delete fDrawingEngine;
 }
 
@@ -203,18 +230,40 @@ Window::InitCheck() const
 }
 
 
-void
+/*!	Computes the visible region of the window from the part of the screen
+	that is not yet covered by the windows in front of it.
+	Returns \c true if the visible region actually changed. Otherwise, the
+	regions derived from it stay valid, so that the drawing of this window
+	is not affected by changes that happened to other windows.
+*/
+bool
 Window::SetClipping(BRegion* stillAvailableOnScreen)
 {
 	// this function is only called from the Desktop thread
 
 	// start from full region (as if the window was fully visible)
-	GetFullRegion(&fVisibleRegion);
-	// clip to region still available on screen
-	fVisibleRegion.IntersectWith(stillAvailableOnScreen);
+	BRegion* visibleRegion = GetRegion();
+	if (visibleRegion == NULL) {
+		GetFullRegion(&fVisibleRegion);
+		fVisibleRegion.IntersectWith(stillAvailableOnScreen);
+	} else {
+		GetFullRegion(visibleRegion);
+		// clip to region still available on screen
+		visibleRegion->IntersectWith(stillAvailableOnScreen);
+
+		bool changed = !(*visibleRegion == fVisibleRegion);
+		if (changed)
+			fVisibleRegion = *visibleRegion;
+
+		RecycleRegion(visibleRegion);
+
+		if (!changed && fVisibleContentRegionValid)
+			return false;
+	}
 
 	fVisibleContentRegionValid = false;
 	fEffectiveDrawingRegionValid = false;
+	return true;
 }
 
 
@@ -273,6 +322,7 @@ Window::VisibleContentRegion()
 	if (!fVisibleContentRegionValid) {
 		GetContentRegion(&fVisibleContentRegion);
 		fVisibleContentRegion.IntersectWith(&fVisibleRegion);
+		fVisibleContentRegionValid = true;
 	}
 	return fVisibleContentRegion;
 }
@@ -312,6 +362,7 @@ Window::MoveBy(int32 x, int32 y)
 		fBorderRegion.OffsetBy(x, y);
 	if (fContentRegionValid)
 		fContentRegion.OffsetBy(x, y);
+	fVisibleContentRegionValid = false;
 
 	if (fCurrentUpdateSession->IsUsed())
 		fCurrentUpdateSession->MoveBy(x, y);
@@ -366,8 +417,12 @@ Window::ResizeBy(int32 x, int32 y, BRegion* dirtyRegion)
 	fFrame.right += x;
 	fFrame.bottom += y;
 
+	// the window contents need to be redrawn by the client anyway
+	_ReleaseBackingStore();
+
 	fBorderRegionValid = false;
 	fContentRegionValid = false;
+	fVisibleContentRegionValid = false;
 	fEffectiveDrawingRegionValid = false;
 
 	if (fDecorator) {
@@ -431,6 +486,16 @@ Window::CopyContents(BRegion* region, int32 xOffset, int32 yOffset)
 	if (!IsVisible())
 		return;
 
+	if (fBackingStore != NULL) {
+		// the backing store picks up the copied contents later
+		BRegion* destination = fRegionPool.GetRegion(*region);
+		if (destination != NULL) {
+			destination->OffsetBy(xOffset, yOffset);
+			MarkBackingStoreStale(*destination);
+			fRegionPool.Recycle(destination);
+		}
+	}
+
 	BRegion* newDirty = fRegionPool.GetRegion(*region);
 
 	// clip the region to the visible contents at the
@@ -671,6 +736,17 @@ Window::RedrawDirtyRegion()
 			fRegionPool.GetRegion(VisibleContentRegion());
 		dirtyContentRegion->IntersectWith(&fDirtyRegion);
 
+		if ((fDirtyCause & UPDATE_EXPOSE) != 0)
+			atomic_add64(&sExposedPixels, region_area(*dirtyContentRegion));
+
+		if (fDirtyCause == UPDATE_EXPOSE && !fInUpdate) {
+			// the contents of the views have not changed, so they
+			// can be restored from the backing store, or from their
+			// display lists, if they have any
+			_RestoreFromBackingStore(*dirtyContentRegion);
+			_PlayDisplayLists(*dirtyContentRegion);
+		}
+
 		_TriggerContentRedraw(*dirtyContentRegion);
 
 		fRegionPool.Recycle(dirtyContentRegion);
@@ -737,6 +813,14 @@ Window::MarkContentDirtyAsync(BRegion& regionOnScreen)
 void
 Window::InvalidateView(View* view, BRegion& viewRegion)
 {
+	if (view != NULL && fBackingStore != NULL) {
+		// The client will draw the region anew, including the parts that
+		// are hidden or obscured right now, and won't be updated below.
+		BRegion stale(viewRegion);
+		view->ConvertToScreen(&stale);
+		MarkBackingStoreStale(stale);
+	}
+
 	if (view && IsVisible() && view->IsVisible()) {
 		if (!fContentRegionValid)
 			_UpdateContentRegion();
@@ -1484,6 +1568,7 @@ Window::SetLook(window_look look, BRegion* updateRegion)
 		// the border very likely changed
 	fContentRegionValid = false;
 		// mabye a resize handle was added...
+	fVisibleContentRegionValid = false;
 	fEffectiveDrawingRegionValid = false;
 		// ...and therefor the drawing region is
 		// likely not valid anymore either
@@ -1994,6 +2079,239 @@ Window::_TriggerContentRedraw(BRegion& dirtyContentRegion)
 }
 
 
+/*!	Restores the parts of \a dirtyContentRegion that are covered by views
+	with a display list by replaying them, and removes those parts from
+	the region, so that the client does not need to redraw them.
+*/
+void
+Window::_PlayDisplayLists(BRegion& dirtyContentRegion)
+{
+	if (dirtyContentRegion.CountRects() == 0
+		|| (fFlags & kWindowScreenFlag) != 0)
+		return;
+
+	if (!fContentRegionValid)
+		_UpdateContentRegion();
+
+	BObjectList<View> views;
+	BRegion* played = fRegionPool.GetRegion();
+	if (played == NULL)
+		return;
+
+	fTopView->FindDisplayLists(dirtyContentRegion, &fContentRegion, views,
+		*played);
+
+	if (views.CountItems() > 0 && fDrawingEngine->LockParallelAccess()) {
+		bool copyToFrontEnabled = fDrawingEngine->CopyToFrontEnabled();
+		fDrawingEngine->SetCopyToFrontEnabled(false);
+		fDrawingEngine->SuspendAutoSync();
+
+		// clear the background of the views first, the display lists
+		// only contain what the client drew on top of it
+		BRegion* background = fRegionPool.GetRegion(*played);
+		if (background != NULL) {
+			fTopView->Draw(fDrawingEngine, background, &fContentRegion, true);
+			fRegionPool.Recycle(background);
+		}
+
+		for (int32 i = 0; View* view = views.ItemAt(i); i++)
+			ServerWindow()->PlayDisplayList(view, *played);
+
+		fDrawingEngine->SetCopyToFrontEnabled(copyToFrontEnabled);
+		fDrawingEngine->CopyToFront(*played);
+		fDrawingEngine->Sync();
+
+		if (_BackingStoreEnabled())
+			_CaptureBackingStore(*played);
+
+		fDrawingEngine->UnlockParallelAccess();
+
+		dirtyContentRegion.Exclude(played);
+		atomic_add64(&sDisplayListPixels, region_area(*played));
+	}
+
+	fRegionPool.Recycle(played);
+}
+
+
+/*!	Restores the parts of \a dirtyContentRegion that are valid in the
+	backing store, and removes them from the region.
+*/
+void
+Window::_RestoreFromBackingStore(BRegion& dirtyContentRegion)
+{
+	if (fBackingStore == NULL || dirtyContentRegion.CountRects() == 0)
+		return;
+
+	if (!_BackingStoreEnabled()) {
+		_ReleaseBackingStore();
+		return;
+	}
+
+	BRegion* restore = fRegionPool.GetRegion(fBackingStoreValid);
+	if (restore == NULL)
+		return;
+
+	restore->OffsetBy((int32)fFrame.left, (int32)fFrame.top);
+	restore->IntersectWith(&dirtyContentRegion);
+
+	if (restore->CountRects() > 0 && fDrawingEngine->LockParallelAccess()) {
+		if (fDrawingEngine->WriteRegion(fBackingStore, *restore,
+				(int32)fFrame.left, (int32)fFrame.top) == B_OK) {
+			dirtyContentRegion.Exclude(restore);
+			atomic_add64(&sBackingStorePixels, region_area(*restore));
+		}
+		fDrawingEngine->UnlockParallelAccess();
+	}
+
+	fRegionPool.Recycle(restore);
+}
+
+
+/*!	Marks the given part of the window as changed, or about to be changed,
+	by the client. It may include parts that are not visible. The visible
+	parts are read back into the backing store by UpdateBackingStore(), once
+	the ServerWindow thread is done with the current batch of messages.
+*/
+void
+Window::MarkBackingStoreStale(const BRegion& regionOnScreen)
+{
+	if (fBackingStore == NULL)
+		return;
+
+	BRegion* stale = fRegionPool.GetRegion(regionOnScreen);
+	if (stale == NULL) {
+		// we cannot keep track of the changes anymore
+		_ReleaseBackingStore();
+		return;
+	}
+
+	stale->OffsetBy(-(int32)fFrame.left, -(int32)fFrame.top);
+	fBackingStoreValid.Exclude(stale);
+	fBackingStoreStale.Include(stale);
+
+	fRegionPool.Recycle(stale);
+}
+
+
+void
+Window::UpdateBackingStore()
+{
+	// executed in ServerWindow thread with the read lock held
+
+	if (fBackingStore == NULL || fBackingStoreStale.CountRects() == 0)
+		return;
+
+	BRegion* region = fRegionPool.GetRegion(fBackingStoreStale);
+	fBackingStoreStale.MakeEmpty();
+	if (region == NULL)
+		return;
+
+	region->OffsetBy((int32)fFrame.left, (int32)fFrame.top);
+	region->IntersectWith(&VisibleContentRegion());
+
+	// the parts the client is going to redraw are read back once it
+	// has finished the update
+	if (fPendingUpdateSession->IsUsed())
+		region->Exclude(&fPendingUpdateSession->DirtyRegion());
+	if (fCurrentUpdateSession->IsUsed())
+		region->Exclude(&fCurrentUpdateSession->DirtyRegion());
+	region->Exclude(&fDirtyRegion);
+
+	if (region->CountRects() > 0 && fDrawingEngine->LockParallelAccess()) {
+		_CaptureBackingStore(*region);
+		fDrawingEngine->UnlockParallelAccess();
+	}
+
+	fRegionPool.Recycle(region);
+}
+
+
+/*static*/ void
+Window::GetRedrawStatistics(RedrawStatisticsInfo& info)
+{
+	info.updateMessages = sUpdateMessages;
+	info.exposedPixels = sExposedPixels;
+	info.backingStorePixels = sBackingStorePixels;
+	info.displayListPixels = sDisplayListPixels;
+}
+
+
+bool
+Window::_BackingStoreEnabled() const
+{
+	if (IsOffscreenWindow() || (fFlags & kWindowScreenFlag) != 0
+		|| fWindow->HasDirectFrameBufferAccess())
+		return false;
+
+	return DesktopSettings(fDesktop).WindowBackingStores();
+}
+
+
+/*!	Makes sure there is a backing store matching the current size of the
+	window.
+*/
+bool
+Window::_EnsureBackingStore()
+{
+	int32 width = fFrame.IntegerWidth() + 1;
+	int32 height = fFrame.IntegerHeight() + 1;
+
+	if (fBackingStore != NULL) {
+		if (fBackingStore->Width() == width
+			&& fBackingStore->Height() == height)
+			return true;
+
+		_ReleaseBackingStore();
+	}
+
+	fBackingStore = new(nothrow) UtilityBitmap(
+		BRect(0, 0, width - 1, height - 1), B_RGB32, 0);
+	if (fBackingStore != NULL && fBackingStore->Bits() == NULL)
+		_ReleaseBackingStore();
+
+	return fBackingStore != NULL;
+}
+
+
+void
+Window::_ReleaseBackingStore()
+{
+	if (fBackingStore != NULL) {
+		fBackingStore->ReleaseReference();
+		fBackingStore = NULL;
+	}
+
+	fBackingStoreValid.MakeEmpty();
+	fBackingStoreStale.MakeEmpty();
+}
+
+
+/*!	Reads the given part of the screen into the backing store. The
+	caller must hold the parallel access lock of the drawing engine.
+*/
+void
+Window::_CaptureBackingStore(const BRegion& regionOnScreen)
+{
+	if (regionOnScreen.CountRects() == 0 || !_EnsureBackingStore())
+		return;
+
+	if (fDrawingEngine->ReadRegion(fBackingStore, regionOnScreen,
+			(int32)fFrame.left, (int32)fFrame.top) != B_OK)
+		return;
+
+	BRegion* captured = fRegionPool.GetRegion(regionOnScreen);
+	if (captured == NULL)
+		return;
+
+	captured->OffsetBy(-(int32)fFrame.left, -(int32)fFrame.top);
+	fBackingStoreValid.Include(captured);
+	fBackingStoreStale.Exclude(captured);
+
+	fRegionPool.Recycle(captured);
+}
+
+
 void
 Window::_DrawBorder()
 {
@@ -2084,6 +2402,8 @@ Window::_SendUpdateMessage()
 
 	fUpdateRequested = true;
 	fEffectiveDrawingRegionValid = false;
+
+	atomic_add64(&sUpdateMessages, 1);
 }
 
 
@@ -2159,6 +2479,13 @@ Window::BeginUpdate(BPrivate::PortLink& link)
 	link.Attach<int32>(B_NULL_TOKEN);
 	link.Flush();
 
+	// views that are redrawn completely record what the client draws, so
+	// that they can be restored without its help on the next expose
+	if (!IsOffscreenWindow() && (fFlags & kWindowScreenFlag) == 0
+		&& !ServerWindow()->HasDirectFrameBufferAccess()
+		&& DesktopSettings(fDesktop).RecordDisplayLists())
+		fTopView->StartDisplayLists(*dirty, &fContentRegion);
+
 	// supress back to front buffer copies in the drawing engine
 	fDrawingEngine->SetCopyToFrontEnabled(false);
 
@@ -2182,6 +2509,8 @@ Window::EndUpdate()
 	// NOTE: see comment in _BeginUpdate()
 
 	if (fInUpdate) {
+		fTopView->FinishDisplayLists();
+
 		// reenable copy to front
 		fDrawingEngine->SetCopyToFrontEnabled(true);
 
@@ -2189,9 +2518,28 @@ Window::EndUpdate()
 			fCurrentUpdateSession->DirtyRegion());
 
 		if (dirty) {
+			if (fBackingStore != NULL) {
+				// whatever the client did not manage to draw is no
+				// longer valid in the backing store
+				MarkBackingStoreStale(*dirty);
+			}
+
 			dirty->IntersectWith(&VisibleContentRegion());
 
 			fDrawingEngine->CopyToFront(*dirty);
+
+			if (_BackingStoreEnabled()) {
+				if (fPendingUpdateSession->IsUsed())
+					dirty->Exclude(&fPendingUpdateSession->DirtyRegion());
+				dirty->Exclude(&fDirtyRegion);
+
+				if (fDrawingEngine->LockParallelAccess()) {
+					_CaptureBackingStore(*dirty);
+					fDrawingEngine->UnlockParallelAccess();
+				}
+			} else
+				_ReleaseBackingStore();
+
 			fRegionPool.Recycle(dirty);
 		}
 
@@ -2223,6 +2571,7 @@ Window::_UpdateContentRegion()
 	}
 
 	fContentRegionValid = true;
+	fVisibleContentRegionValid = false;
 }
 
 
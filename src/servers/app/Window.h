@@ -1,5 +1,5 @@
 /*
- * Copyright 2001-2009, Haiku, Inc.
+ * Copyright 2001-2010, Haiku, Inc.
  * Distributed under the terms of the MIT license.
  *
  * Authors:
@@ -33,7 +33,9 @@ class Desktop;
 class DrawingEngine;
 class EventDispatcher;
 class Screen;
+class UtilityBitmap;
 class WorkspacesView;
+struct RedrawStatisticsInfo;
 
 // TODO: move this into a proper place
 #define AS_REDRAW 'rdrw'
@@ -73,7 +75,7 @@ public:
 
 			// setting and getting the "hard" clipping, you need to have
 			// WriteLock()ed the clipping!
-			void				SetClipping(BRegion* stillAvailableOnScreen);
+			bool				SetClipping(BRegion* stillAvailableOnScreen);
 			// you need to have ReadLock()ed the clipping!
 	inline	BRegion&			VisibleRegion() { return fVisibleRegion; }
 			BRegion&			VisibleContentRegion();
@@ -140,6 +142,14 @@ public:
 			void				CopyContents(BRegion* region,
 									int32 xOffset, int32 yOffset);
 
+			// retaining the window contents
+			void				MarkBackingStoreStale(
+									const BRegion& regionOnScreen);
+			void				UpdateBackingStore();
+
+	static	void				GetRedrawStatistics(
+									RedrawStatisticsInfo& info);
+
 			void				MouseDown(BMessage* message, BPoint where,
 									int32* _viewToken);
 			void				MouseUp(BMessage* message, BPoint where,
@@ -251,6 +261,15 @@ protected:
 
 			// different types of drawing
 			void				_TriggerContentRedraw(BRegion& dirty);
+			void				_PlayDisplayLists(BRegion& dirty);
+			void				_RestoreFromBackingStore(BRegion& dirty);
+
+			// handling the backing store
+			bool				_BackingStoreEnabled() const;
+			bool				_EnsureBackingStore();
+			void				_ReleaseBackingStore();
+			void				_CaptureBackingStore(
+									const BRegion& regionOnScreen);
 			void				_DrawBorder();
 
 			// handling update sessions
@@ -393,6 +412,12 @@ protected:
 			int32				fMaxHeight;
 
 			int32				fWorkspacesViewCount;
+
+			// the contents of the window as they were last drawn,
+			// the regions are in window coordinates
+			UtilityBitmap*		fBackingStore;
+			BRegion				fBackingStoreValid;
+			BRegion				fBackingStoreStale;
 };
 
 #endif // WINDOW_H
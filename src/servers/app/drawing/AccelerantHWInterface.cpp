@@ -1230,6 +1230,8 @@ AccelerantHWInterface::GetOverlayRestrictions(const Overlay* overlay,
 {
 	if (overlay == NULL || restrictions == NULL)
 		return B_BAD_VALUE;
+	if (overlay->IsSoftware())
+		return HWInterface::GetOverlayRestrictions(overlay, restrictions);
 	if (fAccGetOverlayConstraints == NULL)
 		return B_NOT_SUPPORTED;
 
@@ -1,5 +1,5 @@
 /*
- * Copyright 2001-2009, Haiku, Inc.
+ * Copyright 2001-2010, Haiku, Inc.
  * Distributed under the terms of the MIT License.
  *
  * Authors:
@@ -11,6 +11,7 @@
 
 #include <Bitmap.h>
 #include <stdio.h>
+#include <string.h>
 #include <algorithm>
 #include <stack>
 
@@ -105,6 +106,7 @@ DrawingEngine::DrawingEngine(HWInterface* interface)
 	fSuspendSyncLevel(0),
 	fCopyToFront(true)
 {
+	fPainter->SetThreadPool(gPainterThreadPool);
 	SetHWInterface(interface);
 }
 
@@ -1485,6 +1487,44 @@ DrawingEngine::ReadBitmap(ServerBitmap* bitmap, bool drawCursor, BRect bounds)
 }
 
 
+/*!	Copies the pixels of \a region (in screen coordinates) from the drawing
+	buffer into \a bitmap. The screen pixel at (x, y) ends up at
+	(x - xOffset, y - yOffset) in the bitmap.
+	Only 32 bit bitmaps are supported.
+*/
+status_t
+DrawingEngine::ReadRegion(ServerBitmap* bitmap, const BRegion& region,
+	int32 xOffset, int32 yOffset)
+{
+	ASSERT_PARALLEL_LOCKED();
+
+	AutoFloatingOverlaysHider _(fGraphicsCard, region.Frame());
+
+	return _TransferRegion(bitmap, region, xOffset, yOffset, true);
+}
+
+
+/*!	The opposite of ReadRegion(): restores \a region on screen from the
+	pixels of \a bitmap.
+*/
+status_t
+DrawingEngine::WriteRegion(ServerBitmap* bitmap, const BRegion& region,
+	int32 xOffset, int32 yOffset)
+{
+	ASSERT_PARALLEL_LOCKED();
+
+	BRect frame = region.Frame();
+	AutoFloatingOverlaysHider _(fGraphicsCard, frame);
+
+	status_t status = _TransferRegion(bitmap, region, xOffset, yOffset,
+		false);
+	if (status == B_OK)
+		_CopyToFront(frame);
+
+	return status;
+}
+
+
 // #pragma mark -
 
 
@@ -1528,6 +1568,60 @@ DrawingEngine::CopyRect(BRect src, int32 xOffset, int32 yOffset) const
 }
 
 
+status_t
+DrawingEngine::_TransferRegion(ServerBitmap* bitmap, const BRegion& region,
+	int32 xOffset, int32 yOffset, bool toBitmap)
+{
+	// TODO: assumes drawing buffer is 32 bits (which it currently always is)
+	RenderingBuffer* buffer = fGraphicsCard->DrawingBuffer();
+	if (buffer == NULL || bitmap == NULL || bitmap->Bits() == NULL)
+		return B_ERROR;
+
+	color_space space = bitmap->ColorSpace();
+	if (space != B_RGB32 && space != B_RGBA32)
+		return B_BAD_VALUE;
+
+	clipping_rect clip;
+	clip.left = max_c(0, xOffset);
+	clip.top = max_c(0, yOffset);
+	clip.right = min_c((int32)buffer->Width(), xOffset + bitmap->Width()) - 1;
+	clip.bottom = min_c((int32)buffer->Height(), yOffset + bitmap->Height())
+		- 1;
+
+	uint32 bufferBPR = buffer->BytesPerRow();
+	uint32 bitmapBPR = bitmap->BytesPerRow();
+
+	int32 count = region.CountRects();
+	for (int32 i = 0; i < count; i++) {
+		clipping_rect rect = region.RectAtInt(i);
+		rect.left = max_c(rect.left, clip.left);
+		rect.top = max_c(rect.top, clip.top);
+		rect.right = min_c(rect.right, clip.right);
+		rect.bottom = min_c(rect.bottom, clip.bottom);
+		if (rect.left > rect.right || rect.top > rect.bottom)
+			continue;
+
+		uint8* screenBits = (uint8*)buffer->Bits() + rect.top * bufferBPR
+			+ rect.left * 4;
+		uint8* bitmapBits = bitmap->Bits() + (rect.top - yOffset) * bitmapBPR
+			+ (rect.left - xOffset) * 4;
+		uint32 bytes = (rect.right - rect.left + 1) * 4;
+
+		for (int32 y = rect.top; y <= rect.bottom; y++) {
+			if (toBitmap)
+				memcpy(bitmapBits, screenBits, bytes);
+			else
+				memcpy(screenBits, bitmapBits, bytes);
+
+			screenBits += bufferBPR;
+			bitmapBits += bitmapBPR;
+		}
+	}
+
+	return B_OK;
+}
+
+
 void
 DrawingEngine::_CopyRect(uint8* src, uint32 width, uint32 height,
 	uint32 bytesPerRow, int32 xOffset, int32 yOffset) const
@@ -1,5 +1,5 @@
 /*
- * Copyright 2001-2009, Haiku, Inc.
+ * Copyright 2001-2010, Haiku, Inc.
  * Distributed under the terms of the MIT License.
  *
  * Authors:
@@ -64,6 +64,14 @@ public:
 	virtual	status_t		ReadBitmap(ServerBitmap *bitmap, bool drawCursor,
 								BRect bounds);
 
+	// for window backing stores
+	virtual	status_t		ReadRegion(ServerBitmap* bitmap,
+								const BRegion& region, int32 xOffset,
+								int32 yOffset);
+	virtual	status_t		WriteRegion(ServerBitmap* bitmap,
+								const BRegion& region, int32 xOffset,
+								int32 yOffset);
+
 	// clipping for all drawing functions, passing a NULL region
 	// will remove any clipping (drawing allowed everywhere)
 	virtual	void			ConstrainClippingRegion(const BRegion* region);
@@ -187,6 +195,9 @@ public:
 								int32 yOffset) const;
 
 private:
+			status_t		_TransferRegion(ServerBitmap* bitmap,
+								const BRegion& region, int32 xOffset,
+								int32 yOffset, bool toBitmap);
 			void			_CopyRect(uint8* bits, uint32 width,
 								uint32 height, uint32 bytesPerRow,
 								int32 xOffset, int32 yOffset) const;
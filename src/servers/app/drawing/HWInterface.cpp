@@ -1,5 +1,5 @@
 /*
- * Copyright 2005-2009, Haiku.
+ * Copyright 2005-2010, Haiku.
  * Distributed under the terms of the MIT License.
  *
  * Authors:
@@ -11,14 +11,20 @@
 
 #include <new>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 
+#include <Autolock.h>
+#include <BitmapPrivate.h>
+
 #include <vesa/vesa_info.h>
 
 #include "drawing_support.h"
+#include "ycbcr_conversion.h"
 
 #include "DrawingEngine.h"
+#include "Overlay.h"
 #include "RenderingBuffer.h"
 #include "SystemPalette.h"
 #include "UpdateQueue.h"
@@ -27,6 +33,26 @@
 using std::nothrow;
 
 
+struct HWInterface::software_overlay {
+	Overlay*		overlay;
+	overlay_view	view;
+	overlay_window	window;
+	rgb_color		color;
+		// the configuration of the overlay when it was last shown; the
+		// overlay itself is reconfigured without the software overlays lock
+	uint32*			frame;
+		// the converted part of the overlay buffer the overlay shows
+	overlay_view	frameView;
+	int32			frameWidth;
+	int32			frameOffset;
+		// the frame starts at a pixel pair, which may be left of the view
+	int32			changeCount;
+		// the client's change count the frame was converted for
+	bool			frameValid;
+	bool			needsRefresh;
+};
+
+
 HWInterfaceListener::HWInterfaceListener()
 {
 }
@@ -55,6 +81,8 @@ HWInterface::HWInterface(bool doubleBuffered, bool enableUpdateQueue)
 	fDoubleBuffered(doubleBuffered),
 	fVGADevice(-1),
 	fUpdateExecutor(NULL),
+	fSoftwareOverlaysLock("software overlays lock"),
+	fSoftwareOverlaysUpdateQueue(false),
 	fListeners(20)
 {
 	SetAsyncDoubleBuffered(doubleBuffered && enableUpdateQueue);
@@ -67,6 +95,13 @@ HWInterface::~HWInterface()
 
 	delete fCursorAreaBackup;
 
+	for (int32 i = 0; i < fSoftwareOverlays.CountItems(); i++) {
+		software_overlay* entry
+			= (software_overlay*)fSoftwareOverlays.ItemAt(i);
+		free(entry->frame);
+		delete entry;
+	}
+
 	// The standard cursor doesn't belong us - the drag bitmap might
 	if (fCursor != fCursorAndDragBitmap)
 		delete fCursorAndDragBitmap;
@@ -401,6 +436,7 @@ HWInterface::CopyBackToFront(const BRect& frame)
 			region.Exclude((clipping_rect)_CursorFrame());
 
 		_CopyBackToFront(region);
+		_DrawSoftwareOverlays(region, false);
 
 		_DrawCursor(area);
 
@@ -451,7 +487,29 @@ status_t
 HWInterface::GetOverlayRestrictions(const Overlay* overlay,
 	overlay_restrictions* restrictions)
 {
-	return B_NOT_SUPPORTED;
+	if (overlay == NULL || restrictions == NULL)
+		return B_BAD_VALUE;
+	if (!overlay->IsSoftware())
+		return B_NOT_SUPPORTED;
+
+	// software overlays can show any part of their buffer at any size
+	const overlay_buffer* buffer = overlay->OverlayBuffer();
+
+	memset(restrictions, 0, sizeof(overlay_restrictions));
+	restrictions->source.min_width = 1;
+	restrictions->source.max_width = buffer->width;
+	restrictions->source.min_height = 1;
+	restrictions->source.max_height = buffer->height;
+	restrictions->destination.min_width = 1;
+	restrictions->destination.max_width = 65535;
+	restrictions->destination.min_height = 1;
+	restrictions->destination.max_height = 65535;
+	restrictions->min_width_scale = 1.0f / buffer->width;
+	restrictions->max_width_scale = 65535.0f / buffer->width;
+	restrictions->min_height_scale = 1.0f / buffer->height;
+	restrictions->max_height_scale = 65535.0f / buffer->height;
+
+	return B_OK;
 }
 
 
@@ -488,6 +546,146 @@ HWInterface::HideOverlay(Overlay* overlay)
 }
 
 
+// #pragma mark - software overlays
+
+
+/*!	Returns whether or not an overlay bitmap with the given properties can
+	be emulated, if the graphics hardware does not support it.
+
+	Software overlays are drawn directly into the front buffer whenever
+	it is updated. The UpdateQueue checks them once per retrace, and
+	refreshes those whose buffer was changed by the client. The buffer is
+	only converted to RGB when it changed.
+	Like hardware overlays, they only show where the drawing buffer
+	contains their color key; this is why a separate back buffer is
+	required.
+*/
+bool
+HWInterface::CheckSoftwareOverlayRestrictions(int32 width, int32 height,
+	color_space colorSpace)
+{
+	if (width <= 0 || width > 65535 || height <= 0 || height > 65535)
+		return false;
+	if (colorSpace != B_YCbCr422 && colorSpace != B_YCbCr420)
+		return false;
+
+	if (!IsDoubleBuffered())
+		return false;
+
+	RenderingBuffer* frontBuffer = FrontBuffer();
+	return frontBuffer != NULL && (frontBuffer->ColorSpace() == B_RGB32
+		|| frontBuffer->ColorSpace() == B_RGBA32);
+}
+
+
+void
+HWInterface::ShowSoftwareOverlay(Overlay* overlay)
+{
+	{
+		BAutolock _(fSoftwareOverlaysLock);
+
+		software_overlay* entry = _FindSoftwareOverlay(overlay);
+		if (entry == NULL) {
+			entry = new(nothrow) software_overlay;
+			if (entry == NULL || !fSoftwareOverlays.AddItem(entry)) {
+				delete entry;
+				return;
+			}
+
+			memset(entry, 0, sizeof(software_overlay));
+			entry->overlay = overlay;
+		}
+
+		// the overlay was moved, or shows another part of its buffer
+		entry->view = *overlay->OverlayView();
+		entry->window = *overlay->OverlayWindow();
+		entry->color = overlay->Color();
+		entry->needsRefresh = true;
+	}
+
+	// Make sure someone refreshes the overlay; the update queue is removed
+	// again when the last software overlay is hidden. The software overlays
+	// lock must not be held here, as the update queue locks it with parallel
+	// access already granted.
+	if (fUpdateExecutor != NULL || !LockExclusiveAccess())
+		return;
+
+	if (fUpdateExecutor == NULL) {
+		SetAsyncDoubleBuffered(true);
+		if (fUpdateExecutor != NULL) {
+			fUpdateExecutor->Init();
+			fSoftwareOverlaysUpdateQueue = true;
+		}
+	}
+
+	UnlockExclusiveAccess();
+}
+
+
+void
+HWInterface::HideSoftwareOverlay(Overlay* overlay)
+{
+	{
+		BAutolock _(fSoftwareOverlaysLock);
+
+		software_overlay* entry = _FindSoftwareOverlay(overlay);
+		if (entry == NULL)
+			return;
+
+		fSoftwareOverlays.RemoveItem(entry);
+		free(entry->frame);
+		delete entry;
+
+		if (!fSoftwareOverlays.IsEmpty() || !fSoftwareOverlaysUpdateQueue)
+			return;
+	}
+
+	// Remove the update queue if it was only started for the software
+	// overlays. It must be deleted without the exclusive access, as its
+	// thread might be waiting for parallel access.
+	if (!LockExclusiveAccess())
+		return;
+
+	UpdateQueue* updateQueue = NULL;
+	if (fSoftwareOverlaysUpdateQueue && fSoftwareOverlaysLock.Lock()) {
+		if (fSoftwareOverlays.IsEmpty()) {
+			updateQueue = fUpdateExecutor;
+			RemoveListener(updateQueue);
+			fUpdateExecutor = NULL;
+			fSoftwareOverlaysUpdateQueue = false;
+		}
+		fSoftwareOverlaysLock.Unlock();
+	}
+
+	UnlockExclusiveAccess();
+
+	delete updateQueue;
+}
+
+
+/*!	Draws the software overlays that changed since they were last drawn
+	into the front buffer. The interface must already be locked for
+	parallel access.
+*/
+void
+HWInterface::RefreshSoftwareOverlays()
+{
+	RenderingBuffer* backBuffer = BackBuffer();
+	if (backBuffer == NULL || fSoftwareOverlays.IsEmpty())
+		return;
+
+	if (!fFloatingOverlaysLock.Lock())
+		return;
+
+	BRegion region((BRect)backBuffer->Bounds());
+	region.Exclude((clipping_rect)_CursorFrame());
+
+	_DrawSoftwareOverlays(region, true);
+
+	fFloatingOverlaysLock.Unlock();
+}
+
+
 // #pragma mark -
 
 
@@ -674,6 +872,236 @@ HWInterface::_DrawCursor(IntRect area) const
 }
 
 
+/*!	Draws the parts of the software overlays within \a region to the
+	front buffer. If \a changedOnly is \c true, only those overlays are
+	drawn that were changed by the client, or reconfigured since they
+	were last drawn. The caller must hold the floating overlays lock, and
+	the back buffer contents in \a region must already be in the front
+	buffer.
+*/
+void
+HWInterface::_DrawSoftwareOverlays(const BRegion& region, bool changedOnly)
+{
+	BAutolock _(fSoftwareOverlaysLock);
+
+	if (fSoftwareOverlays.IsEmpty() || !IsDoubleBuffered())
+		return;
+
+	RenderingBuffer* frontBuffer = FrontBuffer();
+	if (frontBuffer == NULL || BackBuffer() == NULL
+		|| (frontBuffer->ColorSpace() != B_RGB32
+			&& frontBuffer->ColorSpace() != B_RGBA32))
+		return;
+
+	bool synced = false;
+
+	for (int32 i = 0; i < fSoftwareOverlays.CountItems(); i++) {
+		software_overlay* entry
+			= (software_overlay*)fSoftwareOverlays.ItemAt(i);
+
+		bool changed = _UpdateSoftwareOverlayFrame(entry);
+		if (!entry->frameValid
+			|| (changedOnly && !changed && !entry->needsRefresh))
+			continue;
+
+		if (!synced) {
+			// the back buffer might just have been blitted by the hardware
+			Sync();
+			synced = true;
+		}
+
+		_DrawSoftwareOverlay(entry, region);
+
+		if (changedOnly)
+			entry->needsRefresh = false;
+	}
+}
+
+
+HWInterface::software_overlay*
+HWInterface::_FindSoftwareOverlay(Overlay* overlay) const
+{
+	for (int32 i = 0; i < fSoftwareOverlays.CountItems(); i++) {
+		software_overlay* entry
+			= (software_overlay*)fSoftwareOverlays.ItemAt(i);
+		if (entry->overlay == overlay)
+			return entry;
+	}
+
+	return NULL;
+}
+
+
+/*!	Converts the part of the overlay buffer that the overlay of \a entry
+	shows into its frame, but only if the client changed the buffer since
+	the last conversion, or the overlay shows another part of it now.
+	Returns whether or not the frame was converted anew.
+	The software overlays lock must be held.
+*/
+bool
+HWInterface::_UpdateSoftwareOverlayFrame(software_overlay* entry)
+{
+	Overlay* overlay = entry->overlay;
+	const overlay_view* view = &entry->view;
+	const overlay_buffer* buffer = overlay->OverlayBuffer();
+	const overlay_client_data* clientData = overlay->ClientData();
+
+	bool sameView = memcmp(&entry->frameView, view, sizeof(overlay_view))
+		== 0;
+	if (entry->frameValid && sameView && (clientData == NULL
+			|| clientData->change_count == entry->changeCount))
+		return false;
+
+	if (view->width == 0 || view->height == 0
+		|| view->h_start + view->width > buffer->width
+		|| view->v_start + view->height > buffer->height)
+		return false;
+
+	if (!entry->frameValid || !sameView) {
+		// start at a pixel pair, so that the chroma values are right
+		int32 first = view->h_start & ~1;
+		int32 width = view->h_start + view->width - first;
+
+		uint32* frame = (uint32*)realloc(entry->frame,
+			width * view->height * 4);
+		if (frame == NULL)
+			return false;
+
+		entry->frame = frame;
+		entry->frameView = *view;
+		entry->frameWidth = width;
+		entry->frameOffset = view->h_start - first;
+		entry->frameValid = false;
+	}
+
+	// don't wait for the client if it is writing to the buffer right now,
+	// the frame is converted with the next retrace
+	if (acquire_sem_etc(overlay->Semaphore(), 1, B_RELATIVE_TIMEOUT, 0)
+			!= B_OK)
+		return false;
+
+	// the client changes the count before it unlocks the buffer
+	if (clientData != NULL)
+		entry->changeCount = clientData->change_count;
+
+	int32 first = view->h_start - entry->frameOffset;
+	for (int32 row = 0; row < view->height; row++) {
+		_ConvertSoftwareOverlayRow(entry->frame + row * entry->frameWidth,
+			buffer, view->v_start + row, first, entry->frameWidth);
+	}
+
+	release_sem_etc(overlay->Semaphore(), 1, B_DO_NOT_RESCHEDULE);
+
+	entry->frameValid = true;
+	return true;
+}
+
+
+/*!	Scales the frame of the overlay of \a entry into the front buffer,
+	everywhere within \a region where the back buffer contains the color
+	key of the overlay.
+*/
+void
+HWInterface::_DrawSoftwareOverlay(software_overlay* entry,
+	const BRegion& region)
+{
+	const overlay_window* window = &entry->window;
+	const overlay_view* view = &entry->frameView;
+
+	if (window->width == 0 || window->height == 0)
+		return;
+
+	clipping_rect frame;
+	frame.left = window->h_start;
+	frame.top = window->v_start;
+	frame.right = frame.left + window->width - 1;
+	frame.bottom = frame.top + window->height - 1;
+
+	BRegion clipped;
+	clipped.Set(frame);
+	clipped.IntersectWith(&region);
+	if (clipped.CountRects() == 0)
+		return;
+
+	RenderingBuffer* backBuffer = BackBuffer();
+	RenderingBuffer* frontBuffer = FrontBuffer();
+	uint8* backBits = (uint8*)backBuffer->Bits();
+	uint32 backBPR = backBuffer->BytesPerRow();
+	uint8* frontBits = (uint8*)frontBuffer->Bits();
+	uint32 frontBPR = frontBuffer->BytesPerRow();
+
+	const rgb_color& color = entry->color;
+	uint32 colorKey = (color.red << 16) | (color.green << 8) | color.blue;
+	bool mirror = (window->flags & B_OVERLAY_HORIZONTAL_MIRRORING) != 0;
+
+	// 16.16 fixed point steps through the source
+	uint32 xStep = ((uint32)view->width << 16) / window->width;
+	uint32 yStep = ((uint32)view->height << 16) / window->height;
+
+	int32 count = clipped.CountRects();
+	for (int32 i = 0; i < count; i++) {
+		clipping_rect rect = clipped.RectAtInt(i);
+
+		for (int32 y = rect.top; y <= rect.bottom; y++) {
+			int32 row = ((y - frame.top) * yStep) >> 16;
+			const uint32* line = entry->frame + row * entry->frameWidth
+				+ entry->frameOffset;
+			uint32* back = (uint32*)(backBits + y * backBPR) + rect.left;
+			uint32* front = (uint32*)(frontBits + y * frontBPR) + rect.left;
+			uint32 position = (rect.left - frame.left) * xStep;
+
+			for (int32 x = rect.left; x <= rect.right; x++) {
+				if ((*back & 0x00ffffff) == colorKey) {
+					int32 column = position >> 16;
+					if (mirror)
+						column = view->width - 1 - column;
+
+					*front = line[column];
+				}
+
+				back++;
+				front++;
+				position += xStep;
+			}
+		}
+	}
+}
+
+
+/*!	Converts \a count pixels of the given \a row of the overlay \a buffer,
+	starting at the pixel pair at \a first, into \a dst.
+*/
+void
+HWInterface::_ConvertSoftwareOverlayRow(uint32* dst,
+	const overlay_buffer* buffer, int32 row, int32 first, int32 count)
+{
+	const uint8* bits = (const uint8*)buffer->buffer;
+	uint32 bytesPerRow = buffer->bytes_per_row;
+
+	switch (buffer->space) {
+		case B_YCbCr422:
+			convert_ycbcr422_row(dst, bits + row * bytesPerRow + first * 2,
+				count);
+			break;
+
+		case B_YCbCr420:
+		{
+			// Cb is stored in the even, Cr in the odd line of each pair
+			int32 cbRow = row & ~1;
+			int32 crRow = row | 1;
+			if (crRow >= buffer->height)
+				crRow = cbRow;
+
+			int32 offset = first / 2 * 3;
+			convert_ycbcr420_row(dst, bits + row * bytesPerRow + offset,
+				bits + cbRow * bytesPerRow + offset,
+				bits + crRow * bytesPerRow + offset, count);
+			break;
+		}
+	}
+}
+
+
 /*!	- source is assumed to be already at the right offset
 	- source is assumed to be in B_RGBA32 format
 	- location in front buffer is calculated
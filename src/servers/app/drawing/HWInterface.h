@@ -1,5 +1,5 @@
 /*
- * Copyright 2005-2009, Haiku.
+ * Copyright 2005-2010, Haiku.
  * Distributed under the terms of the MIT License.
  *
  * Authors:
@@ -150,6 +150,13 @@ public:
 	virtual void				ConfigureOverlay(Overlay* overlay);
 	virtual void				HideOverlay(Overlay* overlay);
 
+	// software emulated overlays
+			bool				CheckSoftwareOverlayRestrictions(int32 width,
+									int32 height, color_space colorSpace);
+			void				ShowSoftwareOverlay(Overlay* overlay);
+			void				HideSoftwareOverlay(Overlay* overlay);
+			void				RefreshSoftwareOverlays();
+
 	// frame buffer access (you need to ReadLock!)
 			RenderingBuffer*	DrawingBuffer() const;
 	virtual	RenderingBuffer*	FrontBuffer() const = 0;
@@ -205,6 +212,19 @@ protected:
 
 			void				_NotifyFrameBufferChanged();
 
+			struct software_overlay;
+
+			void				_DrawSoftwareOverlays(const BRegion& region,
+									bool changedOnly);
+			software_overlay*	_FindSoftwareOverlay(Overlay* overlay) const;
+			bool				_UpdateSoftwareOverlayFrame(
+									software_overlay* entry);
+			void				_DrawSoftwareOverlay(software_overlay* entry,
+									const BRegion& region);
+			void				_ConvertSoftwareOverlayRow(uint32* dst,
+									const overlay_buffer* buffer, int32 row,
+									int32 first, int32 count);
+
 	static	bool				_IsValidMode(const display_mode& mode);
 
 			// If we draw the cursor somewhere in the drawing buffer,
@@ -259,6 +279,10 @@ protected:
 private:
 			UpdateQueue*		fUpdateExecutor;
 
+			BLocker				fSoftwareOverlaysLock;
+			BList				fSoftwareOverlays;
+			bool				fSoftwareOverlaysUpdateQueue;
+
 			BList				fListeners;
 };
 
@@ -1,5 +1,5 @@
 /*
- * Copyright 2006-2009, Haiku, Inc.
+ * Copyright 2006-2010, Haiku, Inc.
  * Distributed under the terms of the MIT License.
  *
  * Authors:
@@ -9,6 +9,8 @@
 
 #include "Overlay.h"
 
+#include <string.h>
+
 #include <BitmapPrivate.h>
 
 #include "HWInterface.h"
@@ -64,29 +66,49 @@ Overlay::Overlay(HWInterface& interface, ServerBitmap* bitmap,
 	fHWInterface(interface),
 	fOverlayBuffer(NULL),
 	fClientData(NULL),
-	fOverlayToken(token)
+	fOverlayToken(token),
+	fSoftware(false)
 {
-	fSemaphore = create_sem(1, "overlay lock");
-	fColor = (rgb_color){ 21, 16, 21, 16 };
-		// TODO: whatever fine color we want to use here...
+	_Init();
+	_AllocateBuffer(bitmap);
 
-	fWindow.offset_top = 0;
-	fWindow.offset_left = 0;
-	fWindow.offset_right = 0;
-	fWindow.offset_bottom = 0;
+	TRACE("overlay: created %p, bitmap %p\n", this, bitmap);
+}
 
-	fWindow.flags = B_OVERLAY_COLOR_KEY;
 
-	_AllocateBuffer(bitmap);
+/*!	Creates an overlay that is emulated by the HWInterface, because the
+	graphics hardware cannot show \a bitmap itself. The \a buffer is
+	provided by the caller, and must be accessible by the client.
+*/
+Overlay::Overlay(HWInterface& interface, ServerBitmap* bitmap, uint8* buffer)
+	:
+	fHWInterface(interface),
+	fOverlayBuffer(&fSoftwareBuffer),
+	fClientData(NULL),
+	fOverlayToken(NULL),
+	fSoftware(true)
+{
+	_Init();
 
-	TRACE("overlay: created %p, bitmap %p\n", this, bitmap);
+	fSoftwareBuffer.space = bitmap->ColorSpace();
+	fSoftwareBuffer.width = bitmap->Width();
+	fSoftwareBuffer.height = bitmap->Height();
+	fSoftwareBuffer.bytes_per_row = bitmap->BytesPerRow();
+	fSoftwareBuffer.buffer = buffer;
+	fSoftwareBuffer.buffer_dma = NULL;
+
+	TRACE("overlay: created software %p, bitmap %p\n", this, bitmap);
 }
 
 
 Overlay::~Overlay()
 {
-	fHWInterface.ReleaseOverlayChannel(fOverlayToken);
-	_FreeBuffer();
+	if (fSoftware)
+		fHWInterface.HideSoftwareOverlay(this);
+	else {
+		fHWInterface.ReleaseOverlayChannel(fOverlayToken);
+		_FreeBuffer();
+	}
 
 	delete_sem(fSemaphore);
 	TRACE("overlay: deleted %p\n", this);
@@ -116,6 +138,9 @@ Overlay::Resume(ServerBitmap* bitmap)
 
 	TRACE("overlay: resume %p (lock status %ld)\n", this, locker.LockStatus());
 
+	if (fSoftware)
+		return B_OK;
+
 	status_t status = _AllocateBuffer(bitmap);
 	if (status < B_OK)
 		return status;
@@ -135,6 +160,11 @@ Overlay::Suspend(ServerBitmap* bitmap, bool needTemporary)
 
 	TRACE("overlay: suspend %p (lock status %ld)\n", this, locker.LockStatus());
 
+	if (fSoftware) {
+		// the buffer does not live in the frame buffer, and can stay
+		return B_OK;
+	}
+
 	_FreeBuffer();
 	fClientData->buffer = NULL;
 
@@ -142,6 +172,20 @@ Overlay::Suspend(ServerBitmap* bitmap, bool needTemporary)
 }
 
 
+void
+Overlay::_Init()
+{
+	fSemaphore = create_sem(1, "overlay lock");
+	fColor = (rgb_color){ 21, 16, 21, 16 };
+		// TODO: whatever fine color we want to use here...
+
+	memset(&fView, 0, sizeof(fView));
+	memset(&fWindow, 0, sizeof(fWindow));
+
+	fWindow.flags = B_OVERLAY_COLOR_KEY;
+}
+
+
 void
 Overlay::_FreeBuffer()
 {
@@ -167,7 +211,12 @@ Overlay::SetClientData(overlay_client_data* clientData)
 {
 	fClientData = clientData;
 	fClientData->lock = fSemaphore;
-	fClientData->buffer = (uint8*)fOverlayBuffer->buffer;
+	fClientData->change_count = 0;
+
+	// the client sets the buffer of software overlays itself, as only it
+	// knows where its clone of the buffer is
+	if (!fSoftware)
+		fClientData->buffer = (uint8*)fOverlayBuffer->buffer;
 }
 
 
@@ -187,7 +236,7 @@ void
 Overlay::TakeOverToken(Overlay* other)
 {
 	overlay_token token = other->OverlayToken();
-	if (token == NULL)
+	if (token == NULL || fSoftware)
 		return;
 
 	fOverlayToken = token;
@@ -219,6 +268,12 @@ Overlay::OverlayToken() const
 void
 Overlay::Hide()
 {
+	if (fSoftware) {
+		fHWInterface.HideSoftwareOverlay(this);
+		TRACE("overlay: hide software %p\n", this);
+		return;
+	}
+
 	if (fOverlayToken == NULL)
 		return;
 
@@ -268,7 +323,7 @@ Overlay::SetColorSpace(uint32 colorSpace)
 void
 Overlay::Configure(const BRect& source, const BRect& destination)
 {
-	if (fOverlayToken == NULL) {
+	if (!fSoftware && fOverlayToken == NULL) {
 		fOverlayToken = fHWInterface.AcquireOverlayChannel();
 		if (fOverlayToken == NULL)
 			return;
@@ -286,6 +341,9 @@ Overlay::Configure(const BRect& source, const BRect& destination)
 	fWindow.width = (uint16)destination.IntegerWidth() + 1;
 	fWindow.height = (uint16)destination.IntegerHeight() + 1;
 
-	fHWInterface.ConfigureOverlay(this);
+	if (fSoftware)
+		fHWInterface.ShowSoftwareOverlay(this);
+	else
+		fHWInterface.ConfigureOverlay(this);
 }
 
@@ -1,5 +1,5 @@
 /*
- * Copyright 2006-2007, Haiku, Inc.
+ * Copyright 2006-2010, Haiku, Inc.
  * Distributed under the terms of the MIT License.
  *
  * Authors:
@@ -23,10 +23,14 @@ class Overlay {
 	public:
 		Overlay(HWInterface& interface, ServerBitmap* bitmap,
 			overlay_token token);
+		Overlay(HWInterface& interface, ServerBitmap* bitmap, uint8* buffer);
 		~Overlay();
 
 		status_t InitCheck() const;
 
+		bool IsSoftware() const
+			{ return fSoftware; }
+
 		status_t Suspend(ServerBitmap* bitmap, bool needTemporary);
 		status_t Resume(ServerBitmap* bitmap);
 
@@ -55,6 +59,7 @@ class Overlay {
 		void Hide();
 
 	private:
+		void _Init();
 		void _FreeBuffer();
 		status_t _AllocateBuffer(ServerBitmap* bitmap);
 
@@ -66,6 +71,8 @@ class Overlay {
 		overlay_window			fWindow;
 		sem_id					fSemaphore;
 		rgb_color				fColor;
+		bool					fSoftware;
+		overlay_buffer			fSoftwareBuffer;
 };
 
 #endif	// OVERLAY_H
@@ -1,5 +1,6 @@
 /*
  * Copyright 2009, Christian Packmann.
+ * Copyright 2010, Haiku, Inc.
  * Copyright 2008, Andrej Spielmann <andrej.spielmann@seh.ox.ac.uk>.
  * Copyright 2005-2009, Stephan Aßmus <superstippi@gmx.de>.
  * All rights reserved. Distributed under the terms of the MIT License.
@@ -51,6 +52,8 @@
 
 #include "DrawingMode.h"
 #include "GlobalSubpixelSettings.h"
+#include "PainterThreadPool.h"
+#include "PainterTiles.h"
 #include "PatternHandler.h"
 #include "RenderingBuffer.h"
 #include "ServerBitmap.h"
@@ -78,6 +81,13 @@ using std::nothrow;
 #endif
 
 
+// drawing operations are split into tiles of at most this many rows
+#define PAINTER_TILE_HEIGHT			64
+#define PAINTER_MAX_TILES			256
+// smaller operations are not worth being rendered in parallel
+#define PAINTER_MIN_PARALLEL_PIXELS	(128 * 128)
+
+
 #define CHECK_CLIPPING	if (!fValidClipping) return BRect(0, 0, -1, -1);
 #define CHECK_CLIPPING_NO_RETURN	if (!fValidClipping) return;
 
@@ -114,6 +124,7 @@ Painter::Painter()
 	fLineCapMode(B_BUTT_CAP),
 	fLineJoinMode(B_MITER_JOIN),
 	fMiterLimit(B_DEFAULT_MITER_LIMIT),
+	fThreadPool(NULL),
 
 	fPatternHandler(),
 	fTextRenderer(fSubpixRenderer, fRenderer, fRendererBin, fUnpackedScanline,
@@ -183,6 +194,17 @@ Painter::Bounds() const
 }
 
 
+/*!	Sets the thread pool that is used to render large drawing operations in
+	parallel. If \a pool is \c NULL, everything is rendered by the calling
+	thread.
+*/
+void
+Painter::SetThreadPool(PainterThreadPool* pool)
+{
+	fThreadPool = pool;
+}
+
+
 // #pragma mark -
 
 
@@ -939,36 +961,13 @@ Painter::FillRect(const BRect& r, const rgb_color& c) const
 	if (!fValidClipping)
 		return;
 
-	uint8* dst = fBuffer.row_ptr(0);
-	uint32 bpr = fBuffer.stride();
-	int32 left = (int32)r.left;
-	int32 top = (int32)r.top;
-	int32 right = (int32)r.right;
-	int32 bottom = (int32)r.bottom;
-	// get a 32 bit pixel ready with the color
-	pixel32 color;
-	color.data8[0] = c.blue;
-	color.data8[1] = c.green;
-	color.data8[2] = c.red;
-	color.data8[3] = c.alpha;
-	// fill rects, iterate over clipping boxes
-	fBaseRenderer.first_clip_box();
-	do {
-		int32 x1 = max_c(fBaseRenderer.xmin(), left);
-		int32 x2 = min_c(fBaseRenderer.xmax(), right);
-		if (x1 <= x2) {
-			int32 y1 = max_c(fBaseRenderer.ymin(), top);
-			int32 y2 = min_c(fBaseRenderer.ymax(), bottom);
-			uint8* offset = dst + x1 * 4;
-			for (; y1 <= y2; y1++) {
-//					uint32* handle = (uint32*)(offset + y1 * bpr);
-//					for (int32 x = x1; x <= x2; x++) {
-//						*handle++ = color.data32;
-//					}
-				gfxset32(offset + y1 * bpr, color.data32, (x2 - x1 + 1) * 4);
-			}
-		}
-	} while (fBaseRenderer.next_clip_box());
+	clipping_rect rect;
+	rect.left = (int32)r.left;
+	rect.top = (int32)r.top;
+	rect.right = (int32)r.right;
+	rect.bottom = (int32)r.bottom;
+
+	_FillRects(&rect, 1, c);
 }
 
 
@@ -996,31 +995,19 @@ Painter::FillRectVerticalGradient(BRect r, const BGradientLinear& gradient) cons
 	_MakeGradient(gradient, colorCount, gradientArray,
 		gradientTop - (int32)r.top, gradientArraySize);
 
-	uint8* dst = fBuffer.row_ptr(0);
-	uint32 bpr = fBuffer.stride();
-	int32 left = (int32)r.left;
-	int32 top = (int32)r.top;
-	int32 right = (int32)r.right;
-	int32 bottom = (int32)r.bottom;
-	// fill rects, iterate over clipping boxes
-	fBaseRenderer.first_clip_box();
-	do {
-		int32 x1 = max_c(fBaseRenderer.xmin(), left);
-		int32 x2 = min_c(fBaseRenderer.xmax(), right);
-		if (x1 <= x2) {
-			int32 y1 = max_c(fBaseRenderer.ymin(), top);
-			int32 y2 = min_c(fBaseRenderer.ymax(), bottom);
-			uint8* offset = dst + x1 * 4;
-			for (; y1 <= y2; y1++) {
-//					uint32* handle = (uint32*)(offset + y1 * bpr);
-//					for (int32 x = x1; x <= x2; x++) {
-//						*handle++ = gradientArray[y1 - top];
-//					}
-				gfxset32(offset + y1 * bpr, gradientArray[y1 - top],
-					(x2 - x1 + 1) * 4);
-			}
-		}
-	} while (fBaseRenderer.next_clip_box());
+	clipping_rect rect;
+	rect.left = (int32)r.left;
+	rect.top = (int32)r.top;
+	rect.right = (int32)r.right;
+	rect.bottom = (int32)r.bottom;
+
+	gradient_fill_info info;
+	info.bits = fBuffer.row_ptr(0);
+	info.bytesPerRow = fBuffer.stride();
+	info.colors = gradientArray;
+	info.top = rect.top;
+
+	_RenderTiles(&rect, 1, &vertical_gradient_fill_tile, &info);
 }
 
 
@@ -1556,8 +1543,31 @@ Painter::FillRegion(const BRegion* region) const
 {
 	CHECK_CLIPPING
 
+	// Solid fills of all rects are rendered as one batch of tiles; that
+	// saves going through FillRect() for each of them, and allows to render
+	// a region made of many small rects in parallel.
+	int32 count = region->CountRects();
+	if (count > 0
+		&& (fDrawingMode == B_OP_COPY || fDrawingMode == B_OP_OVER)) {
+		pattern p = *fPatternHandler.GetR5Pattern();
+		if (p == B_SOLID_HIGH || p == B_SOLID_LOW) {
+			clipping_rect* rects = new (nothrow) clipping_rect[count];
+			if (rects != NULL) {
+				ArrayDeleter<clipping_rect> _(rects);
+
+				for (int32 i = 0; i < count; i++)
+					rects[i] = region->RectAtInt(i);
+
+				_FillRects(rects, count, p == B_SOLID_HIGH
+					? fPatternHandler.HighColor()
+					: fPatternHandler.LowColor());
+				return _Clipped(region->Frame());
+			}
+		}
+	}
+
 	BRegion copy(*region);
-	int32 count = copy.CountRects();
+	count = copy.CountRects();
 	BRect touched = FillRect(copy.RectAt(0));
 	for (int32 i = 1; i < count; i++) {
 		touched = touched | FillRect(copy.RectAt(i));
@@ -1604,6 +1614,100 @@ Painter::InvertRect(const BRect& r) const
 // #pragma mark - private
 
 
+/*!	Fills the \a rects, which must not overlap, with the solid color \a c.
+*/
+void
+Painter::_FillRects(const clipping_rect* rects, int32 count,
+	const rgb_color& c) const
+{
+	// get a 32 bit pixel ready with the color
+	pixel32 color;
+	color.data8[0] = c.blue;
+	color.data8[1] = c.green;
+	color.data8[2] = c.red;
+	color.data8[3] = c.alpha;
+
+	solid_fill_info info;
+	info.bits = fBuffer.row_ptr(0);
+	info.bytesPerRow = fBuffer.stride();
+	info.color = color.data32;
+
+	_RenderTiles(rects, count, &solid_fill_tile, &info);
+}
+
+
+/*!	Renders the parts of the \a rects that lie within the clipping region
+	by calling \a function for each tile. The \a rects must not overlap.
+
+	If a thread pool is set, every clipping box is split into bands of at
+	most PAINTER_TILE_HEIGHT rows, and if there is enough to do, these tiles
+	are rendered in parallel. Without a pool, every clipping box is rendered
+	as a single tile. The tile renderers only depend on the absolute pixel
+	positions, and the tiles never overlap, so the result is exactly the
+	same whether the pool is used or not.
+*/
+void
+Painter::_RenderTiles(const clipping_rect* rects, int32 count,
+	tile_render_function function, void* cookie) const
+{
+	clipping_rect tiles[PAINTER_MAX_TILES];
+	int32 tileCount = 0;
+	int64 pixelCount = 0;
+
+	for (int32 i = 0; i < count; i++) {
+		const clipping_rect& rect = rects[i];
+
+		fBaseRenderer.first_clip_box();
+		do {
+			int32 left = max_c(fBaseRenderer.xmin(), rect.left);
+			int32 right = min_c(fBaseRenderer.xmax(), rect.right);
+			int32 top = max_c(fBaseRenderer.ymin(), rect.top);
+			int32 bottom = min_c(fBaseRenderer.ymax(), rect.bottom);
+			if (left > right || top > bottom)
+				continue;
+
+			pixelCount += (int64)(right - left + 1) * (bottom - top + 1);
+
+			while (top <= bottom) {
+				if (tileCount == PAINTER_MAX_TILES) {
+					_RenderTileBatch(tiles, tileCount, pixelCount, function,
+						cookie);
+					tileCount = 0;
+					pixelCount = 0;
+				}
+
+				clipping_rect& tile = tiles[tileCount++];
+				tile.left = left;
+				tile.top = top;
+				tile.right = right;
+				tile.bottom = fThreadPool != NULL
+					? min_c(top + PAINTER_TILE_HEIGHT - 1, bottom) : bottom;
+
+				top = tile.bottom + 1;
+			}
+		} while (fBaseRenderer.next_clip_box());
+	}
+
+	if (tileCount > 0)
+		_RenderTileBatch(tiles, tileCount, pixelCount, function, cookie);
+}
+
+
+void
+Painter::_RenderTileBatch(const clipping_rect* tiles, int32 count,
+	int64 pixelCount, tile_render_function function, void* cookie) const
+{
+	if (fThreadPool != NULL && count > 1
+		&& pixelCount >= PAINTER_MIN_PARALLEL_PIXELS
+		&& fThreadPool->RenderTiles(function, cookie, tiles, count)) {
+		return;
+	}
+
+	for (int32 i = 0; i < count; i++)
+		function(cookie, tiles[i]);
+}
+
+
 // _Transform
 inline void
 Painter::_Transform(BPoint* point, bool centerOffset) const
@@ -1797,6 +1901,25 @@ copy_bitmap_row_bgr32_alpha(uint8* dst, const uint8* src, int32 numPixels,
 }
 
 
+#ifdef __INTEL__
+// copy_bitmap_row_bgr32_alpha_sse2
+static inline void
+copy_bitmap_row_bgr32_alpha_sse2(uint8* dst, const uint8* src,
+	int32 numPixels, const rgb_color* colorMap)
+{
+	// the assembler routine only handles multiples of four pixels
+	int32 count = numPixels & ~3;
+	if (count > 0)
+		blend_row_alpha_sse2(dst, src, count);
+
+	if (count < numPixels) {
+		copy_bitmap_row_bgr32_alpha(dst + count * 4, src + count * 4,
+			numPixels - count, colorMap);
+	}
+}
+#endif
+
+
 // _TransparentMagicToAlpha
 template<typename sourcePixel>
 void
@@ -1981,6 +2104,13 @@ Painter::_DrawBitmap(agg::rendering_buffer& srcBuffer, color_space format,
 		if (fDrawingMode == B_OP_OVER || (fDrawingMode == B_OP_ALPHA
 				 && fAlphaSrcMode == B_PIXEL_ALPHA
 				 && fAlphaFncMode == B_ALPHA_OVERLAY)) {
+#ifdef __INTEL__
+			if ((gAppServerSIMDFlags & APPSERVER_SIMD_SSE2) != 0) {
+				_DrawBitmapNoScale32(copy_bitmap_row_bgr32_alpha_sse2, 4,
+					srcBuffer, (int32)xOffset, (int32)yOffset, viewRect);
+				return;
+			}
+#endif
 			_DrawBitmapNoScale32(copy_bitmap_row_bgr32_alpha, 4, srcBuffer,
 				(int32)xOffset, (int32)yOffset, viewRect);
 			return;
@@ -2223,11 +2353,6 @@ Painter::_DrawBitmapBilinearCopy32(agg::rendering_buffer& srcBuffer,
 			- viewRect.top);
 	}
 
-	struct FilterInfo {
-		uint16 index;	// index into source bitmap row/column
-		uint16 weight;	// weight of the pixel at index [0..255]
-	};
-
 //#define FILTER_INFOS_ON_HEAP
 #ifdef FILTER_INFOS_ON_HEAP
 	FilterInfo* xWeights = new (nothrow) FilterInfo[dstWidth];
@@ -2297,21 +2422,7 @@ Painter::_DrawBitmapBilinearCopy32(agg::rendering_buffer& srcBuffer,
 //	yWeights[dstHeight - 1].index, yWeights[dstHeight - 1].weight,
 //	dstHeight);
 
-	const int32 left = (int32)viewRect.left;
-	const int32 top = (int32)viewRect.top;
-	const int32 right = (int32)viewRect.right;
-	const int32 bottom = (int32)viewRect.bottom;
-
-	const uint32 dstBPR = fBuffer.stride();
-	const uint32 srcBPR = srcBuffer.stride();
-
 	// Figure out which version of the code we want to use...
-	enum {
-		kOptimizeForLowFilterRatio = 0,
-		kUseDefaultVersion,
-		kUseSIMDVersion
-	};
-
 	int codeSelect = kUseDefaultVersion;
 
 	uint32 neededSIMDFlags = APPSERVER_SIMD_MMX | APPSERVER_SIMD_SSE;
@@ -2324,277 +2435,26 @@ Painter::_DrawBitmapBilinearCopy32(agg::rendering_buffer& srcBuffer,
 		}
 	}
 
-	// iterate over clipping boxes
-	fBaseRenderer.first_clip_box();
-	do {
-		const int32 x1 = max_c(fBaseRenderer.xmin(), left);
-		const int32 x2 = min_c(fBaseRenderer.xmax(), right);
-		if (x1 > x2)
-			continue;
-
-		int32 y1 = max_c(fBaseRenderer.ymin(), top);
-		int32 y2 = min_c(fBaseRenderer.ymax(), bottom);
-		if (y1 > y2)
-			continue;
-
-		// buffer offset into destination
-		uint8* dst = fBuffer.row_ptr(y1) + x1 * 4;
-
-		// x and y are needed as indeces into the wheight arrays, so the
-		// offset into the target buffer needs to be compensated
-		const int32 xIndexL = x1 - left - filterWeightXIndexOffset;
-		const int32 xIndexR = x2 - left - filterWeightXIndexOffset;
-		y1 -= top + filterWeightYIndexOffset;
-		y2 -= top + filterWeightYIndexOffset;
-
-//printf("x: %ld - %ld\n", xIndexL, xIndexR);
-//printf("y: %ld - %ld\n", y1, y2);
-
-		switch (codeSelect) {
-			case kOptimizeForLowFilterRatio:
-			{
-				// In this mode, we anticipate to hit many destination pixels
-				// that map directly to a source pixel, we have more branches
-				// in the inner loop but save time because of the special
-				// cases. If there are too few direct hit pixels, the branches
-				// only waste time.
-				for (; y1 <= y2; y1++) {
-					// cache the weight of the top and bottom row
-					const uint16 wTop = yWeights[y1].weight;
-					const uint16 wBottom = 255 - yWeights[y1].weight;
-
-					// buffer offset into source (top row)
-					register const uint8* src
-						= srcBuffer.row_ptr(yWeights[y1].index);
-					// buffer handle for destination to be incremented per
-					// pixel
-					register uint8* d = dst;
-
-					if (wTop == 255) {
-						for (int32 x = xIndexL; x <= xIndexR; x++) {
-							const uint8* s = src + xWeights[x].index;
-							// This case is important to prevent out
-							// of bounds access at bottom edge of the source
-							// bitmap. If the scale is low and integer, it will
-							// also help the speed.
-							if (xWeights[x].weight == 255) {
-								// As above, but to prevent out of bounds
-								// on the right edge.
-								*(uint32*)d = *(uint32*)s;
-							} else {
-								// Only the left and right pixels are
-								// interpolated, since the top row has 100%
-								// weight.
-								const uint16 wLeft = xWeights[x].weight;
-								const uint16 wRight = 255 - wLeft;
-								d[0] = (s[0] * wLeft + s[4] * wRight) >> 8;
-								d[1] = (s[1] * wLeft + s[5] * wRight) >> 8;
-								d[2] = (s[2] * wLeft + s[6] * wRight) >> 8;
-							}
-							d += 4;
-						}
-					} else {
-						for (int32 x = xIndexL; x <= xIndexR; x++) {
-							const uint8* s = src + xWeights[x].index;
-							if (xWeights[x].weight == 255) {
-								// Prevent out of bounds access on the right
-								// edge or simply speed up.
-								const uint8* sBottom = s + srcBPR;
-								d[0] = (s[0] * wTop + sBottom[0] * wBottom)
-									>> 8;
-								d[1] = (s[1] * wTop + sBottom[1] * wBottom)
-									>> 8;
-								d[2] = (s[2] * wTop + sBottom[2] * wBottom)
-									>> 8;
-							} else {
-								// calculate the weighted sum of all four
-								// interpolated pixels
-								const uint16 wLeft = xWeights[x].weight;
-								const uint16 wRight = 255 - wLeft;
-								// left and right of top row
-								uint32 t0 = (s[0] * wLeft + s[4] * wRight)
-									* wTop;
-								uint32 t1 = (s[1] * wLeft + s[5] * wRight)
-									* wTop;
-								uint32 t2 = (s[2] * wLeft + s[6] * wRight)
-									* wTop;
-
-								// left and right of bottom row
-								s += srcBPR;
-								t0 += (s[0] * wLeft + s[4] * wRight) * wBottom;
-								t1 += (s[1] * wLeft + s[5] * wRight) * wBottom;
-								t2 += (s[2] * wLeft + s[6] * wRight) * wBottom;
-
-								d[0] = t0 >> 16;
-								d[1] = t1 >> 16;
-								d[2] = t2 >> 16;
-							}
-							d += 4;
-						}
-					}
-					dst += dstBPR;
-				}
-				break;
-			}
-
-			case kUseDefaultVersion:
-			{
-				// In this mode we anticipate many pixels wich need filtering,
-				// there are no special cases for direct hit pixels except for
-				// the last column/row and the right/bottom corner pixel.
-
-				// The last column/row handling does not need to be performed
-				// for all clipping rects!
-				int32 yMax = y2;
-				if (yWeights[yMax].weight == 255)
-					yMax--;
-				int32 xIndexMax = xIndexR;
-				if (xWeights[xIndexMax].weight == 255)
-					xIndexMax--;
-
-				for (; y1 <= yMax; y1++) {
-					// cache the weight of the top and bottom row
-					const uint16 wTop = yWeights[y1].weight;
-					const uint16 wBottom = 255 - yWeights[y1].weight;
-
-					// buffer offset into source (top row)
-					register const uint8* src
-						= srcBuffer.row_ptr(yWeights[y1].index);
-					// buffer handle for destination to be incremented per
-					// pixel
-					register uint8* d = dst;
-
-					for (int32 x = xIndexL; x <= xIndexMax; x++) {
-						const uint8* s = src + xWeights[x].index;
-						// calculate the weighted sum of all four
-						// interpolated pixels
-						const uint16 wLeft = xWeights[x].weight;
-						const uint16 wRight = 255 - wLeft;
-						// left and right of top row
-						uint32 t0 = (s[0] * wLeft + s[4] * wRight) * wTop;
-						uint32 t1 = (s[1] * wLeft + s[5] * wRight) * wTop;
-						uint32 t2 = (s[2] * wLeft + s[6] * wRight) * wTop;
-
-						// left and right of bottom row
-						s += srcBPR;
-						t0 += (s[0] * wLeft + s[4] * wRight) * wBottom;
-						t1 += (s[1] * wLeft + s[5] * wRight) * wBottom;
-						t2 += (s[2] * wLeft + s[6] * wRight) * wBottom;
-						d[0] = t0 >> 16;
-						d[1] = t1 >> 16;
-						d[2] = t2 >> 16;
-						d += 4;
-					}
-					// last column of pixels if necessary
-					if (xIndexMax < xIndexR) {
-						const uint8* s = src + xWeights[xIndexR].index;
-						const uint8* sBottom = s + srcBPR;
-						d[0] = (s[0] * wTop + sBottom[0] * wBottom) >> 8;
-						d[1] = (s[1] * wTop + sBottom[1] * wBottom) >> 8;
-						d[2] = (s[2] * wTop + sBottom[2] * wBottom) >> 8;
-					}
-
-					dst += dstBPR;
-				}
-
-				// last row of pixels if necessary
-				// buffer offset into source (bottom row)
-				register const uint8* src
-					= srcBuffer.row_ptr(yWeights[y2].index);
-				// buffer handle for destination to be incremented per pixel
-				register uint8* d = dst;
-
-				if (yMax < y2) {
-					for (int32 x = xIndexL; x <= xIndexMax; x++) {
-						const uint8* s = src + xWeights[x].index;
-						const uint16 wLeft = xWeights[x].weight;
-						const uint16 wRight = 255 - wLeft;
-						d[0] = (s[0] * wLeft + s[4] * wRight) >> 8;
-						d[1] = (s[1] * wLeft + s[5] * wRight) >> 8;
-						d[2] = (s[2] * wLeft + s[6] * wRight) >> 8;
-						d += 4;
-					}
-				}
-
-				// pixel in bottom right corner if necessary
-				if (yMax < y2 && xIndexMax < xIndexR) {
-					const uint8* s = src + xWeights[xIndexR].index;
-					*(uint32*)d = *(uint32*)s;
-				}
-				break;
-			}
-
-#ifdef __INTEL__
-			case kUseSIMDVersion:
-			{
-				// Basically the same as the "standard" mode, but we use SIMD
-				// routines for the processing of the single display lines.
-
-				// The last column/row handling does not need to be performed
-				// for all clipping rects!
-				int32 yMax = y2;
-				if (yWeights[yMax].weight == 255)
-					yMax--;
-				int32 xIndexMax = xIndexR;
-				if (xWeights[xIndexMax].weight == 255)
-					xIndexMax--;
-
-				for (; y1 <= yMax; y1++) {
-					// cache the weight of the top and bottom row
-					const uint16 wTop = yWeights[y1].weight;
-					const uint16 wBottom = 255 - yWeights[y1].weight;
-
-					// buffer offset into source (top row)
-					const uint8* src = srcBuffer.row_ptr(yWeights[y1].index);
-					// buffer handle for destination to be incremented per
-					// pixel
-					uint8* d = dst;
-					bilinear_scale_xloop_mmxsse(src, dst, xWeights,	xIndexL,
-						xIndexMax, wTop, srcBPR);
-					// increase pointer by processed pixels
-					d += (xIndexMax - xIndexL + 1) * 4;
-
-					// last column of pixels if necessary
-					if (xIndexMax < xIndexR) {
-						const uint8* s = src + xWeights[xIndexR].index;
-						const uint8* sBottom = s + srcBPR;
-						d[0] = (s[0] * wTop + sBottom[0] * wBottom) >> 8;
-						d[1] = (s[1] * wTop + sBottom[1] * wBottom) >> 8;
-						d[2] = (s[2] * wTop + sBottom[2] * wBottom) >> 8;
-					}
-
-					dst += dstBPR;
-				}
-
-				// last row of pixels if necessary
-				// buffer offset into source (bottom row)
-				register const uint8* src
-					= srcBuffer.row_ptr(yWeights[y2].index);
-				// buffer handle for destination to be incremented per pixel
-				register uint8* d = dst;
-
-				if (yMax < y2) {
-					for (int32 x = xIndexL; x <= xIndexMax; x++) {
-						const uint8* s = src + xWeights[x].index;
-						const uint16 wLeft = xWeights[x].weight;
-						const uint16 wRight = 255 - wLeft;
-						d[0] = (s[0] * wLeft + s[4] * wRight) >> 8;
-						d[1] = (s[1] * wLeft + s[5] * wRight) >> 8;
-						d[2] = (s[2] * wLeft + s[6] * wRight) >> 8;
-						d += 4;
-					}
-				}
-
-				// pixel in bottom right corner if necessary
-				if (yMax < y2 && xIndexMax < xIndexR) {
-					const uint8* s = src + xWeights[xIndexR].index;
-					*(uint32*)d = *(uint32*)s;
-				}
-				break;
-			}
-#endif	// __INTEL__
-		}
-	} while (fBaseRenderer.next_clip_box());
+	clipping_rect rect;
+	rect.left = (int32)viewRect.left;
+	rect.top = (int32)viewRect.top;
+	rect.right = (int32)viewRect.right;
+	rect.bottom = (int32)viewRect.bottom;
+
+	bilinear_copy_info info;
+	info.source = &srcBuffer;
+	info.destination = &fBuffer;
+	info.xWeights = xWeights;
+	info.yWeights = yWeights;
+	info.left = rect.left;
+	info.top = rect.top;
+	info.filterWeightXIndexOffset = filterWeightXIndexOffset;
+	info.filterWeightYIndexOffset = filterWeightYIndexOffset;
+	info.lastXIndex = rect.right - rect.left - filterWeightXIndexOffset;
+	info.lastYIndex = rect.bottom - rect.top - filterWeightYIndexOffset;
+	info.codeSelect = codeSelect;
+
+	_RenderTiles(&rect, 1, &bilinear_copy_tile, &info);
 
 #ifdef FILTER_INFOS_ON_HEAP
 	delete[] xWeights;
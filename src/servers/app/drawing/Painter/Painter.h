@@ -1,5 +1,6 @@
 /*
  * Copyright 2005-2007, Stephan Aßmus <superstippi@gmx.de>.
+ * Copyright 2010, Haiku, Inc.
  * Copyright 2008, Andrej Spielmann <andrej.spielmann@seh.ox.ac.uk>.
  * All rights reserved. Distributed under the terms of the MIT License.
  *
@@ -13,6 +14,7 @@
 
 #include "AGGTextRenderer.h"
 #include "FontManager.h"
+#include "PainterThreadPool.h"
 #include "PatternHandler.h"
 #include "ServerFont.h"
 
@@ -27,8 +29,7 @@
 
 // Prototypes for assembler routines
 extern "C" {
-	void bilinear_scale_xloop_mmxsse(const uint8* src, void* dst, void* xWeights,
-		uint32 xmin, uint32 xmax, uint32 wTop, uint32 srcBPR );
+	void blend_row_alpha_sse2(uint8* dst, const uint8* src, uint32 count);
 }
 
 extern uint32 gAppServerSIMDFlags;
@@ -59,6 +60,10 @@ public:
 			void				DetachFromBuffer();
 			BRect				Bounds() const;
 
+			void				SetThreadPool(PainterThreadPool* pool);
+			PainterThreadPool*	ThreadPool() const
+									{ return fThreadPool; }
+
 			void				ConstrainClipping(const BRegion* region);
 			const BRegion*		ClippingRegion() const
 									{ return fClippingRegion; }
@@ -295,6 +300,16 @@ private:
 			void				_BlendRect32(const BRect& r,
 									const rgb_color& c) const;
 
+			void				_FillRects(const clipping_rect* rects,
+									int32 count, const rgb_color& c) const;
+			void				_RenderTiles(const clipping_rect* rects,
+									int32 count, tile_render_function function,
+									void* cookie) const;
+			void				_RenderTileBatch(const clipping_rect* tiles,
+									int32 count, int64 pixelCount,
+									tile_render_function function,
+									void* cookie) const;
+
 
 			template<class VertexSource>
 			BRect				_BoundingBox(VertexSource& path) const;
@@ -367,6 +382,8 @@ private:
 			join_mode			fLineJoinMode;
 			float				fMiterLimit;
 
+			PainterThreadPool*	fThreadPool;
+
 			PatternHandler		fPatternHandler;
 
 	// a class handling rendering and caching of glyphs
@@ -0,0 +1,156 @@
+/*
+ * Copyright 2010, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+/*!	A pool of worker threads the Painter can use to render independent
+	tiles of a large drawing operation in parallel.
+
+	The tiles passed to RenderTiles() must not overlap, and each tile must
+	be rendered the same way no matter which thread picks it up. That way,
+	the result is the same for any number of threads, and also when the pool
+	is not used at all.
+*/
+
+
+#include "PainterThreadPool.h"
+
+#include <new>
+
+#include <stdio.h>
+
+
+using std::nothrow;
+
+
+PainterThreadPool::PainterThreadPool(int32 threadCount)
+	:
+	fLock("painter thread pool"),
+	fThreads(NULL),
+	fThreadCount(0),
+	fWorkSemaphore(-1),
+	fDoneSemaphore(-1),
+	fQuitting(false),
+	fFunction(NULL),
+	fCookie(NULL),
+	fTiles(NULL),
+	fTileCount(0),
+	fNextTile(0)
+{
+	fWorkSemaphore = create_sem(0, "painter work");
+	fDoneSemaphore = create_sem(0, "painter done");
+	if (fWorkSemaphore < B_OK || fDoneSemaphore < B_OK)
+		return;
+
+	fThreads = new (nothrow) thread_id[threadCount];
+	if (fThreads == NULL)
+		return;
+
+	for (int32 i = 0; i < threadCount; i++) {
+		char name[B_OS_NAME_LENGTH];
+		snprintf(name, sizeof(name), "painter worker %ld", i);
+
+		thread_id thread = spawn_thread(&_WorkerThread, name,
+			B_DISPLAY_PRIORITY, this);
+		if (thread < B_OK)
+			break;
+
+		fThreads[fThreadCount++] = thread;
+		resume_thread(thread);
+	}
+}
+
+
+PainterThreadPool::~PainterThreadPool()
+{
+	fQuitting = true;
+
+	// deleting the semaphore lets all workers return from acquire_sem()
+	delete_sem(fWorkSemaphore);
+
+	for (int32 i = 0; i < fThreadCount; i++) {
+		status_t result;
+		wait_for_thread(fThreads[i], &result);
+	}
+
+	delete_sem(fDoneSemaphore);
+	delete[] fThreads;
+}
+
+
+status_t
+PainterThreadPool::InitCheck() const
+{
+	if (fWorkSemaphore < B_OK)
+		return fWorkSemaphore;
+	if (fDoneSemaphore < B_OK)
+		return fDoneSemaphore;
+	if (fThreadCount == 0)
+		return B_NO_MEMORY;
+
+	return B_OK;
+}
+
+
+/*!	Calls \a function for each of the \a count \a tiles, and returns when
+	all of them have been rendered. The calling thread renders tiles as well.
+
+	The pool only serves one drawing operation at a time; if it is already
+	busy, the method returns \c false without doing anything, and the caller
+	is expected to render the tiles itself.
+*/
+bool
+PainterThreadPool::RenderTiles(tile_render_function function, void* cookie,
+	const clipping_rect* tiles, int32 count)
+{
+	if (fLock.LockWithTimeout(0) != B_OK)
+		return false;
+
+	fFunction = function;
+	fCookie = cookie;
+	fTiles = tiles;
+	fTileCount = count;
+	fNextTile = 0;
+
+	int32 workers = min_c(fThreadCount, count - 1);
+	if (workers > 0)
+		release_sem_etc(fWorkSemaphore, workers, B_DO_NOT_RESCHEDULE);
+
+	_RenderTiles();
+
+	if (workers > 0)
+		acquire_sem_etc(fDoneSemaphore, workers, 0, 0);
+
+	fLock.Unlock();
+	return true;
+}
+
+
+/*static*/ status_t
+PainterThreadPool::_WorkerThread(void* data)
+{
+	PainterThreadPool* pool = (PainterThreadPool*)data;
+
+	while (acquire_sem(pool->fWorkSemaphore) == B_OK) {
+		if (pool->fQuitting)
+			break;
+
+		pool->_RenderTiles();
+		release_sem(pool->fDoneSemaphore);
+	}
+
+	return B_OK;
+}
+
+
+void
+PainterThreadPool::_RenderTiles()
+{
+	while (true) {
+		int32 index = atomic_add(&fNextTile, 1);
+		if (index >= fTileCount)
+			break;
+
+		fFunction(fCookie, fTiles[index]);
+	}
+}
@@ -0,0 +1,52 @@
+/*
+ * Copyright 2010, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef PAINTER_THREAD_POOL_H
+#define PAINTER_THREAD_POOL_H
+
+
+#include <Locker.h>
+#include <OS.h>
+
+#include "PainterTiles.h"
+
+
+class PainterThreadPool {
+public:
+								PainterThreadPool(int32 threadCount);
+								~PainterThreadPool();
+
+			status_t			InitCheck() const;
+
+			int32				CountThreads() const
+									{ return fThreadCount; }
+
+			bool				RenderTiles(tile_render_function function,
+									void* cookie, const clipping_rect* tiles,
+									int32 count);
+
+private:
+	static	status_t			_WorkerThread(void* data);
+			void				_RenderTiles();
+
+			BLocker				fLock;
+			thread_id*			fThreads;
+			int32				fThreadCount;
+			sem_id				fWorkSemaphore;
+			sem_id				fDoneSemaphore;
+	volatile bool				fQuitting;
+
+			tile_render_function fFunction;
+			void*				fCookie;
+			const clipping_rect* fTiles;
+			int32				fTileCount;
+			vint32				fNextTile;
+};
+
+
+// created by the AppServer on multi processor machines, may be NULL
+extern PainterThreadPool* gPainterThreadPool;
+
+
+#endif	// PAINTER_THREAD_POOL_H
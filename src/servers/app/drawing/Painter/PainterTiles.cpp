@@ -0,0 +1,317 @@
+/*
+ * Copyright 2009, Christian Packmann.
+ * Copyright 2010, Haiku, Inc.
+ * Copyright 2005-2009, Stephan Aßmus <superstippi@gmx.de>.
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+
+#include "PainterTiles.h"
+
+#include "drawing_support.h"
+
+
+void
+solid_fill_tile(void* cookie, const clipping_rect& tile)
+{
+	const solid_fill_info& info = *(const solid_fill_info*)cookie;
+	uint8* dst = info.bits + tile.top * info.bytesPerRow + tile.left * 4;
+	int32 bytes = (tile.right - tile.left + 1) * 4;
+
+	for (int32 y = tile.top; y <= tile.bottom; y++) {
+		gfxset32(dst, info.color, bytes);
+		dst += info.bytesPerRow;
+	}
+}
+
+
+void
+vertical_gradient_fill_tile(void* cookie, const clipping_rect& tile)
+{
+	const gradient_fill_info& info = *(const gradient_fill_info*)cookie;
+	uint8* dst = info.bits + tile.top * info.bytesPerRow + tile.left * 4;
+	int32 bytes = (tile.right - tile.left + 1) * 4;
+
+	for (int32 y = tile.top; y <= tile.bottom; y++) {
+		gfxset32(dst, info.colors[y - info.top], bytes);
+		dst += info.bytesPerRow;
+	}
+}
+
+
+/*!	Renders one tile of a bilinear scaled bitmap, see
+	Painter::_DrawBitmapBilinearCopy32().
+*/
+void
+bilinear_copy_tile(void* cookie, const clipping_rect& tile)
+{
+	const bilinear_copy_info& info = *(const bilinear_copy_info*)cookie;
+	agg::rendering_buffer& srcBuffer = *info.source;
+	const FilterInfo* xWeights = info.xWeights;
+	const FilterInfo* yWeights = info.yWeights;
+
+	const uint32 dstBPR = info.destination->stride();
+	const uint32 srcBPR = srcBuffer.stride();
+
+	// buffer offset into destination
+	uint8* dst = info.destination->row_ptr(tile.top) + tile.left * 4;
+
+	// x and y are needed as indeces into the wheight arrays, so the
+	// offset into the target buffer needs to be compensated
+	const int32 xIndexL = tile.left - info.left - info.filterWeightXIndexOffset;
+	const int32 xIndexR = tile.right - info.left - info.filterWeightXIndexOffset;
+	int32 y1 = tile.top - info.top - info.filterWeightYIndexOffset;
+	int32 y2 = tile.bottom - info.top - info.filterWeightYIndexOffset;
+
+	switch (info.codeSelect) {
+		case kOptimizeForLowFilterRatio:
+		{
+			// In this mode, we anticipate to hit many destination pixels
+			// that map directly to a source pixel, we have more branches
+			// in the inner loop but save time because of the special
+			// cases. If there are too few direct hit pixels, the branches
+			// only waste time.
+			for (; y1 <= y2; y1++) {
+				// cache the weight of the top and bottom row
+				const uint16 wTop = yWeights[y1].weight;
+				const uint16 wBottom = 255 - yWeights[y1].weight;
+
+				// buffer offset into source (top row)
+				register const uint8* src
+					= srcBuffer.row_ptr(yWeights[y1].index);
+				// buffer handle for destination to be incremented per
+				// pixel
+				register uint8* d = dst;
+
+				if (wTop == 255) {
+					for (int32 x = xIndexL; x <= xIndexR; x++) {
+						const uint8* s = src + xWeights[x].index;
+						// This case is important to prevent out
+						// of bounds access at bottom edge of the source
+						// bitmap. If the scale is low and integer, it will
+						// also help the speed.
+						if (xWeights[x].weight == 255) {
+							// As above, but to prevent out of bounds
+							// on the right edge.
+							*(uint32*)d = *(uint32*)s;
+						} else {
+							// Only the left and right pixels are
+							// interpolated, since the top row has 100%
+							// weight.
+							const uint16 wLeft = xWeights[x].weight;
+							const uint16 wRight = 255 - wLeft;
+							d[0] = (s[0] * wLeft + s[4] * wRight) >> 8;
+							d[1] = (s[1] * wLeft + s[5] * wRight) >> 8;
+							d[2] = (s[2] * wLeft + s[6] * wRight) >> 8;
+						}
+						d += 4;
+					}
+				} else {
+					for (int32 x = xIndexL; x <= xIndexR; x++) {
+						const uint8* s = src + xWeights[x].index;
+						if (xWeights[x].weight == 255) {
+							// Prevent out of bounds access on the right
+							// edge or simply speed up.
+							const uint8* sBottom = s + srcBPR;
+							d[0] = (s[0] * wTop + sBottom[0] * wBottom)
+								>> 8;
+							d[1] = (s[1] * wTop + sBottom[1] * wBottom)
+								>> 8;
+							d[2] = (s[2] * wTop + sBottom[2] * wBottom)
+								>> 8;
+						} else {
+							// calculate the weighted sum of all four
+							// interpolated pixels
+							const uint16 wLeft = xWeights[x].weight;
+							const uint16 wRight = 255 - wLeft;
+							// left and right of top row
+							uint32 t0 = (s[0] * wLeft + s[4] * wRight)
+								* wTop;
+							uint32 t1 = (s[1] * wLeft + s[5] * wRight)
+								* wTop;
+							uint32 t2 = (s[2] * wLeft + s[6] * wRight)
+								* wTop;
+
+							// left and right of bottom row
+							s += srcBPR;
+							t0 += (s[0] * wLeft + s[4] * wRight) * wBottom;
+							t1 += (s[1] * wLeft + s[5] * wRight) * wBottom;
+							t2 += (s[2] * wLeft + s[6] * wRight) * wBottom;
+
+							d[0] = t0 >> 16;
+							d[1] = t1 >> 16;
+							d[2] = t2 >> 16;
+						}
+						d += 4;
+					}
+				}
+				dst += dstBPR;
+			}
+			break;
+		}
+
+		case kUseDefaultVersion:
+		{
+			// In this mode we anticipate many pixels wich need filtering,
+			// there are no special cases for direct hit pixels except for
+			// the last column/row and the right/bottom corner pixel.
+
+			// The last column/row of the bitmap needs special handling to
+			// prevent out of bounds access. Other columns and rows go
+			// through the normal path, even if their weight is 255, so that
+			// the result does not depend on how the bitmap is clipped or
+			// split into tiles.
+			int32 yMax = y2;
+			if (y2 == info.lastYIndex && yWeights[yMax].weight == 255)
+				yMax--;
+			int32 xIndexMax = xIndexR;
+			if (xIndexR == info.lastXIndex && xWeights[xIndexMax].weight == 255)
+				xIndexMax--;
+
+			for (; y1 <= yMax; y1++) {
+				// cache the weight of the top and bottom row
+				const uint16 wTop = yWeights[y1].weight;
+				const uint16 wBottom = 255 - yWeights[y1].weight;
+
+				// buffer offset into source (top row)
+				register const uint8* src
+					= srcBuffer.row_ptr(yWeights[y1].index);
+				// buffer handle for destination to be incremented per
+				// pixel
+				register uint8* d = dst;
+
+				for (int32 x = xIndexL; x <= xIndexMax; x++) {
+					const uint8* s = src + xWeights[x].index;
+					// calculate the weighted sum of all four
+					// interpolated pixels
+					const uint16 wLeft = xWeights[x].weight;
+					const uint16 wRight = 255 - wLeft;
+					// left and right of top row
+					uint32 t0 = (s[0] * wLeft + s[4] * wRight) * wTop;
+					uint32 t1 = (s[1] * wLeft + s[5] * wRight) * wTop;
+					uint32 t2 = (s[2] * wLeft + s[6] * wRight) * wTop;
+
+					// left and right of bottom row
+					s += srcBPR;
+					t0 += (s[0] * wLeft + s[4] * wRight) * wBottom;
+					t1 += (s[1] * wLeft + s[5] * wRight) * wBottom;
+					t2 += (s[2] * wLeft + s[6] * wRight) * wBottom;
+					d[0] = t0 >> 16;
+					d[1] = t1 >> 16;
+					d[2] = t2 >> 16;
+					d += 4;
+				}
+				// last column of pixels if necessary
+				if (xIndexMax < xIndexR) {
+					const uint8* s = src + xWeights[xIndexR].index;
+					const uint8* sBottom = s + srcBPR;
+					d[0] = (s[0] * wTop + sBottom[0] * wBottom) >> 8;
+					d[1] = (s[1] * wTop + sBottom[1] * wBottom) >> 8;
+					d[2] = (s[2] * wTop + sBottom[2] * wBottom) >> 8;
+				}
+
+				dst += dstBPR;
+			}
+
+			// last row of pixels if necessary
+			// buffer offset into source (bottom row)
+			register const uint8* src
+				= srcBuffer.row_ptr(yWeights[y2].index);
+			// buffer handle for destination to be incremented per pixel
+			register uint8* d = dst;
+
+			if (yMax < y2) {
+				for (int32 x = xIndexL; x <= xIndexMax; x++) {
+					const uint8* s = src + xWeights[x].index;
+					const uint16 wLeft = xWeights[x].weight;
+					const uint16 wRight = 255 - wLeft;
+					d[0] = (s[0] * wLeft + s[4] * wRight) >> 8;
+					d[1] = (s[1] * wLeft + s[5] * wRight) >> 8;
+					d[2] = (s[2] * wLeft + s[6] * wRight) >> 8;
+					d += 4;
+				}
+			}
+
+			// pixel in bottom right corner if necessary
+			if (yMax < y2 && xIndexMax < xIndexR) {
+				const uint8* s = src + xWeights[xIndexR].index;
+				*(uint32*)d = *(uint32*)s;
+			}
+			break;
+		}
+
+#ifdef __INTEL__
+		case kUseSIMDVersion:
+		{
+			// Basically the same as the "standard" mode, but we use SIMD
+			// routines for the processing of the single display lines.
+
+			// The last column/row of the bitmap needs special handling to
+			// prevent out of bounds access. Other columns and rows go
+			// through the normal path, even if their weight is 255, so that
+			// the result does not depend on how the bitmap is clipped or
+			// split into tiles.
+			int32 yMax = y2;
+			if (y2 == info.lastYIndex && yWeights[yMax].weight == 255)
+				yMax--;
+			int32 xIndexMax = xIndexR;
+			if (xIndexR == info.lastXIndex && xWeights[xIndexMax].weight == 255)
+				xIndexMax--;
+
+			for (; y1 <= yMax; y1++) {
+				// cache the weight of the top and bottom row
+				const uint16 wTop = yWeights[y1].weight;
+				const uint16 wBottom = 255 - yWeights[y1].weight;
+
+				// buffer offset into source (top row)
+				const uint8* src = srcBuffer.row_ptr(yWeights[y1].index);
+				// buffer handle for destination to be incremented per
+				// pixel
+				uint8* d = dst;
+				bilinear_scale_xloop_mmxsse(src, dst, (void*)xWeights,
+					xIndexL,
+					xIndexMax, wTop, srcBPR);
+				// increase pointer by processed pixels
+				d += (xIndexMax - xIndexL + 1) * 4;
+
+				// last column of pixels if necessary
+				if (xIndexMax < xIndexR) {
+					const uint8* s = src + xWeights[xIndexR].index;
+					const uint8* sBottom = s + srcBPR;
+					d[0] = (s[0] * wTop + sBottom[0] * wBottom) >> 8;
+					d[1] = (s[1] * wTop + sBottom[1] * wBottom) >> 8;
+					d[2] = (s[2] * wTop + sBottom[2] * wBottom) >> 8;
+				}
+
+				dst += dstBPR;
+			}
+
+			// last row of pixels if necessary
+			// buffer offset into source (bottom row)
+			register const uint8* src
+				= srcBuffer.row_ptr(yWeights[y2].index);
+			// buffer handle for destination to be incremented per pixel
+			register uint8* d = dst;
+
+			if (yMax < y2) {
+				for (int32 x = xIndexL; x <= xIndexMax; x++) {
+					const uint8* s = src + xWeights[x].index;
+					const uint16 wLeft = xWeights[x].weight;
+					const uint16 wRight = 255 - wLeft;
+					d[0] = (s[0] * wLeft + s[4] * wRight) >> 8;
+					d[1] = (s[1] * wLeft + s[5] * wRight) >> 8;
+					d[2] = (s[2] * wLeft + s[6] * wRight) >> 8;
+					d += 4;
+				}
+			}
+
+			// pixel in bottom right corner if necessary
+			if (yMax < y2 && xIndexMax < xIndexR) {
+				const uint8* s = src + xWeights[xIndexR].index;
+				*(uint32*)d = *(uint32*)s;
+			}
+			break;
+		}
+#endif	// __INTEL__
+	}
+}
@@ -0,0 +1,85 @@
+/*
+ * Copyright 2010, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef PAINTER_TILES_H
+#define PAINTER_TILES_H
+
+
+#include <Region.h>
+#include <SupportDefs.h>
+
+#include <agg_rendering_buffer.h>
+
+
+/*!	The tile renderers of the Painter. Each of them renders the part of an
+	operation that lies within a single tile, and only depends on the
+	absolute position of the pixels, never on the position of the tile. The
+	result is therefore the same no matter how an operation is split into
+	tiles.
+
+	They don't depend on any other app_server classes, so that they can also
+	be tested on the build platform.
+*/
+
+
+typedef void (*tile_render_function)(void* cookie, const clipping_rect& tile);
+
+
+// Prototypes for assembler routines
+extern "C" {
+	void bilinear_scale_xloop_mmxsse(const uint8* src, void* dst, void* xWeights,
+		uint32 xmin, uint32 xmax, uint32 wTop, uint32 srcBPR );
+}
+
+
+struct solid_fill_info {
+	uint8*	bits;
+	uint32	bytesPerRow;
+	uint32	color;
+};
+
+
+struct gradient_fill_info {
+	uint8*			bits;
+	uint32			bytesPerRow;
+	const uint32*	colors;
+	int32			top;
+};
+
+
+struct FilterInfo {
+	uint16 index;	// index into source bitmap row/column
+	uint16 weight;	// weight of the pixel at index [0..255]
+};
+
+// which version of the scaling code to use
+enum {
+	kOptimizeForLowFilterRatio = 0,
+	kUseDefaultVersion,
+	kUseSIMDVersion
+};
+
+struct bilinear_copy_info {
+	agg::rendering_buffer*	source;
+	agg::rendering_buffer*	destination;
+	const FilterInfo*		xWeights;
+	const FilterInfo*		yWeights;
+	int32					left;
+	int32					top;
+	uint32					filterWeightXIndexOffset;
+	uint32					filterWeightYIndexOffset;
+	int32					lastXIndex;
+		// the weight indices of the last column and row of the scaled
+		// bitmap, which may map to the last source column or row
+	int32					lastYIndex;
+	int						codeSelect;
+};
+
+
+void solid_fill_tile(void* cookie, const clipping_rect& tile);
+void vertical_gradient_fill_tile(void* cookie, const clipping_rect& tile);
+void bilinear_copy_tile(void* cookie, const clipping_rect& tile);
+
+
+#endif	// PAINTER_TILES_H
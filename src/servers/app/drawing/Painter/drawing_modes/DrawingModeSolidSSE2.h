@@ -0,0 +1,82 @@
+/*
+ * Copyright 2010, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ *
+ * SSE2 versions of the B_OP_COPY and B_OP_OVER solid span blenders on
+ * B_RGBA32, see painter_blend_sse2.nasm. They produce exactly the same
+ * results as the scalar versions.
+ *
+ */
+
+#ifndef DRAWING_MODE_SOLID_SSE2_H
+#define DRAWING_MODE_SOLID_SSE2_H
+
+#include "DrawingModeOver.h"
+
+// Prototypes for assembler routines
+extern "C" {
+	void blend_solid_hspan_sse2(uint8* dst, uint32 color, const uint8* covers,
+		uint32 count);
+}
+
+// blend_solid_hspan_solid_sse2
+static inline void
+blend_solid_hspan_solid_sse2(int x, int y, unsigned len,
+							 const color_type& c, const uint8* covers,
+							 agg_buffer* buffer)
+{
+	uint8* p = buffer->row_ptr(y) + (x << 2);
+
+	// the assembler routine only handles multiples of four pixels
+	unsigned count = len & ~3;
+	if (count > 0) {
+		pixel32 color;
+		color.data8[0] = c.b;
+		color.data8[1] = c.g;
+		color.data8[2] = c.r;
+		color.data8[3] = 255;
+
+		blend_solid_hspan_sse2(p, color.data32, covers, count);
+
+		p += count << 2;
+		covers += count;
+		len -= count;
+	}
+
+	while (len--) {
+		if (*covers) {
+			if (*covers == 255) {
+				ASSIGN_OVER(p, c.r, c.g, c.b);
+			} else {
+				BLEND_OVER(p, c.r, c.g, c.b, *covers);
+			}
+		}
+		covers++;
+		p += 4;
+	}
+}
+
+// blend_solid_hspan_over_solid_sse2
+void
+blend_solid_hspan_over_solid_sse2(int x, int y, unsigned len,
+								  const color_type& c, const uint8* covers,
+								  agg_buffer* buffer,
+								  const PatternHandler* pattern)
+{
+	if (pattern->IsSolidLow())
+		return;
+
+	blend_solid_hspan_solid_sse2(x, y, len, c, covers, buffer);
+}
+
+// blend_solid_hspan_copy_solid_sse2
+void
+blend_solid_hspan_copy_solid_sse2(int x, int y, unsigned len,
+								  const color_type& c, const uint8* covers,
+								  agg_buffer* buffer,
+								  const PatternHandler* pattern)
+{
+	blend_solid_hspan_solid_sse2(x, y, len, c, covers, buffer);
+}
+
+#endif // DRAWING_MODE_SOLID_SSE2_H
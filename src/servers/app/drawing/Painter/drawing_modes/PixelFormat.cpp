@@ -55,6 +55,11 @@
 #include "DrawingModeSelectSUBPIX.h"
 #include "DrawingModeSubtractSUBPIX.h"
 
+#ifdef __INTEL__
+#	include "DrawingModeSolidSSE2.h"
+#endif
+
+#include "AppServer.h"
 #include "PatternHandler.h"
 
 // blend_pixel_empty
@@ -172,6 +177,10 @@ PixelFormat::SetDrawingMode(drawing_mode mode, source_alpha alphaSrcMode,
 				fBlendSolidHSpan = blend_solid_hspan_over_solid;
 				fBlendSolidVSpan = blend_solid_vspan_over_solid;
 				fBlendSolidHSpanSubpix = blend_solid_hspan_over_solid_subpix;
+#ifdef __INTEL__
+				if ((gAppServerSIMDFlags & APPSERVER_SIMD_SSE2) != 0)
+					fBlendSolidHSpan = blend_solid_hspan_over_solid_sse2;
+#endif
 			} else {
 				fBlendPixel = blend_pixel_over;
 				fBlendHLine = blend_hline_over;
@@ -227,6 +236,10 @@ PixelFormat::SetDrawingMode(drawing_mode mode, source_alpha alphaSrcMode,
 				fBlendSolidHSpan = blend_solid_hspan_copy_solid;
 				fBlendSolidVSpan = blend_solid_vspan_copy_solid;
 				fBlendColorHSpan = blend_color_hspan_copy_solid;
+#ifdef __INTEL__
+				if ((gAppServerSIMDFlags & APPSERVER_SIMD_SSE2) != 0)
+					fBlendSolidHSpan = blend_solid_hspan_copy_solid_sse2;
+#endif
 			} else {
 				fBlendPixel = blend_pixel_copy;
 				fBlendHLine = blend_hline_copy;
@@ -160,6 +160,9 @@ UpdateQueue::_ExecuteUpdates()
 						}
 						Unlock();
 					}
+					// software overlays need to be checked constantly, as
+					// the client may have changed their contents
+					fInterface->RefreshSoftwareOverlays();
 					fInterface->UnlockParallelAccess();
 				}
 				break;
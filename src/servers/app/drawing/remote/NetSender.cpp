@@ -1,5 +1,5 @@
 /*
- * Copyright 2009, Haiku, Inc.
+ * Copyright 2009-2010, Haiku, Inc.
  * Distributed under the terms of the MIT License.
  *
  * Authors:
@@ -20,12 +20,17 @@
 #define TRACE_ERROR(x...)	debug_printf("NetSender: "x)
 
 
+// everything that has been queued up to this size is sent at once
+static const size_t kMaxSendSize = 64 * 1024;
+
+
 NetSender::NetSender(BNetEndpoint *endpoint, StreamingRingBuffer *source)
 	:
 	fEndpoint(endpoint),
 	fSource(source),
 	fSenderThread(-1),
-	fStopThread(false)
+	fStopThread(false),
+	fBytesSent(0)
 {
 	fSenderThread = spawn_thread(_NetworkSenderEntry, "network sender",
 		B_NORMAL_PRIORITY, this);
@@ -51,25 +56,37 @@ NetSender::_NetworkSenderEntry(void *data)
 status_t
 NetSender::_NetworkSender()
 {
+	uint8* buffer = (uint8*)malloc(kMaxSendSize);
+	if (buffer == NULL) {
+		TRACE_ERROR("no memory for the send buffer\n");
+		return B_NO_MEMORY;
+	}
+
+	status_t result = B_OK;
 	while (!fStopThread) {
-		uint8 buffer[4096];
-		int32 readSize = fSource->Read(buffer, sizeof(buffer), true);
+		int32 readSize = fSource->Read(buffer, kMaxSendSize, true);
 		if (readSize < 0) {
 			TRACE_ERROR("read failed, stopping sender thread: %s\n",
 				strerror(readSize));
-			return readSize;
+			result = readSize;
+			break;
 		}
 
+		uint8* data = buffer;
 		while (readSize > 0) {
-			int32 sendSize = fEndpoint->Send(buffer, readSize);
+			int32 sendSize = fEndpoint->Send(data, readSize);
 			if (sendSize < 0) {
 				TRACE_ERROR("sending data failed: %s\n", strerror(sendSize));
+				free(buffer);
 				return sendSize;
 			}
 
+			data += sendSize;
 			readSize -= sendSize;
+			fBytesSent += sendSize;
 		}
 	}
 
-	return B_OK;
+	free(buffer);
+	return result;
 }
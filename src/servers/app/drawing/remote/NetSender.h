@@ -1,5 +1,5 @@
 /*
- * Copyright 2009, Haiku, Inc.
+ * Copyright 2009-2010, Haiku, Inc.
  * Distributed under the terms of the MIT License.
  *
  * Authors:
@@ -20,6 +20,8 @@ public:
 									StreamingRingBuffer *source);
 								~NetSender();
 
+		int64					BytesSent() const { return fBytesSent; }
+
 private:
 static	int32					_NetworkSenderEntry(void *data);
 		status_t				_NetworkSender();
@@ -29,6 +31,7 @@ static	int32					_NetworkSenderEntry(void *data);
 
 		thread_id				fSenderThread;
 		bool					fStopThread;
+		int64					fBytesSent;
 };
 
 #endif // NET_SENDER_H
@@ -0,0 +1,102 @@
+/*
+ * Copyright 2010, Haiku, Inc.
+ * Distributed under the terms of the MIT License.
+ */
+
+/*!	Keeps track of the bitmaps the remote side has cached.
+
+	The remote side stores the bitmaps of RP_DRAW_BITMAP messages in the
+	slot given in the message, which can later be drawn again with
+	RP_DRAW_CACHED_BITMAP. Bitmaps are identified by a hash of their
+	contents, the least recently used slot is replaced first.
+	Since the messages must reach the remote side in the same order the
+	slots were assigned, the cache must stay locked until the message
+	has been flushed.
+*/
+
+
+#include "RemoteBitmapCache.h"
+
+#include <string.h>
+
+
+static const uint64 kFNVOffsetBasis = 14695981039346656037ULL;
+static const uint64 kFNVPrime = 1099511628211ULL;
+
+
+RemoteBitmapCache::RemoteBitmapCache()
+	:
+	fLock("remote bitmap cache")
+{
+	MakeEmpty();
+}
+
+
+void
+RemoteBitmapCache::MakeEmpty()
+{
+	memset(fSlots, 0, sizeof(fSlots));
+	fUseCount = 0;
+}
+
+
+/*!	Returns the slot of the bitmap, or -1 if it should not be cached at
+	all. If the bitmap is already cached on the remote side, \a _cached is
+	set to \c true, otherwise the returned slot has been assigned to it, and
+	the bitmap must be sent along.
+*/
+int32
+RemoteBitmapCache::Lookup(const void* bits, uint32 length, int32 width,
+	int32 height, color_space colorSpace, bool& _cached)
+{
+	_cached = false;
+	if (length > kMaxBitmapLength)
+		return -1;
+
+	uint64 hash = _Hash(bits, length, width, height, colorSpace);
+
+	// unused slots have never been used, and are therefore replaced first
+	int32 replace = 0;
+	for (int32 i = 0; i < kSlotCount; i++) {
+		slot& entry = fSlots[i];
+		if (entry.used && entry.hash == hash) {
+			entry.lastUsed = ++fUseCount;
+			_cached = true;
+			return i;
+		}
+
+		if (entry.lastUsed < fSlots[replace].lastUsed)
+			replace = i;
+	}
+
+	slot& entry = fSlots[replace];
+	entry.hash = hash;
+	entry.lastUsed = ++fUseCount;
+	entry.used = true;
+	return replace;
+}
+
+
+/*static*/ uint64
+RemoteBitmapCache::_Hash(const void* bits, uint32 length, int32 width,
+	int32 height, color_space colorSpace)
+{
+	// FNV-1a over 32 bit words, and the remaining bytes
+	uint64 hash = kFNVOffsetBasis;
+	hash = (hash ^ (uint32)width) * kFNVPrime;
+	hash = (hash ^ (uint32)height) * kFNVPrime;
+	hash = (hash ^ (uint32)colorSpace) * kFNVPrime;
+
+	const uint8* data = (const uint8*)bits;
+	for (uint32 words = length / 4; words > 0; words--) {
+		uint32 word;
+		memcpy(&word, data, sizeof(word));
+		hash = (hash ^ word) * kFNVPrime;
+		data += 4;
+	}
+
+	for (uint32 i = 0; i < length % 4; i++)
+		hash = (hash ^ data[i]) * kFNVPrime;
+
+	return hash;
+}
@@ -0,0 +1,43 @@
+/*
+ * Copyright 2010, Haiku, Inc.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef REMOTE_BITMAP_CACHE_H
+#define REMOTE_BITMAP_CACHE_H
+
+#include <GraphicsDefs.h>
+#include <Locker.h>
+
+class RemoteBitmapCache {
+public:
+								RemoteBitmapCache();
+
+		bool					Lock() { return fLock.Lock(); }
+		void					Unlock() { fLock.Unlock(); }
+
+		void					MakeEmpty();
+
+		int32					Lookup(const void* bits, uint32 length,
+									int32 width, int32 height,
+									color_space colorSpace, bool& _cached);
+
+static	const int32				kSlotCount = 64;
+static	const uint32			kMaxBitmapLength = 128 * 1024;
+
+private:
+		struct slot {
+			uint64				hash;
+			uint32				lastUsed;
+			bool				used;
+		};
+
+static	uint64					_Hash(const void* bits, uint32 length,
+									int32 width, int32 height,
+									color_space colorSpace);
+
+		BLocker					fLock;
+		slot					fSlots[kSlotCount];
+		uint32					fUseCount;
+};
+
+#endif // REMOTE_BITMAP_CACHE_H
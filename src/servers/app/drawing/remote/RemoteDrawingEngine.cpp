@@ -1,5 +1,5 @@
 /*
- * Copyright 2009, Haiku, Inc.
+ * Copyright 2009-2010, Haiku, Inc.
  * Distributed under the terms of the MIT License.
  *
  * Authors:
@@ -11,9 +11,11 @@
 
 #include "DrawState.h"
 
+#include <AutoLocker.h>
 #include <Bitmap.h>
 #include <utf8_functions.h>
 
+#include <math.h>
 #include <new>
 
 
@@ -331,14 +333,27 @@ RemoteDrawingEngine::DrawBitmap(ServerBitmap* bitmap, const BRect& _bitmapRect,
 		}
 	}
 
-	// TODO: we may want to cache/checksum bitmaps
+	// the cache must stay locked until the message has been sent, so that
+	// the remote side sees the slots being assigned in the same order
+	RemoteBitmapCache& cache = fHWInterface->BitmapCache();
+	AutoLocker<RemoteBitmapCache> cacheLocker(cache);
+
+	bool cached;
+	int32 slot = cache.Lookup(bitmap->Bits(), bitmap->BitsLength(),
+		bitmap->Width(), bitmap->Height(), bitmap->ColorSpace(), cached);
+
 	RemoteMessage message(NULL, fHWInterface->SendBuffer());
-	message.Start(RP_DRAW_BITMAP);
+	message.Start(cached ? RP_DRAW_CACHED_BITMAP : RP_DRAW_BITMAP);
 	message.Add(fToken);
 	message.Add(bitmapRect);
 	message.Add(viewRect);
 	message.Add(options);
-	message.AddBitmap(*bitmap);
+	message.Add(slot);
+	if (!cached)
+		message.AddBitmap(*bitmap, true);
+	message.Flush();
+
+	cacheLocker.Unlock();
 
 	if (other != NULL)
 		delete other;
@@ -809,22 +824,10 @@ RemoteDrawingEngine::DrawString(const char* string, int32 length,
 	if (delta != NULL)
 		message.AddList(delta, length);
 
-	status_t result = _AddCallback();
-	if (message.Flush() != B_OK)
-		return point;
-
-	if (result != B_OK)
-		return point;
-
-	do {
-		result = acquire_sem_etc(fResultNotify, 1, B_RELATIVE_TIMEOUT,
-			1 * 1000 * 1000);
-	} while (result == B_INTERRUPTED);
-
-	if (result != B_OK)
-		return point;
-
-	return fDrawStringResult;
+	// compute the pen location ourselves instead of waiting for the
+	// remote side to report it, which would cost a round trip per string
+	return _PenLocation(point,
+		fState.Font().StringWidth(string, length, delta));
 }
 
 
@@ -838,24 +841,20 @@ RemoteDrawingEngine::DrawString(const char* string, int32 length,
 	message.Start(RP_DRAW_STRING_WITH_OFFSETS);
 	message.Add(fToken);
 	message.AddString(string, length);
-	message.AddList(offsets, UTF8CountChars(string, length));
-
-	status_t result = _AddCallback();
-	if (message.Flush() != B_OK)
-		return offsets[0];
+	int32 charCount = UTF8CountChars(string, length);
+	message.AddList(offsets, charCount);
 
-	if (result != B_OK)
+	if (charCount <= 0)
 		return offsets[0];
 
-	do {
-		result = acquire_sem_etc(fResultNotify, 1, B_RELATIVE_TIMEOUT,
-			1 * 1000 * 1000);
-	} while (result == B_INTERRUPTED);
+	// the pen ends up behind the last character
+	int32 lastCharStart = length - 1;
+	while (lastCharStart > 0 && (string[lastCharStart] & 0xc0) == 0x80)
+		lastCharStart--;
 
-	if (result != B_OK)
-		return offsets[0];
-
-	return fDrawStringResult;
+	return _PenLocation(offsets[charCount - 1],
+		fState.Font().StringWidth(string + lastCharStart,
+			length - lastCharStart));
 }
 
 
@@ -959,6 +958,18 @@ RemoteDrawingEngine::_DrawingEngineResult(void* cookie, RemoteMessage& message)
 }
 
 
+BPoint
+RemoteDrawingEngine::_PenLocation(const BPoint& start, float width) const
+{
+	float rotation = fState.Font().Rotation();
+	if (rotation == 0.0)
+		return BPoint(start.x + width, start.y);
+
+	double angle = rotation * M_PI / 180.0;
+	return BPoint(start.x + width * cos(angle), start.y - width * sin(angle));
+}
+
+
 BRect
 RemoteDrawingEngine::_BuildBounds(BPoint* points, int32 pointCount)
 {
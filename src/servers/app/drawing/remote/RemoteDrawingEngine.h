@@ -1,5 +1,5 @@
 /*
- * Copyright 2009, Haiku, Inc.
+ * Copyright 2009-2010, Haiku, Inc.
  * Distributed under the terms of the MIT License.
  *
  * Authors:
@@ -146,6 +146,8 @@ private:
 	static	bool				_DrawingEngineResult(void* cookie,
 									RemoteMessage& message);
 
+			BPoint				_PenLocation(const BPoint& start,
+									float width) const;
 			BRect				_BuildBounds(BPoint* points, int32 pointCount);
 
 			RemoteHWInterface*	fHWInterface;
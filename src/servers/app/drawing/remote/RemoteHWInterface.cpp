@@ -1,5 +1,5 @@
 /*
- * Copyright 2009, Haiku, Inc.
+ * Copyright 2009-2010, Haiku, Inc.
  * Distributed under the terms of the MIT License.
  *
  * Authors:
@@ -27,6 +27,11 @@
 #define TRACE_ERROR(x...)		debug_printf("RemoteHWInterface: "x)
 
 
+// large enough to keep the drawing threads from waiting for the network
+// in the common case
+static const size_t kSendBufferSize = 256 * 1024;
+
+
 struct callback_info {
 	uint32				token;
 	CallbackFunction	callback;
@@ -87,7 +92,7 @@ RemoteHWInterface::RemoteHWInterface(const char* target)
 	if (fInitStatus != B_OK)
 		return;
 
-	fSendBuffer = new(std::nothrow) StreamingRingBuffer(16 * 1024);
+	fSendBuffer = new(std::nothrow) StreamingRingBuffer(kSendBufferSize);
 	if (fSendBuffer == NULL) {
 		fInitStatus = B_NO_MEMORY;
 		return;
@@ -308,6 +313,9 @@ RemoteHWInterface::_Connect()
 		return result;
 	}
 
+	// the remote side starts out with an empty bitmap cache
+	fBitmapCache.MakeEmpty();
+
 	RemoteMessage message(fReceiveBuffer, fSendBuffer);
 	message.Start(RP_INIT_CONNECTION);
 	message.Add(fListenPort);
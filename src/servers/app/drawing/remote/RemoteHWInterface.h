@@ -1,5 +1,5 @@
 /*
- * Copyright 2009, Haiku, Inc.
+ * Copyright 2009-2010, Haiku, Inc.
  * Distributed under the terms of the MIT License.
  *
  * Authors:
@@ -9,6 +9,7 @@
 #define REMOTE_HW_INTERFACE_H
 
 #include "HWInterface.h"
+#include "RemoteBitmapCache.h"
 
 #include <Locker.h>
 #include <ObjectList.h>
@@ -80,6 +81,7 @@ virtual	status_t					CopyBackToFront(const BRect& frame);
 		// drawing engine interface
 		StreamingRingBuffer*		ReceiveBuffer() { return fReceiveBuffer; }
 		StreamingRingBuffer*		SendBuffer() { return fSendBuffer; }
+		RemoteBitmapCache&			BitmapCache() { return fBitmapCache; }
 
 		status_t					AddCallback(uint32 token,
 										CallbackFunction callback,
@@ -117,6 +119,8 @@ static	int32						_EventThreadEntry(void* data);
 		NetSender*					fSender;
 		NetReceiver*				fReceiver;
 
+		RemoteBitmapCache			fBitmapCache;
+
 		thread_id					fEventThread;
 		RemoteEventStream*			fEventStream;
 
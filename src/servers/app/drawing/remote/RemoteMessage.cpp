@@ -1,5 +1,5 @@
 /*
- * Copyright 2009, Haiku, Inc.
+ * Copyright 2009-2010, Haiku, Inc.
  * Distributed under the terms of the MIT License.
  *
  * Authors:
@@ -27,6 +27,12 @@
 
 #include <new>
 
+#include <zlib.h>
+
+
+// bitmaps smaller than this are not worth compressing
+static const uint32 kMinCompressLength = 1024;
+
 
 status_t
 RemoteMessage::NextMessage(uint16& code)
@@ -58,7 +64,7 @@ RemoteMessage::NextMessage(uint16& code)
 
 #ifndef CLIENT_COMPILE
 void
-RemoteMessage::AddBitmap(const ServerBitmap& bitmap)
+RemoteMessage::AddBitmap(const ServerBitmap& bitmap, bool compress)
 {
 	Add(bitmap.Width());
 	Add(bitmap.Height());
@@ -69,12 +75,7 @@ RemoteMessage::AddBitmap(const ServerBitmap& bitmap)
 	uint32 bitsLength = bitmap.BitsLength();
 	Add(bitsLength);
 
-	if (!_MakeSpace(bitsLength))
-		return;
-
-	memcpy(fBuffer + fWriteIndex, bitmap.Bits(), bitsLength);
-	fWriteIndex += bitsLength;
-	fAvailable -= bitsLength;
+	_AddBits(bitmap.Bits(), bitsLength, compress);
 }
 
 
@@ -137,7 +138,7 @@ RemoteMessage::AddPattern(const Pattern& pattern)
 #else // !CLIENT_COMPILE
 
 void
-RemoteMessage::AddBitmap(const BBitmap& bitmap)
+RemoteMessage::AddBitmap(const BBitmap& bitmap, bool compress)
 {
 	BRect bounds = bitmap.Bounds();
 	Add(bounds.IntegerWidth() + 1);
@@ -149,12 +150,7 @@ RemoteMessage::AddBitmap(const BBitmap& bitmap)
 	uint32 bitsLength = bitmap.BitsLength();
 	Add(bitsLength);
 
-	if (!_MakeSpace(bitsLength))
-		return;
-
-	memcpy(fBuffer + fWriteIndex, bitmap.Bits(), bitsLength);
-	fWriteIndex += bitsLength;
-	fAvailable -= bitsLength;
+	_AddBits(bitmap.Bits(), bitsLength, compress);
 }
 #endif // !CLIENT_COMPILE
 
@@ -285,10 +281,9 @@ RemoteMessage::ReadBitmap(BBitmap** _bitmap)
 	Read(bytesPerRow);
 	Read(colorSpace);
 	Read(flags);
-	Read(bitsLength);
-
-	if (bitsLength > fDataLeft)
-		return B_ERROR;
+	status_t result = Read(bitsLength);
+	if (result != B_OK)
+		return result;
 
 #ifndef CLIENT_COMPILE
 	flags = B_BITMAP_NO_SERVER_LINK;
@@ -299,7 +294,7 @@ RemoteMessage::ReadBitmap(BBitmap** _bitmap)
 	if (bitmap == NULL)
 		return B_NO_MEMORY;
 
-	status_t result = bitmap->InitCheck();
+	result = bitmap->InitCheck();
 	if (result != B_OK) {
 		delete bitmap;
 		return result;
@@ -310,13 +305,12 @@ RemoteMessage::ReadBitmap(BBitmap** _bitmap)
 		return B_ERROR;
 	}
 
-	int32 readSize = fSource->Read(bitmap->Bits(), bitsLength);
-	if ((uint32)readSize != bitsLength) {
+	result = _ReadBits(bitmap->Bits(), bitsLength);
+	if (result != B_OK) {
 		delete bitmap;
-		return readSize < 0 ? readSize : B_ERROR;
+		return result;
 	}
 
-	fDataLeft -= readSize;
 	*_bitmap = bitmap;
 	return B_OK;
 }
@@ -499,3 +493,92 @@ RemoteMessage::ReadArrayLine(BPoint& startPoint, BPoint& endPoint,
 	Read(endPoint);
 	return Read(color);
 }
+
+
+/*!	Adds \a length bytes of bitmap data, prefixed by their encoding. If
+	\a compress is \c true, the data is compressed with zlib, as long as
+	that actually saves a noticeable amount of bandwidth.
+*/
+void
+RemoteMessage::_AddBits(const void* bits, uint32 length, bool compress)
+{
+	if (compress && length >= kMinCompressLength) {
+		// compress directly into the message buffer, behind the header
+		static const size_t kHeaderSize = sizeof(uint8) + sizeof(uint32);
+		uLongf compressedLength = compressBound(length);
+		if (_MakeSpace(kHeaderSize + compressedLength)
+			&& compress2(fBuffer + fWriteIndex + kHeaderSize,
+				&compressedLength, (const Bytef*)bits, length, Z_BEST_SPEED)
+					== Z_OK
+			&& compressedLength < length - length / 8) {
+			Add((uint8)RP_BITS_ZLIB);
+			Add((uint32)compressedLength);
+			fWriteIndex += compressedLength;
+			fAvailable -= compressedLength;
+			return;
+		}
+	}
+
+	Add((uint8)RP_BITS_RAW);
+	if (!_MakeSpace(length))
+		return;
+
+	memcpy(fBuffer + fWriteIndex, bits, length);
+	fWriteIndex += length;
+	fAvailable -= length;
+}
+
+
+status_t
+RemoteMessage::_ReadBits(void* bits, uint32 length)
+{
+	uint8 encoding;
+	status_t result = Read(encoding);
+	if (result != B_OK)
+		return result;
+
+	if (encoding == RP_BITS_RAW) {
+		if (length > fDataLeft)
+			return B_ERROR;
+
+		int32 readSize = fSource->Read(bits, length);
+		if ((uint32)readSize != length)
+			return readSize < 0 ? readSize : B_ERROR;
+
+		fDataLeft -= readSize;
+		return B_OK;
+	}
+
+	if (encoding != RP_BITS_ZLIB)
+		return B_BAD_DATA;
+
+	uint32 compressedLength;
+	result = Read(compressedLength);
+	if (result != B_OK)
+		return result;
+
+	if (compressedLength > fDataLeft)
+		return B_ERROR;
+
+	uint8* compressed = (uint8*)malloc(compressedLength);
+	if (compressed == NULL)
+		return B_NO_MEMORY;
+
+	int32 readSize = fSource->Read(compressed, compressedLength);
+	if ((uint32)readSize != compressedLength) {
+		free(compressed);
+		return readSize < 0 ? readSize : B_ERROR;
+	}
+
+	fDataLeft -= readSize;
+
+	uLongf uncompressedLength = length;
+	int zlibResult = uncompress((Bytef*)bits, &uncompressedLength, compressed,
+		compressedLength);
+	free(compressed);
+
+	if (zlibResult != Z_OK || uncompressedLength != length)
+		return B_BAD_DATA;
+
+	return B_OK;
+}
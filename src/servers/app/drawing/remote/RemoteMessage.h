@@ -1,5 +1,5 @@
 /*
- * Copyright 2009, Haiku, Inc.
+ * Copyright 2009-2010, Haiku, Inc.
  * Distributed under the terms of the MIT License.
  *
  * Authors:
@@ -60,6 +60,7 @@ enum {
 	RP_COPY_RECT_NO_CLIPPING,
 	RP_INVERT_RECT,
 	RP_DRAW_BITMAP,
+	RP_DRAW_CACHED_BITMAP,
 
 	RP_STROKE_ARC = 80,
 	RP_STROKE_BEZIER,
@@ -123,6 +124,12 @@ enum {
 	RP_MODIFIERS_CHANGED
 };
 
+// encodings of the bitmap data
+enum {
+	RP_BITS_RAW = 0,
+	RP_BITS_ZLIB
+};
+
 
 class RemoteMessage {
 public:
@@ -145,14 +152,16 @@ public:
 		void					AddGradient(const BGradient& gradient);
 
 #ifndef CLIENT_COMPILE
-		void					AddBitmap(const ServerBitmap& bitmap);
+		void					AddBitmap(const ServerBitmap& bitmap,
+									bool compress = false);
 		void					AddFont(const ServerFont& font);
 		void					AddPattern(const Pattern& pattern);
 		void					AddDrawState(const DrawState& drawState);
 		void					AddArrayLine(const ViewLineArrayInfo& line);
 		void					AddCursor(const ServerCursor& cursor);
 #else
-		void					AddBitmap(const BBitmap& bitmap);
+		void					AddBitmap(const BBitmap& bitmap,
+									bool compress = false);
 #endif
 
 		template<typename T>
@@ -179,6 +188,10 @@ public:
 private:
 		bool					_MakeSpace(size_t size);
 
+		void					_AddBits(const void* bits, uint32 length,
+									bool compress);
+		status_t				_ReadBits(void* bits, uint32 length);
+
 		StreamingRingBuffer*	fSource;
 		StreamingRingBuffer*	fTarget;
 
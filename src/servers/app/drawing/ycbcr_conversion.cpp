@@ -0,0 +1,117 @@
+/*
+ * Copyright 2010, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+/*!	Conversion of the YCbCr overlay color spaces to B_RGB32, used for
+	software emulated overlays.
+
+	The ITU-R BT.601 coefficients are applied with 9 fractional bits, and
+	every product is rounded down on its own; this is exactly what the SSE2
+	version in ycbcr_conversion_sse2.nasm computes.
+*/
+
+
+#include "ycbcr_conversion.h"
+
+#include "AppServer.h"
+
+
+// Prototypes for assembler routines
+extern "C" {
+	void convert_ycbcr422_row_sse2(uint32* dst, const uint8* src,
+		uint32 count);
+}
+
+
+static inline int32
+scaled(int32 value, int32 factor)
+{
+	return (value * 128 * factor) >> 16;
+}
+
+
+static inline uint8
+clamp(int32 value)
+{
+	if (value < 0)
+		return 0;
+	if (value > 255)
+		return 255;
+	return value;
+}
+
+
+static inline uint32
+ycbcr_to_rgb32(int32 luma, int32 cb, int32 cr)
+{
+	int32 blue = luma + scaled(cb, 1033);
+	int32 green = luma + scaled(cb, -200) + scaled(cr, -416);
+	int32 red = luma + scaled(cr, 817);
+
+	return 0xff000000 | (clamp(red) << 16) | (clamp(green) << 8)
+		| clamp(blue);
+}
+
+
+static inline void
+convert_pair(uint32* dst, uint8 y0, uint8 y1, uint8 cb, uint8 cr,
+	bool secondPixel)
+{
+	int32 cbCentered = cb - 128;
+	int32 crCentered = cr - 128;
+
+	dst[0] = ycbcr_to_rgb32(scaled(y0 - 16, 597), cbCentered, crCentered);
+	if (secondPixel)
+		dst[1] = ycbcr_to_rgb32(scaled(y1 - 16, 597), cbCentered, crCentered);
+}
+
+
+/*!	Converts \a count B_YCbCr422 pixels (Y0 Cb0 Y1 Cr0 ...) to B_RGB32.
+	\a src must point to the first byte of a pixel pair.
+*/
+void
+convert_ycbcr422_row(uint32* dst, const uint8* src, int32 count)
+{
+#ifdef __INTEL__
+	if ((gAppServerSIMDFlags & APPSERVER_SIMD_SSE2) != 0) {
+		// the assembler routine only handles multiples of eight pixels
+		int32 simdCount = count & ~7;
+		if (simdCount > 0) {
+			convert_ycbcr422_row_sse2(dst, src, simdCount);
+			dst += simdCount;
+			src += simdCount * 2;
+			count -= simdCount;
+		}
+	}
+#endif
+
+	while (count > 0) {
+		convert_pair(dst, src[0], src[2], src[1], src[3], count > 1);
+		dst += 2;
+		src += 4;
+		count -= 2;
+	}
+}
+
+
+/*!	Converts \a count B_YCbCr420 pixels to B_RGB32. This is the packed
+	format of the BeOS, where every pixel pair is stored as a chroma value
+	followed by the two luma values, Cb on even, and Cr on odd lines.
+	\a src is the line to convert, \a cbRow and \a crRow are the even and
+	odd line of its pair of lines. All of them must point to the first byte
+	of a pixel pair.
+*/
+void
+convert_ycbcr420_row(uint32* dst, const uint8* src, const uint8* cbRow,
+	const uint8* crRow, int32 count)
+{
+	while (count > 0) {
+		convert_pair(dst, src[1], src[2], cbRow[0], crRow[0], count > 1);
+		dst += 2;
+		src += 3;
+		cbRow += 3;
+		crRow += 3;
+		count -= 2;
+	}
+}
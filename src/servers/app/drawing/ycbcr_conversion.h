@@ -0,0 +1,17 @@
+/*
+ * Copyright 2010, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef YCBCR_CONVERSION_H
+#define YCBCR_CONVERSION_H
+
+
+#include <SupportDefs.h>
+
+
+void convert_ycbcr422_row(uint32* dst, const uint8* src, int32 count);
+void convert_ycbcr420_row(uint32* dst, const uint8* src, const uint8* cbRow,
+	const uint8* crRow, int32 count);
+
+
+#endif	// YCBCR_CONVERSION_H
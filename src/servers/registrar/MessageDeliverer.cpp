@@ -11,6 +11,7 @@
 #include <AutoDeleter.h>
 #include <Autolock.h>
 #include <DataIO.h>
+#include <locks.h>
 #include <MessagePrivate.h>
 #include <MessengerPrivate.h>
 #include <OS.h>
@@ -30,7 +31,11 @@ using std::set;
 // sDeliverer -- the singleton instance
 MessageDeliverer *MessageDeliverer::sDeliverer = NULL;
 
-static const bigtime_t	kRetryDelay			= 100000;			// 100 ms
+// Retry delays for full target ports. The delay is doubled every time a
+// retry does not deliver any message, so that a hung application does not
+// keep the deliverer threads busy.
+static const bigtime_t	kMinRetryDelay		= 10000;			// 10 ms
+static const bigtime_t	kMaxRetryDelay		= 1000000;			// 1 s
 
 // per port sanity limits
 static const int32		kMaxMessagesPerPort	= 10000;
@@ -174,13 +179,28 @@ public:
 			fTimeoutTime = fCreationTime;
 		else
 			fTimeoutTime = fCreationTime + timeout;
+
+		mutex_init(&fSendLock, "message deliverer message");
 	}
 
 	~Message()
 	{
+		mutex_destroy(&fSendLock);
 		free(fData);
 	}
 
+	status_t Send(port_id portID, int32 token)
+	{
+		// The target token is written into the message data, so the message
+		// must not be sent to two targets at the same time.
+		mutex_lock(&fSendLock);
+		status_t error = BMessage::Private::SendFlattenedMessage(fData,
+			fDataSize, portID, token, 0);
+		mutex_unlock(&fSendLock);
+
+		return error;
+	}
+
 	void *Data() const
 	{
 		return fData;
@@ -222,6 +242,7 @@ private:
 	bigtime_t	fCreationTime;
 	bigtime_t	fTimeoutTime;
 	bool		fBusy;
+	mutex		fSendLock;
 };
 
 // TargetMessage
@@ -332,21 +353,60 @@ private:
 	delivered. Furthermore the object maintains an ordered set of
 	TargetMessages that can timeout (in ascending order of timeout time), so
 	that timed out messages can be dropped easily.
+
+	The queue is protected by the object's own lock, so that delivering to
+	one port never has to wait for another one. The scheduling state is
+	protected by the MessageDeliverer's lock, though.
+
+	While the port is congested, the object also records how many messages
+	were delivered late or dropped, and how long they had to wait.
 */
-class MessageDeliverer::TargetPort {
+class MessageDeliverer::TargetPort : public Referenceable,
+	public DoublyLinkedListLinkImpl<MessageDeliverer::TargetPort> {
 public:
 	TargetPort(port_id portID)
-		: fPortID(portID),
+		: Referenceable(true),
+		  fPortID(portID),
 		  fMessages(),
 		  fMessageCount(0),
-		  fMessageSize(0)
+		  fMessageSize(0),
+		  fScheduled(false),
+		  fRetryDelay(kMinRetryDelay),
+		  fNextRetryTime(0),
+		  fDeliveredCount(0),
+		  fDroppedCount(0),
+		  fTotalLatency(0),
+		  fMaxLatency(0)
 	{
+		mutex_init(&fLock, "message deliverer target port");
 	}
 
 	~TargetPort()
 	{
-		while (!fMessages.IsEmpty())
-			PopMessage();
+		DropAllMessages();
+
+		if (fDroppedCount > 0) {
+			WARNING(("MessageDeliverer: port %ld: dropped %ld messages, "
+				"delivered %ld late (max latency %lld us)\n", fPortID,
+				fDroppedCount, fDeliveredCount, fMaxLatency));
+		} else if (fDeliveredCount > 0) {
+			PRINT(("MessageDeliverer: port %ld: delivered %ld messages late, "
+				"average latency %lld us, max latency %lld us\n", fPortID,
+				fDeliveredCount, fTotalLatency / fDeliveredCount,
+				fMaxLatency));
+		}
+
+		mutex_destroy(&fLock);
+	}
+
+	void Lock()
+	{
+		mutex_lock(&fLock);
+	}
+
+	void Unlock()
+	{
+		mutex_unlock(&fLock);
 	}
 
 	port_id PortID() const
@@ -354,6 +414,31 @@ public:
 		return fPortID;
 	}
 
+	bool IsScheduled() const
+	{
+		return fScheduled;
+	}
+
+	void SetScheduled(bool scheduled)
+	{
+		fScheduled = scheduled;
+	}
+
+	bigtime_t NextRetryTime() const
+	{
+		return fNextRetryTime;
+	}
+
+	void SetNextRetryTime(bool backOff)
+	{
+		if (backOff)
+			fRetryDelay = min_c(fRetryDelay * 2, kMaxRetryDelay);
+		else
+			fRetryDelay = kMinRetryDelay;
+
+		fNextRetryTime = system_time() + fRetryDelay;
+	}
+
 	status_t PushMessage(Message *message, int32 token)
 	{
 PRINT(("MessageDeliverer::TargetPort::PushMessage(port: %ld, %p, %ld)\n",
@@ -387,15 +472,21 @@ fPortID, message, token));
 		return fMessages.Head()->GetMessage();
 	}
 
-	void PopMessage()
+	void PopMessage(bool delivered = false)
 	{
 		if (fMessages.Head()) {
 PRINT(("MessageDeliverer::TargetPort::PopMessage(): port: %ld, %p\n",
 fPortID, fMessages.Head()->GetMessage()));
-			_RemoveMessage(fMessages.Head());
+			_RemoveMessage(fMessages.Head(), delivered);
 		}
 	}
 
+	void DropAllMessages()
+	{
+		while (!fMessages.IsEmpty())
+			PopMessage();
+	}
+
 	void DropTimedOutMessages()
 	{
 		bigtime_t now = system_time();
@@ -407,7 +498,7 @@ fPortID, fMessages.Head()->GetMessage()));
 
 PRINT(("MessageDeliverer::TargetPort::DropTimedOutMessages(): port: %ld: "
 "message %p timed out\n", fPortID, message->GetMessage()));
-			_RemoveMessage(message);
+			_RemoveMessage(message, false);
 		}
 	}
 
@@ -417,12 +508,21 @@ PRINT(("MessageDeliverer::TargetPort::DropTimedOutMessages(): port: %ld: "
 	}
 
 private:
-	void _RemoveMessage(TargetMessage *message)
+	void _RemoveMessage(TargetMessage *message, bool delivered)
 	{
 		fMessages.Remove(message);
 		fMessageCount--;
 		fMessageSize -= message->GetMessage()->DataSize();
 
+		if (delivered) {
+			bigtime_t latency
+				= system_time() - message->GetMessage()->CreationTime();
+			fDeliveredCount++;
+			fTotalLatency += latency;
+			fMaxLatency = max_c(fMaxLatency, latency);
+		} else
+			fDroppedCount++;
+
 		if (message->GetMessage()->HasTimeout())
 			fTimeoutableMessages.erase(message);
 
@@ -448,17 +548,32 @@ PRINT(("MessageDeliverer::TargetPort::_EnforceLimits(): port: %ld: hit maximum "
 
 	typedef DoublyLinkedList<TargetMessage>	MessageList;
 
+	mutex						fLock;
 	port_id						fPortID;
 	MessageList					fMessages;
 	int32						fMessageCount;
 	int32						fMessageSize;
 	set<TargetMessageHandle>	fTimeoutableMessages;
+
+	bool						fScheduled;
+	bigtime_t					fRetryDelay;
+	bigtime_t					fNextRetryTime;
+
+	int32						fDeliveredCount;
+	int32						fDroppedCount;
+	bigtime_t					fTotalLatency;
+	bigtime_t					fMaxLatency;
 };
 
 // TargetPortMap
 struct MessageDeliverer::TargetPortMap : public map<port_id, TargetPort*> {
 };
 
+// TargetPortQueue
+struct MessageDeliverer::TargetPortQueue
+	: public DoublyLinkedList<MessageDeliverer::TargetPort> {
+};
+
 
 // #pragma mark -
 
@@ -472,17 +587,23 @@ struct MessageDeliverer::TargetPortMap : public map<port_id, TargetPort*> {
 
 	The class maintains a TargetPort for each target port which was full at the
 	time a message was to be delivered to it. A TargetPort has a queue of
-	undelivered messages. A separate worker thread retries periodically to send
-	the yet undelivered messages to the respective target ports.
+	undelivered messages. A small pool of worker threads retries to send the
+	yet undelivered messages to the respective target ports, when they are
+	due. Each port is retried independently, and less often the longer it
+	stays full, so that a hung application delays neither the delivery to
+	the other targets, nor the callers of DeliverMessage().
 */
 
 // constructor
 MessageDeliverer::MessageDeliverer()
 	: fLock("message deliverer"),
 	  fTargetPorts(NULL),
-	  fDelivererThread(-1),
+	  fScheduledPorts(NULL),
+	  fScheduleSemaphore(-1),
 	  fTerminating(false)
 {
+	for (int32 i = 0; i < kDelivererThreadCount; i++)
+		fDelivererThreads[i] = -1;
 }
 
 // destructor
@@ -490,31 +611,51 @@ MessageDeliverer::~MessageDeliverer()
 {
 	fTerminating = true;
 
-	if (fDelivererThread >= 0) {
-		int32 result;
-		wait_for_thread(fDelivererThread, &result);
+	// deleting the semaphore wakes up the deliverer threads
+	delete_sem(fScheduleSemaphore);
+
+	for (int32 i = 0; i < kDelivererThreadCount; i++) {
+		if (fDelivererThreads[i] >= 0) {
+			int32 result;
+			wait_for_thread(fDelivererThreads[i], &result);
+		}
+	}
+
+	if (fTargetPorts != NULL) {
+		for (TargetPortMap::iterator it = fTargetPorts->begin();
+				it != fTargetPorts->end(); it++) {
+			it->second->ReleaseReference();
+		}
 	}
 
 	delete fTargetPorts;
+	delete fScheduledPorts;
 }
 
 // Init
 status_t
 MessageDeliverer::Init()
 {
-	// create the target port map
+	// create the target port map and queue
 	fTargetPorts = new(nothrow) TargetPortMap;
-	if (!fTargetPorts)
+	fScheduledPorts = new(nothrow) TargetPortQueue;
+	if (!fTargetPorts || !fScheduledPorts)
 		return B_NO_MEMORY;
 
-	// spawn the deliverer thread
-	fDelivererThread = spawn_thread(MessageDeliverer::_DelivererThreadEntry,
-		"message deliverer", B_NORMAL_PRIORITY + 1, this);
-	if (fDelivererThread < 0)
-		return fDelivererThread;
+	fScheduleSemaphore = create_sem(0, "message deliverer schedule");
+	if (fScheduleSemaphore < 0)
+		return fScheduleSemaphore;
+
+	// spawn the deliverer threads
+	for (int32 i = 0; i < kDelivererThreadCount; i++) {
+		fDelivererThreads[i] = spawn_thread(
+			MessageDeliverer::_DelivererThreadEntry, "message deliverer",
+			B_NORMAL_PRIORITY + 1, this);
+		if (fDelivererThreads[i] < 0)
+			return fDelivererThreads[i];
 
-	// resume the deliverer thread
-	resume_thread(fDelivererThread);
+		resume_thread(fDelivererThreads[i]);
+	}
 
 	return B_OK;
 }
@@ -656,37 +797,42 @@ MessageDeliverer::DeliverMessage(const void *messageData, int32 messageSize,
 	Reference<Message> _(message, true);
 
 	// add the message to the respective target ports
-	BAutolock locker(fLock);
 	for (int32 targetIndex = 0; targets.HasNext(); targetIndex++) {
 		port_id portID;
 		int32 token;
 		targets.Next(portID, token);
 
-		// get the target port
-		TargetPort *port = _GetTargetPort(portID, true);
-		if (!port)
-			return B_NO_MEMORY;
-
-		// try sending the message, if there are no queued messages yet
-		if (port->IsEmpty()) {
+		// Try sending the message, if there are no queued messages yet. A
+		// TargetPort only exists as long as there are.
+		TargetPort *port = _GetTargetPort(portID);
+		if (!port) {
 			status_t error = _SendMessage(message, portID, token);
-			// if the message was delivered OK, we're done with the target
-			if (error == B_OK) {
-				_PutTargetPort(port);
-				continue;
-			}
 
 			// if the port is not full, but an error occurred, we skip this target
 			if (error != B_WOULD_BLOCK) {
-				_PutTargetPort(port);
-				if (targetIndex == 0 && !targets.HasNext())
+				if (error != B_OK && targetIndex == 0 && !targets.HasNext())
 					return error;
 				continue;
 			}
+
+			port = _GetTargetPort(portID, true);
+			if (!port)
+				return B_NO_MEMORY;
 		}
 
 		// add the message
+		port->Lock();
 		status_t error = port->PushMessage(message, token);
+		port->Unlock();
+
+		if (error == B_OK) {
+			BAutolock _(fLock);
+			if (!port->IsScheduled()) {
+				port->SetNextRetryTime(false);
+				_SchedulePort(port);
+			}
+		}
+
 		_PutTargetPort(port);
 		if (error != B_OK)
 			return error;
@@ -696,13 +842,24 @@ MessageDeliverer::DeliverMessage(const void *messageData, int32 messageSize,
 }
 
 // _GetTargetPort
+/*!	\brief Returns the TargetPort for the given port, with a reference
+		   acquired.
+
+	If \a create is \c true, the TargetPort is created if it doesn't exist
+	yet. The map keeps a reference to the TargetPort until it has become
+	empty again.
+*/
 MessageDeliverer::TargetPort *
 MessageDeliverer::_GetTargetPort(port_id portID, bool create)
 {
+	BAutolock _(fLock);
+
 	// get the port from the map
 	TargetPortMap::iterator it = fTargetPorts->find(portID);
-	if (it != fTargetPorts->end())
+	if (it != fTargetPorts->end()) {
+		it->second->AcquireReference();
 		return it->second;
+	}
 
 	if (!create)
 		return NULL;
@@ -713,19 +870,145 @@ MessageDeliverer::_GetTargetPort(port_id portID, bool create)
 		return NULL;
 	(*fTargetPorts)[portID] = port;
 
+	port->AcquireReference();
 	return port;
 }
 
 // _PutTargetPort
+/*!	\brief Releases a reference to the given TargetPort, and removes it from
+		   the map, if no one else uses it and it has become empty.
+*/
 void
 MessageDeliverer::_PutTargetPort(TargetPort *port)
 {
 	if (!port)
 		return;
 
-	if (port->IsEmpty()) {
-		fTargetPorts->erase(port->PortID());
-		delete port;
+	BAutolock _(fLock);
+
+	// Only references acquired with fLock held exist, so no one can get hold
+	// of the port anymore when we and the map are the only ones left.
+	if (port->CountReferences() == 2 && !port->IsScheduled()) {
+		port->Lock();
+		bool empty = port->IsEmpty();
+		port->Unlock();
+
+		if (empty) {
+			fTargetPorts->erase(port->PortID());
+			port->ReleaseReference();
+		}
+	}
+
+	port->ReleaseReference();
+}
+
+// _SchedulePort
+/*!	\brief Adds the given TargetPort to the queue of ports to be retried.
+
+	The caller must hold fLock.
+*/
+void
+MessageDeliverer::_SchedulePort(TargetPort *port)
+{
+	fScheduledPorts->Insert(port);
+	port->SetScheduled(true);
+
+	// wake up a deliverer thread, so that it can adjust its timeout
+	release_sem_etc(fScheduleSemaphore, 1, B_DO_NOT_RESCHEDULE);
+}
+
+// _NextScheduledPort
+/*!	\brief Waits until a scheduled TargetPort is due, removes it from the
+		   queue, and returns it with a reference acquired.
+
+	The port remains marked scheduled, so that nobody else will schedule it
+	while it's being worked on.
+
+	\return The due TargetPort, or \c NULL, if the deliverer is terminating.
+*/
+MessageDeliverer::TargetPort *
+MessageDeliverer::_NextScheduledPort()
+{
+	while (!fTerminating) {
+		bigtime_t timeout = B_INFINITE_TIMEOUT;
+
+		// find the port that is due first -- there are only few congested
+		// ports at any time
+		fLock.Lock();
+		TargetPort *port = fScheduledPorts->Head();
+		for (TargetPort *next = port; next;
+				next = fScheduledPorts->GetNext(next)) {
+			if (next->NextRetryTime() < port->NextRetryTime())
+				port = next;
+		}
+
+		if (port) {
+			bigtime_t now = system_time();
+			if (port->NextRetryTime() <= now) {
+				fScheduledPorts->Remove(port);
+				port->AcquireReference();
+				fLock.Unlock();
+				return port;
+			}
+
+			timeout = port->NextRetryTime() - now;
+		}
+		fLock.Unlock();
+
+		status_t error = acquire_sem_etc(fScheduleSemaphore, 1,
+			timeout != B_INFINITE_TIMEOUT ? B_RELATIVE_TIMEOUT : 0, timeout);
+		if (error != B_OK && error != B_TIMED_OUT && error != B_INTERRUPTED)
+			return NULL;
+	}
+
+	return NULL;
+}
+
+// _DeliverQueuedMessages
+/*!	\brief Tries to send the messages queued for the given TargetPort, and
+		   schedules it again, if that didn't succeed for all of them.
+*/
+void
+MessageDeliverer::_DeliverQueuedMessages(TargetPort *port)
+{
+	bool delivered = false;
+
+	port->Lock();
+	port->DropTimedOutMessages();
+
+	// try sending all messages
+	int32 token;
+	while (Message *message = port->PeekMessage(token)) {
+		status_t error = _SendMessage(message, port->PortID(), token);
+		if (error == B_OK) {
+			port->PopMessage(true);
+			delivered = true;
+		} else if (error == B_WOULD_BLOCK) {
+			// no luck yet -- port is still full
+			break;
+		} else {
+			// unexpected error -- probably the port is gone
+			port->DropAllMessages();
+			break;
+		}
+	}
+
+	port->Unlock();
+
+	// Schedule the port again, if it still has messages. That includes
+	// messages that have been added in the meantime, as the port wasn't
+	// rescheduled for them.
+	BAutolock _(fLock);
+
+	port->Lock();
+	bool empty = port->IsEmpty();
+	port->Unlock();
+
+	if (empty)
+		port->SetScheduled(false);
+	else {
+		port->SetNextRetryTime(!delivered);
+		_SchedulePort(port);
 	}
 }
 
@@ -733,8 +1016,7 @@ MessageDeliverer::_PutTargetPort(TargetPort *port)
 status_t
 MessageDeliverer::_SendMessage(Message *message, port_id portID, int32 token)
 {
-	status_t error = BMessage::Private::SendFlattenedMessage(message->Data(),
-		message->DataSize(), portID, token, 0);
+	status_t error = message->Send(portID, token);
 //PRINT(("MessageDeliverer::_SendMessage(%p, port: %ld, token: %ld): %lx\n",
 //message, portID, token, error));
 	return error;
@@ -751,53 +1033,9 @@ MessageDeliverer::_DelivererThreadEntry(void *data)
 int32
 MessageDeliverer::_DelivererThread()
 {
-	while (!fTerminating) {
-		snooze(kRetryDelay);
-		if (fTerminating)
-			break;
-
-		// iterate through all target ports and try sending the messages
-		BAutolock _(fLock);
-		for (TargetPortMap::iterator it = fTargetPorts->begin();
-			 it != fTargetPorts->end();) {
-			TargetPort *port = it->second;
-			bool portError = false;
-
-			port->DropTimedOutMessages();
-
-			// try sending all messages
-			int32 token;
-			while (Message *message = port->PeekMessage(token)) {
-				status_t error = B_OK;
-//				if (message->TimeoutTime() > system_time()) {
-					error = _SendMessage(message, port->PortID(), token);
-//				} else {
-//					// timeout, drop message
-//					PRINT(("MessageDeliverer::_DelivererThread(): port %ld, "
-//						"message %p timed out\n", port->PortID(), message));
-//				}
-
-				if (error == B_OK) {
-					port->PopMessage();
-				} else if (error == B_WOULD_BLOCK) {
-					// no luck yet -- port is still full
-					break;
-				} else {
-					// unexpected error -- probably the port is gone
-					portError = true;
-					break;
-				}
-			}
-
-			// next port
-			if (portError || port->IsEmpty()) {
-				TargetPortMap::iterator oldIt = it;
-				++it;
-				delete port;
-				fTargetPorts->erase(oldIt);
-			} else
-				++it;
-		}
+	while (TargetPort *port = _NextScheduledPort()) {
+		_DeliverQueuedMessages(port);
+		_PutTargetPort(port);
 	}
 
 	return 0;
@@ -81,10 +81,19 @@ private:
 	class TargetMessageHandle;
 	class TargetPort;
 	struct TargetPortMap;
+	struct TargetPortQueue;
+
+	enum {
+		kDelivererThreadCount = 2
+	};
 
 	TargetPort *_GetTargetPort(port_id portID, bool create = false);
 	void _PutTargetPort(TargetPort *port);
 
+	void _SchedulePort(TargetPort *port);
+	TargetPort *_NextScheduledPort();
+	void _DeliverQueuedMessages(TargetPort *port);
+
 	status_t _SendMessage(Message *message, port_id portID, int32 token);
 
 	static int32 _DelivererThreadEntry(void *data);
@@ -94,7 +103,9 @@ private:
 
 	BLocker			fLock;
 	TargetPortMap	*fTargetPorts;
-	thread_id		fDelivererThread;
+	TargetPortQueue	*fScheduledPorts;
+	sem_id			fScheduleSemaphore;
+	thread_id		fDelivererThreads[kDelivererThreadCount];
 	volatile bool	fTerminating;
 };
 
@@ -34,8 +34,8 @@ namespace Mime {
 CreateAppMetaMimeThread::CreateAppMetaMimeThread(const char *name,
 	int32 priority, Database *database, BMessenger managerMessenger,
 	const entry_ref *root, bool recursive, int32 force, BMessage *replyee)
-	: MimeUpdateThread(name, priority, database, managerMessenger, root,
-		recursive, force, replyee)
+	: MimeUpdateThread(name, "CreateAppMetaMimeCheckpoint", priority, database,
+		managerMessenger, root, recursive, force, replyee)
 {
 }
 
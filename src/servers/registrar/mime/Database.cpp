@@ -1,5 +1,5 @@
 /*
- * Copyright 2002-2006, Haiku.
+ * Copyright 2002-2010, Haiku.
  * Distributed under the terms of the MIT License.
  *
  * Authors:
@@ -68,6 +68,10 @@ Database::Database()
 	// Do some really minor error checking
 	BEntry entry(get_database_directory().c_str());
 	fStatus = entry.Exists() ? B_OK : B_BAD_VALUE;
+
+	// the clients can do without the index, so its failure isn't fatal
+	if (fStatus == B_OK)
+		fIndex.Init();
 }
 
 // destructor
@@ -1367,6 +1371,8 @@ Database::_SendMonitorUpdate(int32 which, const char *type, const char *extraTyp
 	BMessage msg(B_META_MIME_CHANGED);
 	status_t err;
 
+	_UpdateIndex(which, type);
+
 	if (_CheckDeferredInstallNotification(which, type))
 		return B_OK;
 
@@ -1395,6 +1401,8 @@ status_t
 Database::_SendMonitorUpdate(int32 which, const char *type, const char *extraType,
 	int32 action)
 {
+	_UpdateIndex(which, type);
+
 	if (_CheckDeferredInstallNotification(which, type))
 		return B_OK;
 
@@ -1423,6 +1431,8 @@ Database::_SendMonitorUpdate(int32 which, const char *type, const char *extraTyp
 status_t
 Database::_SendMonitorUpdate(int32 which, const char *type, bool largeIcon, int32 action)
 {
+	_UpdateIndex(which, type);
+
 	if (_CheckDeferredInstallNotification(which, type))
 		return B_OK;
 
@@ -1449,6 +1459,8 @@ Database::_SendMonitorUpdate(int32 which, const char *type, bool largeIcon, int3
 status_t
 Database::_SendMonitorUpdate(int32 which, const char *type, int32 action)
 {
+	_UpdateIndex(which, type);
+
 	if (_CheckDeferredInstallNotification(which, type))
 		return B_OK;
 
@@ -1487,6 +1499,22 @@ Database::_SendMonitorUpdate(BMessage &msg)
 }
 
 
+/*!	\brief Brings the clients' index of the database up to date with a
+	change to the given type.
+
+	This is done before a notification can be deferred, so that the
+	clients never see an older state than the one on disk.
+*/
+void
+Database::_UpdateIndex(int32 which, const char *type)
+{
+	if (which == B_MIME_TYPE_DELETED)
+		fIndex.RemoveType(type);
+	else
+		fIndex.UpdateType(type);
+}
+
+
 Database::DeferredInstallNotification*
 Database::_FindDeferredInstallNotification(const char* type, bool remove)
 {
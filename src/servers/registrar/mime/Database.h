@@ -1,5 +1,5 @@
 /*
- * Copyright 2002-2006, Haiku.
+ * Copyright 2002-2010, Haiku.
  * Distributed under the terms of the MIT License.
  *
  * Authors:
@@ -21,6 +21,7 @@
 #include <mime/database_access.h>
 
 #include "AssociatedTypes.h"
+#include "DatabaseIndex.h"
 #include "InstalledTypes.h"
 #include "SnifferRules.h"
 #include "SupportingApps.h"
@@ -130,6 +131,7 @@ class Database {
 		status_t _SendMonitorUpdate(int32 which, const char *type,
 					int32 action);
 		status_t _SendMonitorUpdate(BMessage &msg);
+		void _UpdateIndex(int32 which, const char *type);
 
 		DeferredInstallNotification* _FindDeferredInstallNotification(
 			const char* type, bool remove = false);
@@ -139,6 +141,7 @@ class Database {
 		status_t fStatus;
 		std::set<BMessenger> fMonitorMessengers;
 		AssociatedTypes fAssociatedTypes;
+		DatabaseIndex fIndex;
 		InstalledTypes fInstalledTypes;
 		SnifferRules fSnifferRules;
 		SupportingApps fSupportingApps;
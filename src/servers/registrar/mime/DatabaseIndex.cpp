@@ -0,0 +1,395 @@
+/*
+ * Copyright 2010, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+/*!
+	\file DatabaseIndex.cpp
+	DatabaseIndex class implementation
+*/
+
+#include "DatabaseIndex.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <Directory.h>
+#include <Entry.h>
+#include <fs_attr.h>
+#include <MimeType.h>
+#include <Node.h>
+
+#include <AutoLocker.h>
+#include <mime/database_index.h>
+#include <mime/database_support.h>
+#include <storage_support.h>
+
+//#define DBG(x) x
+#define DBG(x)
+#define OUT printf
+
+
+namespace BPrivate {
+namespace Storage {
+namespace Mime {
+
+
+static const size_t kInitialIndexSize = 4 * 1024 * 1024;
+static const size_t kMaxIndexSize = 64 * 1024 * 1024;
+static const size_t kIndexSizePerHashSlot = 1024;
+
+
+static inline uint32
+align_offset(uint32 offset)
+{
+	return (offset + 7) & ~(uint32)7;
+}
+
+
+/*!
+	\class DatabaseIndex
+	\brief Keeps a copy of the attributes of all types in the database in an
+	area, so that the clients can read them without having to access the
+	database files.
+
+	The layout of the area is described in <mime/database_index.h>. The
+	index has to be told about every change to the database, which
+	Database does whenever it sends a monitor notification.
+*/
+
+// constructor
+/*!	\brief Creates an index of the database in the given \a directory, or
+	of the user's database if it is \c NULL.
+
+	The area starts with \a initialSize bytes, and never grows beyond
+	\a maxSize bytes; \c 0 selects the defaults for either of them.
+*/
+DatabaseIndex::DatabaseIndex(const char* directory, size_t initialSize,
+	size_t maxSize)
+	:
+	fLock("mime database index"),
+	fDirectory(directory != NULL ? directory : ""),
+	fInitialSize(initialSize != 0 ? initialSize : kInitialIndexSize),
+	fMaxSize(maxSize != 0 ? maxSize : kMaxIndexSize),
+	fArea(-1),
+	fHeader(NULL),
+	fSerial(0)
+{
+}
+
+// destructor
+DatabaseIndex::~DatabaseIndex()
+{
+	if (fArea >= 0)
+		delete_area(fArea);
+}
+
+// Init
+/*!	\brief Builds the index from the contents of the database.
+*/
+status_t
+DatabaseIndex::Init()
+{
+	AutoLocker<BLocker> _(fLock);
+
+	return _Rebuild();
+}
+
+// UpdateType
+/*!	\brief Reads all attributes of the given type from the database again,
+	and replaces its entries in the index.
+*/
+status_t
+DatabaseIndex::UpdateType(const char* type)
+{
+	if (type == NULL)
+		return B_BAD_VALUE;
+
+	AutoLocker<BLocker> _(fLock);
+
+	if (fHeader == NULL)
+		return B_NO_INIT;
+
+	std::string lowerType = to_lower(type);
+
+	status_t status = _AddType(fHeader, lowerType.c_str());
+	if (status == B_BUFFER_OVERFLOW) {
+		// the database has already been changed, so we can just start over
+		status = _Rebuild();
+	}
+
+	return status;
+}
+
+// RemoveType
+/*!	\brief Marks the given type as removed from the database.
+*/
+status_t
+DatabaseIndex::RemoveType(const char* type)
+{
+	if (type == NULL)
+		return B_BAD_VALUE;
+
+	AutoLocker<BLocker> _(fLock);
+
+	if (fHeader == NULL)
+		return B_NO_INIT;
+
+	std::string lowerType = to_lower(type);
+
+	fSerial++;
+	status_t status = _Append(fHeader, lowerType.c_str(), "", 0, -1, NULL);
+	if (status == B_BUFFER_OVERFLOW)
+		status = _Rebuild();
+
+	return status;
+}
+
+// _Rebuild
+/*!	\brief Builds a new index from the database, and replaces the current
+	one with it.
+
+	Since the index is append-only, the current one is mostly filled with
+	outdated entries when it overflows; the size of the new area is
+	therefore only determined by the contents of the database. Starting
+	with the initial size, it is doubled until the database fits, and
+	still leaves at least half of the area for later changes.
+
+	If the database doesn't fit at all, the current index is invalidated,
+	so that the clients read the database files instead.
+*/
+status_t
+DatabaseIndex::_Rebuild()
+{
+	size_t size = fInitialSize;
+
+	while (true) {
+		if (size > fMaxSize) {
+			_Invalidate();
+			return B_NO_MEMORY;
+		}
+
+		database_index_header* header;
+		area_id area = create_area(MIME_DATABASE_INDEX_AREA_NAME,
+			(void**)&header, B_ANY_ADDRESS, size, B_NO_LOCK,
+			B_READ_AREA | B_WRITE_AREA);
+		if (area < B_OK) {
+			_Invalidate();
+			return area;
+		}
+
+		uint32 hashSize = 1;
+		while (hashSize < size / kIndexSizePerHashSlot)
+			hashSize <<= 1;
+
+		header->magic = kDatabaseIndexMagic;
+		header->size = size;
+		header->used = align_offset(sizeof(database_index_header)
+			+ hashSize * sizeof(uint32));
+		header->hash_size = hashSize;
+		header->replacement = -1;
+		memset(header->table, 0, hashSize * sizeof(uint32));
+
+		status_t status = _Build(header);
+		if (status == B_BUFFER_OVERFLOW
+			|| (status == B_OK && header->used > size / 2
+				&& size * 2 <= fMaxSize)) {
+			// also make room for further changes, or we would have to
+			// rebuild the index again right away
+			delete_area(area);
+			size *= 2;
+			continue;
+		}
+		if (status != B_OK) {
+			DBG(OUT("Mime::DatabaseIndex::_Rebuild(): building the index "
+				"failed: %s\n", strerror(status)));
+			delete_area(area);
+			_Invalidate();
+			return status;
+		}
+
+		if (fHeader != NULL) {
+			// let the clients know about the new area before the old one
+			// goes away; their clones of it stay valid
+			atomic_set(&fHeader->replacement, area);
+			delete_area(fArea);
+		}
+
+		fArea = area;
+		fHeader = header;
+		return B_OK;
+	}
+}
+
+// _Build
+/*!	\brief Crawls through the database, and adds every type it finds to the
+	given index.
+*/
+status_t
+DatabaseIndex::_Build(database_index_header* header)
+{
+	BDirectory root;
+	status_t err = root.SetTo(fDirectory.empty()
+		? get_database_directory().c_str() : fDirectory.c_str());
+	if (err != B_OK)
+		return err;
+
+	BEntry entry;
+	while (root.GetNextEntry(&entry) == B_OK) {
+		char supertype[B_PATH_NAME_LENGTH];
+		if (!entry.IsDirectory() || entry.GetName(supertype) != B_OK
+			|| !BMimeType::IsValid(supertype)) {
+			continue;
+		}
+
+		to_lower(supertype);
+
+		err = _AddType(header, supertype);
+		if (err != B_OK)
+			return err;
+
+		BDirectory dir;
+		if (dir.SetTo(&entry) != B_OK)
+			continue;
+
+		BEntry subEntry;
+		while (dir.GetNextEntry(&subEntry) == B_OK) {
+			char subtype[B_PATH_NAME_LENGTH];
+			if (subEntry.GetName(subtype) != B_OK)
+				continue;
+
+			to_lower(subtype);
+
+			char fullType[B_PATH_NAME_LENGTH];
+			snprintf(fullType, sizeof(fullType), "%s/%s", supertype, subtype);
+
+			err = _AddType(header, fullType);
+			if (err != B_OK)
+				return err;
+		}
+	}
+
+	return B_OK;
+}
+
+// _AddType
+/*!	\brief Appends all attributes of the given type to the index, followed
+	by the type entry that makes them visible to the clients.
+
+	If the type is not installed, it's added as a removed type.
+*/
+status_t
+DatabaseIndex::_AddType(database_index_header* header, const char* type)
+{
+	fSerial++;
+
+	BNode node;
+	status_t status = fDirectory.empty() ? open_type(type, &node)
+		: node.SetTo((fDirectory + "/" + type).c_str());
+	if (status != B_OK)
+		return _Append(header, type, "", 0, -1, NULL);
+
+	char attribute[B_ATTR_NAME_LENGTH];
+	while (node.GetNextAttrName(attribute) == B_OK) {
+		attr_info info;
+		if (node.GetAttrInfo(attribute, &info) != B_OK
+			|| info.size > (off_t)fMaxSize)
+			continue;
+
+		database_index_entry* entry;
+		status = _Append(header, type, attribute, info.type, info.size,
+			&entry);
+		if (status != B_OK)
+			return status;
+
+		ssize_t bytesRead = node.ReadAttr(attribute, info.type, 0,
+			(uint8*)entry + entry->data_offset, info.size);
+		if (bytesRead != info.size) {
+			DBG(OUT("Mime::DatabaseIndex::_AddType(): could not read "
+				"attribute %s of %s\n", attribute, type));
+
+			// the clients can't see the entry yet, so we can still make
+			// sure they never will
+			entry->hash = ~entry->hash;
+		}
+	}
+
+	return _Append(header, type, "", 0, 0, NULL);
+}
+
+// _Append
+/*!	\brief Appends an entry with the current serial number to the index.
+
+	The entry is linked into the hash table right away. If \a _entry is not
+	\c NULL, it is set to the new entry, whose data still has to be filled
+	in by the caller; this is safe, because the clients will only look at
+	an attribute entry once the type entry with the same serial number has
+	been appended.
+
+	\return \c B_BUFFER_OVERFLOW if the entry doesn't fit into the area.
+*/
+status_t
+DatabaseIndex::_Append(database_index_header* header, const char* type,
+	const char* attribute, type_code attributeType, int32 size,
+	database_index_entry** _entry)
+{
+	size_t typeLength = strlen(type) + 1;
+	size_t attributeLength = strlen(attribute) + 1;
+	uint32 dataOffset = align_offset(sizeof(database_index_entry)
+		+ typeLength + attributeLength);
+
+	uint64 offset = align_offset(header->used);
+	if (offset + dataOffset + max_c(size, 0) > header->size)
+		return B_BUFFER_OVERFLOW;
+
+	database_index_entry* entry
+		= (database_index_entry*)((uint8*)header + offset);
+	entry->hash = database_index_hash(type, attribute);
+	entry->serial = fSerial;
+	entry->type = attributeType;
+	entry->size = size;
+	entry->type_length = typeLength;
+	entry->attribute_length = attributeLength;
+	entry->data_offset = dataOffset;
+	memcpy(entry->name, type, typeLength);
+	memcpy(entry->name + typeLength, attribute, attributeLength);
+
+	if (_entry != NULL)
+		*_entry = entry;
+
+	header->used = offset + dataOffset + max_c(size, 0);
+
+	// publish the entry
+	vint32* slot = (vint32*)&header->table[entry->hash
+		& (header->hash_size - 1)];
+	entry->next = *slot;
+	atomic_set(slot, offset);
+
+	return B_OK;
+}
+
+// _Invalidate
+/*!	\brief Removes the current index, because it could not be brought up to
+	date with a change to the database.
+
+	The clients that already use it notice that it's no longer valid, and
+	read from the database files instead.
+*/
+void
+DatabaseIndex::_Invalidate()
+{
+	if (fHeader == NULL)
+		return;
+
+	DBG(OUT("Mime::DatabaseIndex::_Invalidate()\n"));
+
+	atomic_set((vint32*)&fHeader->magic, 0);
+	delete_area(fArea);
+
+	fArea = -1;
+	fHeader = NULL;
+}
+
+} // namespace Mime
+} // namespace Storage
+} // namespace BPrivate
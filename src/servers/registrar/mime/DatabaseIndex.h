@@ -0,0 +1,57 @@
+/*
+ * Copyright 2010, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef MIME_DATABASE_INDEX_H
+#define MIME_DATABASE_INDEX_H
+
+
+#include <Locker.h>
+#include <OS.h>
+
+#include <string>
+
+
+namespace BPrivate {
+namespace Storage {
+namespace Mime {
+
+struct database_index_entry;
+struct database_index_header;
+
+class DatabaseIndex {
+public:
+	DatabaseIndex(const char* directory = NULL, size_t initialSize = 0,
+		size_t maxSize = 0);
+	~DatabaseIndex();
+
+	status_t Init();
+
+	status_t UpdateType(const char* type);
+	status_t RemoveType(const char* type);
+
+	area_id Area() const { return fArea; }
+
+private:
+	status_t _Rebuild();
+	status_t _Build(database_index_header* header);
+	status_t _AddType(database_index_header* header, const char* type);
+	status_t _Append(database_index_header* header, const char* type,
+		const char* attribute, type_code attributeType, int32 size,
+		database_index_entry** _entry);
+	void _Invalidate();
+
+	BLocker					fLock;
+	std::string				fDirectory;
+	size_t					fInitialSize;
+	size_t					fMaxSize;
+	area_id					fArea;
+	database_index_header*	fHeader;
+	uint32					fSerial;
+};
+
+} // namespace Mime
+} // namespace Storage
+} // namespace BPrivate
+
+#endif	// MIME_DATABASE_INDEX_H
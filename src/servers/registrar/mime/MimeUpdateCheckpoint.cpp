@@ -0,0 +1,273 @@
+/*
+ * Copyright 2010, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+/*!
+	\file MimeUpdateCheckpoint.cpp
+	MimeUpdateCheckpoint class implementation
+*/
+
+#include "MimeUpdateCheckpoint.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <Directory.h>
+#include <Entry.h>
+#include <File.h>
+#include <FindDirectory.h>
+#include <Message.h>
+#include <Path.h>
+
+#include <AutoLocker.h>
+
+//#define DBG(x) x
+#define DBG(x)
+#define OUT printf
+
+
+namespace BPrivate {
+namespace Storage {
+namespace Mime {
+
+
+static const bigtime_t kSaveInterval = 5000000;
+static const bigtime_t kMaxCheckpointAge = 24 * 60 * 60 * 1000000LL;
+
+static BLocker sActiveCheckpointsLock("mime update checkpoints");
+static std::set<std::string> sActiveCheckpoints;
+
+
+static uint32
+hash_path(const char* path)
+{
+	uint32 hash = 0;
+	for (; path[0] != '\0'; path++)
+		hash = (hash << 5) - hash + (uint8)path[0];
+	return hash;
+}
+
+
+/*!
+	\class MimeUpdateCheckpoint
+	\brief Remembers which directories of a tree a MIME update has
+	completed, so that an interrupted update can be resumed.
+
+	Every tree has a checkpoint file of its own, whose name is made from
+	the kind of update and the tree's root. Only one update of a tree can
+	use it at a time; InitCheck() returns \c B_BUSY for the others, which
+	then have to do without.
+
+	The directories are written to the file every few seconds. A checkpoint
+	that is older than a day is ignored, and removed, since the files may
+	have changed a lot since. When an update is resumed, the checkpoint
+	keeps the time that the interrupted update was started.
+*/
+
+// constructor
+/*!	\brief Creates the checkpoint of the update of the tree at \a root,
+	and reads the directories that an interrupted update has completed.
+
+	The checkpoint file is stored in \a directory, or in the registrar's
+	settings directory if it is \c NULL.
+*/
+MimeUpdateCheckpoint::MimeUpdateCheckpoint(const char* name, const char* root,
+	const char* directory)
+	:
+	fLock("mime update checkpoint"),
+	fRoot(root),
+	fStarted(real_time_clock_usecs()),
+	fNextSave(system_time() + kSaveInterval),
+	fStatus(B_OK)
+{
+	if (directory != NULL)
+		fDirectory = directory;
+	else {
+		BPath path;
+		fStatus = find_directory(B_USER_SETTINGS_DIRECTORY, &path);
+		if (fStatus == B_OK)
+			fStatus = path.Append("system/registrar");
+		if (fStatus != B_OK)
+			return;
+
+		fDirectory = path.Path();
+	}
+
+	char fileName[B_FILE_NAME_LENGTH];
+	snprintf(fileName, sizeof(fileName), "%s-%08lx", name,
+		(unsigned long)hash_path(root));
+	fPath = fDirectory + "/" + fileName;
+
+	AutoLocker<BLocker> locker(sActiveCheckpointsLock);
+	if (!sActiveCheckpoints.insert(fPath).second) {
+		fStatus = B_BUSY;
+		return;
+	}
+	locker.Unlock();
+
+	_Load();
+}
+
+// destructor
+MimeUpdateCheckpoint::~MimeUpdateCheckpoint()
+{
+	if (fStatus != B_OK)
+		return;
+
+	AutoLocker<BLocker> _(sActiveCheckpointsLock);
+	sActiveCheckpoints.erase(fPath);
+}
+
+// InitCheck
+status_t
+MimeUpdateCheckpoint::InitCheck() const
+{
+	return fStatus;
+}
+
+// IsCompleted
+/*!	\brief Returns whether the given directory has already been completed by
+	the interrupted update. If so, it's also completed for this one.
+*/
+bool
+MimeUpdateCheckpoint::IsCompleted(const char* path)
+{
+	AutoLocker<BLocker> locker(fLock);
+
+	if (fStatus != B_OK || fResume.find(path) == fResume.end())
+		return false;
+
+	locker.Unlock();
+
+	SetCompleted(path);
+	return true;
+}
+
+// SetCompleted
+/*!	\brief Adds the given directory to the checkpoint, and writes the
+	checkpoint if it is due.
+
+	The directories below it are removed, as they are implied now.
+*/
+void
+MimeUpdateCheckpoint::SetCompleted(const char* path)
+{
+	AutoLocker<BLocker> _(fLock);
+
+	if (fStatus != B_OK)
+		return;
+
+	std::string prefix = path;
+	prefix += '/';
+
+	std::set<std::string>::iterator i = fCompleted.lower_bound(prefix);
+	while (i != fCompleted.end()
+		&& i->compare(0, prefix.length(), prefix) == 0) {
+		fCompleted.erase(i++);
+	}
+
+	fCompleted.insert(path);
+
+	if (system_time() >= fNextSave) {
+		_Save();
+		fNextSave = system_time() + kSaveInterval;
+	}
+}
+
+// Save
+//! \brief Writes the checkpoint, so that the update can be resumed later.
+void
+MimeUpdateCheckpoint::Save()
+{
+	AutoLocker<BLocker> _(fLock);
+
+	if (fStatus == B_OK)
+		_Save();
+}
+
+// Remove
+//! \brief Removes the checkpoint once the update has been completed.
+void
+MimeUpdateCheckpoint::Remove()
+{
+	AutoLocker<BLocker> _(fLock);
+
+	if (fStatus != B_OK)
+		return;
+
+	BEntry entry(fPath.c_str());
+	entry.Remove();
+}
+
+// _Load
+void
+MimeUpdateCheckpoint::_Load()
+{
+	BFile file;
+	BMessage checkpoint;
+	if (file.SetTo(fPath.c_str(), B_READ_ONLY) != B_OK
+		|| checkpoint.Unflatten(&file) != B_OK)
+		return;
+
+	const char* root;
+	if (checkpoint.FindString("root", &root) != B_OK || fRoot != root) {
+		// the checkpoint of another tree that happens to have the same name
+		return;
+	}
+
+	bigtime_t started;
+	if (checkpoint.FindInt64("started", &started) != B_OK
+		|| started > real_time_clock_usecs()
+		|| real_time_clock_usecs() - started > kMaxCheckpointAge) {
+		DBG(OUT("MimeUpdateCheckpoint: ignoring outdated checkpoint of %s\n",
+			root));
+		BEntry(fPath.c_str()).Remove();
+		return;
+	}
+
+	const char* directory;
+	for (int32 i = 0;
+			checkpoint.FindString("directory", i, &directory) == B_OK; i++) {
+		fResume.insert(directory);
+	}
+
+	fStarted = started;
+
+	DBG(OUT("MimeUpdateCheckpoint: resuming %s, %ld directories done\n",
+		root, fResume.size()));
+}
+
+// _Save
+//! Writes the checkpoint; the caller must hold the lock.
+void
+MimeUpdateCheckpoint::_Save()
+{
+	BMessage checkpoint;
+	status_t err = checkpoint.AddString("root", fRoot.c_str());
+	if (!err)
+		err = checkpoint.AddInt64("started", fStarted);
+
+	std::set<std::string>::iterator i = fCompleted.begin();
+	for (; !err && i != fCompleted.end(); i++)
+		err = checkpoint.AddString("directory", i->c_str());
+
+	BFile file;
+	if (!err)
+		err = create_directory(fDirectory.c_str(), 0777);
+	if (!err) {
+		err = file.SetTo(fPath.c_str(),
+			B_WRITE_ONLY | B_CREATE_FILE | B_ERASE_FILE);
+	}
+	if (!err)
+		err = checkpoint.Flatten(&file);
+
+	if (err != B_OK) {
+		DBG(OUT("MimeUpdateCheckpoint: could not write %s: %s\n",
+			fPath.c_str(), strerror(err)));
+	}
+}
+
+} // namespace Mime
+} // namespace Storage
+} // namespace BPrivate
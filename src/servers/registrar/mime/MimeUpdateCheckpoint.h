@@ -0,0 +1,53 @@
+/*
+ * Copyright 2010, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef MIME_UPDATE_CHECKPOINT_H
+#define MIME_UPDATE_CHECKPOINT_H
+
+
+#include <Locker.h>
+#include <OS.h>
+
+#include <set>
+#include <string>
+
+
+namespace BPrivate {
+namespace Storage {
+namespace Mime {
+
+class MimeUpdateCheckpoint {
+public:
+	MimeUpdateCheckpoint(const char* name, const char* root,
+		const char* directory = NULL);
+	~MimeUpdateCheckpoint();
+
+	status_t InitCheck() const;
+
+	bool IsCompleted(const char* path);
+	void SetCompleted(const char* path);
+
+	void Save();
+	void Remove();
+
+private:
+	void _Load();
+	void _Save();
+
+	BLocker					fLock;
+	std::string				fRoot;
+	std::string				fDirectory;
+	std::string				fPath;
+	std::set<std::string>	fCompleted;
+	std::set<std::string>	fResume;
+	bigtime_t				fStarted;
+	bigtime_t				fNextSave;
+	status_t				fStatus;
+};
+
+} // namespace Mime
+} // namespace Storage
+} // namespace BPrivate
+
+#endif	// MIME_UPDATE_CHECKPOINT_H
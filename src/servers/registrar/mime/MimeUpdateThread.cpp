@@ -1,5 +1,5 @@
 /*
- * Copyright 2002-2006, Haiku Inc.
+ * Copyright 2002-2010, Haiku Inc.
  * Distributed under the terms of the MIT License.
  *
  * Authors:
@@ -15,15 +15,23 @@
 #include "MimeUpdateThread.h"
 
 #include <stdio.h>
+#include <string.h>
+
+#include <deque>
+#include <new>
 
 #include <Directory.h>
 #include <Message.h>
+#include <Mime.h>
 #include <Path.h>
 #include <RegistrarDefs.h>
 #include <Volume.h>
 
+#include <AutoLocker.h>
 #include <storage_support.h>
 
+#include "MimeUpdateCheckpoint.h"
+
 //#define DBG(x) x
 #define DBG(x)
 #define OUT printf
@@ -32,12 +40,67 @@ namespace BPrivate {
 namespace Storage {
 namespace Mime {
 
+static const int32 kMaxWorkers = 8;
+
+
 /*!	\class MimeUpdateThread
 	\brief RegistrarThread class implementing the common functionality of
 	update_mime_info() and create_app_meta_mime()
+
+	Recursive updates are done by a pool of worker threads. Each of them
+	has its own queue of directories still to be read; it adds the
+	subdirectories it finds to the end of its own queue, and takes its work
+	from there as well, so that it stays close to the directories it has
+	just visited. A worker that runs out of work takes the oldest directory
+	from the queue of another worker.
+
+	Only the directory walk and the attribute I/O run in parallel, though:
+	the files are still sniffed one after the other by the registrar's MIME
+	manager looper, since the sniffer rules aren't safe to use from several
+	threads at once. Trees with many files that have to be sniffed are
+	therefore not updated much faster than before.
+
+	The directories whose subtree has been updated completely are recorded
+	in a MimeUpdateCheckpoint. When an update of the same tree has been
+	interrupted, the next one skips those directories. This is only done
+	for unforced updates: forced ones have been asked to look at every
+	file again.
 */
 
 
+struct MimeUpdateThread::directory {
+	directory(const entry_ref &ref, directory *parent)
+		:
+		ref(ref),
+		parent(parent),
+		pending(1)
+	{
+	}
+
+	entry_ref	ref;
+	directory	*parent;
+	vint32		pending;
+		// the directory itself, and each of its subdirectories that
+		// hasn't been completed yet
+};
+
+
+struct MimeUpdateThread::worker {
+	worker()
+		:
+		thread(NULL),
+		lock("mime update worker"),
+		id(-1)
+	{
+	}
+
+	MimeUpdateThread		*thread;
+	BLocker					lock;
+	std::deque<directory*>	queue;
+	thread_id				id;
+};
+
+
 /*! \brief Creates a new MimeUpdateThread object.
 
 	If \a replyee is non-NULL and construction succeeds, the MimeThreadObject
@@ -48,9 +111,10 @@ namespace Mime {
 	field detached from the registrar's	mime manager looper (though this is not verified).
 	The message will be	replied to at the end of the thread's execution.
 */
-MimeUpdateThread::MimeUpdateThread(const char *name, int32 priority,
-		Database *database, BMessenger managerMessenger, const entry_ref *root,
-		bool recursive, int32 force, BMessage *replyee)
+MimeUpdateThread::MimeUpdateThread(const char *name,
+		const char *checkpointName, int32 priority, Database *database,
+		BMessenger managerMessenger, const entry_ref *root, bool recursive,
+		int32 force, BMessage *replyee)
 	:
 	RegistrarThread(name, priority, managerMessenger),
 	fDatabase(database),
@@ -58,6 +122,15 @@ MimeUpdateThread::MimeUpdateThread(const char *name, int32 priority,
 	fRecursive(recursive),
 	fForce(force),
 	fReplyee(replyee),
+	fAttributeSupportLock("mime update attribute support"),
+	fWorkers(NULL),
+	fWorkerCount(0),
+	fWorkSemaphore(-1),
+	fDone(false),
+	fError(B_OK),
+	fErrorLock("mime update error"),
+	fCheckpointName(checkpointName),
+	fCheckpoint(NULL),
 	fStatus(root ? B_OK : B_BAD_VALUE)
 {
 }
@@ -103,7 +176,7 @@ MimeUpdateThread::ThreadFunction()
 	try {
 		// Do the updates
 		if (!err)
-			err = UpdateEntry(&fRoot);
+			err = UpdateTree();
 	} catch (...) {
 		err = B_ERROR;
 	}
@@ -149,6 +222,8 @@ MimeUpdateThread::ThreadFunction()
 bool
 MimeUpdateThread::DeviceSupportsAttributes(dev_t device)
 {
+	AutoLocker<BLocker> _(fAttributeSupportLock);
+
 	// See if an entry for this device already exists
 	std::list< std::pair<dev_t,bool> >::iterator i;
 	for (i = fAttributeSupportList.begin();
@@ -179,59 +254,300 @@ MimeUpdateThread::DeviceSupportsAttributes(dev_t device)
 	return result;		
 }
 
+// UpdateTree
+/*! \brief Updates the root entry and, if it is a directory and \c fRecursive
+	is true, all entries below it.
+*/
+status_t
+MimeUpdateThread::UpdateTree()
+{
+	status_t err = UpdateEntry(&fRoot);
+	if (err != B_OK || !fRecursive)
+		return err;
+
+	BDirectory rootDirectory;
+	if (rootDirectory.SetTo(&fRoot) != B_OK)
+		return B_OK;
+
+	directory *root = new(std::nothrow) directory(fRoot, NULL);
+	if (root == NULL)
+		return B_NO_MEMORY;
+
+	system_info info;
+	get_system_info(&info);
+	int32 workerCount = min_c(max_c(info.cpu_count, 1), kMaxWorkers);
+
+	thread_info threadInfo;
+	get_thread_info(find_thread(NULL), &threadInfo);
+
+	fWorkers = new(std::nothrow) worker[workerCount];
+	fWorkSemaphore = create_sem(0, "mime update work");
+	if (fWorkers == NULL || fWorkSemaphore < B_OK) {
+		delete root;
+		delete[] fWorkers;
+		fWorkers = NULL;
+		delete_sem(fWorkSemaphore);
+		return B_NO_MEMORY;
+	}
+	fWorkerCount = workerCount;
+
+	BPath rootPath;
+	if (fForce == B_UPDATE_MIME_INFO_NO_FORCE
+		&& rootPath.SetTo(&fRoot) == B_OK) {
+		fCheckpoint = new(std::nothrow) MimeUpdateCheckpoint(fCheckpointName,
+			rootPath.Path());
+		if (fCheckpoint != NULL && fCheckpoint->InitCheck() != B_OK) {
+			// another update of the same tree is running
+			delete fCheckpoint;
+			fCheckpoint = NULL;
+		}
+	}
+
+	fWorkers[0].queue.push_back(root);
+	release_sem(fWorkSemaphore);
+
+	// the first worker is this thread itself
+	for (int32 i = 0; i < fWorkerCount; i++) {
+		fWorkers[i].thread = this;
+		if (i == 0)
+			continue;
+
+		fWorkers[i].id = spawn_thread(&_WorkerEntry, "mime update worker",
+			threadInfo.priority, &fWorkers[i]);
+		if (fWorkers[i].id >= B_OK)
+			resume_thread(fWorkers[i].id);
+	}
+
+	_Work(&fWorkers[0]);
+
+	for (int32 i = 1; i < fWorkerCount; i++) {
+		if (fWorkers[i].id >= B_OK) {
+			status_t result;
+			wait_for_thread(fWorkers[i].id, &result);
+		}
+	}
+
+	// If we have been aborted, there are still directories left in the
+	// queues; they must be done before their parents can be deleted
+	for (int32 i = 0; i < fWorkerCount; i++) {
+		while (!fWorkers[i].queue.empty()) {
+			directory *dir = fWorkers[i].queue.back();
+			fWorkers[i].queue.pop_back();
+			_DirectoryDone(dir);
+		}
+	}
+
+	delete[] fWorkers;
+	fWorkers = NULL;
+	fWorkerCount = 0;
+	delete_sem(fWorkSemaphore);
+	fWorkSemaphore = -1;
+
+	if (fCheckpoint != NULL) {
+		if (fError == B_OK)
+			fCheckpoint->Remove();
+		else
+			fCheckpoint->Save();
+
+		delete fCheckpoint;
+		fCheckpoint = NULL;
+	}
+
+	return fError;
+}
+
 // UpdateEntry
-/*! \brief Updates the given entry and then recursively updates all the entry's child
-	entries	if the entry is a directory and \c fRecursive is true.
+/*! \brief Updates the given entry, unless it lives on a device that doesn't
+	support attributes.
 */
 status_t
 MimeUpdateThread::UpdateEntry(const entry_ref *ref)
 {
 	status_t err = ref ? B_OK : B_BAD_VALUE;
 	bool entryIsDir = false;
-	
+
 	// Look to see if we're being terminated
 	if (!err && fShouldExit)
 		err = B_CANCELED;
-		
+
 	// Before we update, make sure this entry lives on a device that supports
 	// attributes. If not, we skip it and any of its children for
 	// updates (we don't signal an error, however).
 
-//BPath path(ref);
-//printf("Updating '%s' (%s)... \n", path.Path(),
-//	(DeviceSupportsAttributes(ref->device) ? "yes" : "no"));
-
 	if (!err && (device_is_root_device(ref->device)
-				|| DeviceSupportsAttributes(ref->device))) {	
-		// Update this entry
-		if (!err) {
-			// R5 appears to ignore whether or not the update succeeds.
-			DoMimeUpdate(ref, &entryIsDir);
+				|| DeviceSupportsAttributes(ref->device))) {
+		// R5 appears to ignore whether or not the update succeeds.
+		DoMimeUpdate(ref, &entryIsDir);
+	}
+	return err;
+}
+
+status_t
+MimeUpdateThread::_WorkerEntry(void *data)
+{
+	worker *self = (worker*)data;
+	self->thread->_Work(self);
+	return B_OK;
+}
+
+//! The main loop of a worker thread
+void
+MimeUpdateThread::_Work(worker *self)
+{
+	while (true) {
+		status_t err;
+		do {
+			err = acquire_sem(fWorkSemaphore);
+		} while (err == B_INTERRUPTED);
+
+		if (err != B_OK || fDone)
+			return;
+
+		directory *dir = _NextDirectory(self);
+		if (dir == NULL)
+			continue;
+
+		err = fShouldExit ? B_CANCELED : _UpdateDirectory(self, dir);
+		if (err != B_OK)
+			_Abort(err);
+
+		_DirectoryDone(dir);
+	}
+}
+
+/*! \brief Returns the next directory to update, preferably the newest one
+	in the worker's own queue, otherwise the oldest one of another worker.
+
+	There is one directory in the queues for every time the work semaphore
+	has been released, so the caller will always find one.
+*/
+MimeUpdateThread::directory*
+MimeUpdateThread::_NextDirectory(worker *self)
+{
+	int32 index = self - fWorkers;
+	while (!fDone) {
+		for (int32 i = 0; i < fWorkerCount; i++) {
+			worker &victim = fWorkers[(index + i) % fWorkerCount];
+			AutoLocker<BLocker> _(victim.lock);
+			if (victim.queue.empty())
+				continue;
+
+			directory *dir;
+			if (&victim == self) {
+				dir = victim.queue.back();
+				victim.queue.pop_back();
+			} else {
+				dir = victim.queue.front();
+				victim.queue.pop_front();
+			}
+			return dir;
 		}
 
-		// If we're recursing and this is a directory, update
-		// each of the directory's children as well
-		if (!err && fRecursive && entryIsDir) {		
-			BDirectory dir;		
-			err = dir.SetTo(ref);
-			if (!err) {
-				entry_ref childRef;
-				while (!err) {
-					err = dir.GetNextRef(&childRef);
-					if (err) {
-						// If we've come to the end of the directory listing,
-						// it's not an error.
-						if (err == B_ENTRY_NOT_FOUND)
-						 	err = B_OK;
-						break;
-					} else {
-						err = UpdateEntry(&childRef);				
-					}			
-				}		
-			}			
+		// another worker acquired the semaphore, but hasn't yet taken its
+		// directory out of the queue
+		snooze(100);
+	}
+
+	return NULL;
+}
+
+/*! \brief Updates all entries of the given directory, and queues its
+	subdirectories.
+*/
+status_t
+MimeUpdateThread::_UpdateDirectory(worker *self, directory *dir)
+{
+	BDirectory listing;
+	status_t err = listing.SetTo(&dir->ref);
+	if (err != B_OK)
+		return err;
+
+	entry_ref childRef;
+	while ((err = listing.GetNextRef(&childRef)) == B_OK) {
+		if (fDone)
+			return B_OK;
+		if (fShouldExit)
+			return B_CANCELED;
+
+		if (!device_is_root_device(childRef.device)
+			&& !DeviceSupportsAttributes(childRef.device))
+			continue;
+
+		bool entryIsDir = false;
+		// R5 appears to ignore whether or not the update succeeds.
+		DoMimeUpdate(&childRef, &entryIsDir);
+
+		if (!entryIsDir || _IsCompleted(&childRef))
+			continue;
+
+		directory *child = new(std::nothrow) directory(childRef, dir);
+		if (child == NULL)
+			return B_NO_MEMORY;
+
+		atomic_add(&dir->pending, 1);
+
+		self->lock.Lock();
+		self->queue.push_back(child);
+		self->lock.Unlock();
+
+		release_sem_etc(fWorkSemaphore, 1, B_DO_NOT_RESCHEDULE);
+	}
+
+	// If we've come to the end of the directory listing, it's not an error.
+	return err == B_ENTRY_NOT_FOUND ? B_OK : err;
+}
+
+/*! \brief Marks the given directory as read, and deletes it and its parents
+	as far as their subtrees are complete.
+
+	When the root directory is done, the workers are told to exit.
+*/
+void
+MimeUpdateThread::_DirectoryDone(directory *dir)
+{
+	while (dir != NULL && atomic_add(&dir->pending, -1) == 1) {
+		directory *parent = dir->parent;
+
+		if (fError == B_OK && fCheckpoint != NULL) {
+			BPath path;
+			if (path.SetTo(&dir->ref) == B_OK)
+				fCheckpoint->SetCompleted(path.Path());
 		}
+
+		if (parent == NULL) {
+			fDone = true;
+			release_sem_etc(fWorkSemaphore, fWorkerCount, 0);
+		}
+
+		delete dir;
+		dir = parent;
 	}
-	return err;			  
+}
+
+//! Stops all workers; the first error is the one that is reported.
+void
+MimeUpdateThread::_Abort(status_t error)
+{
+	AutoLocker<BLocker> _(fErrorLock);
+
+	if (fError == B_OK)
+		fError = error;
+
+	if (!fDone) {
+		fDone = true;
+		release_sem_etc(fWorkSemaphore, fWorkerCount, 0);
+	}
+}
+
+/*! \brief Returns whether the given directory has already been completed by
+	an earlier, interrupted update.
+*/
+bool
+MimeUpdateThread::_IsCompleted(const entry_ref *ref)
+{
+	BPath path;
+	return fCheckpoint != NULL && path.SetTo(ref) == B_OK
+		&& fCheckpoint->IsCompleted(path.Path());
 }
 
 }	// namespace Mime
@@ -11,6 +11,7 @@
 #define _MIME_UPDATE_THREAD_H
 
 #include <Entry.h>
+#include <Locker.h>
 #include <SupportDefs.h>
 
 #include <list>
@@ -26,12 +27,14 @@ namespace Storage {
 namespace Mime {
 
 class Database;
+class MimeUpdateCheckpoint;
 
 class MimeUpdateThread : public RegistrarThread {
 public:
-	MimeUpdateThread(const char *name, int32 priority, Database *database,
-		BMessenger managerMessenger, const entry_ref *root, bool recursive,
-		int32 force, BMessage *replyee);
+	MimeUpdateThread(const char *name, const char *checkpointName,
+		int32 priority, Database *database, BMessenger managerMessenger,
+		const entry_ref *root, bool recursive, int32 force,
+		BMessage *replyee);
 	virtual ~MimeUpdateThread();
 	
 	virtual status_t InitCheck();	
@@ -49,10 +52,34 @@ protected:
 	bool DeviceSupportsAttributes(dev_t device);
 
 private:
-	std::list< std::pair<dev_t, bool> > fAttributeSupportList;
+	struct directory;
+	struct worker;
 
 	status_t UpdateEntry(const entry_ref *ref);
-	
+	status_t UpdateTree();
+
+	static status_t _WorkerEntry(void *data);
+	void _Work(worker *self);
+	directory* _NextDirectory(worker *self);
+	status_t _UpdateDirectory(worker *self, directory *dir);
+	void _DirectoryDone(directory *dir);
+	void _Abort(status_t error);
+
+	bool _IsCompleted(const entry_ref *ref);
+
+	BLocker fAttributeSupportLock;
+	std::list< std::pair<dev_t, bool> > fAttributeSupportList;
+
+	worker *fWorkers;
+	int32 fWorkerCount;
+	sem_id fWorkSemaphore;
+	volatile bool fDone;
+	status_t fError;
+	BLocker fErrorLock;
+
+	const char *fCheckpointName;
+	MimeUpdateCheckpoint *fCheckpoint;
+
 	status_t fStatus;
 };
 
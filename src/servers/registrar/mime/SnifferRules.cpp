@@ -1,5 +1,5 @@
 /*
- * Copyright 2002-2006, Haiku Inc.
+ * Copyright 2002-2010, Haiku Inc.
  * Distributed under the terms of the MIT License.
  *
  * Authors:
@@ -112,7 +112,8 @@ bool operator<(SnifferRules::sniffer_rule &left, SnifferRules::sniffer_rule &rig
 // Constructor
 //! Constructs a new SnifferRules object
 SnifferRules::SnifferRules()
-	: fHaveDoneFullBuild(false)
+	: fHaveDoneFullBuild(false),
+	  fMatcherNeedsUpdate(true)
 {
 }
 
@@ -264,6 +265,8 @@ SnifferRules::SetSnifferRule(const char *type, const char *rule)
 		}
 		if (i == fRuleList.end())
 			fRuleList.push_back(item);
+
+		fMatcherNeedsUpdate = true;
 	}
 
 	return err;
@@ -290,6 +293,7 @@ SnifferRules::DeleteSnifferRule(const char *type)
 	{
 		if (i->type == type) {
 			fRuleList.erase(i);
+			fMatcherNeedsUpdate = true;
 			break;
 		}
 	}
@@ -407,6 +411,7 @@ SnifferRules::BuildRuleList()
 		fRuleList.sort();
 		fMaxBytesNeeded = maxBytesNeeded;
 		fHaveDoneFullBuild = true;
+		fMatcherNeedsUpdate = true;
 //		PrintToStream();
 	} else
 		DBG(OUT("Mime::SnifferRules::BuildRuleList() failed, error code == 0x%lx\n", err));
@@ -441,9 +446,6 @@ SnifferRules::GuessMimeType(BFile* file, const void *buffer, int32 length,
 	if (err)
 		return err;
 
-	// wrap the buffer by a BMemoryIO
-	BMemoryIO data(buffer, length);
-
 	if (!err && !fHaveDoneFullBuild)
 		err = BuildRuleList();
 
@@ -458,32 +460,23 @@ SnifferRules::GuessMimeType(BFile* file, const void *buffer, int32 length,
 		}
 	}
 
-	if (!err) {
-		// Run through our rule list, which is sorted in order of
-		// descreasing priority, and see if one of the rules sniffs
-		// out a match
-		for (std::list<sniffer_rule>::const_iterator i = fRuleList.begin();
-			   i != fRuleList.end();
-			     i++)
-		{
-			if (i->rule) {
-				// If an add-on identified the type with a priority at least
-				// as great as the remaining rules, we can stop further
-				// processing and return the type found by the add-on.
-				if (i->rule->Priority() <= addonPriority) {
-					*type = mimeType.Type();
-					return B_OK;
-				}
+	if (!err && fMatcherNeedsUpdate)
+		err = UpdateMatcher();
 
-				if (i->rule->Sniff(&data)) {
-					type->SetTo(i->type.c_str());
-					return B_OK;
-				}
-			} else {
-				DBG(OUT("WARNING: Mime::SnifferRules::GuessMimeType(BPositionIO*,BString*): "
-					"NULL sniffer_rule::rule member found in rule list for type == '%s', "
-					"rule_string == '%s'\n",
-					i->type.c_str(), i->rule_string.c_str()));
+	if (!err) {
+		// Find the first rule in our rule list, which is sorted in order
+		// of decreasing priority, that sniffs out a match. All rules are
+		// checked in a single pass over the data.
+		int32 index = fMatcher.Match(buffer, length);
+		if (index >= 0) {
+			const sniffer_rule* rule = fMatcherRules[index];
+
+			// If an add-on identified the type with a priority at least
+			// as great as the matching rule, the type found by the add-on
+			// is returned instead.
+			if (rule->rule->Priority() > addonPriority) {
+				type->SetTo(rule->type.c_str());
+				return B_OK;
 			}
 		}
 
@@ -580,6 +573,45 @@ SnifferRules::ProcessType(const char *type, ssize_t *bytesNeeded)
 	return err;
 }
 
+// UpdateMatcher
+/*! \brief Compiles the current rule list into the matcher used by
+	GuessMimeType().
+
+	\return
+	- \c B_OK: success
+	- \c other error code: failure
+*/
+status_t
+SnifferRules::UpdateMatcher()
+{
+	fMatcher.MakeEmpty();
+	fMatcherRules.clear();
+
+	for (std::list<sniffer_rule>::const_iterator i = fRuleList.begin();
+		   i != fRuleList.end();
+		     i++)
+	{
+		if (!i->rule) {
+			DBG(OUT("WARNING: Mime::SnifferRules::UpdateMatcher(): "
+				"NULL sniffer_rule::rule member found in rule list for type == '%s', "
+				"rule_string == '%s'\n",
+				i->type.c_str(), i->rule_string.c_str()));
+			continue;
+		}
+
+		status_t err = fMatcher.AddRule(i->rule);
+		if (err != B_OK)
+			return err;
+
+		fMatcherRules.push_back(&*i);
+	}
+
+	status_t err = fMatcher.Compile();
+	if (!err)
+		fMatcherNeedsUpdate = false;
+	return err;
+}
+
 } // namespace Mime
 } // namespace Storage
 } // namespace BPrivate
@@ -1,5 +1,5 @@
 /*
- * Copyright 2002-2007, Haiku, Inc. All Rights Reserved.
+ * Copyright 2002-2010, Haiku, Inc. All Rights Reserved.
  * Distributed under the terms of the MIT License.
  */
 #ifndef _MIME_SNIFFER_RULES_H
@@ -10,6 +10,9 @@
 
 #include <list>
 #include <string>
+#include <vector>
+
+#include <sniffer/Matcher.h>
 
 class BFile;
 class BString;
@@ -52,10 +55,16 @@ private:
 		BString *type);
 	ssize_t MaxBytesNeeded();
 	status_t ProcessType(const char *type, ssize_t *bytesNeeded);
+	status_t UpdateMatcher();
 
 	std::list<sniffer_rule> fRuleList;
 	ssize_t fMaxBytesNeeded;
 	bool fHaveDoneFullBuild;
+
+	BPrivate::Storage::Sniffer::Matcher fMatcher;
+	std::vector<const sniffer_rule*> fMatcherRules;
+		// the rules in the order they have been added to fMatcher
+	bool fMatcherNeedsUpdate;
 };
 
 } // namespace Mime
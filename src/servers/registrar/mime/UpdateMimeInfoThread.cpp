@@ -11,6 +11,7 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
 
 #include <AppFileInfo.h>
 #include <Bitmap.h>
@@ -25,6 +26,49 @@ namespace Storage {
 namespace Mime {
 
 static const char *kAppFlagsAttribute			= "BEOS:APP_FLAGS";
+static const char *kUpdateStampAttribute		= "BEOS:MIME_INFO_STAMP";
+
+/*!	Stored with every file that has been updated. A forced update that
+	keeps the type skips the files whose size and modification time still
+	match their stamp, if they have been updated with at least the same
+	force level before.
+*/
+struct update_stamp {
+	int64	modification_time;
+	int64	size;
+	int32	force;
+};
+
+// has_current_update_stamp
+static bool
+has_current_update_stamp(BNode &node, const struct stat &st, int32 force)
+{
+	update_stamp stamp;
+	if (node.ReadAttr(kUpdateStampAttribute, B_RAW_TYPE, 0, &stamp,
+			sizeof(stamp)) != sizeof(stamp))
+		return false;
+
+	return stamp.modification_time == (int64)st.st_mtim.tv_sec * 1000000000LL
+			+ st.st_mtim.tv_nsec
+		&& stamp.size == st.st_size && stamp.force >= force;
+}
+
+// write_update_stamp
+static void
+write_update_stamp(BNode &node, int32 force)
+{
+	struct stat st;
+	if (node.GetStat(&st) != B_OK)
+		return;
+
+	update_stamp stamp;
+	stamp.modification_time = (int64)st.st_mtim.tv_sec * 1000000000LL
+		+ st.st_mtim.tv_nsec;
+	stamp.size = st.st_size;
+	stamp.force = force;
+	node.WriteAttr(kUpdateStampAttribute, B_RAW_TYPE, 0, &stamp,
+		sizeof(stamp));
+}
 
 // update_icon
 static status_t
@@ -71,8 +115,8 @@ is_shared_object_mime_type(BMimeType &type)
 UpdateMimeInfoThread::UpdateMimeInfoThread(const char *name, int32 priority,
 	Database *database, BMessenger managerMessenger, const entry_ref *root,
 	bool recursive, int32 force, BMessage *replyee)
-	: MimeUpdateThread(name, priority, database, managerMessenger, root,
-		recursive, force, replyee)
+	: MimeUpdateThread(name, "UpdateMimeInfoCheckpoint", priority, database,
+		managerMessenger, root, recursive, force, replyee)
 {
 }
 
@@ -81,6 +125,8 @@ UpdateMimeInfoThread::UpdateMimeInfoThread(const char *name, int32 priority,
 
 	If the entry has no \c BEOS:TYPE attribute, or if \c fForce is true, the
 	entry is sniffed and its \c BEOS:TYPE attribute is set accordingly.
+	With \c B_UPDATE_MIME_INFO_FORCE_KEEP_TYPE, files that haven't changed
+	since they have last been updated that way are skipped.
 */
 status_t
 UpdateMimeInfoThread::DoMimeUpdate(const entry_ref *entry, bool *entryIsDir)
@@ -94,6 +140,13 @@ UpdateMimeInfoThread::DoMimeUpdate(const entry_ref *entry, bool *entryIsDir)
 		err = node.SetTo(entry);
 	if (!err && entryIsDir)
 		*entryIsDir = node.IsDirectory();
+
+	struct stat st;
+	bool isFile = !err && node.GetStat(&st) == B_OK && S_ISREG(st.st_mode);
+	if (isFile && fForce == B_UPDATE_MIME_INFO_FORCE_KEEP_TYPE
+		&& has_current_update_stamp(node, st, fForce))
+		return B_OK;
+
 	if (!err) {
 		// If not forced, only update if the entry has no file type attribute
 		attr_info info;
@@ -240,6 +293,9 @@ UpdateMimeInfoThread::DoMimeUpdate(const entry_ref *entry, bool *entryIsDir)
 		}
 	}
 
+	if (!err && isFile && (updateType || updateAppInfo))
+		write_update_stamp(node, fForce);
+
 	return err;
 }
 
@@ -22,7 +22,7 @@
 #include <util/kernel_cpp.h>
 #include <util/DoublyLinkedList.h>
 #include <util/AutoLock.h>
-#include <util/khash.h>
+#include <util/ProbingHashTable.h>
 #include <vm/vm_page.h>
 
 #include "kernel_debug_config.h"
@@ -55,7 +55,6 @@ struct block_cache;
 typedef DoublyLinkedListLink<cached_block> block_link;
 
 struct cached_block {
-	cached_block*	next;			// next in hash
 	cached_block*	transaction_next;
 	block_link		link;
 	off_t			block_number;
@@ -84,14 +83,50 @@ struct cached_block {
 	int32 LastAccess() const
 		{ return system_time() / 1000000L - last_accessed; }
 
-	static int Compare(void* _cacheEntry, const void* _block);
-	static uint32 Hash(void* _cacheEntry, const void* _block, uint32 range);
 };
 
 typedef DoublyLinkedList<cached_block,
 	DoublyLinkedListMemberGetLink<cached_block,
 		&cached_block::link> > block_list;
 
+struct BlockHashDefinition {
+	typedef off_t			KeyType;
+	typedef cached_block	ValueType;
+
+	size_t HashKey(off_t key) const
+	{
+		return (size_t)(key ^ (key >> 32));
+	}
+
+	size_t Hash(cached_block* block) const
+	{
+		return HashKey(block->block_number);
+	}
+
+	bool Compare(off_t key, cached_block* block) const
+	{
+		return block->block_number == key;
+	}
+};
+
+typedef BProbingHashTable<BlockHashDefinition> BlockTable;
+
+struct TransactionHashDefinition {
+	typedef int32				KeyType;
+	typedef cache_transaction	ValueType;
+
+	size_t HashKey(int32 key) const
+	{
+		return key;
+	}
+
+	size_t Hash(cache_transaction* transaction) const;
+	bool Compare(int32 key, cache_transaction* transaction) const;
+};
+
+typedef BProbingHashTable<TransactionHashDefinition> TransactionTable;
+typedef TransactionTable::Iterator TransactionIterator;
+
 struct cache_notification : DoublyLinkedListLinkImpl<cache_notification> {
 	int32			transaction_id;
 	int32			events_pending;
@@ -104,14 +139,14 @@ struct cache_notification : DoublyLinkedListLinkImpl<cache_notification> {
 typedef DoublyLinkedList<cache_notification> NotificationList;
 
 struct block_cache : DoublyLinkedListLinkImpl<block_cache> {
-	hash_table*		hash;
+	BlockTable		hash;
 	mutex			lock;
 	int				fd;
 	off_t			max_blocks;
 	size_t			block_size;
 	int32			next_transaction_id;
 	cache_transaction* last_transaction;
-	hash_table*		transaction_hash;
+	TransactionTable transaction_hash;
 
 	object_cache*	buffer_cache;
 	block_list		unused_blocks;
@@ -167,7 +202,6 @@ typedef DoublyLinkedList<cache_listener,
 struct cache_transaction {
 	cache_transaction();
 
-	cache_transaction* next;
 	int32			id;
 	int32			num_blocks;
 	int32			main_num_blocks;
@@ -182,6 +216,21 @@ struct cache_transaction {
 };
 
 
+inline size_t
+TransactionHashDefinition::Hash(cache_transaction* transaction) const
+{
+	return HashKey(transaction->id);
+}
+
+
+inline bool
+TransactionHashDefinition::Compare(int32 key,
+	cache_transaction* transaction) const
+{
+	return transaction->id == key;
+}
+
+
 class BlockWriter {
 public:
 								BlockWriter(block_cache* cache,
@@ -189,12 +238,12 @@ public:
 								~BlockWriter();
 
 			bool				Add(cached_block* block,
-									hash_iterator* iterator = NULL);
+									TransactionIterator* iterator = NULL);
 			bool				Add(cache_transaction* transaction,
-									hash_iterator* iterator,
+									TransactionIterator* iterator,
 									bool& hasLeftOvers);
 
-			status_t			Write(hash_iterator* iterator = NULL,
+			status_t			Write(TransactionIterator* iterator = NULL,
 									bool canUnlock = true);
 
 			bool				DeletedTransaction() const
@@ -207,7 +256,7 @@ private:
 			void*				_Data(cached_block* block) const;
 			status_t			_WriteBlock(cached_block* block);
 			void				_BlockDone(cached_block* block,
-									hash_iterator* iterator);
+									TransactionIterator* iterator);
 			void				_UnmarkWriting(cached_block* block);
 
 private:
@@ -918,29 +967,6 @@ cache_transaction::cache_transaction()
 }
 
 
-static int
-transaction_compare(void* _transaction, const void* _id)
-{
-	cache_transaction* transaction = (cache_transaction*)_transaction;
-	const int32* id = (const int32*)_id;
-
-	return transaction->id - *id;
-}
-
-
-static uint32
-transaction_hash(void* _transaction, const void* _id, uint32 range)
-{
-	cache_transaction* transaction = (cache_transaction*)_transaction;
-	const int32* id = (const int32*)_id;
-
-	if (transaction != NULL)
-		return transaction->id % range;
-
-	return (uint32)*id % range;
-}
-
-
 static void
 delete_transaction(block_cache* cache, cache_transaction* transaction)
 {
@@ -955,7 +981,7 @@ delete_transaction(block_cache* cache, cache_transaction* transaction)
 static cache_transaction*
 lookup_transaction(block_cache* cache, int32 id)
 {
-	return (cache_transaction*)hash_lookup(cache->transaction_hash, &id);
+	return cache->transaction_hash.Lookup(id);
 }
 
 
@@ -985,33 +1011,6 @@ cached_block::CanBeWritten() const
 }
 
 
-/*static*/ int
-cached_block::Compare(void* _cacheEntry, const void* _block)
-{
-	cached_block* cacheEntry = (cached_block*)_cacheEntry;
-	const off_t* block = (const off_t*)_block;
-
-	off_t diff = cacheEntry->block_number - *block;
-	if (diff > 0)
-		return 1;
-
-	return diff < 0 ? -1 : 0;
-}
-
-
-/*static*/ uint32
-cached_block::Hash(void* _cacheEntry, const void* _block, uint32 range)
-{
-	cached_block* cacheEntry = (cached_block*)_cacheEntry;
-	const off_t* block = (const off_t*)_block;
-
-	if (cacheEntry != NULL)
-		return cacheEntry->block_number % range;
-
-	return (uint64)*block % range;
-}
-
-
 //	#pragma mark - BlockWriter
 
 
@@ -1040,7 +1039,7 @@ BlockWriter::~BlockWriter()
 	be added, false is returned, otherwise true.
 */
 bool
-BlockWriter::Add(cached_block* block, hash_iterator* iterator)
+BlockWriter::Add(cached_block* block, TransactionIterator* iterator)
 {
 	ASSERT(block->CanBeWritten());
 
@@ -1086,8 +1085,8 @@ BlockWriter::Add(cached_block* block, hash_iterator* iterator)
 	If no more blocks can be added, false is returned, otherwise true.
 */
 bool
-BlockWriter::Add(cache_transaction* transaction, hash_iterator* iterator,
-	bool& hasLeftOvers)
+BlockWriter::Add(cache_transaction* transaction,
+	TransactionIterator* iterator, bool& hasLeftOvers)
 {
 	ASSERT(!transaction->open);
 
@@ -1121,7 +1120,7 @@ BlockWriter::Add(cache_transaction* transaction, hash_iterator* iterator,
 	while the blocks are written back.
 */
 status_t
-BlockWriter::Write(hash_iterator* iterator, bool canUnlock)
+BlockWriter::Write(TransactionIterator* iterator, bool canUnlock)
 {
 	if (fCount == 0)
 		return B_OK;
@@ -1213,7 +1212,7 @@ BlockWriter::_WriteBlock(cached_block* block)
 
 
 void
-BlockWriter::_BlockDone(cached_block* block, hash_iterator* iterator)
+BlockWriter::_BlockDone(cached_block* block, TransactionIterator* iterator)
 {
 	if (block == NULL) {
 		// An error occured when trying to write this block
@@ -1249,9 +1248,9 @@ BlockWriter::_BlockDone(cached_block* block, hash_iterator* iterator)
 				TRANSACTION_WRITTEN);
 
 			if (iterator != NULL)
-				hash_remove_current(fCache->transaction_hash, iterator);
+				fCache->transaction_hash.RemoveCurrent(*iterator);
 			else
-				hash_remove(fCache->transaction_hash, previous);
+				fCache->transaction_hash.Remove(previous);
 
 			delete_transaction(fCache, previous);
 			fDeletedTransaction = true;
@@ -1291,13 +1290,11 @@ BlockWriter::_UnmarkWriting(cached_block* block)
 block_cache::block_cache(int _fd, off_t numBlocks, size_t blockSize,
 		bool readOnly)
 	:
-	hash(NULL),
 	fd(_fd),
 	max_blocks(numBlocks),
 	block_size(blockSize),
 	next_transaction_id(1),
 	last_transaction(NULL),
-	transaction_hash(NULL),
 	buffer_cache(NULL),
 	unused_block_count(0),
 	busy_reading_count(0),
@@ -1315,9 +1312,6 @@ block_cache::~block_cache()
 {
 	unregister_low_resource_handler(&_LowMemoryHandler, this);
 
-	hash_uninit(transaction_hash);
-	hash_uninit(hash);
-
 	delete_object_cache(buffer_cache);
 
 	mutex_destroy(&lock);
@@ -1337,16 +1331,7 @@ block_cache::Init()
 	if (buffer_cache == NULL)
 		return B_NO_MEMORY;
 
-	cached_block dummyBlock;
-	hash = hash_init(1024, offset_of_member(dummyBlock, next),
-		&cached_block::Compare, &cached_block::Hash);
-	if (hash == NULL)
-		return B_NO_MEMORY;
-
-	cache_transaction dummyTransaction;
-	transaction_hash = hash_init(16, offset_of_member(dummyTransaction, next),
-		&transaction_compare, &::transaction_hash);
-	if (transaction_hash == NULL)
+	if (hash.Init(1024) != B_OK || transaction_hash.Init(16) != B_OK)
 		return B_NO_MEMORY;
 
 	return register_low_resource_handler(&_LowMemoryHandler, this,
@@ -1492,7 +1477,7 @@ block_cache::RemoveUnusedBlocks(int32 count, int32 minSecondsOld)
 void
 block_cache::RemoveBlock(cached_block* block)
 {
-	hash_remove(hash, block);
+	hash.Remove(block);
 	FreeBlock(block);
 }
 
@@ -1582,7 +1567,7 @@ block_cache::_GetUnusedBlock()
 		// remove block from lists
 		iterator.Remove();
 		unused_block_count--;
-		hash_remove(hash, block);
+		hash.Remove(block);
 
 		// TODO: see if parent/compare data is handled correctly here!
 		if (block->parent_data != NULL
@@ -1768,7 +1753,7 @@ put_cached_block(block_cache* cache, off_t blockNumber)
 			blockNumber, cache->max_blocks - 1);
 	}
 
-	cached_block* block = (cached_block*)hash_lookup(cache->hash, &blockNumber);
+	cached_block* block = cache->hash.Lookup(blockNumber);
 	if (block != NULL)
 		put_cached_block(cache, block);
 	else {
@@ -1801,8 +1786,7 @@ get_cached_block(block_cache* cache, off_t blockNumber, bool* _allocated,
 	}
 
 retry:
-	cached_block* block = (cached_block*)hash_lookup(cache->hash,
-		&blockNumber);
+	cached_block* block = cache->hash.Lookup(blockNumber);
 	*_allocated = false;
 
 	if (block == NULL) {
@@ -1811,7 +1795,7 @@ retry:
 		if (block == NULL)
 			return NULL;
 
-		hash_insert_grow(cache->hash, block);
+		cache->hash.Insert(block);
 		*_allocated = true;
 	} else if (block->busy_reading) {
 		// The block is currently busy_reading - wait and try again later
@@ -2122,8 +2106,7 @@ dump_cache(int argc, char** argv)
 	off_t blockNumber = -1;
 	if (i + 1 < argc) {
 		blockNumber = parse_expression(argv[i + 1]);
-		cached_block* block = (cached_block*)hash_lookup(cache->hash,
-			&blockNumber);
+		cached_block* block = cache->hash.Lookup(blockNumber);
 		if (block != NULL)
 			dump_block_long(block);
 		else
@@ -2161,12 +2144,10 @@ dump_cache(int argc, char** argv)
 		kprintf(" transactions:\n");
 		kprintf("address       id state  blocks  main   sub\n");
 
-		hash_iterator iterator;
-		hash_open(cache->transaction_hash, &iterator);
+		TransactionIterator iterator = cache->transaction_hash.GetIterator();
 
 		cache_transaction* transaction;
-		while ((transaction = (cache_transaction*)hash_next(
-				cache->transaction_hash, &iterator)) != NULL) {
+		while ((transaction = iterator.Next()) != NULL) {
 			kprintf("%p %5ld %-7s %5ld %5ld %5ld\n", transaction,
 				transaction->id, transaction->open ? "open" : "closed",
 				transaction->num_blocks, transaction->main_num_blocks,
@@ -2184,10 +2165,9 @@ dump_cache(int argc, char** argv)
 	uint32 count = 0;
 	uint32 dirty = 0;
 	uint32 discarded = 0;
-	hash_iterator iterator;
-	hash_open(cache->hash, &iterator);
+	BlockTable::Iterator iterator = cache->hash.GetIterator();
 	cached_block* block;
-	while ((block = (cached_block*)hash_next(cache->hash, &iterator)) != NULL) {
+	while ((block = iterator.Next()) != NULL) {
 		if (showBlocks)
 			dump_block(block);
 
@@ -2204,7 +2184,6 @@ dump_cache(int argc, char** argv)
 		"busy, %" B_PRIu32 " in unused.\n", count, dirty, discarded, referenced,
 		cache->busy_reading_count, cache->unused_block_count);
 
-	hash_close(cache->hash, &iterator, false);
 	return 0;
 }
 
@@ -2476,24 +2455,19 @@ block_notifier_and_writer(void* /*data*/)
 			if (cache->num_dirty_blocks) {
 				// This cache is not using transactions, we'll scan the blocks
 				// directly
-				hash_iterator iterator;
-				hash_open(cache->hash, &iterator);
+				BlockTable::Iterator iterator = cache->hash.GetIterator();
 
 				cached_block* block;
-				while ((block = (cached_block*)hash_next(cache->hash, &iterator))
-						!= NULL) {
+				while ((block = iterator.Next()) != NULL) {
 					if (block->CanBeWritten() && !writer.Add(block))
 						break;
 				}
-
-				hash_close(cache->hash, &iterator, false);
 			} else {
-				hash_iterator iterator;
-				hash_open(cache->transaction_hash, &iterator);
+				TransactionIterator iterator
+					= cache->transaction_hash.GetIterator();
 
 				cache_transaction* transaction;
-				while ((transaction = (cache_transaction*)hash_next(
-						cache->transaction_hash, &iterator)) != NULL) {
+				while ((transaction = iterator.Next()) != NULL) {
 					if (transaction->open) {
 						if (system_time() > transaction->last_used
 								+ kTransactionIdleTime) {
@@ -2509,8 +2483,6 @@ block_notifier_and_writer(void* /*data*/)
 					if (!writer.Add(transaction, &iterator, hasLeftOvers))
 						break;
 				}
-
-				hash_close(cache->transaction_hash, &iterator, false);
 			}
 
 			writer.Write();
@@ -2676,7 +2648,7 @@ cache_start_transaction(void* _cache)
 	TRACE(("cache_start_transaction(): id %ld started\n", transaction->id));
 	T(Action("start", cache, transaction));
 
-	hash_insert_grow(cache->transaction_hash, transaction);
+	cache->transaction_hash.Insert(transaction);
 
 	return transaction->id;
 }
@@ -2695,12 +2667,10 @@ cache_sync_transaction(void* _cache, int32 id)
 		hadBusy = false;
 
 		BlockWriter writer(cache);
-		hash_iterator iterator;
-		hash_open(cache->transaction_hash, &iterator);
+		TransactionIterator iterator = cache->transaction_hash.GetIterator();
 
 		cache_transaction* transaction;
-		while ((transaction = (cache_transaction*)hash_next(
-				cache->transaction_hash, &iterator)) != NULL) {
+		while ((transaction = iterator.Next()) != NULL) {
 			// close all earlier transactions which haven't been closed yet
 
 			if (transaction->busy_writing_count != 0) {
@@ -2722,8 +2692,6 @@ cache_sync_transaction(void* _cache, int32 id)
 			}
 		}
 
-		hash_close(cache->transaction_hash, &iterator, false);
-
 		status_t status = writer.Write();
 		if (status != B_OK)
 			return status;
@@ -2854,7 +2822,7 @@ cache_abort_transaction(void* _cache, int32 id)
 		block->discard = false;
 	}
 
-	hash_remove(cache->transaction_hash, transaction);
+	cache->transaction_hash.Remove(transaction);
 	delete_transaction(cache, transaction);
 	return B_OK;
 }
@@ -2961,7 +2929,7 @@ cache_detach_sub_transaction(void* _cache, int32 id,
 	transaction->num_blocks = transaction->main_num_blocks;
 	transaction->sub_num_blocks = 0;
 
-	hash_insert_grow(cache->transaction_hash, newTransaction);
+	cache->transaction_hash.Insert(newTransaction);
 	cache->last_transaction = newTransaction;
 
 	return newTransaction->id;
@@ -3246,19 +3214,18 @@ block_cache_delete(void* _cache, bool allowWrites)
 
 	// free all blocks
 
-	uint32 cookie = 0;
-	cached_block* block;
-	while ((block = (cached_block*)hash_remove_first(cache->hash,
-			&cookie)) != NULL) {
+	BlockTable::Iterator blockIterator = cache->hash.GetIterator();
+	while (cached_block* block = blockIterator.Next()) {
+		cache->hash.RemoveCurrent(blockIterator);
 		cache->FreeBlock(block);
 	}
 
 	// free all transactions (they will all be aborted)
 
-	cookie = 0;
-	cache_transaction* transaction;
-	while ((transaction = (cache_transaction*)hash_remove_first(
-			cache->transaction_hash, &cookie)) != NULL) {
+	TransactionTable::Iterator transactionIterator
+		= cache->transaction_hash.GetIterator();
+	while (cache_transaction* transaction = transactionIterator.Next()) {
+		cache->transaction_hash.RemoveCurrent(transactionIterator);
 		delete transaction;
 	}
 
@@ -3297,17 +3264,14 @@ block_cache_sync(void* _cache)
 	MutexLocker locker(&cache->lock);
 
 	BlockWriter writer(cache);
-	hash_iterator iterator;
-	hash_open(cache->hash, &iterator);
+	BlockTable::Iterator iterator = cache->hash.GetIterator();
 
 	cached_block* block;
-	while ((block = (cached_block*)hash_next(cache->hash, &iterator)) != NULL) {
+	while ((block = iterator.Next()) != NULL) {
 		if (block->CanBeWritten())
 			writer.Add(block);
 	}
 
-	hash_close(cache->hash, &iterator, false);
-
 	status_t status = writer.Write();
 
 	locker.Unlock();
@@ -3337,8 +3301,7 @@ block_cache_sync_etc(void* _cache, off_t blockNumber, size_t numBlocks)
 	BlockWriter writer(cache);
 
 	for (; numBlocks > 0; numBlocks--, blockNumber++) {
-		cached_block* block = (cached_block*)hash_lookup(cache->hash,
-			&blockNumber);
+		cached_block* block = cache->hash.Lookup(blockNumber);
 		if (block == NULL)
 			continue;
 
@@ -3366,8 +3329,7 @@ block_cache_discard(void* _cache, off_t blockNumber, size_t numBlocks)
 	BlockWriter writer(cache);
 
 	for (; numBlocks > 0; numBlocks--, blockNumber++) {
-		cached_block* block = (cached_block*)hash_lookup(cache->hash,
-			&blockNumber);
+		cached_block* block = cache->hash.Lookup(blockNumber);
 		if (block != NULL && block->previous_transaction != NULL)
 			writer.Add(block);
 	}
@@ -3376,8 +3338,7 @@ block_cache_discard(void* _cache, off_t blockNumber, size_t numBlocks)
 		// TODO: this can fail, too!
 
 	for (; numBlocks > 0; numBlocks--, blockNumber++) {
-		cached_block* block = (cached_block*)hash_lookup(cache->hash,
-			&blockNumber);
+		cached_block* block = cache->hash.Lookup(blockNumber);
 		if (block == NULL)
 			continue;
 
@@ -3509,8 +3470,7 @@ block_cache_set_dirty(void* _cache, off_t blockNumber, bool dirty,
 	block_cache* cache = (block_cache*)_cache;
 	MutexLocker locker(&cache->lock);
 
-	cached_block* block = (cached_block*)hash_lookup(cache->hash,
-		&blockNumber);
+	cached_block* block = cache->hash.Lookup(blockNumber);
 	if (block == NULL)
 		return B_BAD_VALUE;
 	if (block->is_dirty == dirty) {
@@ -24,7 +24,6 @@ typedef struct vnode Vnode;
 
 
 struct vnode : fs_vnode, DoublyLinkedListLinkImpl<vnode> {
-			struct vnode*		next;
 			VMCache*			cache;
 			struct fs_mount*	mount;
 			struct vnode*		covered_by;
@@ -10,14 +10,17 @@
 
 #include <stddef.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <AppDefs.h>
+#include <KernelExport.h>
 #include <NodeMonitor.h>
 
 #include <fd.h>
 #include <khash.h>
 #include <lock.h>
 #include <messaging.h>
+#include <node_monitor_defs.h>
 #include <Notifications.h>
 #include <vfs.h>
 #include <util/AutoLock.h>
@@ -65,6 +68,34 @@ struct interested_monitor_listener_list {
 	uint32				flags;
 };
 
+static const int32 kMaxBatchedEvents = 256;
+static const int32 kMaxBatchSize = 32 * 1024;
+	// a batch is delivered right away when it gets that large
+static const int kBatchFlushFrequency = 1;
+	// in kernel daemon intervals of 100 ms
+
+struct batched_event {
+	int32				opcode;
+	dev_t				device;
+	ino_t				node;
+	int32				size;
+	// followed by a copy of the event's message
+
+	void* Message() { return this + 1; }
+};
+
+struct node_monitor_batch : DoublyLinkedListLinkImpl<node_monitor_batch> {
+	port_id				port;
+	int32				token;
+	int32				ref_count;
+	int32				last_event;
+	int32				event_count;
+	int32				size;
+	batched_event*		events[kMaxBatchedEvents];
+};
+
+typedef DoublyLinkedList<node_monitor_batch> BatchList;
+
 static UserMessagingMessageSender sNodeMonitorSender;
 
 class UserNodeListener : public UserMessagingListener {
@@ -83,6 +114,31 @@ class UserNodeListener : public UserMessagingListener {
 		}
 };
 
+/*!	A user listener that asked for B_WATCH_BATCHED; its events are collected
+	in the batch shared by all listeners with the same port and token, and
+	are delivered by the kernel daemon.
+*/
+class BatchedUserNodeListener : public UserNodeListener {
+	public:
+		BatchedUserNodeListener(port_id port, int32 token,
+				node_monitor_batch* batch)
+			: UserNodeListener(port, token),
+			fBatch(batch)
+		{
+		}
+
+		node_monitor_batch* Batch() const { return fBatch; }
+
+		virtual void EventOccurred(NotificationService& service,
+			const KMessage* event);
+		virtual void AllListenersNotified(NotificationService& service)
+		{
+		}
+
+	private:
+		node_monitor_batch* fBatch;
+};
+
 class NodeMonitorService : public NotificationService {
 	public:
 		NodeMonitorService();
@@ -121,11 +177,26 @@ class NodeMonitorService : public NotificationService {
 		status_t UpdateUserListener(io_context *context, dev_t device,
 			ino_t node, uint32 flags, UserNodeListener &userListener);
 
+		void AddBatchedEvent(node_monitor_batch *batch,
+			const KMessage *event);
+		void FlushBatches();
+
 		virtual const char* Name() { return "node monitor"; }
 
 	private:
 		void _RemoveMonitor(node_monitor *monitor);
 		void _RemoveListener(monitor_listener *listener);
+		UserNodeListener *_CreateUserListener(
+			const UserNodeListener &userListener, uint32 flags);
+		void _DeleteUserListener(NotificationListener *listener);
+		node_monitor_batch *_GetBatch(port_id port, int32 token);
+		void _PutBatch(node_monitor_batch *batch);
+		batched_event *_AppendBatchedEvent(node_monitor_batch *batch,
+			const KMessage *event);
+		bool _CancelBatchedEntry(node_monitor_batch *batch,
+			const KMessage *event);
+		void _CancelBatchedEvent(node_monitor_batch *batch, int32 index);
+		void _FlushBatch(node_monitor_batch *batch);
 		node_monitor *_MonitorFor(dev_t device, ino_t node);
 		status_t _GetMonitor(io_context *context, dev_t device, ino_t node,
 			bool addIfNecessary, node_monitor **_monitor);
@@ -176,11 +247,98 @@ class NodeMonitorService : public NotificationService {
 		typedef BOpenHashTable<HashDefinition> MonitorHash;
 		MonitorHash	fMonitors;
 		recursive_lock fRecursiveLock;
+		BatchList	fBatches;
+		int32		fPendingBatchCount;
+		int32		fEventSerial;
 };
 
 static NodeMonitorService sNodeMonitorService;
 
 
+void
+BatchedUserNodeListener::EventOccurred(NotificationService& service,
+	const KMessage* event)
+{
+	// we are only registered with the node monitor service
+	static_cast<NodeMonitorService&>(service).AddBatchedEvent(fBatch, event);
+}
+
+
+/*!	Returns whether the given event message has all the fields its opcode
+	has in a batch, and can therefore be batched.
+*/
+static bool
+is_batchable_event(const KMessage* event, int32 opcode)
+{
+	if (opcode <= 0 || opcode >= 32 || opcode == B_BATCHED_EVENTS)
+		return false;
+
+	for (uint32 i = 0; i < NODE_MONITOR_BATCH_FIELD_COUNT; i++) {
+		const node_monitor_batch_field& field = kNodeMonitorBatchFields[i];
+		if ((field.opcodes & NODE_MONITOR_OPCODE_MASK(opcode)) == 0)
+			continue;
+
+		const void* data;
+		int32 size;
+		if (event->FindData(field.name, field.type, &data, &size) != B_OK)
+			return false;
+	}
+
+	return true;
+}
+
+
+/*!	Changes the value of an int32 field in the copy of an event message that
+	is kept in a batch.
+*/
+static void
+set_batched_event_int32(batched_event* event, const char* name, int32 value)
+{
+	KMessage message;
+	if (message.SetTo(event->Message(), event->size) != B_OK)
+		return;
+
+	const void* data;
+	int32 size;
+	if (message.FindData(name, B_INT32_TYPE, &data, &size) == B_OK
+		&& size == sizeof(int32)) {
+		// the buffer is our own, only the KMessage view of it is read-only
+		*(int32*)const_cast<void*>(data) = value;
+	}
+}
+
+
+static int32
+get_batched_event_int32(batched_event* event, const char* name)
+{
+	KMessage message;
+	if (message.SetTo(event->Message(), event->size) != B_OK)
+		return 0;
+
+	return message.GetInt32(name, 0);
+}
+
+
+static bool
+batched_event_string_equals(batched_event* event, const char* name,
+	const char* value)
+{
+	KMessage message;
+	if (message.SetTo(event->Message(), event->size) != B_OK)
+		return false;
+
+	const char* eventValue = message.GetString(name, NULL);
+	return eventValue != NULL && value != NULL && !strcmp(eventValue, value);
+}
+
+
+static void
+flush_node_monitor_batches(void* /*data*/, int /*iteration*/)
+{
+	sNodeMonitorService.FlushBatches();
+}
+
+
 /*!	\brief Notifies the listener of a live query that an entry has been added
   		   to or removed from the query (for whatever reason).
   	\param opcode \c B_ENTRY_CREATED or \c B_ENTRY_REMOVED.
@@ -224,6 +382,9 @@ notify_query_entry_created_or_removed(int32 opcode, port_id port, int32 token,
 
 
 NodeMonitorService::NodeMonitorService()
+	:
+	fPendingBatchCount(0),
+	fEventSerial(0)
 {
 	recursive_lock_init(&fRecursiveLock, "node monitor");
 }
@@ -270,7 +431,7 @@ NodeMonitorService::_RemoveListener(monitor_listener *listener)
 	if (dynamic_cast<UserNodeListener*>(listener->listener) != NULL) {
 		// This is a listener we copied ourselves in UpdateUserListener(),
 		// so we have to delete it here.
-		delete listener->listener;
+		_DeleteUserListener(listener->listener);
 	}
 
 	delete listener;
@@ -492,6 +653,9 @@ NodeMonitorService::_SendNotificationMessage(KMessage &message,
 	interested_monitor_listener_list *interestedListeners,
 	int32 interestedListenerCount)
 {
+	// lets the batches recognize an event they get through several listeners
+	fEventSerial++;
+
 	// iterate through the lists
 	interested_monitor_listener_list *list = interestedListeners;
 	for (int32 i = 0; i < interestedListenerCount; i++, list++) {
@@ -899,13 +1063,26 @@ NodeMonitorService::UpdateUserListener(io_context *context, dev_t device,
 	MonitorListenerList::Iterator iterator = monitor->listeners.GetIterator();
 	while (monitor_listener* listener = iterator.Next()) {
 		if (*listener->listener == userListener) {
+			if ((flags & B_WATCH_BATCHED) != 0
+				&& dynamic_cast<BatchedUserNodeListener*>(listener->listener)
+					== NULL) {
+				// switch the listener over to batched delivery
+				UserNodeListener* batchedListener = _CreateUserListener(
+					userListener, flags);
+				if (batchedListener == NULL)
+					return B_NO_MEMORY;
+
+				_DeleteUserListener(listener->listener);
+				listener->listener = batchedListener;
+			}
+
 			listener->flags |= flags;
 			return B_OK;
 		}
 	}
 
-	UserNodeListener* copiedListener = new(std::nothrow) UserNodeListener(
-		userListener);
+	UserNodeListener* copiedListener = _CreateUserListener(userListener,
+		flags);
 	if (copiedListener == NULL) {
 		if (monitor->listeners.IsEmpty())
 			_RemoveMonitor(monitor);
@@ -914,12 +1091,398 @@ NodeMonitorService::UpdateUserListener(io_context *context, dev_t device,
 
 	status = _AddMonitorListener(context, monitor, flags, *copiedListener);
 	if (status != B_OK)
-		delete copiedListener;
+		_DeleteUserListener(copiedListener);
 
 	return status;
 }
 
 
+/*!	\brief Adds an event to the batch of a listener that asked for
+		   \c B_WATCH_BATCHED.
+
+	The event is folded into the events already in the batch where possible:
+	- a stat change replaces an earlier stat change of the same node, and
+	  gets its fields, too,
+	- an attribute change replaces an earlier change of the same attribute,
+	  combining their causes,
+	- the removal of an entry that has been created in the same batch
+	  cancels the creation, and all stat and attribute changes of the node
+	  since then.
+
+	Must be called with monitors lock hold.
+*/
+void
+NodeMonitorService::AddBatchedEvent(node_monitor_batch *batch,
+	const KMessage *event)
+{
+	if (batch->last_event == fEventSerial) {
+		// we already got this event through another listener
+		return;
+	}
+	batch->last_event = fEventSerial;
+
+	int32 opcode = event->GetInt32("opcode", -1);
+	if (!is_batchable_event(event, opcode)) {
+		// keep the order of the events, and send this one on its own
+		_FlushBatch(batch);
+
+		messaging_target target;
+		target.port = batch->port;
+		target.token = batch->token;
+		send_message(event, &target, 1);
+		return;
+	}
+
+	dev_t device = event->GetInt32("device", -1);
+	ino_t node = event->GetInt64("node", -1);
+
+	int32 previous = -1;
+	if (opcode == B_STAT_CHANGED || opcode == B_ATTR_CHANGED) {
+		const char* attribute = event->GetString("attr", NULL);
+
+		for (int32 i = batch->event_count - 1; i >= 0; i--) {
+			batched_event* batchedEvent = batch->events[i];
+			if (batchedEvent != NULL && batchedEvent->opcode == opcode
+				&& batchedEvent->device == device
+				&& batchedEvent->node == node
+				&& (opcode == B_STAT_CHANGED || batched_event_string_equals(
+					batchedEvent, "attr", attribute))) {
+				previous = i;
+				break;
+			}
+		}
+	} else if (opcode == B_ENTRY_REMOVED && _CancelBatchedEntry(batch, event))
+		return;
+
+	if (previous < 0) {
+		_AppendBatchedEvent(batch, event);
+		return;
+	}
+
+	if (opcode == B_STAT_CHANGED) {
+		uint32 fields = event->GetInt32("fields", 0);
+		uint32 previousFields = get_batched_event_int32(batch->events[previous],
+			"fields");
+
+		// the folded change is only an interim update if both were
+		fields = ((fields | previousFields) & ~B_STAT_INTERIM_UPDATE)
+			| (fields & previousFields & B_STAT_INTERIM_UPDATE);
+
+		_CancelBatchedEvent(batch, previous);
+		batched_event* batchedEvent = _AppendBatchedEvent(batch, event);
+		if (batchedEvent != NULL)
+			set_batched_event_int32(batchedEvent, "fields", fields);
+		return;
+	}
+
+	int32 cause = event->GetInt32("cause", B_ATTR_CHANGED);
+	int32 previousCause = get_batched_event_int32(batch->events[previous],
+		"cause");
+	_CancelBatchedEvent(batch, previous);
+
+	if (previousCause == B_ATTR_CREATED) {
+		if (cause == B_ATTR_REMOVED)
+			return;
+		cause = B_ATTR_CREATED;
+	} else if (previousCause == B_ATTR_REMOVED && cause == B_ATTR_CREATED)
+		cause = B_ATTR_CHANGED;
+
+	batched_event* batchedEvent = _AppendBatchedEvent(batch, event);
+	if (batchedEvent != NULL)
+		set_batched_event_int32(batchedEvent, "cause", cause);
+}
+
+
+/*!	\brief Delivers the events that have been collected in the batches.
+	Called by the kernel daemon.
+*/
+void
+NodeMonitorService::FlushBatches()
+{
+	if (fPendingBatchCount == 0)
+		return;
+
+	RecursiveLocker _(fRecursiveLock);
+
+	BatchList::Iterator iterator = fBatches.GetIterator();
+	while (node_monitor_batch* batch = iterator.Next())
+		_FlushBatch(batch);
+}
+
+
+/*!	Creates the copy of a user listener that is kept in the monitor_listener.
+	Must be called with monitors lock hold.
+*/
+UserNodeListener*
+NodeMonitorService::_CreateUserListener(const UserNodeListener &userListener,
+	uint32 flags)
+{
+	if ((flags & B_WATCH_BATCHED) == 0)
+		return new(std::nothrow) UserNodeListener(userListener);
+
+	node_monitor_batch* batch = _GetBatch(userListener.Port(),
+		userListener.Token());
+	if (batch == NULL)
+		return NULL;
+
+	UserNodeListener* listener = new(std::nothrow) BatchedUserNodeListener(
+		userListener.Port(), userListener.Token(), batch);
+	if (listener == NULL)
+		_PutBatch(batch);
+
+	return listener;
+}
+
+
+/*!	Deletes a listener created by _CreateUserListener().
+	Must be called with monitors lock hold.
+*/
+void
+NodeMonitorService::_DeleteUserListener(NotificationListener *listener)
+{
+	BatchedUserNodeListener* batchedListener
+		= dynamic_cast<BatchedUserNodeListener*>(listener);
+	if (batchedListener != NULL)
+		_PutBatch(batchedListener->Batch());
+
+	delete listener;
+}
+
+
+/*!	Returns the batch of the given port/token pair, and creates it if
+	necessary. Must be called with monitors lock hold.
+*/
+node_monitor_batch*
+NodeMonitorService::_GetBatch(port_id port, int32 token)
+{
+	BatchList::Iterator iterator = fBatches.GetIterator();
+	while (node_monitor_batch* batch = iterator.Next()) {
+		if (batch->port == port && batch->token == token) {
+			batch->ref_count++;
+			return batch;
+		}
+	}
+
+	node_monitor_batch* batch = new(std::nothrow) node_monitor_batch;
+	if (batch == NULL)
+		return NULL;
+
+	batch->port = port;
+	batch->token = token;
+	batch->ref_count = 1;
+	batch->last_event = fEventSerial;
+	batch->event_count = 0;
+	batch->size = 0;
+
+	fBatches.Add(batch);
+	return batch;
+}
+
+
+/*!	Releases a reference to the given batch. When the last listener is
+	gone, the remaining events are delivered, and the batch is deleted.
+	Must be called with monitors lock hold.
+*/
+void
+NodeMonitorService::_PutBatch(node_monitor_batch *batch)
+{
+	if (--batch->ref_count > 0)
+		return;
+
+	_FlushBatch(batch);
+	fBatches.Remove(batch);
+	delete batch;
+}
+
+
+/*!	Appends a copy of the given event to the batch; if the batch is full, it
+	is delivered first. If there is not enough memory, the event is sent on
+	its own, and \c NULL is returned.
+	Must be called with monitors lock hold.
+*/
+batched_event*
+NodeMonitorService::_AppendBatchedEvent(node_monitor_batch *batch,
+	const KMessage *event)
+{
+	int32 size = event->ContentSize();
+	if (batch->event_count == kMaxBatchedEvents
+		|| batch->size + size > kMaxBatchSize) {
+		_FlushBatch(batch);
+	}
+
+	batched_event* batchedEvent
+		= (batched_event*)malloc(sizeof(batched_event) + size);
+	if (batchedEvent == NULL) {
+		_FlushBatch(batch);
+
+		messaging_target target;
+		target.port = batch->port;
+		target.token = batch->token;
+		send_message(event, &target, 1);
+		return NULL;
+	}
+
+	batchedEvent->opcode = event->GetInt32("opcode", -1);
+	batchedEvent->device = event->GetInt32("device", -1);
+	batchedEvent->node = event->GetInt64("node", -1);
+	batchedEvent->size = size;
+	memcpy(batchedEvent->Message(), event->Buffer(), size);
+
+	if (batch->event_count == 0)
+		fPendingBatchCount++;
+
+	batch->events[batch->event_count++] = batchedEvent;
+	batch->size += size;
+	return batchedEvent;
+}
+
+
+/*!	If the entry removed by the given event has been created in the same
+	batch, the creation and all stat and attribute changes of the node since
+	then are removed from the batch, and \c true is returned.
+	Must be called with monitors lock hold.
+*/
+bool
+NodeMonitorService::_CancelBatchedEntry(node_monitor_batch *batch,
+	const KMessage *event)
+{
+	dev_t device = event->GetInt32("device", -1);
+	ino_t directory = event->GetInt64("directory", -1);
+	ino_t node = event->GetInt64("node", -1);
+	const char* name = event->GetString("name", NULL);
+
+	for (int32 i = batch->event_count - 1; i >= 0; i--) {
+		batched_event* batchedEvent = batch->events[i];
+		if (batchedEvent == NULL || batchedEvent->node != node)
+			continue;
+
+		if (batchedEvent->opcode == B_STAT_CHANGED
+			|| batchedEvent->opcode == B_ATTR_CHANGED)
+			continue;
+
+		if (batchedEvent->opcode != B_ENTRY_CREATED
+			|| batchedEvent->device != device
+			|| !batched_event_string_equals(batchedEvent, "name", name)) {
+			// the entry has been moved, or linked elsewhere, in the meantime
+			return false;
+		}
+
+		KMessage created;
+		if (created.SetTo(batchedEvent->Message(), batchedEvent->size) != B_OK
+			|| created.GetInt64("directory", -1) != directory)
+			return false;
+
+		for (int32 j = batch->event_count - 1; j >= i; j--) {
+			batched_event* nodeEvent = batch->events[j];
+			if (nodeEvent != NULL && nodeEvent->device == device
+				&& nodeEvent->node == node)
+				_CancelBatchedEvent(batch, j);
+		}
+		return true;
+	}
+
+	return false;
+}
+
+
+//!	Must be called with monitors lock hold.
+void
+NodeMonitorService::_CancelBatchedEvent(node_monitor_batch *batch,
+	int32 index)
+{
+	batch->size -= batch->events[index]->size;
+	free(batch->events[index]);
+	batch->events[index] = NULL;
+}
+
+
+/*!	Sends all events in the batch as a single \c B_BATCHED_EVENTS message,
+	laid out as described in <node_monitor_defs.h>.
+	Must be called with monitors lock hold.
+*/
+void
+NodeMonitorService::_FlushBatch(node_monitor_batch *batch)
+{
+	if (batch->event_count == 0)
+		return;
+
+	messaging_target target;
+	target.port = batch->port;
+	target.token = batch->token;
+
+	KMessage message(B_NODE_MONITOR);
+	status_t status = message.AddInt32("opcode", B_BATCHED_EVENTS);
+
+	KMessageField opcodes;
+	if (status == B_OK) {
+		status = message.AddField(NODE_MONITOR_BATCH_OPCODES_FIELD,
+			B_INT32_TYPE, sizeof(int32), &opcodes);
+	}
+
+	int32 eventCount = 0;
+	for (int32 i = 0; status == B_OK && i < batch->event_count; i++) {
+		if (batch->events[i] != NULL) {
+			status = opcodes.AddElement(&batch->events[i]->opcode);
+			eventCount++;
+		}
+	}
+
+	// the fields can only be added to one after the other
+	for (uint32 i = 0; status == B_OK && i < NODE_MONITOR_BATCH_FIELD_COUNT;
+			i++) {
+		const node_monitor_batch_field& batchField = kNodeMonitorBatchFields[i];
+		KMessageField field;
+		bool fieldAdded = false;
+
+		for (int32 j = 0; status == B_OK && j < batch->event_count; j++) {
+			batched_event* batchedEvent = batch->events[j];
+			if (batchedEvent == NULL || (batchField.opcodes
+					& NODE_MONITOR_OPCODE_MASK(batchedEvent->opcode)) == 0)
+				continue;
+
+			KMessage event;
+			const void* data;
+			int32 size;
+			status = event.SetTo(batchedEvent->Message(), batchedEvent->size);
+			if (status == B_OK) {
+				status = event.FindData(batchField.name, batchField.type,
+					&data, &size);
+			}
+			if (status == B_OK && !fieldAdded) {
+				status = message.AddField(batchField.name, batchField.type,
+					batchField.type == B_STRING_TYPE ? -1 : size, &field);
+				fieldAdded = true;
+			}
+			if (status == B_OK)
+				status = field.AddElement(data, size);
+		}
+	}
+
+	if (eventCount > 0) {
+		if (status == B_OK)
+			send_message(&message, &target, 1);
+		else {
+			// deliver the events one by one instead
+			for (int32 i = 0; i < batch->event_count; i++) {
+				KMessage event;
+				if (batch->events[i] != NULL
+					&& event.SetTo(batch->events[i]->Message(),
+						batch->events[i]->size) == B_OK) {
+					send_message(&event, &target, 1);
+				}
+			}
+		}
+	}
+
+	for (int32 i = 0; i < batch->event_count; i++)
+		free(batch->events[i]);
+
+	batch->event_count = 0;
+	batch->size = 0;
+	fPendingBatchCount--;
+}
+
+
 //	#pragma mark - private kernel API
 
 
@@ -939,6 +1502,9 @@ node_monitor_init(void)
 	if (sNodeMonitorService.InitCheck() < B_OK)
 		panic("initializing node monitor failed\n");
 
+	register_kernel_daemon(&flush_node_monitor_batches, NULL,
+		kBatchFlushFrequency);
+
 	return B_OK;
 }
 
@@ -31,6 +31,7 @@
 #define MAX_SOCKET_ADDRESS_LENGTH	(sizeof(sockaddr_storage))
 #define MAX_SOCKET_OPTION_LEN	128
 #define MAX_ANCILLARY_DATA_LEN	1024
+#define MAX_BATCH_MESSAGES		1024
 
 #define GET_SOCKET_FD_OR_RETURN(fd, kernel, descriptor)	\
 	do {												\
@@ -956,8 +957,8 @@ _user_recvfrom(int socket, void *data, size_t length, int flags,
 }
 
 
-ssize_t
-_user_recvmsg(int socket, struct msghdr *userMessage, int flags)
+static ssize_t
+user_recvmsg(int socket, struct msghdr *userMessage, int flags)
 {
 	// copy message from userland
 	msghdr message;
@@ -991,9 +992,7 @@ _user_recvmsg(int socket, struct msghdr *userMessage, int flags)
 	}
 
 	// recvmsg()
-	SyscallRestartWrapper<ssize_t> result;
-
-	result = common_recvmsg(socket, &message, flags, false);
+	ssize_t result = common_recvmsg(socket, &message, flags, false);
 	if (result < 0)
 		return result;
 
@@ -1014,6 +1013,62 @@ _user_recvmsg(int socket, struct msghdr *userMessage, int flags)
 }
 
 
+ssize_t
+_user_recvmsg(int socket, struct msghdr *userMessage, int flags)
+{
+	SyscallRestartWrapper<ssize_t> result;
+	return result = user_recvmsg(socket, userMessage, flags);
+}
+
+
+/*!	Receives up to \a count messages at once. If MSG_WAITFORONE is
+	specified, only the first message is waited for. The \a timeout is only
+	checked after each received message.
+	Returns the number of messages received, or an error code if not even
+	the first message could be received.
+*/
+ssize_t
+_user_recvmmsg(int socket, struct mmsghdr *userMessages, unsigned int count,
+	int flags, bigtime_t timeout)
+{
+	if (userMessages == NULL || !IS_USER_ADDRESS(userMessages))
+		return B_BAD_ADDRESS;
+	if (count > MAX_BATCH_MESSAGES)
+		count = MAX_BATCH_MESSAGES;
+
+	bigtime_t end = timeout >= 0 ? system_time() + timeout : B_INFINITE_TIMEOUT;
+	SyscallRestartWrapper<ssize_t> result;
+
+	unsigned int received = 0;
+	while (received < count) {
+		int messageFlags = flags & ~MSG_WAITFORONE;
+		if (received > 0 && (flags & MSG_WAITFORONE) != 0)
+			messageFlags |= MSG_DONTWAIT;
+
+		ssize_t bytesReceived = user_recvmsg(socket,
+			&userMessages[received].msg_hdr, messageFlags);
+		if (bytesReceived < 0) {
+			if (received > 0)
+				break;
+			return result = bytesReceived;
+		}
+
+		unsigned int length = bytesReceived;
+		if (user_memcpy(&userMessages[received].msg_len, &length,
+				sizeof(length)) != B_OK) {
+			return B_BAD_ADDRESS;
+		}
+
+		received++;
+
+		if (system_time() >= end)
+			break;
+	}
+
+	return result = received;
+}
+
+
 ssize_t
 _user_send(int socket, const void *data, size_t length, int flags)
 {
@@ -1054,8 +1109,8 @@ _user_sendto(int socket, const void *data, size_t length, int flags,
 }
 
 
-ssize_t
-_user_sendmsg(int socket, const struct msghdr *userMessage, int flags)
+static ssize_t
+user_sendmsg(int socket, const struct msghdr *userMessage, int flags)
 {
 	// copy message from userland
 	msghdr message;
@@ -1098,9 +1153,53 @@ _user_sendmsg(int socket, const struct msghdr *userMessage, int flags)
 	}
 
 	// sendmsg()
+	return common_sendmsg(socket, &message, flags, false);
+}
+
+
+ssize_t
+_user_sendmsg(int socket, const struct msghdr *userMessage, int flags)
+{
 	SyscallRestartWrapper<ssize_t> result;
+	return result = user_sendmsg(socket, userMessage, flags);
+}
+
+
+/*!	Sends up to \a count messages at once.
+	Returns the number of messages sent, or an error code if not even the
+	first message could be sent.
+*/
+ssize_t
+_user_sendmmsg(int socket, struct mmsghdr *userMessages, unsigned int count,
+	int flags)
+{
+	if (userMessages == NULL || !IS_USER_ADDRESS(userMessages))
+		return B_BAD_ADDRESS;
+	if (count > MAX_BATCH_MESSAGES)
+		count = MAX_BATCH_MESSAGES;
+
+	SyscallRestartWrapper<ssize_t> result;
+
+	unsigned int sent = 0;
+	while (sent < count) {
+		ssize_t bytesSent = user_sendmsg(socket, &userMessages[sent].msg_hdr,
+			flags);
+		if (bytesSent < 0) {
+			if (sent > 0)
+				break;
+			return result = bytesSent;
+		}
+
+		unsigned int length = bytesSent;
+		if (user_memcpy(&userMessages[sent].msg_len, &length, sizeof(length))
+				!= B_OK) {
+			return B_BAD_ADDRESS;
+		}
+
+		sent++;
+	}
 
-	return result = common_sendmsg(socket, &message, flags, false);
+	return result = sent;
 }
 
 
@@ -50,6 +50,7 @@
 #include <util/atomic.h>
 #include <util/AutoLock.h>
 #include <util/DoublyLinkedList.h>
+#include <util/ProbingHashTable.h>
 #include <vfs.h>
 #include <vm/vm.h>
 #include <vm/VMCache.h>
@@ -117,6 +118,33 @@ struct vnode_hash_key {
 	ino_t	vnode;
 };
 
+struct VnodeHashDefinition {
+	typedef vnode_hash_key	KeyType;
+	typedef struct vnode	ValueType;
+
+#define VHASH(mountid, vnodeid) \
+	(((uint32)((vnodeid) >> 32) + (uint32)(vnodeid)) ^ (uint32)(mountid))
+
+	size_t HashKey(const vnode_hash_key& key) const
+	{
+		return VHASH(key.device, key.vnode);
+	}
+
+	size_t Hash(struct vnode* vnode) const
+	{
+		return VHASH(vnode->device, vnode->id);
+	}
+
+#undef VHASH
+
+	bool Compare(const vnode_hash_key& key, struct vnode* vnode) const
+	{
+		return vnode->device == key.device && vnode->id == key.vnode;
+	}
+};
+
+typedef BProbingHashTable<VnodeHashDefinition> VnodeTable;
+
 typedef DoublyLinkedList<vnode> VnodeList;
 
 /*!	\brief Structure to manage a mounted file system
@@ -253,7 +281,7 @@ static mutex sIOContextRootLock = MUTEX_INITIALIZER("io_context::root lock");
 
 
 #define VNODE_HASH_TABLE_SIZE 1024
-static hash_table* sVnodeTable;
+static VnodeTable sVnodeTable;
 static struct vnode* sRoot;
 
 #define MOUNTS_HASH_TABLE_SIZE 16
@@ -802,37 +830,6 @@ get_file_system_name_for_layer(const char* fsNames, int32 layer)
 }
 
 
-static int
-vnode_compare(void* _vnode, const void* _key)
-{
-	struct vnode* vnode = (struct vnode*)_vnode;
-	const struct vnode_hash_key* key = (vnode_hash_key*)_key;
-
-	if (vnode->device == key->device && vnode->id == key->vnode)
-		return 0;
-
-	return -1;
-}
-
-
-static uint32
-vnode_hash(void* _vnode, const void* _key, uint32 range)
-{
-	struct vnode* vnode = (struct vnode*)_vnode;
-	const struct vnode_hash_key* key = (vnode_hash_key*)_key;
-
-#define VHASH(mountid, vnodeid) \
-	(((uint32)((vnodeid) >> 32) + (uint32)(vnodeid)) ^ (uint32)(mountid))
-
-	if (vnode != NULL)
-		return VHASH(vnode->device, vnode->id) % range;
-
-	return VHASH(key->device, key->vnode) % range;
-
-#undef VHASH
-}
-
-
 static void
 add_vnode_to_mount_list(struct vnode* vnode, struct fs_mount* mount)
 {
@@ -867,7 +864,7 @@ lookup_vnode(dev_t mountID, ino_t vnodeID)
 	key.device = mountID;
 	key.vnode = vnodeID;
 
-	return (vnode*)hash_lookup(sVnodeTable, &key);
+	return sVnodeTable.Lookup(key);
 }
 
 
@@ -926,7 +923,12 @@ create_new_vnode_and_lock(dev_t mountID, ino_t vnodeID, struct vnode*& _vnode,
 	}
 
 	// add the vnode to the mount's node list and the hash table
-	hash_insert(sVnodeTable, vnode);
+	if (sVnodeTable.Insert(vnode) != B_OK) {
+		mutex_unlock(&sMountMutex);
+		rw_lock_write_unlock(&sVnodeLock);
+		free(vnode);
+		return B_NO_MEMORY;
+	}
 	add_vnode_to_mount_list(vnode, vnode->mount);
 
 	mutex_unlock(&sMountMutex);
@@ -986,7 +988,7 @@ free_vnode(struct vnode* vnode, bool reenter)
 	// The file system has removed the resources of the vnode now, so we can
 	// make it available again (by removing the busy vnode from the hash).
 	rw_lock_write_lock(&sVnodeLock);
-	hash_remove(sVnodeTable, vnode);
+	sVnodeTable.Remove(vnode);
 	rw_lock_write_unlock(&sVnodeLock);
 
 	// if we have a VMCache attached, remove it
@@ -1210,7 +1212,7 @@ restart:
 				FS_CALL(vnode, put_vnode, reenter);
 
 			rw_lock_write_lock(&sVnodeLock);
-			hash_remove(sVnodeTable, vnode);
+			sVnodeTable.Remove(vnode);
 			remove_vnode_from_mount_list(vnode, vnode->mount);
 			rw_lock_write_unlock(&sVnodeLock);
 
@@ -3252,19 +3254,17 @@ dump_vnode(int argc, char** argv)
 		return 0;
 	}
 
-	struct hash_iterator iterator;
 	dev_t device = parse_expression(argv[argi]);
 	ino_t id = parse_expression(argv[argi + 1]);
 
-	hash_open(sVnodeTable, &iterator);
-	while ((vnode = (struct vnode*)hash_next(sVnodeTable, &iterator)) != NULL) {
+	VnodeTable::Iterator iterator = sVnodeTable.GetIterator();
+	while ((vnode = iterator.Next()) != NULL) {
 		if (vnode->id != id || vnode->device != device)
 			continue;
 
 		_dump_vnode(vnode, printPath);
 	}
 
-	hash_close(sVnodeTable, &iterator, false);
 	return 0;
 }
 
@@ -3280,14 +3280,13 @@ dump_vnodes(int argc, char** argv)
 	// restrict dumped nodes to a certain device if requested
 	dev_t device = parse_expression(argv[1]);
 
-	struct hash_iterator iterator;
 	struct vnode* vnode;
 
 	kprintf("address    dev     inode  ref cache      fs-node    locking    "
 		"flags\n");
 
-	hash_open(sVnodeTable, &iterator);
-	while ((vnode = (struct vnode*)hash_next(sVnodeTable, &iterator)) != NULL) {
+	VnodeTable::Iterator iterator = sVnodeTable.GetIterator();
+	while ((vnode = iterator.Next()) != NULL) {
 		if (vnode->device != device)
 			continue;
 
@@ -3297,7 +3296,6 @@ dump_vnodes(int argc, char** argv)
 			vnode->IsBusy() ? "b" : "-", vnode->IsUnpublished() ? "u" : "-");
 	}
 
-	hash_close(sVnodeTable, &iterator, false);
 	return 0;
 }
 
@@ -3305,7 +3303,6 @@ dump_vnodes(int argc, char** argv)
 static int
 dump_vnode_caches(int argc, char** argv)
 {
-	struct hash_iterator iterator;
 	struct vnode* vnode;
 
 	if (argc > 2 || !strcmp(argv[1], "--help")) {
@@ -3320,8 +3317,8 @@ dump_vnode_caches(int argc, char** argv)
 
 	kprintf("address    dev     inode cache          size   pages\n");
 
-	hash_open(sVnodeTable, &iterator);
-	while ((vnode = (struct vnode*)hash_next(sVnodeTable, &iterator)) != NULL) {
+	VnodeTable::Iterator iterator = sVnodeTable.GetIterator();
+	while ((vnode = iterator.Next()) != NULL) {
 		if (vnode->cache == NULL)
 			continue;
 		if (device != -1 && vnode->device != device)
@@ -3332,7 +3329,6 @@ dump_vnode_caches(int argc, char** argv)
 				/ B_PAGE_SIZE, vnode->cache->page_count);
 	}
 
-	hash_close(sVnodeTable, &iterator, false);
 	return 0;
 }
 
@@ -3406,17 +3402,14 @@ dump_vnode_usage(int argc, char** argv)
 	kprintf("Unused vnodes: %ld (max unused %ld)\n", sUnusedVnodes,
 		kMaxUnusedVnodes);
 
-	struct hash_iterator iterator;
-	hash_open(sVnodeTable, &iterator);
+	VnodeTable::Iterator iterator = sVnodeTable.GetIterator();
 
 	uint32 count = 0;
 	struct vnode* vnode;
-	while ((vnode = (struct vnode*)hash_next(sVnodeTable, &iterator)) != NULL) {
+	while ((vnode = iterator.Next()) != NULL) {
 		count++;
 	}
 
-	hash_close(sVnodeTable, &iterator, false);
-
 	kprintf("%lu vnodes total (%ld in use).\n", count, count - sUnusedVnodes);
 	return 0;
 }
@@ -3739,7 +3732,7 @@ publish_vnode(fs_volume* volume, ino_t vnodeID, void* privateNode,
 			vnode->SetUnpublished(false);
 		} else {
 			locker.Lock();
-			hash_remove(sVnodeTable, vnode);
+			sVnodeTable.Remove(vnode);
 			remove_vnode_from_mount_list(vnode, vnode->mount);
 			free(vnode);
 		}
@@ -5098,12 +5091,10 @@ vfs_init(kernel_args* args)
 {
 	vnode::StaticInit();
 
-	struct vnode dummyVnode;
-	sVnodeTable = hash_init(VNODE_HASH_TABLE_SIZE,
-		offset_of_member(dummyVnode, next), &vnode_compare, &vnode_hash);
-	if (sVnodeTable == NULL)
+	if (sVnodeTable.Init(VNODE_HASH_TABLE_SIZE) != B_OK)
 		panic("vfs_init: error creating vnode hash table\n");
 
+	struct vnode dummyVnode;
 	list_init_etc(&sUnusedVnodeList, offset_of_member(dummyVnode, unused_link));
 
 	struct fs_mount dummyMount;
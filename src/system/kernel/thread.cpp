@@ -22,7 +22,7 @@
 #include <OS.h>
 
 #include <util/AutoLock.h>
-#include <util/khash.h>
+#include <util/ProbingHashTable.h>
 
 #include <arch/debug.h>
 #include <boot/kernel_args.h>
@@ -58,16 +58,38 @@
 #define THREAD_MAX_MESSAGE_SIZE		65536
 
 
-struct thread_key {
-	thread_id id;
+struct ThreadHashDefinition {
+	typedef thread_id		KeyType;
+	typedef struct thread	ValueType;
+
+	size_t HashKey(thread_id key) const
+	{
+		return key;
+	}
+
+	size_t Hash(struct thread* value) const
+	{
+		return HashKey(value->id);
+	}
+
+	bool Compare(thread_id key, struct thread* value) const
+	{
+		return value->id == key;
+	}
 };
 
+// The table is accessed with interrupts disabled, so it must not allocate
+// memory on its own; see resize_thread_hash().
+typedef BProbingHashTable<ThreadHashDefinition, false> ThreadHashTable;
+
+static const size_t kInitialThreadHashSize = 128;
+
 // global
 spinlock gThreadSpinlock = B_SPINLOCK_INITIALIZER;
 
 // thread list
 static struct thread sIdleThreads[B_MAX_CPU_COUNT];
-static hash_table *sThreadHash = NULL;
+static ThreadHashTable sThreadHash;
 static thread_id sNextThreadID = 1;
 
 // some arbitrary chosen limits - should probably depend on the available
@@ -164,29 +186,46 @@ remove_thread_from_team(struct team *team, struct thread *thread)
 }
 
 
-static int
-thread_struct_compare(void *_t, const void *_key)
+/*!	Makes sure the thread hash table has room for another thread, by resizing
+	it if necessary. The allocations are done with interrupts enabled, so this
+	must be called without holding the thread lock.
+*/
+static status_t
+resize_thread_hash()
 {
-	struct thread *thread = (struct thread*)_t;
-	const struct thread_key *key = (const struct thread_key*)_key;
+	while (true) {
+		cpu_status state = disable_interrupts();
+		GRAB_THREAD_LOCK();
+		size_t size = sThreadHash.ResizeNeeded();
+		RELEASE_THREAD_LOCK();
+		restore_interrupts(state);
 
-	if (thread->id == key->id)
-		return 0;
+		if (size == 0)
+			return B_OK;
 
-	return 1;
-}
+		void* allocation = malloc(size);
+		if (allocation == NULL)
+			return B_NO_MEMORY;
 
+		void* oldTable = NULL;
+		bool resized = false;
 
-static uint32
-thread_struct_hash(void *_t, const void *_key, uint32 range)
-{
-	struct thread *thread = (struct thread*)_t;
-	const struct thread_key *key = (const struct thread_key*)_key;
+		state = disable_interrupts();
+		GRAB_THREAD_LOCK();
+		if (sThreadHash.ResizeNeeded() == size) {
+			resized = sThreadHash.Resize(allocation, size, false, &oldTable);
+			allocation = NULL;
+		}
+		RELEASE_THREAD_LOCK();
+		restore_interrupts(state);
 
-	if (thread != NULL)
-		return thread->id % range;
+		// the requirements might have changed in the meantime
+		free(allocation);
+		free(oldTable);
 
-	return (uint32)key->id % range;
+		if (resized)
+			return B_OK;
+	}
 }
 
 
@@ -452,6 +491,13 @@ create_thread(thread_creation_attributes& attributes, bool kernel)
 	thread->kernel_stack_top = thread->kernel_stack_base + KERNEL_STACK_SIZE
 		+ KERNEL_STACK_GUARD_PAGES * B_PAGE_SIZE;
 
+	status = resize_thread_hash();
+	if (status != B_OK) {
+		delete_area(thread->kernel_stack_area);
+		delete_thread_struct(thread);
+		return status;
+	}
+
 	state = disable_interrupts();
 	GRAB_THREAD_LOCK();
 
@@ -476,7 +522,14 @@ create_thread(thread_creation_attributes& attributes, bool kernel)
 	}
 
 	// insert into global list
-	hash_insert(sThreadHash, thread);
+	if (sThreadHash.Insert(thread) != B_OK) {
+		// other threads have filled up the table since we resized it
+		RELEASE_THREAD_LOCK();
+		restore_interrupts(state);
+		delete_area(thread->kernel_stack_area);
+		delete_thread_struct(thread);
+		return B_NO_MEMORY;
+	}
 	sUsedThreads++;
 	scheduler_on_thread_init(thread);
 	RELEASE_THREAD_LOCK();
@@ -513,7 +566,7 @@ create_thread(thread_creation_attributes& attributes, bool kernel)
 	RELEASE_TEAM_LOCK();
 	if (abort) {
 		GRAB_THREAD_LOCK();
-		hash_remove(sThreadHash, thread);
+		sThreadHash.Remove(thread);
 		RELEASE_THREAD_LOCK();
 	}
 	restore_interrupts(state);
@@ -872,7 +925,6 @@ static int
 make_thread_unreal(int argc, char **argv)
 {
 	struct thread *thread;
-	struct hash_iterator i;
 	int32 id = -1;
 
 	if (argc > 2) {
@@ -883,9 +935,9 @@ make_thread_unreal(int argc, char **argv)
 	if (argc > 1)
 		id = strtoul(argv[1], NULL, 0);
 
-	hash_open(sThreadHash, &i);
+	ThreadHashTable::Iterator iterator = sThreadHash.GetIterator();
 
-	while ((thread = (struct thread*)hash_next(sThreadHash, &i)) != NULL) {
+	while ((thread = iterator.Next()) != NULL) {
 		if (id != -1 && thread->id != id)
 			continue;
 
@@ -895,7 +947,6 @@ make_thread_unreal(int argc, char **argv)
 		}
 	}
 
-	hash_close(sThreadHash, &i, false);
 	return 0;
 }
 
@@ -904,7 +955,6 @@ static int
 set_thread_prio(int argc, char **argv)
 {
 	struct thread *thread;
-	struct hash_iterator i;
 	int32 id;
 	int32 prio;
 
@@ -924,9 +974,9 @@ set_thread_prio(int argc, char **argv)
 	else
 		id = thread_get_current_thread()->id;
 
-	hash_open(sThreadHash, &i);
+	ThreadHashTable::Iterator iterator = sThreadHash.GetIterator();
 
-	while ((thread = (struct thread*)hash_next(sThreadHash, &i)) != NULL) {
+	while ((thread = iterator.Next()) != NULL) {
 		if (thread->id != id)
 			continue;
 		thread->priority = thread->next_priority = prio;
@@ -936,7 +986,6 @@ set_thread_prio(int argc, char **argv)
 	if (!thread)
 		kprintf("thread %ld (%#lx) not found\n", id, id);
 
-	hash_close(sThreadHash, &i, false);
 	return 0;
 }
 
@@ -945,7 +994,6 @@ static int
 make_thread_suspended(int argc, char **argv)
 {
 	struct thread *thread;
-	struct hash_iterator i;
 	int32 id;
 
 	if (argc > 2) {
@@ -958,9 +1006,9 @@ make_thread_suspended(int argc, char **argv)
 	else
 		id = strtoul(argv[1], NULL, 0);
 
-	hash_open(sThreadHash, &i);
+	ThreadHashTable::Iterator iterator = sThreadHash.GetIterator();
 
-	while ((thread = (struct thread*)hash_next(sThreadHash, &i)) != NULL) {
+	while ((thread = iterator.Next()) != NULL) {
 		if (thread->id != id)
 			continue;
 
@@ -971,7 +1019,6 @@ make_thread_suspended(int argc, char **argv)
 	if (!thread)
 		kprintf("thread %ld (%#lx) not found\n", id, id);
 
-	hash_close(sThreadHash, &i, false);
 	return 0;
 }
 
@@ -980,7 +1027,6 @@ static int
 make_thread_resumed(int argc, char **argv)
 {
 	struct thread *thread;
-	struct hash_iterator i;
 	int32 id;
 
 	if (argc != 2) {
@@ -992,9 +1038,9 @@ make_thread_resumed(int argc, char **argv)
 	// the current thread is usually not intended
 	id = strtoul(argv[1], NULL, 0);
 
-	hash_open(sThreadHash, &i);
+	ThreadHashTable::Iterator iterator = sThreadHash.GetIterator();
 
-	while ((thread = (struct thread*)hash_next(sThreadHash, &i)) != NULL) {
+	while ((thread = iterator.Next()) != NULL) {
 		if (thread->id != id)
 			continue;
 
@@ -1007,7 +1053,6 @@ make_thread_resumed(int argc, char **argv)
 	if (!thread)
 		kprintf("thread %ld (%#lx) not found\n", id, id);
 
-	hash_close(sThreadHash, &i, false);
 	return 0;
 }
 
@@ -1159,8 +1204,8 @@ _dump_thread_info(struct thread *thread, bool shortInfo)
 	kprintf("THREAD: %p\n", thread);
 	kprintf("id:                 %ld (%#lx)\n", thread->id, thread->id);
 	kprintf("name:               \"%s\"\n", thread->name);
-	kprintf("all_next:           %p\nteam_next:          %p\nq_next:             %p\n",
-		thread->all_next, thread->team_next, thread->queue_next);
+	kprintf("team_next:          %p\nq_next:             %p\n",
+		thread->team_next, thread->queue_next);
 	kprintf("priority:           %ld (next %ld, I/O: %ld)\n", thread->priority,
 		thread->next_priority, thread->io_priority);
 	kprintf("state:              %s\n", state_to_text(thread, thread->state));
@@ -1277,17 +1322,15 @@ dump_thread_info(int argc, char **argv)
 
 		// walk through the thread list, trying to match name or id
 		bool found = false;
-		struct hash_iterator i;
-		hash_open(sThreadHash, &i);
+		ThreadHashTable::Iterator iterator = sThreadHash.GetIterator();
 		struct thread *thread;
-		while ((thread = (struct thread*)hash_next(sThreadHash, &i)) != NULL) {
+		while ((thread = iterator.Next()) != NULL) {
 			if (!strcmp(name, thread->name) || thread->id == id) {
 				_dump_thread_info(thread, shortInfo);
 				found = true;
 				break;
 			}
 		}
-		hash_close(sThreadHash, &i, false);
 
 		if (!found)
 			kprintf("thread \"%s\" (%ld) doesn't exist!\n", name, id);
@@ -1301,7 +1344,6 @@ static int
 dump_thread_list(int argc, char **argv)
 {
 	struct thread *thread;
-	struct hash_iterator i;
 	bool realTimeOnly = false;
 	bool calling = false;
 	const char *callSymbol = NULL;
@@ -1344,8 +1386,8 @@ dump_thread_list(int argc, char **argv)
 
 	print_thread_list_table_head();
 
-	hash_open(sThreadHash, &i);
-	while ((thread = (struct thread*)hash_next(sThreadHash, &i)) != NULL) {
+	ThreadHashTable::Iterator iterator = sThreadHash.GetIterator();
+	while ((thread = iterator.Next()) != NULL) {
 		// filter out threads not matching the search criteria
 		if ((requiredState && thread->state != requiredState)
 			|| (calling && !arch_debug_contains_call(thread, callSymbol,
@@ -1357,7 +1399,6 @@ dump_thread_list(int argc, char **argv)
 
 		_dump_thread_info(thread, true);
 	}
-	hash_close(sThreadHash, &i, false);
 	return 0;
 }
 
@@ -1516,7 +1557,7 @@ thread_exit(void)
 	GRAB_THREAD_LOCK();
 
 	// remove thread from hash, so it's no longer accessible
-	hash_remove(sThreadHash, thread);
+	sThreadHash.Remove(thread);
 	sUsedThreads--;
 
 	// Stop debugging for this thread
@@ -1629,11 +1670,7 @@ thread_get_thread_struct(thread_id id)
 struct thread *
 thread_get_thread_struct_locked(thread_id id)
 {
-	struct thread_key key;
-
-	key.id = id;
-
-	return (struct thread*)hash_lookup(sThreadHash, &key);
+	return sThreadHash.Lookup(id);
 }
 
 
@@ -1780,18 +1817,14 @@ thread_dequeue_id(struct thread_queue *q, thread_id id)
 struct thread*
 thread_iterate_through_threads(thread_iterator_callback callback, void* cookie)
 {
-	struct hash_iterator iterator;
-	hash_open(sThreadHash, &iterator);
+	ThreadHashTable::Iterator iterator = sThreadHash.GetIterator();
 
 	struct thread* thread;
-	while ((thread = (struct thread*)hash_next(sThreadHash, &iterator))
-			!= NULL) {
+	while ((thread = iterator.Next()) != NULL) {
 		if (callback(thread, cookie))
 			break;
 	}
 
-	hash_close(sThreadHash, &iterator, false);
-
 	return thread;
 }
 
@@ -2108,8 +2141,8 @@ thread_init(kernel_args *args)
 	TRACE(("thread_init: entry\n"));
 
 	// create the thread hash table
-	sThreadHash = hash_init(15, offsetof(struct thread, all_next),
-		&thread_struct_compare, &thread_struct_hash);
+	if (sThreadHash.Init(kInitialThreadHashSize) != B_OK)
+		panic("thread_init(): failed to create thread hash table!");
 
 	// zero out the dead thread structure q
 	memset(&dead_q, 0, sizeof(dead_q));
@@ -2151,7 +2184,7 @@ thread_init(kernel_args *args)
 		thread->kernel_stack_base = (addr_t)info.address;
 		thread->kernel_stack_top = thread->kernel_stack_base + info.size;
 
-		hash_insert(sThreadHash, thread);
+		sThreadHash.Insert(thread);
 		insert_thread_into_team(thread->team, thread);
 	}
 	sUsedThreads = args->num_cpus;
@@ -2499,7 +2532,6 @@ _get_next_thread_info(team_id teamID, int32 *_cookie, thread_info *info,
 thread_id
 find_thread(const char *name)
 {
-	struct hash_iterator iterator;
 	struct thread *thread;
 	cpu_status state;
 
@@ -2514,9 +2546,8 @@ find_thread(const char *name)
 	// ToDo: scanning the whole list with the thread lock held isn't exactly
 	//		cheap either - although this function is probably used very rarely.
 
-	hash_open(sThreadHash, &iterator);
-	while ((thread = (struct thread*)hash_next(sThreadHash, &iterator))
-			!= NULL) {
+	ThreadHashTable::Iterator iterator = sThreadHash.GetIterator();
+	while ((thread = iterator.Next()) != NULL) {
 		// Search through hash
 		if (thread->name != NULL && !strcmp(thread->name, name)) {
 			thread_id id = thread->id;
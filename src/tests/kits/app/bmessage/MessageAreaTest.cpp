@@ -0,0 +1,241 @@
+/*
+ * Copyright 2010, Haiku.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include "MessageAreaTest.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <Message.h>
+#include <Messenger.h>
+#include <OS.h>
+
+#include <MessagePrivate.h>
+#include <TokenSpace.h>
+
+
+// large enough to be passed by area
+static const size_t kLargeDataSize = 64 * 1024;
+
+
+static team_id
+current_team()
+{
+	thread_info info;
+	if (get_thread_info(find_thread(NULL), &info) != B_OK)
+		return -1;
+
+	return info.team;
+}
+
+
+static int32
+count_message_areas()
+{
+	int32 count = 0;
+	ssize_t cookie = 0;
+	area_info info;
+	while (get_next_area_info(current_team(), &cookie, &info) == B_OK) {
+		if (strcmp(info.name, "BMessage data") == 0)
+			count++;
+	}
+
+	return count;
+}
+
+
+/*!	Sends a message with \a size bytes of \a fill to \a port, and bypasses
+	the direct delivery to loopers of the same team, so that it is passed
+	by area like messages to other teams.
+*/
+static status_t
+send_large_message(port_id port, size_t size, uint8 fill)
+{
+	uint8* data = (uint8*)malloc(size);
+	if (data == NULL)
+		return B_NO_MEMORY;
+
+	memset(data, fill, size);
+
+	BMessage message('larg');
+	status_t status = message.AddData("data", B_RAW_TYPE, data, size);
+	free(data);
+	if (status != B_OK)
+		return status;
+
+	BMessenger replyTo;
+	return BMessage::Private(message).SendMessage(port, current_team(),
+		B_NULL_TOKEN, B_INFINITE_TIMEOUT, false, replyTo);
+}
+
+
+/*!	Reads the next message header from \a port into \a buffer, which must
+	be large enough to hold it.
+*/
+static BMessage::message_header*
+receive_message_header(port_id port, char* buffer, size_t size)
+{
+	int32 code;
+	ssize_t bytesRead = read_port(port, &code, buffer, size);
+	if (bytesRead < (ssize_t)sizeof(BMessage::message_header))
+		return NULL;
+
+	return (BMessage::message_header*)buffer;
+}
+
+
+static bool
+check_data(const BMessage& message, size_t size, uint8 fill)
+{
+	const uint8* data;
+	ssize_t dataSize;
+	if (message.FindData("data", B_RAW_TYPE, (const void**)&data, &dataSize)
+			!= B_OK || (size_t)dataSize != size)
+		return false;
+
+	for (size_t i = 0; i < size; i++) {
+		if (data[i] != fill)
+			return false;
+	}
+
+	return true;
+}
+
+
+/*!	The receiver must not be able to write to the area of a message it
+	received, only read the fields in place, and copy them to change them.
+*/
+void
+TMessageAreaTest::MessageAreaTestWriteProtection()
+{
+	port_id port = create_port(10, "message area test");
+	CPPUNIT_ASSERT(port >= 0);
+
+	CPPUNIT_ASSERT(send_large_message(port, kLargeDataSize, 0x42) == B_OK);
+
+	char buffer[sizeof(BMessage::message_header)];
+	BMessage::message_header* header
+		= receive_message_header(port, buffer, sizeof(buffer));
+	CPPUNIT_ASSERT(header != NULL);
+	CPPUNIT_ASSERT((header->flags & MESSAGE_FLAG_PASS_BY_AREA) != 0);
+
+	area_info info;
+	CPPUNIT_ASSERT(get_area_info(header->message_area, &info) == B_OK);
+	CPPUNIT_ASSERT((info.protection & B_READ_AREA) != 0);
+	CPPUNIT_ASSERT((info.protection & B_WRITE_AREA) == 0);
+
+	BMessage message;
+	CPPUNIT_ASSERT(message.Unflatten(buffer) == B_OK);
+	CPPUNIT_ASSERT(check_data(message, kLargeDataSize, 0x42));
+
+	// the data is read in place
+	CPPUNIT_ASSERT(BMessage::Private(message).GetMessageData()
+		>= (uint8*)info.address);
+	CPPUNIT_ASSERT(BMessage::Private(message).GetMessageData()
+		< (uint8*)info.address + info.size);
+
+	// changing the message copies it out of the area first
+	CPPUNIT_ASSERT(message.AddInt32("more", 1) == B_OK);
+	CPPUNIT_ASSERT(BMessage::Private(message).GetMessageData()
+		< (uint8*)info.address
+		|| BMessage::Private(message).GetMessageData()
+			>= (uint8*)info.address + info.size);
+	CPPUNIT_ASSERT(check_data(message, kLargeDataSize, 0x42));
+
+	delete_port(port);
+}
+
+
+/*!	A message area that a team is done with is kept to send the next large
+	message, and does not contain any data of its previous message anymore.
+*/
+void
+TMessageAreaTest::MessageAreaTestReuse()
+{
+	port_id port = create_port(10, "message area test");
+	CPPUNIT_ASSERT(port >= 0);
+
+	char buffer[sizeof(BMessage::message_header)];
+
+	CPPUNIT_ASSERT(send_large_message(port, kLargeDataSize, 0x11) == B_OK);
+	CPPUNIT_ASSERT(receive_message_header(port, buffer, sizeof(buffer))
+		!= NULL);
+
+	BMessage* message = new BMessage;
+	CPPUNIT_ASSERT(message->Unflatten(buffer) == B_OK);
+	CPPUNIT_ASSERT(check_data(*message, kLargeDataSize, 0x11));
+
+	// the area is kept when the message goes away
+	int32 areaCount = count_message_areas();
+	delete message;
+	CPPUNIT_ASSERT(count_message_areas() == areaCount);
+
+	// a smaller message reuses it, instead of creating another one
+	size_t size = kLargeDataSize / 2;
+	CPPUNIT_ASSERT(send_large_message(port, size, 0x22) == B_OK);
+	BMessage::message_header* header
+		= receive_message_header(port, buffer, sizeof(buffer));
+	CPPUNIT_ASSERT(header != NULL);
+	CPPUNIT_ASSERT(count_message_areas() == areaCount);
+
+	// the rest of the area was cleared
+	area_info info;
+	CPPUNIT_ASSERT(get_area_info(header->message_area, &info) == B_OK);
+	size_t usedSize = header->field_count * sizeof(BMessage::field_header)
+		+ header->data_size;
+	CPPUNIT_ASSERT(usedSize <= info.size);
+	for (size_t i = usedSize; i < info.size; i++)
+		CPPUNIT_ASSERT(((uint8*)info.address)[i] == 0);
+
+	message = new BMessage;
+	CPPUNIT_ASSERT(message->Unflatten(buffer) == B_OK);
+	CPPUNIT_ASSERT(check_data(*message, size, 0x22));
+	delete message;
+
+	delete_port(port);
+}
+
+
+/*!	Large message areas are not kept, so that they don't use up the memory
+	of a team that once received a large message.
+*/
+void
+TMessageAreaTest::MessageAreaTestCacheLimit()
+{
+	port_id port = create_port(10, "message area test");
+	CPPUNIT_ASSERT(port >= 0);
+
+	char buffer[sizeof(BMessage::message_header)];
+
+	size_t size = 1024 * 1024;
+	CPPUNIT_ASSERT(send_large_message(port, size, 0x33) == B_OK);
+	CPPUNIT_ASSERT(receive_message_header(port, buffer, sizeof(buffer))
+		!= NULL);
+
+	BMessage* message = new BMessage;
+	CPPUNIT_ASSERT(message->Unflatten(buffer) == B_OK);
+	CPPUNIT_ASSERT(check_data(*message, size, 0x33));
+
+	int32 areaCount = count_message_areas();
+	delete message;
+	CPPUNIT_ASSERT(count_message_areas() == areaCount - 1);
+
+	delete_port(port);
+}
+
+
+TestSuite*
+TMessageAreaTest::Suite()
+{
+	TestSuite* suite = new TestSuite("BMessage::Message areas");
+
+	ADD_TEST4(BMessage, suite, TMessageAreaTest,
+		MessageAreaTestWriteProtection);
+	ADD_TEST4(BMessage, suite, TMessageAreaTest, MessageAreaTestReuse);
+	ADD_TEST4(BMessage, suite, TMessageAreaTest, MessageAreaTestCacheLimit);
+
+	return suite;
+}
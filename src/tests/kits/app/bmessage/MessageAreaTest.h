@@ -0,0 +1,27 @@
+/*
+ * Copyright 2010, Haiku.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef _MESSAGE_AREA_TEST_H_
+#define _MESSAGE_AREA_TEST_H_
+
+
+#include "../common.h"
+
+
+class TMessageAreaTest : public TestCase {
+public:
+					TMessageAreaTest() {};
+					TMessageAreaTest(std::string name)
+						: TestCase(name)
+					{};
+
+		void		MessageAreaTestWriteProtection();
+		void		MessageAreaTestReuse();
+		void		MessageAreaTestCacheLimit();
+
+static	TestSuite*	Suite();
+};
+
+
+#endif	// _MESSAGE_AREA_TEST_H_
@@ -22,6 +22,7 @@
 #include "MessagePointerItemTest.h"
 #include "MessageFlattenableItemTest.h"
 #include "MessageSpeedTest.h"
+#include "MessageAreaTest.h"
 
 Test* MessageTestSuite()
 {
@@ -48,6 +49,7 @@ Test* MessageTestSuite()
 	tests->addTest(TMessagePointerItemTest::Suite());
 	tests->addTest(TMessageFlattenableItemTest::Suite());
 	tests->addTest(TMessageSpeedTest::Suite());
+	tests->addTest(TMessageAreaTest::Suite());
 
 	return tests;
 }
@@ -0,0 +1,151 @@
+/*
+ * Copyright 2010, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+/*!	Measures the per message overhead of the looper message loop: two
+	loopers bounce a message back and forth, and then several threads post
+	messages to a single looper at the same time.
+*/
+
+
+#include <Looper.h>
+#include <Message.h>
+#include <Messenger.h>
+
+#include <OS.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+
+static const uint32 kPing = 'ping';
+static const uint32 kFlood = 'fldd';
+static const int32 kRounds = 100000;
+static const int32 kProducers = 4;
+static const int32 kMessagesPerProducer = 50000;
+
+
+class PingPongLooper : public BLooper {
+public:
+	PingPongLooper(const char* name, sem_id doneSemaphore)
+		:
+		BLooper(name),
+		fDoneSemaphore(doneSemaphore),
+		fReceived(0)
+	{
+	}
+
+	void SetPeer(BLooper* peer)
+	{
+		fPeer = BMessenger(peer);
+	}
+
+	virtual void MessageReceived(BMessage* message)
+	{
+		switch (message->what) {
+			case kPing:
+			{
+				int32 round = message->FindInt32("round");
+				if (round >= kRounds) {
+					release_sem(fDoneSemaphore);
+					break;
+				}
+
+				message->ReplaceInt32("round", round + 1);
+				fPeer.SendMessage(message);
+				break;
+			}
+
+			case kFlood:
+				if (++fReceived == kProducers * kMessagesPerProducer)
+					release_sem(fDoneSemaphore);
+				break;
+
+			default:
+				BLooper::MessageReceived(message);
+				break;
+		}
+	}
+
+private:
+	BMessenger	fPeer;
+	sem_id		fDoneSemaphore;
+	int32		fReceived;
+};
+
+
+static status_t
+producer_thread(void* data)
+{
+	BMessenger target((BLooper*)data);
+	BMessage message(kFlood);
+
+	for (int32 i = 0; i < kMessagesPerProducer; i++) {
+		if (target.SendMessage(&message) != B_OK)
+			return B_ERROR;
+	}
+
+	return B_OK;
+}
+
+
+static void
+print_result(const char* name, bigtime_t time, int32 count)
+{
+	printf("%-12s %8lld us for %ld messages, %.2f us per message\n", name,
+		time, count, (double)time / count);
+}
+
+
+int
+main()
+{
+	sem_id doneSemaphore = create_sem(0, "done");
+
+	PingPongLooper* ping = new PingPongLooper("ping", doneSemaphore);
+	PingPongLooper* pong = new PingPongLooper("pong", doneSemaphore);
+	ping->SetPeer(pong);
+	pong->SetPeer(ping);
+	ping->Run();
+	pong->Run();
+
+	// ping-pong between two loopers
+
+	BMessage message(kPing);
+	message.AddInt32("round", 0);
+
+	bigtime_t start = system_time();
+	BMessenger(ping).SendMessage(&message);
+	acquire_sem(doneSemaphore);
+	print_result("ping-pong", system_time() - start, kRounds);
+
+	// several producers flooding a single looper
+
+	thread_id threads[kProducers];
+	for (int32 i = 0; i < kProducers; i++) {
+		threads[i] = spawn_thread(&producer_thread, "producer",
+			B_NORMAL_PRIORITY, pong);
+	}
+
+	start = system_time();
+	for (int32 i = 0; i < kProducers; i++)
+		resume_thread(threads[i]);
+
+	acquire_sem(doneSemaphore);
+	print_result("flood", system_time() - start,
+		kProducers * kMessagesPerProducer);
+
+	for (int32 i = 0; i < kProducers; i++) {
+		status_t result;
+		wait_for_thread(threads[i], &result);
+	}
+
+	ping->Lock();
+	ping->Quit();
+	pong->Lock();
+	pong->Quit();
+
+	delete_sem(doneSemaphore);
+	return 0;
+}
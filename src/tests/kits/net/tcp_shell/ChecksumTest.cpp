@@ -0,0 +1,335 @@
+/*
+ * Copyright 2010, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include "utility.h"
+
+#include <net_buffer.h>
+#include <net_socket.h>
+
+#include <ByteOrder.h>
+#include <OS.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+extern "C" status_t _add_builtin_module(module_info *info);
+
+extern struct net_buffer_module_info gNetBufferModule;
+	// from net_buffer.cpp
+
+struct net_socket_module_info gNetSocketModule;
+struct net_buffer_module_info* gBufferModule;
+
+static const size_t kMaxSize = 65536;
+
+static uint8 sData[kMaxSize + 16];
+static uint8 sCopy[kMaxSize + 16];
+static int32 sFailures = 0;
+
+
+static void
+fail(const char* test, size_t length, size_t alignment, uint16 expected,
+	uint16 result)
+{
+	printf("%s failed for %lu bytes at alignment %lu: expected %04x, got "
+		"%04x\n", test, length, alignment, expected, result);
+	sFailures++;
+}
+
+
+/*!	Straight forward implementation of the Internet checksum, used as a
+	reference.
+*/
+static uint16
+reference_checksum(const uint8* data, size_t length)
+{
+	uint32 sum = 0;
+
+	while (length >= 2) {
+		uint16 value;
+		memcpy(&value, data, 2);
+		sum += value;
+		data += 2;
+		length -= 2;
+	}
+
+	if (length) {
+		uint8 ordered[2] = { data[0], 0 };
+		uint16 value;
+		memcpy(&value, ordered, 2);
+		sum += value;
+	}
+
+	while (sum >> 16)
+		sum = (sum & 0xffff) + (sum >> 16);
+
+	return sum;
+}
+
+
+static void
+fill_random(uint8* data, size_t length)
+{
+	for (size_t i = 0; i < length; i++)
+		data[i] = rand();
+}
+
+
+static void
+test_compute_checksum()
+{
+	fill_random(sData, sizeof(sData));
+
+	for (size_t alignment = 0; alignment < 4; alignment++) {
+		for (size_t length = 0; length < 512; length++) {
+			uint16 expected = reference_checksum(sData + alignment, length);
+			uint16 result = compute_checksum(sData + alignment, length);
+			if (result != expected)
+				fail("compute_checksum", length, alignment, expected, result);
+
+			memset(sCopy, 0, sizeof(sCopy));
+			result = compute_checksum_copy(sCopy + alignment,
+				sData + alignment, length);
+			if (result != expected) {
+				fail("compute_checksum_copy", length, alignment, expected,
+					result);
+			}
+			if (memcmp(sCopy + alignment, sData + alignment, length) != 0) {
+				printf("compute_checksum_copy did not copy %lu bytes at "
+					"alignment %lu\n", length, alignment);
+				sFailures++;
+			}
+		}
+	}
+
+	// all bits set must not overflow
+	memset(sData, 0xff, sizeof(sData));
+	uint16 expected = reference_checksum(sData, kMaxSize);
+	uint16 result = compute_checksum(sData, kMaxSize);
+	if (result != expected)
+		fail("compute_checksum", kMaxSize, 0, expected, result);
+}
+
+
+static void
+test_update_checksum()
+{
+	uint16 header[10];
+
+	for (int32 i = 0; i < 10000; i++) {
+		fill_random((uint8*)header, sizeof(header));
+		header[5] = 0;
+		header[5] = checksum((uint8*)header, sizeof(header));
+
+		int32 index = rand() % 10;
+		if (index == 5)
+			continue;
+
+		uint16 value = rand();
+		header[5] = update_checksum(header[5], header[index], value);
+		header[index] = value;
+
+		// a correct checksum sums up to zero
+		uint16 result = checksum((uint8*)header, sizeof(header));
+		if (result != 0) {
+			fail("update_checksum", sizeof(header), 0, 0, result);
+			return;
+		}
+	}
+}
+
+
+static void
+check_buffer_checksum(net_buffer* buffer, const char* test)
+{
+	if (gBufferModule->read(buffer, 0, sCopy, buffer->size) != B_OK) {
+		printf("%s: reading the buffer failed\n", test);
+		sFailures++;
+		return;
+	}
+
+	for (uint32 offset = 0; offset < buffer->size; offset += 7) {
+		size_t size = buffer->size - offset;
+		uint16 expected = reference_checksum(sCopy + offset, size);
+		uint16 result = gBufferModule->checksum(buffer, offset, size, false);
+
+		// the buffer sums relative to its start, so the bytes are swapped
+		// when starting at an uneven offset
+		if ((offset & 1) != 0)
+			expected = __swap_int16(expected);
+
+		// the result may only differ in the representation of zero
+		if (result != expected
+			&& !(result == 0xffff && expected == 0)
+			&& !(result == 0 && expected == 0xffff)) {
+			fail(test, size, offset, expected, result);
+			return;
+		}
+	}
+}
+
+
+static void
+test_buffer_checksum()
+{
+	fill_random(sData, sizeof(sData));
+
+	for (int32 i = 0; i < 200; i++) {
+		net_buffer* buffer = gBufferModule->create(256);
+		if (buffer == NULL) {
+			printf("creating a buffer failed!\n");
+			sFailures++;
+			return;
+		}
+
+		// append data in chunks of odd sizes that spread over several nodes
+		size_t chunks = 1 + rand() % 8;
+		for (size_t chunk = 0; chunk < chunks; chunk++) {
+			size_t offset = rand() % 1024;
+			gBufferModule->append(buffer, sData + offset, rand() % 3000);
+		}
+		check_buffer_checksum(buffer, "checksum after append");
+
+		// prepend headers of odd sizes
+		gBufferModule->prepend(buffer, sData + 1, 8);
+		gBufferModule->prepend(buffer, sData + 3, 21);
+		check_buffer_checksum(buffer, "checksum after prepend");
+
+		gBufferModule->remove_header(buffer, 21);
+		check_buffer_checksum(buffer, "checksum after remove_header");
+
+		if (buffer->size > 64) {
+			gBufferModule->write(buffer, buffer->size / 2, sData + 5, 3);
+			check_buffer_checksum(buffer, "checksum after write");
+
+			gBufferModule->remove_trailer(buffer, 17);
+			check_buffer_checksum(buffer, "checksum after remove_trailer");
+
+			gBufferModule->remove_header(buffer, 13);
+			check_buffer_checksum(buffer, "checksum after remove_header");
+		}
+
+		gBufferModule->free(buffer);
+	}
+}
+
+
+static void
+test_append_checksum()
+{
+	fill_random(sData, sizeof(sData));
+
+	for (int32 i = 0; i < 200; i++) {
+		net_buffer* buffer = gBufferModule->create(256);
+		if (buffer == NULL) {
+			printf("creating a buffer failed!\n");
+			sFailures++;
+			return;
+		}
+
+		// append only odd sized chunks, so that every other one starts at an
+		// uneven offset, and make them large enough to span several nodes
+		size_t chunks = 2 + rand() % 8;
+		for (size_t chunk = 0; chunk < chunks; chunk++) {
+			size_t offset = rand() % 1024;
+			gBufferModule->append(buffer, sData + offset,
+				(rand() % 3000) | 1);
+		}
+
+		if (gBufferModule->read(buffer, 0, sCopy, buffer->size) != B_OK) {
+			printf("reading the buffer failed\n");
+			sFailures++;
+			gBufferModule->free(buffer);
+			return;
+		}
+
+		uint16 expected = reference_checksum(sCopy, buffer->size);
+		uint16 cached = gBufferModule->checksum(buffer, 0, buffer->size,
+			false);
+
+		// rewriting the first byte drops the cached sum, forcing a full one
+		gBufferModule->write(buffer, 0, sCopy, 1);
+		uint16 full = gBufferModule->checksum(buffer, 0, buffer->size, false);
+
+		if (cached != expected)
+			fail("cached checksum after append", buffer->size, 0, expected,
+				cached);
+		if (cached != full)
+			fail("cached vs. full checksum", buffer->size, 0, full, cached);
+
+		gBufferModule->free(buffer);
+	}
+}
+
+
+static void
+test_throughput()
+{
+	const int32 kRuns = 2000;
+	fill_random(sData, sizeof(sData));
+
+	uint16 sum = 0;
+	bigtime_t start = system_time();
+	for (int32 i = 0; i < kRuns; i++)
+		sum += reference_checksum(sData, kMaxSize);
+	bigtime_t reference = system_time() - start;
+
+	start = system_time();
+	for (int32 i = 0; i < kRuns; i++)
+		sum += compute_checksum(sData, kMaxSize);
+	bigtime_t compute = system_time() - start;
+
+	start = system_time();
+	for (int32 i = 0; i < kRuns; i++)
+		sum += compute_checksum_copy(sCopy, sData, kMaxSize);
+	bigtime_t computeCopy = system_time() - start;
+
+	start = system_time();
+	for (int32 i = 0; i < kRuns; i++)
+		memcpy(sCopy, sData, kMaxSize);
+	bigtime_t copy = system_time() - start;
+
+	double megabytes = (double)kRuns * kMaxSize / (1024 * 1024);
+	printf("reference checksum:    %8.1f MB/s\n",
+		megabytes * 1000000 / reference);
+	printf("compute_checksum:      %8.1f MB/s\n",
+		megabytes * 1000000 / compute);
+	printf("compute_checksum_copy: %8.1f MB/s\n",
+		megabytes * 1000000 / computeCopy);
+	printf("memcpy:                %8.1f MB/s\n",
+		megabytes * 1000000 / copy);
+	printf("(sum %04x)\n", sum);
+}
+
+
+int
+main()
+{
+	_add_builtin_module((module_info*)&gNetBufferModule);
+	get_module(NET_BUFFER_MODULE_NAME, (module_info**)&gBufferModule);
+
+	srand(system_time());
+
+	test_compute_checksum();
+	test_update_checksum();
+	test_buffer_checksum();
+	test_append_checksum();
+
+	if (sFailures == 0)
+		test_throughput();
+
+	put_module(NET_BUFFER_MODULE_NAME);
+
+	if (sFailures != 0) {
+		printf("%ld tests failed!\n", sFailures);
+		return 1;
+	}
+
+	printf("All tests passed.\n");
+	return 0;
+}
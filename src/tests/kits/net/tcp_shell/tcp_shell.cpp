@@ -230,6 +230,7 @@ static net_stack_module_info gNetStackModule = {
 	notify_socket,
 
 	checksum,
+	update_checksum,
 
 	init_fifo,
 	uninit_fifo,
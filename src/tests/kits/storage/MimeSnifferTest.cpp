@@ -5,6 +5,7 @@
 #include <cppunit/Test.h>
 #include <cppunit/TestSuite.h>
 #include <cppunit/TestCaller.h>
+#include <sniffer/Matcher.h>
 #include <sniffer/Rule.h>
 #include <sniffer/Parser.h>
 #include <DataIO.h>
@@ -29,6 +30,8 @@ MimeSnifferTest::Suite() {
 						   &MimeSnifferTest::ParserTest) );		
 	suite->addTest( new TC("Mime Sniffer::Sniffer Test",
 						   &MimeSnifferTest::SnifferTest) );		
+	suite->addTest( new TC("Mime Sniffer::Matcher Test",
+						   &MimeSnifferTest::MatcherTest) );
 						   
 	return suite;
 }		
@@ -1383,3 +1386,93 @@ std::string("\000\034	000 034", 10),	// Otherwise, it thinks the NULL is the end
 	}
 #endif // !TEST_R5
 }
+
+// Matcher Test
+/*! Checks that the compiled Matcher finds exactly the same rules as
+	Rule::Sniff() does, both for every rule on its own, and for the first
+	matching rule of all of them, over a pseudo random corpus that contains
+	the patterns at various offsets.
+*/
+void
+MimeSnifferTest::MatcherTest() {
+#if TEST_R5
+	Outputf("(no tests actually performed for R5 version)\n");
+#else	// TEST_R5
+	const char *rules[] = {
+		"0.50 ('#include')",
+		"0.20 [0:32] ('#include')",
+		".2 ([0:32] \"#include\" | [0] '#define' | [0:200] 'int main(')",
+		"0.60 [0:32] ('<html>' | '<head>' | '<body>')",
+		"0.40 [0:9] ('rock' | 'roll')",
+		"0.40 ([9] 'rock' | [10] 'roll')",
+		"0.40 ([4] 'rock') ([9] 'roll')",
+		"0.40 [4] (-i 'Rock' | 'Roll')",
+		"0.40 (-i [4] 'Rock' | [9] 'Roll')",
+		"0.30 [0:100] (-i 'ROCK' | 'rOll')",
+		"0.30 [0:100] (-i \"r\\xFFck\" & \"\\xFF\\x00\\xFF\\xFF\")",
+		"0.70 (\\xFF\\xFF & '\\xF0\\xF0')",
+		"0.70 ('\\33\\34' & \\xFF\\x00)",
+		"0.70 (\\xFF & \\x05)",
+		"0.80 (\"GIF8\")",
+		"0.80 (\"\\x89PNG\")",
+		"0.80 (\"RIFF\") [8] (\"WAVE\")",
+		"0.50 [0:64] (-i \"<!DOCTYPE HTML\")",
+		"0.90 (\"%PDF\")",
+	};
+	const int ruleCount = sizeof(rules) / sizeof(const char*);
+	const char *fragments[] = {
+		"#include", "#define", "int main(", "<html>", "<BODY>", "rock",
+		"Roll", "ROCK", "r\377ck", "\360\360", "\033", "GIF89a", "\211PNG",
+		"RIFF", "WAVE", "<!doctype html", "%PDF",
+	};
+	const int fragmentCount = sizeof(fragments) / sizeof(const char*);
+
+	Rule parsedRules[ruleCount];
+	Matcher matcher;
+	for (int i = 0; i < ruleCount; i++) {
+		BString errorMsg;
+		CHK(parse(rules[i], &parsedRules[i], &errorMsg) == B_OK);
+		CHK(matcher.AddRule(&parsedRules[i]) == B_OK);
+	}
+	CHK(matcher.Compile() == B_OK);
+	CHK(matcher.CountRules() == ruleCount);
+
+	uint32 seed = 42;
+	for (int i = 0; i < 2000; i++) {
+		NextSubTest();
+
+		// build some semi random data with a few of the fragments in it
+		seed = seed * 1103515245 + 12345;
+		size_t length = (seed >> 16) % 512;
+		std::string data;
+		for (size_t j = 0; j < length; j++) {
+			seed = seed * 1103515245 + 12345;
+			data += (char)(seed >> 16);
+		}
+		for (int j = i % 4; j > 0 && length > 0; j--) {
+			seed = seed * 1103515245 + 12345;
+			const char *fragment = fragments[(seed >> 16) % fragmentCount];
+			seed = seed * 1103515245 + 12345;
+			size_t offset = (seed >> 16)
+				% (j == 1 ? min_c(data.length(), 16) : data.length());
+			data.replace(offset, 0, fragment);
+		}
+
+		BMemoryIO io(data.data(), data.length());
+		int32 firstMatch = -1;
+		for (int j = 0; j < ruleCount; j++) {
+			bool match = parsedRules[j].Sniff(&io);
+			if (match && firstMatch < 0)
+				firstMatch = j;
+
+			Matcher single;
+			CHK(single.AddRule(&parsedRules[j]) == B_OK);
+			CHK(single.Compile() == B_OK);
+			CHK((single.Match(data.data(), data.length()) == 0) == match);
+		}
+
+		CHK(matcher.Match(data.data(), data.length()) == firstMatch);
+	}
+#endif // !TEST_R5
+}
+
@@ -185,6 +185,10 @@ ResourcesTest::Suite() {
 						   &ResourcesTest::AddRemoveTest) );
 	suite->addTest( new TC("BResources::ReadWrite Test",
 						   &ResourcesTest::ReadWriteTest) );
+	suite->addTest( new TC("BResources::MappedFile Test",
+						   &ResourcesTest::MappedFileTest) );
+	suite->addTest( new TC("BResources::WriteToSameFile Test",
+						   &ResourcesTest::WriteToSameFileTest) );
 
 	return suite;
 }		
@@ -1527,7 +1531,116 @@ ResourcesTest::ReadWriteTest()
 	}
 }
 
+// MappedFileTest
+void
+ResourcesTest::MappedFileTest()
+{
+	ResourceSet resourceSet;
+	resourceSet.add(&testResource1);
+	resourceSet.add(&testResource2);
+	resourceSet.add(&testResource3);
+	// open the same file twice
+	NextSubTest();
+	{
+		BFile file1(x86ResFile, B_READ_ONLY);
+		BFile file2(x86ResFile, B_READ_ONLY);
+		CPPUNIT_ASSERT( file1.InitCheck() == B_OK );
+		CPPUNIT_ASSERT( file2.InitCheck() == B_OK );
+		BResources resources1;
+		BResources resources2;
+		CPPUNIT_ASSERT( resources1.SetTo(&file1, false) == B_OK );
+		CPPUNIT_ASSERT( resources2.SetTo(&file2, false) == B_OK );
+		CompareResources(resources1, resourceSet);
+		CompareResources(resources2, resourceSet);
+#if !TEST_R5 && B_HOST_IS_LENDIAN
+		// both share the mapping of the file
+		const void *data1 = resources1.LoadResource(testResource1.type,
+													testResource1.id, NULL);
+		const void *data2 = resources2.LoadResource(testResource1.type,
+													testResource1.id, NULL);
+		CPPUNIT_ASSERT( data1 != NULL && data1 == data2 );
+#endif
+	}
+	// the file is changed in between: the new contents must be seen
+	NextSubTest();
+	execCommand(string("cp ") + x86ResFile + " " + testFile1);
+	{
+		BFile file1(testFile1, B_READ_ONLY);
+		CPPUNIT_ASSERT( file1.InitCheck() == B_OK );
+		BResources resources1;
+		CPPUNIT_ASSERT( resources1.SetTo(&file1, false) == B_OK );
+		CompareResources(resources1, resourceSet);
+		{
+			BFile file(testFile1, B_READ_WRITE);
+			CPPUNIT_ASSERT( file.InitCheck() == B_OK );
+			BResources resources;
+			CPPUNIT_ASSERT( resources.SetTo(&file, false) == B_OK );
+			resourceSet.add(&testResource4);
+			CPPUNIT_ASSERT( resources.AddResource(testResource4.type,
+												  testResource4.id,
+												  testResource4.data,
+												  testResource4.size,
+												  testResource4.name)
+							== B_OK );
+			CPPUNIT_ASSERT( resources.Sync() == B_OK );
+		}
+		BFile file2(testFile1, B_READ_ONLY);
+		CPPUNIT_ASSERT( file2.InitCheck() == B_OK );
+		BResources resources2;
+		CPPUNIT_ASSERT( resources2.SetTo(&file2, false) == B_OK );
+		CompareResources(resources2, resourceSet);
+	}
+}
 
-
-
-
+// WriteToSameFileTest
+void
+ResourcesTest::WriteToSameFileTest()
+{
+	ResourceSet resourceSet;
+	resourceSet.add(&testResource1);
+	resourceSet.add(&testResource2);
+	resourceSet.add(&testResource3);
+	// open a file read-only, and write its resources to the same file
+	NextSubTest();
+	execCommand(string("cp ") + x86ResFile + " " + testFile1);
+	{
+		BFile file(testFile1, B_READ_ONLY);
+		CPPUNIT_ASSERT( file.InitCheck() == B_OK );
+		BResources resources;
+		CPPUNIT_ASSERT( resources.SetTo(&file, false) == B_OK );
+		CompareResources(resources, resourceSet);
+		BFile file2(testFile1, B_READ_WRITE);
+		CPPUNIT_ASSERT( file2.InitCheck() == B_OK );
+		CPPUNIT_ASSERT( resources.WriteTo(&file2) == B_OK );
+		CompareResources(resources, resourceSet);
+	}
+	{
+		BFile file(testFile1, B_READ_ONLY);
+		CPPUNIT_ASSERT( file.InitCheck() == B_OK );
+		BResources resources;
+		CPPUNIT_ASSERT( resources.SetTo(&file, false) == B_OK );
+		CompareResources(resources, resourceSet);
+	}
+	// preload the resources, and write them to the same file, truncating
+	// it first
+	NextSubTest();
+	execCommand(string("cp ") + x86ResFile + " " + testFile1);
+	{
+		BFile file(testFile1, B_READ_ONLY);
+		CPPUNIT_ASSERT( file.InitCheck() == B_OK );
+		BResources resources;
+		CPPUNIT_ASSERT( resources.SetTo(&file, false) == B_OK );
+		CPPUNIT_ASSERT( resources.PreloadResourceType() == B_OK );
+		BFile file2(testFile1, B_READ_WRITE | B_ERASE_FILE);
+		CPPUNIT_ASSERT( file2.InitCheck() == B_OK );
+		CPPUNIT_ASSERT( resources.WriteTo(&file2) == B_OK );
+		CompareResources(resources, resourceSet);
+	}
+	{
+		BFile file(testFile1, B_READ_ONLY);
+		CPPUNIT_ASSERT( file.InitCheck() == B_OK );
+		BResources resources;
+		CPPUNIT_ASSERT( resources.SetTo(&file, false) == B_OK );
+		CompareResources(resources, resourceSet);
+	}
+}
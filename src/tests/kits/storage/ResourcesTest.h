@@ -33,6 +33,8 @@ public:
 	void AddRemoveTest();
 	void GetInfoTest();
 	void ReadWriteTest();
+	void MappedFileTest();
+	void WriteToSameFileTest();
 };
 
 
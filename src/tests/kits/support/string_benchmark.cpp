@@ -0,0 +1,145 @@
+/*
+ * Copyright 2010, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+/*!	Measures the BString operations that used to reallocate the buffer on
+	every call: appending, inserting, replacing, removing, and creating empty
+	strings.
+*/
+
+
+#include <stdio.h>
+
+#include <OS.h>
+#include <String.h>
+
+
+static const int32 kRounds = 10;
+static const int32 kAppendCount = 100000;
+static const int32 kEmptyCount = 1000000;
+
+
+static void
+print_result(const char* name, bigtime_t time, int32 operations)
+{
+	printf("%-32s %8.1f ns/op\n", name,
+		1000.0 * time / kRounds / operations);
+}
+
+
+static void
+benchmark_append()
+{
+	bigtime_t time = 0;
+	for (int32 round = 0; round < kRounds; round++) {
+		BString string;
+		bigtime_t start = system_time();
+		for (int32 i = 0; i < kAppendCount; i++)
+			string << 'x';
+		time += system_time() - start;
+	}
+	print_result("Append() single chars", time, kAppendCount);
+
+	time = 0;
+	for (int32 round = 0; round < kRounds; round++) {
+		BString string;
+		bigtime_t start = system_time();
+		for (int32 i = 0; i < kAppendCount; i++)
+			string << "some words ";
+		time += system_time() - start;
+	}
+	print_result("Append() words", time, kAppendCount);
+}
+
+
+static void
+benchmark_insert()
+{
+	static const int32 kCount = kAppendCount / 10;
+
+	bigtime_t time = 0;
+	for (int32 round = 0; round < kRounds; round++) {
+		BString string;
+		bigtime_t start = system_time();
+		for (int32 i = 0; i < kCount; i++)
+			string.Insert("word ", string.Length() / 2);
+		time += system_time() - start;
+	}
+	print_result("Insert() in the middle", time, kCount);
+}
+
+
+static void
+benchmark_replace(const char* name, const char* replace, const char* with)
+{
+	BString text;
+	for (int32 i = 0; i < kAppendCount; i++)
+		text << "a line of text, ";
+
+	bigtime_t time = 0;
+	for (int32 round = 0; round < kRounds; round++) {
+		BString string(text);
+		string.LockBuffer(0);
+		string.UnlockBuffer();
+			// make sure the copy isn't part of the measurement
+
+		bigtime_t start = system_time();
+		string.ReplaceAll(replace, with);
+		time += system_time() - start;
+	}
+	print_result(name, time, kAppendCount);
+}
+
+
+static void
+benchmark_remove()
+{
+	static const int32 kCount = kAppendCount / 10;
+
+	BString text;
+	for (int32 i = 0; i < kCount; i++)
+		text << "word ";
+
+	bigtime_t time = 0;
+	for (int32 round = 0; round < kRounds; round++) {
+		BString string(text);
+		bigtime_t start = system_time();
+		while (string.Length() > 0)
+			string.Remove(string.Length() / 2, 5);
+		time += system_time() - start;
+	}
+	print_result("Remove() from the middle", time, kCount);
+}
+
+
+static void
+benchmark_empty()
+{
+	bigtime_t time = 0;
+	for (int32 round = 0; round < kRounds; round++) {
+		bigtime_t start = system_time();
+		for (int32 i = 0; i < kEmptyCount; i++) {
+			BString string;
+			BString copy(string);
+		}
+		time += system_time() - start;
+	}
+	print_result("empty string construction", time, kEmptyCount);
+}
+
+
+int
+main(int argc, char** argv)
+{
+	benchmark_append();
+	benchmark_insert();
+	benchmark_replace("ReplaceAll() shrinking", "line", "row");
+	benchmark_replace("ReplaceAll() same length", "line", "LINE");
+	benchmark_replace("ReplaceAll() growing", "line", "paragraph");
+	benchmark_replace("RemoveAll() via ReplaceAll()", ", ", "");
+	benchmark_remove();
+	benchmark_empty();
+
+	return 0;
+}
@@ -17,6 +17,7 @@
 // tests
 #include "HorizontalLineTest.h"
 #include "RandomLineTest.h"
+#include "SmallRectTest.h"
 #include "StringTest.h"
 #include "VerticalLineTest.h"
 
@@ -29,6 +30,7 @@ struct test_info {
 const test_info kTestInfos[] = {
 	{ "HorizontalLines",	HorizontalLineTest::CreateTest },
 	{ "RandomLines",		RandomLineTest::CreateTest },
+	{ "SmallRects",			SmallRectTest::CreateTest },
 	{ "Strings",			StringTest::CreateTest },
 	{ "VerticalLines",		VerticalLineTest::CreateTest },
 	{ NULL, NULL }
@@ -133,6 +135,11 @@ main(int argc, char** argv)
 		drawing_mode possibleMode;
 		if (strcmp(argv[0], "--clipping") == 0 || strcmp(argv[0], "-c") == 0) {
 			clipping = true;
+		} else if (strcmp(argv[0], "--link-ring") == 0
+			|| strcmp(argv[0], "-r") == 0) {
+			// let the windows talk to the app_server through a shared
+			// memory ring buffer instead of their port
+			setenv("LINK_RING", "1", 1);
 		} else if (ToDrawingMode(argv[0], possibleMode)) {
 			mode = possibleMode;
 		}
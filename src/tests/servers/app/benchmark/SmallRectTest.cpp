@@ -0,0 +1,102 @@
+/*
+ * Copyright 2010, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+/*!	Fills lots of tiny rectangles, so that the time is spent mostly in
+	transferring the drawing commands to the app_server, and not in the
+	actual drawing. Run it with and without the "--link-ring" option to
+	compare the port based link with the shared memory ring.
+*/
+
+#include "SmallRectTest.h"
+
+#include <stdio.h>
+
+#include <View.h>
+
+
+static const float kRectSize = 3;
+static const float kSpacing = 5;
+
+
+SmallRectTest::SmallRectTest()
+	: Test(),
+	  fTestDuration(0),
+	  fTestStart(-1),
+
+	  fRectsRendered(0),
+
+	  fIterations(0),
+	  fMaxIterations(200),
+
+	  fViewBounds(0, 0, -1, -1)
+{
+}
+
+
+SmallRectTest::~SmallRectTest()
+{
+}
+
+
+void
+SmallRectTest::Prepare(BView* view)
+{
+	fViewBounds = view->Bounds();
+
+	fTestDuration = 0;
+	fRectsRendered = 0;
+	fIterations = 0;
+	fTestStart = system_time();
+}
+
+
+bool
+SmallRectTest::RunIteration(BView* view)
+{
+	bigtime_t now = system_time();
+
+	for (float y = fViewBounds.top; y + kRectSize <= fViewBounds.bottom;
+			y += kSpacing) {
+		for (float x = fViewBounds.left; x + kRectSize <= fViewBounds.right;
+				x += kSpacing) {
+			view->FillRect(BRect(x, y, x + kRectSize - 1, y + kRectSize - 1));
+			fRectsRendered++;
+		}
+	}
+
+	view->Sync();
+
+	fTestDuration += system_time() - now;
+	fIterations++;
+
+	return fIterations < fMaxIterations;
+}
+
+
+void
+SmallRectTest::PrintResults(BView* view)
+{
+	if (fTestDuration == 0) {
+		printf("Test was not run.\n");
+		return;
+	}
+	bigtime_t timeLeak = system_time() - fTestStart - fTestDuration;
+
+	Test::PrintResults(view);
+
+	printf("Rect size: %.0f\n", kRectSize);
+	printf("Total rects rendered: %llu\n", fRectsRendered);
+	printf("Rects per second: %.3f\n",
+		fRectsRendered * 1000000.0 / fTestDuration);
+	printf("Average time between iterations: %.4f seconds.\n",
+		(float)timeLeak / fIterations / 1000000);
+}
+
+
+Test*
+SmallRectTest::CreateTest()
+{
+	return new SmallRectTest();
+}
@@ -0,0 +1,34 @@
+/*
+ * Copyright 2010, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef SMALL_RECT_TEST_H
+#define SMALL_RECT_TEST_H
+
+#include <Rect.h>
+
+#include "Test.h"
+
+class SmallRectTest : public Test {
+public:
+								SmallRectTest();
+	virtual						~SmallRectTest();
+
+	virtual	void				Prepare(BView* view);
+	virtual	bool				RunIteration(BView* view);
+	virtual	void				PrintResults(BView* view);
+
+	static	Test*				CreateTest();
+
+private:
+	bigtime_t					fTestDuration;
+	bigtime_t					fTestStart;
+	uint64						fRectsRendered;
+
+	uint32						fIterations;
+	uint32						fMaxIterations;
+
+	BRect						fViewBounds;
+};
+
+#endif // SMALL_RECT_TEST_H
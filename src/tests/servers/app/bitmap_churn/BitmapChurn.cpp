@@ -0,0 +1,100 @@
+/*
+ * Copyright 2010, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+/*!	Creates and deletes bitmaps of random sizes, like a thumbnail browser
+	would, and prints how much client memory the app_server keeps for this
+	application. The area size should stay flat once the working set has
+	been reached.
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <Application.h>
+#include <Bitmap.h>
+#include <Font.h>
+
+#include <AppServerLink.h>
+#include <ServerProtocol.h>
+#include <ServerProtocolStructs.h>
+
+
+static const int32 kWorkingSet = 64;
+static const int32 kRounds = 10000;
+
+
+static bool
+get_statistics(ClientMemoryStatisticsInfo& info)
+{
+	BPrivate::AppServerLink link;
+	link.StartMessage(AS_GET_CLIENT_MEMORY_STATISTICS);
+
+	int32 code;
+	if (link.FlushWithReply(code) != B_OK || code != B_OK)
+		return false;
+
+	return link.Read<ClientMemoryStatisticsInfo>(&info) == B_OK;
+}
+
+
+static void
+print_statistics(int32 round)
+{
+	ClientMemoryStatisticsInfo info;
+	if (!get_statistics(info)) {
+		printf("Could not get the client memory statistics.\n");
+		return;
+	}
+
+	printf("%6ld: %8lld KB used, %8lld KB in %ld areas (peak %lld KB, "
+		"%lld KB released), %ld free blocks\n", round,
+		info.allocatedBytes / 1024, info.areaBytes / 1024, info.areaCount,
+		info.peakAreaBytes / 1024, info.releasedBytes / 1024,
+		info.freeBlockCount);
+}
+
+
+int
+main()
+{
+	BApplication app("application/x-vnd.Haiku-BitmapChurn");
+
+	srand(system_time());
+
+	BBitmap* bitmaps[kWorkingSet];
+	for (int32 i = 0; i < kWorkingSet; i++)
+		bitmaps[i] = NULL;
+
+	bigtime_t start = system_time();
+
+	for (int32 round = 0; round < kRounds; round++) {
+		int32 index = rand() % kWorkingSet;
+		delete bitmaps[index];
+
+		// thumbnails of various sizes, and the occasional full image
+		int32 width = 32 + rand() % 224;
+		int32 height = 32 + rand() % 224;
+		if (rand() % 16 == 0) {
+			width *= 4;
+			height *= 4;
+		}
+
+		bitmaps[index] = new BBitmap(BRect(0, 0, width - 1, height - 1),
+			B_RGB32);
+
+		if (round % 1000 == 0)
+			print_statistics(round);
+	}
+
+	bigtime_t time = system_time() - start;
+
+	for (int32 i = 0; i < kWorkingSet; i++)
+		delete bitmaps[i];
+
+	print_statistics(kRounds);
+	printf("%ld bitmaps in %lld ms\n", kRounds, time / 1000);
+	return 0;
+}
@@ -0,0 +1,174 @@
+/*
+ * Copyright 2010, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+/*!	Tests the slot allocation of the GlyphAtlas: slots of a size class are
+	packed into shared pages, freed slots are reused, and a page is released
+	as soon as its last slot is freed, so that it can serve another size
+	class.
+*/
+
+
+#include <stdio.h>
+#include <string.h>
+
+#include "GlyphAtlas.h"
+
+
+static const size_t kPageSize = 64 * 1024;
+
+static int32 sFailures = 0;
+
+
+#define CHECK(condition) \
+	do { \
+		if (!(condition)) { \
+			printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, \
+				#condition); \
+			sFailures++; \
+		} \
+	} while (false)
+
+
+static void
+test_allocation_size()
+{
+	CHECK(GlyphAtlas::AllocationSize(1) == 16);
+	CHECK(GlyphAtlas::AllocationSize(16) == 16);
+	CHECK(GlyphAtlas::AllocationSize(17) == 32);
+	CHECK(GlyphAtlas::AllocationSize(1000) == 1024);
+	CHECK(GlyphAtlas::AllocationSize(2048) == 2048);
+
+	// larger glyphs are allocated from the heap, and use what they need
+	CHECK(GlyphAtlas::AllocationSize(2049) == 2049);
+}
+
+
+static void
+test_slot_allocation()
+{
+	GlyphAtlas atlas;
+	CHECK(atlas.PageMemory() == 0);
+
+	uint8* slots[100];
+	for (int32 i = 0; i < 100; i++) {
+		slots[i] = atlas.Allocate(20);
+		CHECK(slots[i] != NULL);
+		if (slots[i] != NULL)
+			memset(slots[i], i, 20);
+	}
+
+	// all of them fit into one page
+	CHECK(atlas.PageMemory() == kPageSize);
+
+	for (int32 i = 0; i < 100; i++) {
+		if (slots[i] == NULL)
+			continue;
+
+		// the slots must not overlap
+		for (int32 j = 0; j < 20; j++) {
+			if (slots[i][j] != (uint8)i) {
+				printf("slot %ld was overwritten\n", i);
+				sFailures++;
+				break;
+			}
+		}
+
+		// and share their page
+		CHECK(((addr_t)slots[i] & ~(addr_t)(kPageSize - 1))
+			== ((addr_t)slots[0] & ~(addr_t)(kPageSize - 1)));
+	}
+
+	// another size class uses its own page
+	uint8* other = atlas.Allocate(100);
+	CHECK(other != NULL);
+	CHECK(atlas.PageMemory() == 2 * kPageSize);
+
+	// glyphs too large for a slot don't use a page
+	uint8* large = atlas.Allocate(4000);
+	CHECK(large != NULL);
+	CHECK(atlas.PageMemory() == 2 * kPageSize);
+	atlas.Free(large, 4000);
+
+	atlas.Free(other, 100);
+	for (int32 i = 0; i < 100; i++)
+		atlas.Free(slots[i], 20);
+}
+
+
+static void
+test_slot_reuse()
+{
+	GlyphAtlas atlas;
+
+	uint8* first = atlas.Allocate(64);
+	uint8* second = atlas.Allocate(64);
+	CHECK(first != NULL && second != NULL && first != second);
+
+	// a freed slot is handed out again for the same size class
+	atlas.Free(first, 64);
+	CHECK(atlas.Allocate(50) == first);
+
+	// but not for another one
+	atlas.Free(first, 64);
+	uint8* other = atlas.Allocate(128);
+	CHECK(other != first);
+	CHECK(atlas.Allocate(64) == first);
+
+	atlas.Free(other, 128);
+	atlas.Free(first, 64);
+	atlas.Free(second, 64);
+}
+
+
+static void
+test_page_release()
+{
+	GlyphAtlas atlas;
+
+	// fill more than one page with the largest slots
+	const int32 kCount = 64;
+	uint8* slots[kCount];
+	for (int32 i = 0; i < kCount; i++)
+		slots[i] = atlas.Allocate(2048);
+
+	size_t pageMemory = atlas.PageMemory();
+	CHECK(pageMemory > kPageSize);
+
+	// a slot freed from a full page is used before a new page is started
+	atlas.Free(slots[0], 2048);
+	slots[0] = atlas.Allocate(2048);
+	CHECK(atlas.PageMemory() == pageMemory);
+
+	// freeing all slots releases all pages
+	for (int32 i = 0; i < kCount; i++)
+		atlas.Free(slots[i], 2048);
+	CHECK(atlas.PageMemory() == 0);
+
+	// the memory can serve another size class now
+	uint8* slot = atlas.Allocate(16);
+	CHECK(slot != NULL);
+	CHECK(atlas.PageMemory() == kPageSize);
+
+	atlas.Free(slot, 16);
+	CHECK(atlas.PageMemory() == 0);
+}
+
+
+int
+main()
+{
+	test_allocation_size();
+	test_slot_allocation();
+	test_slot_reuse();
+	test_page_release();
+
+	if (sFailures != 0) {
+		printf("%ld tests failed!\n", sFailures);
+		return 1;
+	}
+
+	printf("All tests passed.\n");
+	return 0;
+}
@@ -0,0 +1,202 @@
+/*
+ * Copyright 2010, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+/*!	Compares the SSE2 span blenders with the scalar versions they replace,
+	which must produce exactly the same pixels, and measures their speed.
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <OS.h>
+
+#include "DrawingModeCopySolid.h"
+#include "DrawingModeOverSolid.h"
+#include "DrawingModeSolidSSE2.h"
+#include "Painter.h"
+
+
+uint32 gAppServerSIMDFlags = 0;
+
+static const uint32 kMaxPixels = 1024;
+static const int32 kRuns = 20000;
+
+typedef PixelFormat::blend_solid_span blend_solid_span;
+
+static uint8 sReference[kMaxPixels * 4];
+static uint8 sResult[kMaxPixels * 4];
+static uint8 sSource[kMaxPixels * 4];
+static uint8 sCovers[kMaxPixels];
+static int32 sFailures = 0;
+
+
+/*!	The scalar copy_bitmap_row_bgr32_alpha() from Painter.cpp. */
+static void
+reference_blend_row_alpha(uint8* dst, const uint8* src, int32 numPixels)
+{
+	while (numPixels--) {
+		if (src[3] == 255) {
+			*(uint32*)dst = *(uint32*)src;
+		} else {
+			dst[0] = ((src[0] - dst[0]) * src[3] + (dst[0] << 8)) >> 8;
+			dst[1] = ((src[1] - dst[1]) * src[3] + (dst[1] << 8)) >> 8;
+			dst[2] = ((src[2] - dst[2]) * src[3] + (dst[2] << 8)) >> 8;
+		}
+		dst += 4;
+		src += 4;
+	}
+}
+
+
+static void
+fill_random(uint8* data, size_t length)
+{
+	for (size_t i = 0; i < length; i++)
+		data[i] = rand();
+}
+
+
+/*!	Covers and alpha values of 0 and 255 take special paths, so they are
+	made a lot more likely than other values.
+*/
+static uint8
+random_alpha()
+{
+	switch (rand() % 4) {
+		case 0:
+			return 0;
+		case 1:
+			return 255;
+		default:
+			return rand();
+	}
+}
+
+
+static void
+compare(const char* test, uint32 length, uint32 offset)
+{
+	if (memcmp(sReference, sResult, sizeof(sResult)) == 0)
+		return;
+
+	printf("%s differs for %lu pixels at offset %lu\n", test, length, offset);
+	sFailures++;
+}
+
+
+static void
+test_solid_span(const char* name, blend_solid_span scalar,
+	blend_solid_span sse2)
+{
+	PatternHandler pattern;
+	agg::rendering_buffer reference(sReference, kMaxPixels, 1,
+		kMaxPixels * 4);
+	agg::rendering_buffer result(sResult, kMaxPixels, 1, kMaxPixels * 4);
+
+	for (int32 i = 0; i < 2000; i++) {
+		uint32 offset = rand() % 16;
+		uint32 length = 1 + rand() % (kMaxPixels - offset);
+		color_type color(rand() & 0xff, rand() & 0xff, rand() & 0xff,
+			rand() & 0xff);
+
+		fill_random(sReference, sizeof(sReference));
+		memcpy(sResult, sReference, sizeof(sResult));
+		for (uint32 j = 0; j < length; j++)
+			sCovers[j] = random_alpha();
+
+		scalar(offset, 0, length, color, sCovers, &reference, &pattern);
+		sse2(offset, 0, length, color, sCovers, &result, &pattern);
+		compare(name, length, offset);
+	}
+
+	// throughput
+	color_type color(100, 150, 200, 255);
+	for (uint32 j = 0; j < kMaxPixels; j++)
+		sCovers[j] = j;
+
+	bigtime_t start = system_time();
+	for (int32 i = 0; i < kRuns; i++)
+		scalar(0, 0, kMaxPixels, color, sCovers, &reference, &pattern);
+	bigtime_t scalarTime = system_time() - start;
+
+	start = system_time();
+	for (int32 i = 0; i < kRuns; i++)
+		sse2(0, 0, kMaxPixels, color, sCovers, &result, &pattern);
+	bigtime_t sse2Time = system_time() - start;
+
+	printf("%-30s %8.1f %8.1f MPixels/s\n", name,
+		(double)kRuns * kMaxPixels / scalarTime,
+		(double)kRuns * kMaxPixels / sse2Time);
+}
+
+
+static void
+test_blend_row_alpha()
+{
+	const char* name = "blend_row_alpha";
+
+	for (int32 i = 0; i < 2000; i++) {
+		uint32 offset = rand() % 16;
+		uint32 length = rand() % (kMaxPixels - offset);
+
+		fill_random(sReference, sizeof(sReference));
+		memcpy(sResult, sReference, sizeof(sResult));
+		fill_random(sSource, sizeof(sSource));
+		for (uint32 j = 0; j < kMaxPixels; j++)
+			sSource[j * 4 + 3] = random_alpha();
+
+		reference_blend_row_alpha(sReference + offset * 4, sSource, length);
+		uint32 count = length & ~3;
+		blend_row_alpha_sse2(sResult + offset * 4, sSource, count);
+		reference_blend_row_alpha(sResult + (offset + count) * 4,
+			sSource + count * 4, length - count);
+		compare(name, length, offset);
+	}
+
+	// throughput
+	bigtime_t start = system_time();
+	for (int32 i = 0; i < kRuns; i++)
+		reference_blend_row_alpha(sReference, sSource, kMaxPixels);
+	bigtime_t scalarTime = system_time() - start;
+
+	start = system_time();
+	for (int32 i = 0; i < kRuns; i++)
+		blend_row_alpha_sse2(sResult, sSource, kMaxPixels);
+	bigtime_t sse2Time = system_time() - start;
+
+	printf("%-30s %8.1f %8.1f MPixels/s\n", name,
+		(double)kRuns * kMaxPixels / scalarTime,
+		(double)kRuns * kMaxPixels / sse2Time);
+}
+
+
+int
+main()
+{
+	cpuid_info info;
+	if (get_cpuid(&info, 1, 0) != B_OK || (info.regs.edx & (1 << 26)) == 0) {
+		printf("This CPU does not support SSE2.\n");
+		return 0;
+	}
+
+	srand(system_time());
+
+	printf("%-30s %8s %8s\n", "", "scalar", "SSE2");
+	test_solid_span("blend_solid_hspan_over_solid",
+		&blend_solid_hspan_over_solid, &blend_solid_hspan_over_solid_sse2);
+	test_solid_span("blend_solid_hspan_copy_solid",
+		&blend_solid_hspan_copy_solid, &blend_solid_hspan_copy_solid_sse2);
+	test_blend_row_alpha();
+
+	if (sFailures != 0) {
+		printf("%ld tests failed!\n", sFailures);
+		return 1;
+	}
+
+	printf("All tests passed.\n");
+	return 0;
+}
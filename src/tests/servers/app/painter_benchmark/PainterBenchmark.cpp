@@ -0,0 +1,232 @@
+/*
+ * Copyright 2010, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+/*!	Measures the speed of some of the Painter's drawing operations when
+	rendered untiled by the calling thread only, and when split into tiles
+	that are rendered with the help of a PainterThreadPool. It also makes
+	sure that both produce exactly the same pixels.
+	The Painter draws into a MallocBuffer, so no app_server is involved.
+	PainterTileBenchmark does the same for the tile renderers alone, on the
+	build platform.
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <GradientLinear.h>
+#include <OS.h>
+#include <Region.h>
+
+#include "MallocBuffer.h"
+#include "Painter.h"
+#include "PainterThreadPool.h"
+#include "ServerBitmap.h"
+
+
+uint32 gAppServerSIMDFlags = 0;
+
+static const uint32 kWidth = 1920;
+static const uint32 kHeight = 1200;
+static const int32 kRuns = 50;
+
+static UtilityBitmap* sBitmap;
+static UtilityBitmap* sDirectHitBitmap;
+static BRegion* sCheckerBoard;
+
+
+static void
+fill_rect(Painter& painter)
+{
+	painter.FillRect(painter.Bounds());
+}
+
+
+static void
+fill_region(Painter& painter)
+{
+	painter.FillRegion(sCheckerBoard);
+}
+
+
+static void
+fill_vertical_gradient(Painter& painter)
+{
+	BGradientLinear gradient(BPoint(0, 0), BPoint(0, kHeight - 1));
+	gradient.AddColor(make_color(255, 0, 0, 255), 0);
+	gradient.AddColor(make_color(0, 0, 255, 255), 255);
+
+	painter.FillRect(painter.Bounds(), gradient);
+}
+
+
+static void
+draw_bitmap_bilinear(Painter& painter)
+{
+	painter.DrawBitmap(sBitmap, sBitmap->Bounds(), painter.Bounds(),
+		B_FILTER_BITMAP_BILINEAR);
+}
+
+
+static void
+draw_bitmap_bilinear_direct_hits(Painter& painter)
+{
+	painter.DrawBitmap(sDirectHitBitmap, sDirectHitBitmap->Bounds(),
+		painter.Bounds(), B_FILTER_BITMAP_BILINEAR);
+}
+
+
+static const struct {
+	const char*	name;
+	void		(*function)(Painter& painter);
+} kBenchmarks[] = {
+	{ "FillRect() solid", &fill_rect },
+	{ "FillRegion() checker board", &fill_region },
+	{ "FillRect() vertical gradient", &fill_vertical_gradient },
+	{ "DrawBitmap() bilinear scaled", &draw_bitmap_bilinear },
+	{ "DrawBitmap() direct hits", &draw_bitmap_bilinear_direct_hits },
+};
+
+
+static UtilityBitmap*
+create_bitmap(int32 width, int32 height)
+{
+	UtilityBitmap* bitmap = new UtilityBitmap(
+		BRect(0, 0, width - 1, height - 1), B_RGB32, 0);
+
+	for (int32 y = 0; y < bitmap->Height(); y++) {
+		uint8* bits = bitmap->Bits() + y * bitmap->BytesPerRow();
+		for (int32 x = 0; x < bitmap->Width(); x++) {
+			bits[0] = x;
+			bits[1] = y;
+			bits[2] = x ^ y;
+			bits[3] = 255;
+			bits += 4;
+		}
+	}
+
+	return bitmap;
+}
+
+
+static void
+init_bitmaps()
+{
+	sBitmap = create_bitmap(640, 400);
+
+	// scaled to the frame buffer, every 19th column and 11th row map
+	// directly to a source pixel, some of them at the edges of tiles
+	sDirectHitBitmap = create_bitmap(102, 110);
+}
+
+
+static void
+init_checker_board()
+{
+	sCheckerBoard = new BRegion;
+
+	for (uint32 y = 0; y < kHeight; y += 32) {
+		for (uint32 x = (y / 32) % 2 * 32; x < kWidth; x += 64)
+			sCheckerBoard->Include(BRect(x, y, x + 31, y + 31));
+	}
+}
+
+
+static bigtime_t
+run(Painter& painter, void (*function)(Painter& painter))
+{
+	bigtime_t start = system_time();
+
+	for (int32 i = 0; i < kRuns; i++)
+		function(painter);
+
+	return (system_time() - start) / kRuns;
+}
+
+
+int
+main(int argc, char** argv)
+{
+	system_info info;
+	get_system_info(&info);
+
+	int32 threadCount = info.cpu_count - 1;
+	if (argc > 1)
+		threadCount = atoi(argv[1]);
+	if (threadCount < 1)
+		threadCount = 1;
+
+	MallocBuffer buffer(kWidth, kHeight);
+	if (buffer.InitCheck() != B_OK) {
+		fprintf(stderr, "Could not allocate the frame buffer!\n");
+		return 1;
+	}
+
+	uint32 size = buffer.BytesPerRow() * buffer.Height();
+	uint8* reference = (uint8*)malloc(size);
+	if (reference == NULL) {
+		fprintf(stderr, "Could not allocate the reference buffer!\n");
+		return 1;
+	}
+
+	PainterThreadPool pool(threadCount);
+	if (pool.InitCheck() != B_OK) {
+		fprintf(stderr, "Could not create the thread pool!\n");
+		return 1;
+	}
+
+	init_bitmaps();
+	init_checker_board();
+
+	BRegion clipping(BRect(0, 0, kWidth - 1, kHeight - 1));
+
+	Painter painter;
+	painter.AttachToBuffer(&buffer);
+	painter.ConstrainClipping(&clipping);
+	painter.SetDrawingMode(B_OP_COPY);
+	painter.SetHighColor(make_color(51, 102, 152, 255));
+
+	printf("%ld worker threads, %lux%lu pixels, average of %ld runs\n\n",
+		pool.CountThreads(), kWidth, kHeight, kRuns);
+	printf("%-30s %10s %10s %8s\n", "", "untiled", "tiled", "speedup");
+
+	int32 failures = 0;
+	int32 count = sizeof(kBenchmarks) / sizeof(kBenchmarks[0]);
+
+	for (int32 i = 0; i < count; i++) {
+		// without a pool, the Painter does not split the clipping boxes
+		memset(buffer.Bits(), 0, size);
+		painter.SetThreadPool(NULL);
+		bigtime_t untiled = run(painter, kBenchmarks[i].function);
+		memcpy(reference, buffer.Bits(), size);
+
+		memset(buffer.Bits(), 0, size);
+		painter.SetThreadPool(&pool);
+		bigtime_t tiled = run(painter, kBenchmarks[i].function);
+
+		bool identical = memcmp(reference, buffer.Bits(), size) == 0;
+		if (!identical)
+			failures++;
+
+		printf("%-30s %8lld µs %8lld µs %7.2fx%s\n", kBenchmarks[i].name,
+			untiled, tiled, tiled > 0 ? (double)untiled / tiled : 0.0,
+			identical ? "" : "  (result differs!)");
+	}
+
+	painter.DetachFromBuffer();
+	sBitmap->ReleaseReference();
+	sDirectHitBitmap->ReleaseReference();
+	delete sCheckerBoard;
+	free(reference);
+
+	if (failures > 0) {
+		printf("\n%ld operations rendered differently in tiles!\n",
+			failures);
+		return 1;
+	}
+
+	return 0;
+}
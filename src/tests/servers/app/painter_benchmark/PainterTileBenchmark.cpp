@@ -0,0 +1,346 @@
+/*
+ * Copyright 2010, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+/*!	A build platform version of the PainterBenchmark: it runs the Painter's
+	tile renderers directly on a frame buffer in memory, and therefore also
+	works on Linux and other build platforms.
+
+	Every operation is rendered once the way the Painter does it without a
+	thread pool, one tile per clipping box, and once split into bands of
+	kTileHeight rows that are rendered by a number of POSIX threads. Both
+	results must be identical, pixel for pixel.
+*/
+
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "PainterTiles.h"
+
+
+static const int32 kWidth = 1920;
+static const int32 kHeight = 1200;
+static const int32 kTileHeight = 64;
+	// PAINTER_TILE_HEIGHT
+static const int32 kRuns = 20;
+
+
+struct clipping {
+	const char*		name;
+	clipping_rect*	rects;
+	int32			count;
+};
+
+struct operation {
+	const char*				name;
+	tile_render_function	function;
+	void*					cookie;
+};
+
+struct tile_batch {
+	tile_render_function	function;
+	void*					cookie;
+	const clipping_rect*	tiles;
+	int32					count;
+	int32					next;
+	pthread_mutex_t			lock;
+};
+
+
+static bigtime_t
+current_time()
+{
+	struct timespec time;
+	clock_gettime(CLOCK_MONOTONIC, &time);
+	return (bigtime_t)time.tv_sec * 1000000 + time.tv_nsec / 1000;
+}
+
+
+static void*
+render_tiles(void* _batch)
+{
+	tile_batch& batch = *(tile_batch*)_batch;
+
+	while (true) {
+		pthread_mutex_lock(&batch.lock);
+		int32 index = batch.next++;
+		pthread_mutex_unlock(&batch.lock);
+
+		if (index >= batch.count)
+			return NULL;
+
+		batch.function(batch.cookie, batch.tiles[index]);
+	}
+}
+
+
+static void
+render_untiled(const operation& operation, const clipping& clipping)
+{
+	for (int32 i = 0; i < clipping.count; i++)
+		operation.function(operation.cookie, clipping.rects[i]);
+}
+
+
+static void
+render_tiled(const operation& operation, const clipping_rect* tiles,
+	int32 tileCount, int32 threadCount)
+{
+	tile_batch batch;
+	batch.function = operation.function;
+	batch.cookie = operation.cookie;
+	batch.tiles = tiles;
+	batch.count = tileCount;
+	batch.next = 0;
+	pthread_mutex_init(&batch.lock, NULL);
+
+	// like the Painter, the calling thread renders tiles as well
+	pthread_t threads[threadCount];
+	int32 started = 0;
+	for (; started < threadCount - 1; started++) {
+		if (pthread_create(&threads[started], NULL, &render_tiles, &batch)
+				!= 0)
+			break;
+	}
+
+	render_tiles(&batch);
+
+	for (int32 i = 0; i < started; i++)
+		pthread_join(threads[i], NULL);
+
+	pthread_mutex_destroy(&batch.lock);
+}
+
+
+static int32
+split_into_tiles(const clipping& clipping, clipping_rect* tiles)
+{
+	int32 count = 0;
+
+	for (int32 i = 0; i < clipping.count; i++) {
+		const clipping_rect& rect = clipping.rects[i];
+		for (int32 top = rect.top; top <= rect.bottom; top += kTileHeight) {
+			clipping_rect& tile = tiles[count++];
+			tile.left = rect.left;
+			tile.top = top;
+			tile.right = rect.right;
+			tile.bottom = top + kTileHeight - 1;
+			if (tile.bottom > rect.bottom)
+				tile.bottom = rect.bottom;
+		}
+	}
+
+	return count;
+}
+
+
+/*!	Computes the filter weights the same way
+	Painter::_DrawBitmapBilinearCopy32() does.
+*/
+static void
+init_filter_weights(FilterInfo* weights, uint32 count, uint32 sourceSize,
+	double scale, uint32 indexFactor)
+{
+	for (uint32 i = 0; i < count; i++) {
+		float index = i * (sourceSize - 1) / (sourceSize * scale - 1);
+		weights[i].index = (uint16)index;
+		weights[i].weight = 255 - (uint16)((index - weights[i].index) * 255);
+		weights[i].index *= indexFactor;
+	}
+}
+
+
+static void
+init_bilinear_copy(bilinear_copy_info& info, agg::rendering_buffer* source,
+	agg::rendering_buffer* destination, int codeSelect)
+{
+	double xScale = (double)kWidth / source->width();
+	double yScale = (double)kHeight / source->height();
+
+	FilterInfo* xWeights = new FilterInfo[kWidth];
+	FilterInfo* yWeights = new FilterInfo[kHeight];
+	init_filter_weights(xWeights, kWidth, source->width(), xScale, 4);
+	init_filter_weights(yWeights, kHeight, source->height(), yScale, 1);
+
+	info.source = source;
+	info.destination = destination;
+	info.xWeights = xWeights;
+	info.yWeights = yWeights;
+	info.left = 0;
+	info.top = 0;
+	info.filterWeightXIndexOffset = 0;
+	info.filterWeightYIndexOffset = 0;
+	info.lastXIndex = kWidth - 1;
+	info.lastYIndex = kHeight - 1;
+	info.codeSelect = codeSelect;
+}
+
+
+static agg::rendering_buffer*
+create_bitmap(int32 width, int32 height)
+{
+	uint8* bits = new uint8[width * height * 4];
+	for (int32 y = 0; y < height; y++) {
+		uint8* row = bits + y * width * 4;
+		for (int32 x = 0; x < width; x++) {
+			row[0] = x;
+			row[1] = y;
+			row[2] = x ^ y;
+			row[3] = 255;
+			row += 4;
+		}
+	}
+
+	return new agg::rendering_buffer(bits, width, height, width * 4);
+}
+
+
+int
+main(int argc, char** argv)
+{
+	int32 threadCount = 4;
+	if (argc > 1)
+		threadCount = atoi(argv[1]);
+	if (threadCount < 1)
+		threadCount = 1;
+
+	uint32 bytesPerRow = kWidth * 4;
+	uint32 size = bytesPerRow * kHeight;
+	uint8* bits = (uint8*)malloc(size);
+	uint8* reference = (uint8*)malloc(size);
+	if (bits == NULL || reference == NULL) {
+		fprintf(stderr, "Could not allocate the frame buffers!\n");
+		return 1;
+	}
+
+	agg::rendering_buffer buffer(bits, kWidth, kHeight, bytesPerRow);
+
+	// clipping: the whole frame buffer, and a checker board
+
+	clipping_rect bounds = { 0, 0, kWidth - 1, kHeight - 1 };
+
+	int32 boardCount = 0;
+	clipping_rect* board = new clipping_rect[(kWidth / 32 + 1)
+		* (kHeight / 32 + 1)];
+	for (int32 y = 0; y < kHeight; y += 32) {
+		for (int32 x = (y / 32) % 2 * 32; x < kWidth; x += 64) {
+			clipping_rect& rect = board[boardCount++];
+			rect.left = x;
+			rect.top = y;
+			rect.right = x + 31;
+			rect.bottom = y + 31 < kHeight ? y + 31 : kHeight - 1;
+		}
+	}
+
+	const clipping kClippings[] = {
+		{ "full", &bounds, 1 },
+		{ "checker board", board, boardCount },
+	};
+
+	// operations
+
+	solid_fill_info solidFill;
+	solidFill.bits = bits;
+	solidFill.bytesPerRow = bytesPerRow;
+	solidFill.color = 0xff336699;
+
+	uint32* gradientColors = new uint32[kHeight];
+	for (int32 y = 0; y < kHeight; y++)
+		gradientColors[y] = 0xff000000 | (y * 255 / (kHeight - 1));
+
+	gradient_fill_info gradientFill;
+	gradientFill.bits = bits;
+	gradientFill.bytesPerRow = bytesPerRow;
+	gradientFill.colors = gradientColors;
+	gradientFill.top = 0;
+
+	// The first bitmap is scaled by exactly 3, the second by 3.2. The third
+	// one is chosen so that every 19th column, and every 11th row maps
+	// directly to a source pixel, some of which are at the edges of tiles
+	// and clipping boxes.
+	agg::rendering_buffer* integerBitmap = create_bitmap(640, 400);
+	agg::rendering_buffer* fractionalBitmap = create_bitmap(600, 375);
+	agg::rendering_buffer* directHitBitmap = create_bitmap(102, 110);
+
+	bilinear_copy_info integerScale;
+	init_bilinear_copy(integerScale, integerBitmap, &buffer,
+		kOptimizeForLowFilterRatio);
+	bilinear_copy_info fractionalScale;
+	init_bilinear_copy(fractionalScale, fractionalBitmap, &buffer,
+		kUseDefaultVersion);
+	bilinear_copy_info directHitScale;
+	init_bilinear_copy(directHitScale, directHitBitmap, &buffer,
+		kUseDefaultVersion);
+
+	const operation kOperations[] = {
+		{ "solid fill", &solid_fill_tile, &solidFill },
+		{ "vertical gradient", &vertical_gradient_fill_tile, &gradientFill },
+		{ "bilinear scale x3", &bilinear_copy_tile, &integerScale },
+		{ "bilinear scale x3.2", &bilinear_copy_tile, &fractionalScale },
+		{ "bilinear scale direct hits", &bilinear_copy_tile, &directHitScale },
+	};
+
+	// int32 is not the same type on all build platforms
+	printf("%d threads, %dx%d pixels, %d rows per tile, average of %d "
+		"runs\n\n", (int)threadCount, (int)kWidth, (int)kHeight,
+		(int)kTileHeight, (int)kRuns);
+	printf("%-44s %10s %10s %8s\n", "", "untiled", "tiled", "speedup");
+
+	clipping_rect* tiles = new clipping_rect[(kWidth / 32 + 1)
+		* (kHeight / 32 + 1) + kHeight / kTileHeight + 1];
+	int32 failures = 0;
+
+	for (size_t c = 0; c < sizeof(kClippings) / sizeof(kClippings[0]); c++) {
+		const clipping& clipping = kClippings[c];
+		int32 tileCount = split_into_tiles(clipping, tiles);
+
+		for (size_t i = 0; i < sizeof(kOperations) / sizeof(kOperations[0]);
+				i++) {
+			const operation& operation = kOperations[i];
+
+			memset(bits, 0, size);
+			bigtime_t start = current_time();
+			for (int32 run = 0; run < kRuns; run++)
+				render_untiled(operation, clipping);
+			bigtime_t untiled = (current_time() - start) / kRuns;
+			memcpy(reference, bits, size);
+
+			memset(bits, 0, size);
+			start = current_time();
+			for (int32 run = 0; run < kRuns; run++)
+				render_tiled(operation, tiles, tileCount, threadCount);
+			bigtime_t tiled = (current_time() - start) / kRuns;
+
+			bool identical = memcmp(reference, bits, size) == 0;
+			if (!identical)
+				failures++;
+
+			char name[64];
+			snprintf(name, sizeof(name), "%s (%s)", operation.name,
+				clipping.name);
+			printf("%-44s %7lld us %7lld us %7.2fx%s\n", name,
+				(long long)untiled, (long long)tiled,
+				tiled > 0 ? (double)untiled / tiled : 0.0,
+				identical ? "" : "  (result differs!)");
+		}
+	}
+
+	delete[] tiles;
+	delete[] board;
+	delete[] gradientColors;
+	free(bits);
+	free(reference);
+
+	if (failures > 0) {
+		printf("\n%d operations rendered differently in tiles!\n",
+			(int)failures);
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,351 @@
+/*
+ * Copyright 2010, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+/*!	Replays a drawing session through the remote drawing protocol over a
+	loopback ring buffer, and reports the bytes that would go over the wire
+	and the frame latency, with and without bitmap caching and compression.
+
+	The session resembles a typical desktop: each frame fills a few
+	rectangles, draws some strings, and a number of small icons that keep
+	being reused. Every few frames a larger photo-like bitmap is drawn, and
+	each frame draws one bitmap with new contents.
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <Bitmap.h>
+#include <OS.h>
+
+#include "RemoteBitmapCache.h"
+#include "RemoteMessage.h"
+#include "StreamingRingBuffer.h"
+
+
+static const int32 kFrameCount = 100;
+static const int32 kIconCount = 24;
+static const int32 kIconsPerFrame = 12;
+static const int32 kFillsPerFrame = 30;
+static const int32 kStringsPerFrame = 20;
+static const int32 kPhotoInterval = 10;
+static const uint32 kToken = 1;
+
+// the simulated link, 10 MBit/s
+static const double kLinkBytesPerSecond = 10 * 1000 * 1000 / 8;
+
+
+enum {
+	SEND_COMPRESSED		= 0x01,
+	SEND_CACHED			= 0x02
+};
+
+struct session {
+	BBitmap*			icons[kIconCount];
+	BBitmap*			photo;
+	BBitmap*			changing;
+};
+
+struct frame_times {
+	bigtime_t			start;
+	bigtime_t			end;
+	uint32				bytes;
+};
+
+struct receiver_info {
+	StreamingRingBuffer* buffer;
+	frame_times*		frames;
+	uint64				bytes;
+	BBitmap*			cache[RemoteBitmapCache::kSlotCount];
+	int32				errors;
+};
+
+
+static BBitmap*
+create_bitmap(int32 width, int32 height)
+{
+	return new BBitmap(BRect(0, 0, width - 1, height - 1),
+		B_BITMAP_NO_SERVER_LINK, B_RGBA32);
+}
+
+
+/*!	Icons have large transparent and flat areas, like real ones. */
+static void
+fill_icon(BBitmap* bitmap, int32 seed)
+{
+	uint32* bits = (uint32*)bitmap->Bits();
+	int32 width = bitmap->Bounds().IntegerWidth() + 1;
+	int32 height = bitmap->Bounds().IntegerHeight() + 1;
+	int32 radius = width / 2 - seed % 4;
+
+	for (int32 y = 0; y < height; y++) {
+		for (int32 x = 0; x < width; x++) {
+			int32 dx = x - width / 2;
+			int32 dy = y - height / 2;
+			if (dx * dx + dy * dy > radius * radius)
+				bits[y * width + x] = 0;
+			else {
+				bits[y * width + x] = 0xff000000 | (seed * 0x102030)
+					| ((y * 4) << 8);
+			}
+		}
+	}
+}
+
+
+static void
+fill_noise(BBitmap* bitmap, uint32 seed)
+{
+	uint32* bits = (uint32*)bitmap->Bits();
+	int32 count = bitmap->BitsLength() / 4;
+	uint32 value = seed;
+	for (int32 i = 0; i < count; i++) {
+		// smooth, but not flat, like a photo
+		value = value * 1103515245 + 12345;
+		uint8 base = i / 64 + seed;
+		uint8 noise = (value >> 16) & 0x0f;
+		bits[i] = 0xff000000 | ((base + noise) << 16) | ((base * 2) << 8)
+			| (base + noise / 2);
+	}
+}
+
+
+static void
+create_session(session& session)
+{
+	for (int32 i = 0; i < kIconCount; i++) {
+		session.icons[i] = create_bitmap(32, 32);
+		fill_icon(session.icons[i], i);
+	}
+
+	session.photo = create_bitmap(200, 150);
+	fill_noise(session.photo, 42);
+
+	session.changing = create_bitmap(64, 64);
+}
+
+
+static void
+delete_session(session& session)
+{
+	for (int32 i = 0; i < kIconCount; i++)
+		delete session.icons[i];
+	delete session.photo;
+	delete session.changing;
+}
+
+
+static void
+send_bitmap(RemoteMessage& message, RemoteBitmapCache& cache, BBitmap* bitmap,
+	BPoint where, uint32 flags)
+{
+	BRect bounds = bitmap->Bounds();
+
+	bool cached = false;
+	int32 slot = -1;
+	if ((flags & SEND_CACHED) != 0) {
+		slot = cache.Lookup(bitmap->Bits(), bitmap->BitsLength(),
+			bounds.IntegerWidth() + 1, bounds.IntegerHeight() + 1,
+			bitmap->ColorSpace(), cached);
+	}
+
+	message.Start(cached ? RP_DRAW_CACHED_BITMAP : RP_DRAW_BITMAP);
+	message.Add(kToken);
+	message.Add(bounds);
+	message.Add(bounds.OffsetToCopy(where));
+	message.Add((uint32)0);
+	message.Add(slot);
+	if (!cached)
+		message.AddBitmap(*bitmap, (flags & SEND_COMPRESSED) != 0);
+}
+
+
+static void
+send_frame(RemoteMessage& message, RemoteBitmapCache& cache,
+	session& session, int32 frame, uint32 flags)
+{
+	for (int32 i = 0; i < kFillsPerFrame; i++) {
+		message.Start(RP_FILL_RECT_COLOR);
+		message.Add(kToken);
+		message.Add(BRect(i * 10, frame, i * 10 + 50, frame + 20));
+		message.Add(make_color(i * 8, 216, 216));
+	}
+
+	for (int32 i = 0; i < kStringsPerFrame; i++) {
+		static const char* kString = "The quick brown fox jumps";
+		message.Start(RP_DRAW_STRING);
+		message.Add(kToken);
+		message.Add(BPoint(10, i * 15));
+		message.AddString(kString, strlen(kString));
+		message.Add(false);
+	}
+
+	for (int32 i = 0; i < kIconsPerFrame; i++) {
+		send_bitmap(message, cache, session.icons[(frame + i * 7) % kIconCount],
+			BPoint(i * 40, 300), flags);
+	}
+
+	if (frame % kPhotoInterval == 0)
+		send_bitmap(message, cache, session.photo, BPoint(400, 100), flags);
+
+	fill_noise(session.changing, frame);
+	send_bitmap(message, cache, session.changing, BPoint(100, 100), flags);
+
+	// marks the end of the frame
+	message.Start(RP_INVALIDATE_RECT);
+	message.Add(BRect(0, 0, 639, 479));
+	message.Add(frame);
+	message.Flush();
+}
+
+
+static status_t
+receiver_thread(void* data)
+{
+	receiver_info* info = (receiver_info*)data;
+	RemoteMessage message(info->buffer, NULL);
+	uint32 frameBytes = 0;
+
+	while (true) {
+		uint16 code;
+		if (message.NextMessage(code) != B_OK)
+			return B_ERROR;
+
+		uint32 messageBytes = message.DataLeft() + sizeof(uint16)
+			+ sizeof(uint32);
+		info->bytes += messageBytes;
+		frameBytes += messageBytes;
+
+		switch (code) {
+			case RP_DRAW_BITMAP:
+			case RP_DRAW_CACHED_BITMAP:
+			{
+				uint32 token, options;
+				BRect bitmapRect, viewRect;
+				int32 slot;
+				message.Read(token);
+				message.Read(bitmapRect);
+				message.Read(viewRect);
+				message.Read(options);
+				message.Read(slot);
+
+				if (code == RP_DRAW_CACHED_BITMAP) {
+					if (slot < 0 || slot >= RemoteBitmapCache::kSlotCount
+						|| info->cache[slot] == NULL)
+						info->errors++;
+					break;
+				}
+
+				BBitmap* bitmap;
+				if (message.ReadBitmap(&bitmap) != B_OK) {
+					info->errors++;
+					break;
+				}
+
+				if (slot >= 0 && slot < RemoteBitmapCache::kSlotCount) {
+					delete info->cache[slot];
+					info->cache[slot] = bitmap;
+				} else
+					delete bitmap;
+				break;
+			}
+
+			case RP_INVALIDATE_RECT:
+			{
+				BRect rect;
+				int32 frame;
+				message.Read(rect);
+				if (message.Read(frame) != B_OK)
+					return B_ERROR;
+
+				info->frames[frame].end = system_time();
+				info->frames[frame].bytes = frameBytes;
+				frameBytes = 0;
+
+				if (frame == kFrameCount - 1)
+					return B_OK;
+				break;
+			}
+
+			default:
+				// the remaining data is skipped by NextMessage()
+				break;
+		}
+	}
+}
+
+
+static void
+run(const char* name, session& session, uint32 flags)
+{
+	StreamingRingBuffer buffer(256 * 1024);
+	if (buffer.InitCheck() != B_OK) {
+		printf("could not create ring buffer\n");
+		return;
+	}
+
+	frame_times frames[kFrameCount];
+	receiver_info info;
+	memset(&info, 0, sizeof(info));
+	info.buffer = &buffer;
+	info.frames = frames;
+
+	thread_id receiver = spawn_thread(receiver_thread, "receiver",
+		B_NORMAL_PRIORITY, &info);
+	resume_thread(receiver);
+
+	RemoteBitmapCache cache;
+	RemoteMessage message(NULL, &buffer);
+	for (int32 frame = 0; frame < kFrameCount; frame++) {
+		frames[frame].start = system_time();
+		send_frame(message, cache, session, frame, flags);
+	}
+
+	status_t result;
+	wait_for_thread(receiver, &result);
+
+	bigtime_t totalLatency = 0;
+	bigtime_t maxLatency = 0;
+	double totalLinkLatency = 0;
+	for (int32 i = 0; i < kFrameCount; i++) {
+		bigtime_t latency = frames[i].end - frames[i].start;
+		totalLatency += latency;
+		if (latency > maxLatency)
+			maxLatency = latency;
+
+		totalLinkLatency += frames[i].bytes / kLinkBytesPerSecond * 1000.0;
+	}
+
+	printf("%-22s %10llu %10.1f %10.2f %10.2f %10.1f%s\n", name, info.bytes,
+		(double)info.bytes / kFrameCount / 1024,
+		totalLatency / 1000.0 / kFrameCount, maxLatency / 1000.0,
+		totalLinkLatency / kFrameCount,
+		result != B_OK || info.errors != 0 ? "  (errors!)" : "");
+
+	for (int32 i = 0; i < RemoteBitmapCache::kSlotCount; i++)
+		delete info.cache[i];
+}
+
+
+int
+main()
+{
+	session session;
+	create_session(session);
+
+	printf("%d frames, simulated link %.0f KB/s\n\n", (int)kFrameCount,
+		kLinkBytesPerSecond / 1024);
+	printf("%-22s %10s %10s %10s %10s %10s\n", "", "bytes", "KB/frame",
+		"avg ms", "max ms", "link ms");
+
+	run("raw", session, 0);
+	run("compressed", session, SEND_COMPRESSED);
+	run("cached", session, SEND_CACHED);
+	run("cached + compressed", session, SEND_CACHED | SEND_COMPRESSED);
+
+	delete_session(session);
+	return 0;
+}
@@ -0,0 +1,214 @@
+/*
+ * Copyright 2010, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+// Tests how the registrar's MIME database index deals with running out of
+// space: it must be rebuilt at a size that only depends on the contents of
+// the database, and be invalidated for its clients if that is not possible.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <Directory.h>
+#include <File.h>
+#include <OS.h>
+#include <String.h>
+#include <TypeConstants.h>
+
+#include <mime/database_index.h>
+
+#include "DatabaseIndex.h"
+
+
+using namespace BPrivate::Storage::Mime;
+
+
+static const size_t kInitialSize = 64 * 1024;
+static const size_t kMaxSize = 1024 * 1024;
+static const size_t kSmallAttributeSize = 2 * 1024;
+static const size_t kLargeAttributeSize = 400 * 1024;
+static const int32 kUpdateCount = 500;
+
+static int32 sFailures = 0;
+
+
+#define CHECK(condition)												\
+	do {																\
+		if (!(condition)) {												\
+			fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__,		\
+				__LINE__, #condition);									\
+			sFailures++;												\
+		}																\
+	} while (false)
+
+
+static status_t
+write_type(const char* directory, const char* type, size_t size,
+	uint8 fill)
+{
+	char path[B_PATH_NAME_LENGTH];
+	snprintf(path, sizeof(path), "%s/%s", directory, type);
+
+	BFile file(path, B_CREATE_FILE | B_WRITE_ONLY);
+	status_t status = file.InitCheck();
+	if (status != B_OK)
+		return status;
+
+	file.WriteAttr("META:TYPE", B_STRING_TYPE, 0, type, strlen(type) + 1);
+
+	uint8* data = (uint8*)malloc(size);
+	if (data == NULL)
+		return B_NO_MEMORY;
+
+	memset(data, fill, size);
+	ssize_t written = file.WriteAttr("test:data", B_RAW_TYPE, 0, data, size);
+	free(data);
+
+	return written == (ssize_t)size ? B_OK : B_IO_ERROR;
+}
+
+
+/*!	Clones the index area like a client does, so that it stays accessible
+	after the index replaced or removed it.
+*/
+static const database_index_header*
+clone_index(const DatabaseIndex& index, area_id* _area)
+{
+	database_index_header* header;
+	*_area = clone_area("mime database index test", (void**)&header,
+		B_ANY_ADDRESS, B_READ_AREA, index.Area());
+	if (*_area < B_OK)
+		return NULL;
+
+	return header;
+}
+
+
+static bool
+check_type(const database_index_header* header, const char* type,
+	size_t size, uint8 fill)
+{
+	const database_index_entry* entry = database_index_find(header, type,
+		"test:data");
+	if (entry == NULL || entry->size != (int32)size)
+		return false;
+
+	const uint8* data = (const uint8*)entry->Data();
+	for (size_t i = 0; i < size; i++) {
+		if (data[i] != fill)
+			return false;
+	}
+
+	return true;
+}
+
+
+static void
+test_rebuild(const char* directory)
+{
+	DatabaseIndex index(directory, kInitialSize, kMaxSize);
+	CHECK(index.Init() == B_OK);
+
+	area_id firstArea;
+	const database_index_header* first = clone_index(index, &firstArea);
+	CHECK(first != NULL);
+	if (first == NULL)
+		return;
+
+	CHECK(first->magic == kDatabaseIndexMagic);
+	CHECK(check_type(first, "text/a", kSmallAttributeSize, 1));
+
+	// Every update appends the type again, so this overflows the index
+	// many times. Since it is rebuilt from the database, it must not grow.
+	for (int32 i = 0; i < kUpdateCount; i++) {
+		uint8 fill = 2 + i % 200;
+		CHECK(write_type(directory, "text/a", kSmallAttributeSize, fill)
+			== B_OK);
+		CHECK(index.UpdateType("text/a") == B_OK);
+	}
+
+	CHECK(first->replacement >= 0);
+
+	area_id lastArea;
+	const database_index_header* last = clone_index(index, &lastArea);
+	CHECK(last != NULL);
+	if (last != NULL) {
+		CHECK(last->magic == kDatabaseIndexMagic);
+		CHECK(last->size == kInitialSize);
+		CHECK(last->replacement < 0);
+		CHECK(check_type(last, "text/a", kSmallAttributeSize,
+			2 + (kUpdateCount - 1) % 200));
+		CHECK(check_type(last, "text/b", kSmallAttributeSize, 1));
+		delete_area(lastArea);
+	}
+
+	delete_area(firstArea);
+}
+
+
+static void
+test_failed_rebuild(const char* directory)
+{
+	DatabaseIndex index(directory, kInitialSize, kMaxSize);
+	CHECK(index.Init() == B_OK);
+
+	area_id area;
+	const database_index_header* header = clone_index(index, &area);
+	CHECK(header != NULL);
+	if (header == NULL)
+		return;
+
+	// the database no longer fits into the largest index allowed
+	CHECK(write_type(directory, "text/large1", kLargeAttributeSize, 3)
+		== B_OK);
+	CHECK(write_type(directory, "text/large2", kLargeAttributeSize, 4)
+		== B_OK);
+	CHECK(write_type(directory, "text/large3", kLargeAttributeSize, 5)
+		== B_OK);
+
+	CHECK(index.UpdateType("text/large1") == B_NO_MEMORY);
+
+	// the clients must not use the outdated index anymore
+	CHECK(header->magic != kDatabaseIndexMagic);
+	CHECK(index.Area() < 0);
+	CHECK(index.UpdateType("text/large2") == B_NO_INIT);
+
+	delete_area(area);
+}
+
+
+int
+main()
+{
+	char directory[B_PATH_NAME_LENGTH];
+	snprintf(directory, sizeof(directory), "/tmp/mime_database_index_test_%ld",
+		(long)find_thread(NULL));
+
+	if (create_directory(directory, 0755) != B_OK
+		|| create_directory((BString(directory) << "/text").String(), 0755)
+			!= B_OK) {
+		fprintf(stderr, "Could not create the test database in %s\n",
+			directory);
+		return 1;
+	}
+
+	write_type(directory, "text/a", kSmallAttributeSize, 1);
+	write_type(directory, "text/b", kSmallAttributeSize, 1);
+
+	test_rebuild(directory);
+	test_failed_rebuild(directory);
+
+	char command[B_PATH_NAME_LENGTH + 16];
+	snprintf(command, sizeof(command), "rm -rf %s", directory);
+	system(command);
+
+	if (sFailures > 0) {
+		printf("%ld checks failed.\n", (long)sFailures);
+		return 1;
+	}
+
+	printf("All tests passed.\n");
+	return 0;
+}
@@ -0,0 +1,167 @@
+/*
+ * Copyright 2010, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+// Tests the checkpoints that let the registrar resume an interrupted MIME
+// update: they must belong to a single tree and a single update at a time,
+// and an outdated one must not be used anymore.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <Directory.h>
+#include <Entry.h>
+#include <File.h>
+#include <Message.h>
+#include <OS.h>
+#include <Path.h>
+#include <String.h>
+
+#include "MimeUpdateCheckpoint.h"
+
+
+using namespace BPrivate::Storage::Mime;
+
+
+static const bigtime_t kDay = 24 * 60 * 60 * 1000000LL;
+
+static int32 sFailures = 0;
+
+
+#define CHECK(condition)												\
+	do {																\
+		if (!(condition)) {												\
+			fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__,		\
+				__LINE__, #condition);									\
+			sFailures++;												\
+		}																\
+	} while (false)
+
+
+static int32
+count_files(const char* directory)
+{
+	BDirectory dir(directory);
+	return dir.CountEntries();
+}
+
+
+/*!	Returns the path of the only checkpoint file in \a directory. */
+static BString
+checkpoint_file(const char* directory)
+{
+	BDirectory dir(directory);
+	BEntry entry;
+	BPath path;
+	if (dir.GetNextEntry(&entry) != B_OK || entry.GetPath(&path) != B_OK)
+		return BString();
+
+	return path.Path();
+}
+
+
+static void
+test_resume(const char* directory)
+{
+	{
+		MimeUpdateCheckpoint checkpoint("test", "/boot/a", directory);
+		CHECK(checkpoint.InitCheck() == B_OK);
+
+		// another update of the same tree can't use it
+		MimeUpdateCheckpoint concurrent("test", "/boot/a", directory);
+		CHECK(concurrent.InitCheck() == B_BUSY);
+		CHECK(!concurrent.IsCompleted("/boot/a/x"));
+
+		// the first save is only due after a while
+		checkpoint.SetCompleted("/boot/a/x");
+		checkpoint.SetCompleted("/boot/a/y/z");
+		CHECK(count_files(directory) == 0);
+
+		// the update is interrupted
+		checkpoint.Save();
+		CHECK(count_files(directory) == 1);
+	}
+
+	{
+		// another tree doesn't see it, and has a file of its own
+		MimeUpdateCheckpoint other("test", "/boot/b", directory);
+		CHECK(other.InitCheck() == B_OK);
+		CHECK(!other.IsCompleted("/boot/a/x"));
+		other.Save();
+		CHECK(count_files(directory) == 2);
+		other.Remove();
+		CHECK(count_files(directory) == 1);
+	}
+
+	{
+		MimeUpdateCheckpoint checkpoint("test", "/boot/a", directory);
+		CHECK(checkpoint.InitCheck() == B_OK);
+		CHECK(checkpoint.IsCompleted("/boot/a/x"));
+		CHECK(checkpoint.IsCompleted("/boot/a/y/z"));
+		CHECK(!checkpoint.IsCompleted("/boot/a/y"));
+
+		// the update is done
+		checkpoint.Remove();
+		CHECK(count_files(directory) == 0);
+	}
+}
+
+
+static void
+test_expiry(const char* directory)
+{
+	{
+		MimeUpdateCheckpoint checkpoint("test", "/boot/a", directory);
+		CHECK(checkpoint.InitCheck() == B_OK);
+		checkpoint.SetCompleted("/boot/a/x");
+		checkpoint.Save();
+	}
+
+	// make the checkpoint older than a day
+	BString path = checkpoint_file(directory);
+	BFile file(path.String(), B_READ_WRITE);
+	BMessage message;
+	CHECK(message.Unflatten(&file) == B_OK);
+	CHECK(message.ReplaceInt64("started", real_time_clock_usecs() - 2 * kDay)
+		== B_OK);
+	file.Seek(0, SEEK_SET);
+	file.SetSize(0);
+	CHECK(message.Flatten(&file) == B_OK);
+	file.Unset();
+
+	MimeUpdateCheckpoint checkpoint("test", "/boot/a", directory);
+	CHECK(checkpoint.InitCheck() == B_OK);
+	CHECK(!checkpoint.IsCompleted("/boot/a/x"));
+	CHECK(count_files(directory) == 0);
+}
+
+
+int
+main()
+{
+	char directory[B_PATH_NAME_LENGTH];
+	snprintf(directory, sizeof(directory),
+		"/tmp/mime_update_checkpoint_test_%ld", (long)find_thread(NULL));
+
+	if (create_directory(directory, 0755) != B_OK) {
+		fprintf(stderr, "Could not create the test directory %s\n",
+			directory);
+		return 1;
+	}
+
+	test_resume(directory);
+	test_expiry(directory);
+
+	char command[B_PATH_NAME_LENGTH + 16];
+	snprintf(command, sizeof(command), "rm -rf %s", directory);
+	system(command);
+
+	if (sFailures > 0) {
+		printf("%ld checks failed.\n", (long)sFailures);
+		return 1;
+	}
+
+	printf("All tests passed.\n");
+	return 0;
+}
@@ -0,0 +1,471 @@
+/*
+ * Copyright 2010, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+// Tests the B_WATCH_BATCHED node monitoring: how NodeMonitorBatch splits a
+// batch into the single notifications, and which events the kernel folds
+// while collecting a batch.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <Directory.h>
+#include <Entry.h>
+#include <File.h>
+#include <Message.h>
+#include <Messenger.h>
+#include <NodeMonitor.h>
+#include <OS.h>
+#include <TypeConstants.h>
+
+#include <MessengerPrivate.h>
+#include <NodeMonitorBatch.h>
+#include <PathMonitor.h>
+
+
+using BPrivate::Storage::NodeMonitorBatch;
+
+
+// the kernel delivers the batches every 100 ms
+static const bigtime_t kBatchTimeout = 1000000;
+
+static int32 sFailures = 0;
+
+
+#define CHECK(condition)												\
+	do {																\
+		if (!(condition)) {												\
+			fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__,		\
+				__LINE__, #condition);									\
+			sFailures++;												\
+		}																\
+	} while (false)
+
+
+static int32
+find_int32(const BMessage& message, const char* name, int32 defaultValue)
+{
+	int32 value;
+	if (message.FindInt32(name, &value) != B_OK)
+		return defaultValue;
+	return value;
+}
+
+
+static int64
+find_int64(const BMessage& message, const char* name, int64 defaultValue)
+{
+	int64 value;
+	if (message.FindInt64(name, &value) != B_OK)
+		return defaultValue;
+	return value;
+}
+
+
+static bool
+has_string(const BMessage& message, const char* name, const char* value)
+{
+	const char* string;
+	return message.FindString(name, &string) == B_OK
+		&& strcmp(string, value) == 0;
+}
+
+
+static int32
+event_opcode(const BMessage& event)
+{
+	return find_int32(event, "opcode", -1);
+}
+
+
+// #pragma mark - parser
+
+
+static void
+test_parse_batch()
+{
+	BMessage batch(B_NODE_MONITOR);
+	batch.AddInt32("opcode", B_BATCHED_EVENTS);
+
+	// B_ENTRY_CREATED of "a", B_STAT_CHANGED of node 11, B_ENTRY_MOVED of
+	// "b" to "c", and B_ATTR_CHANGED of node 11, stored column-wise
+	batch.AddInt32(NODE_MONITOR_BATCH_OPCODES_FIELD, B_ENTRY_CREATED);
+	batch.AddInt32(NODE_MONITOR_BATCH_OPCODES_FIELD, B_STAT_CHANGED);
+	batch.AddInt32(NODE_MONITOR_BATCH_OPCODES_FIELD, B_ENTRY_MOVED);
+	batch.AddInt32(NODE_MONITOR_BATCH_OPCODES_FIELD, B_ATTR_CHANGED);
+
+	for (int32 i = 0; i < 4; i++)
+		batch.AddInt32("device", 3);
+	batch.AddInt32("node device", 3);
+	batch.AddInt64("directory", 2);
+	batch.AddInt64("from directory", 2);
+	batch.AddInt64("to directory", 5);
+	batch.AddInt64("node", 10);
+	batch.AddInt64("node", 11);
+	batch.AddInt64("node", 12);
+	batch.AddInt64("node", 11);
+	batch.AddString("name", "a");
+	batch.AddString("name", "c");
+	batch.AddString("from name", "b");
+	batch.AddInt32("fields", B_STAT_SIZE);
+	batch.AddString("attr", "test:attr");
+	batch.AddInt32("cause", B_ATTR_CREATED);
+
+	NodeMonitorBatch events(&batch);
+	CHECK(events.CountEvents() == 4);
+
+	BMessage event;
+	CHECK(events.GetNextEvent(&event) == B_OK);
+	CHECK(event.what == B_NODE_MONITOR);
+	CHECK(event_opcode(event) == B_ENTRY_CREATED);
+	CHECK(find_int32(event, "device", -1) == 3);
+	CHECK(find_int64(event, "directory", -1) == 2);
+	CHECK(find_int64(event, "node", -1) == 10);
+	CHECK(has_string(event, "name", "a"));
+	CHECK(!event.HasInt32("fields"));
+
+	CHECK(events.GetNextEvent(&event) == B_OK);
+	CHECK(event_opcode(event) == B_STAT_CHANGED);
+	CHECK(find_int64(event, "node", -1) == 11);
+	CHECK(find_int32(event, "fields", 0) == B_STAT_SIZE);
+	CHECK(!event.HasString("name"));
+	CHECK(!event.HasInt64("directory"));
+
+	CHECK(events.GetNextEvent(&event) == B_OK);
+	CHECK(event_opcode(event) == B_ENTRY_MOVED);
+	CHECK(find_int32(event, "node device", -1) == 3);
+	CHECK(find_int64(event, "from directory", -1) == 2);
+	CHECK(find_int64(event, "to directory", -1) == 5);
+	CHECK(find_int64(event, "node", -1) == 12);
+	CHECK(has_string(event, "name", "c"));
+	CHECK(has_string(event, "from name", "b"));
+
+	CHECK(events.GetNextEvent(&event) == B_OK);
+	CHECK(event_opcode(event) == B_ATTR_CHANGED);
+	CHECK(find_int64(event, "node", -1) == 11);
+	CHECK(has_string(event, "attr", "test:attr"));
+	CHECK(find_int32(event, "cause", -1) == B_ATTR_CREATED);
+
+	CHECK(events.GetNextEvent(&event) == B_ENTRY_NOT_FOUND);
+}
+
+
+static void
+test_parse_truncated_batch()
+{
+	BMessage batch(B_NODE_MONITOR);
+	batch.AddInt32("opcode", B_BATCHED_EVENTS);
+	batch.AddInt32(NODE_MONITOR_BATCH_OPCODES_FIELD, B_STAT_CHANGED);
+	batch.AddInt32(NODE_MONITOR_BATCH_OPCODES_FIELD, B_STAT_CHANGED);
+	batch.AddInt32("device", 3);
+	batch.AddInt64("node", 11);
+	batch.AddInt32("fields", B_STAT_SIZE);
+
+	// the second event is missing its fields
+	NodeMonitorBatch events(&batch);
+	CHECK(events.CountEvents() == 2);
+
+	BMessage event;
+	CHECK(events.GetNextEvent(&event) == B_OK);
+	CHECK(events.GetNextEvent(&event) != B_OK);
+}
+
+
+static void
+test_parse_single_event()
+{
+	BMessage message(B_NODE_MONITOR);
+	message.AddInt32("opcode", B_STAT_CHANGED);
+	message.AddInt32("device", 3);
+	message.AddInt64("node", 11);
+	message.AddInt32("fields", B_STAT_MODIFICATION_TIME);
+
+	NodeMonitorBatch events(&message);
+	CHECK(events.CountEvents() == 1);
+
+	BMessage event;
+	CHECK(events.GetNextEvent(&event) == B_OK);
+	CHECK(event_opcode(event) == B_STAT_CHANGED);
+	CHECK(find_int32(event, "fields", 0) == B_STAT_MODIFICATION_TIME);
+	CHECK(events.GetNextEvent(&event) == B_ENTRY_NOT_FOUND);
+}
+
+
+static void
+test_parse_forwarded_batch()
+{
+	BMessage first(B_PATH_MONITOR);
+	first.AddInt32("opcode", B_ENTRY_CREATED);
+	first.AddString("path", "/tmp/a");
+	BMessage second(B_PATH_MONITOR);
+	second.AddInt32("opcode", B_ENTRY_REMOVED);
+	second.AddString("path", "/tmp/b");
+
+	BMessage batch(B_PATH_MONITOR);
+	batch.AddInt32("opcode", B_BATCHED_EVENTS);
+	batch.AddMessage("event", &first);
+	batch.AddMessage("event", &second);
+
+	NodeMonitorBatch events(&batch);
+	CHECK(events.CountEvents() == 2);
+
+	BMessage event;
+	CHECK(events.GetNextEvent(&event) == B_OK);
+	CHECK(event_opcode(event) == B_ENTRY_CREATED);
+	CHECK(has_string(event, "path", "/tmp/a"));
+	CHECK(events.GetNextEvent(&event) == B_OK);
+	CHECK(event_opcode(event) == B_ENTRY_REMOVED);
+	CHECK(has_string(event, "path", "/tmp/b"));
+	CHECK(events.GetNextEvent(&event) == B_ENTRY_NOT_FOUND);
+}
+
+
+// #pragma mark - folding
+
+
+/*!	Receives the notifications sent to \a port until none arrives for a
+	while, and returns the single events they contain.
+*/
+static void
+receive_events(port_id port, BMessage& events)
+{
+	events.MakeEmpty();
+
+	while (true) {
+		ssize_t size = port_buffer_size_etc(port, B_RELATIVE_TIMEOUT,
+			kBatchTimeout);
+		if (size < 0)
+			return;
+
+		char* buffer = (char*)malloc(size);
+		if (buffer == NULL)
+			return;
+
+		int32 code;
+		read_port(port, &code, buffer, size);
+
+		BMessage message;
+		if (message.Unflatten(buffer) == B_OK) {
+			CHECK(event_opcode(message) == B_BATCHED_EVENTS);
+
+			NodeMonitorBatch batch(&message);
+			BMessage event;
+			while (batch.GetNextEvent(&event) == B_OK)
+				events.AddMessage("event", &event);
+		}
+
+		free(buffer);
+	}
+}
+
+
+static int32
+count_events(const BMessage& events, int32 opcode, BMessage* _last = NULL)
+{
+	int32 count = 0;
+	BMessage event;
+	for (int32 i = 0; events.FindMessage("event", i, &event) == B_OK; i++) {
+		if (event_opcode(event) == opcode) {
+			count++;
+			if (_last != NULL)
+				*_last = event;
+		}
+	}
+
+	return count;
+}
+
+
+// The kernel delivers the batches at a fixed interval, so the events of a
+// step may end up in two of them; the steps are therefore retried a few
+// times before they count as failed.
+static const int32 kMaxAttempts = 10;
+
+
+static bool
+fold_created_and_removed(BDirectory& dir, port_id port)
+{
+	{
+		BFile file(&dir, "transient", B_CREATE_FILE | B_WRITE_ONLY);
+		CHECK(file.InitCheck() == B_OK);
+	}
+	CHECK(BEntry(&dir, "transient").Remove() == B_OK);
+
+	BMessage events;
+	receive_events(port, events);
+
+	// both notifications must be gone, or none of them
+	CHECK(count_events(events, B_ENTRY_CREATED)
+		== count_events(events, B_ENTRY_REMOVED));
+	return count_events(events, B_ENTRY_CREATED) == 0;
+}
+
+
+static bool
+fold_stat_changes(BFile& file, port_id port)
+{
+	for (int32 i = 0; i < 20; i++)
+		file.Write("data", 4);
+	file.SetPermissions(0600);
+
+	BMessage events;
+	receive_events(port, events);
+
+	BMessage event;
+	if (count_events(events, B_STAT_CHANGED, &event) != 1)
+		return false;
+
+	// the fields of all changes are kept
+	int32 fields = find_int32(event, "fields", 0);
+	CHECK((fields & B_STAT_SIZE) != 0);
+	CHECK((fields & B_STAT_MODE) != 0);
+	CHECK((fields & B_STAT_INTERIM_UPDATE) == 0);
+	return true;
+}
+
+
+static bool
+fold_attribute_changes(BFile& file, port_id port, int32 attempt)
+{
+	char name[B_ATTR_NAME_LENGTH];
+	snprintf(name, sizeof(name), "test:attr%ld", (long)attempt);
+
+	int32 value = 1;
+	file.WriteAttr(name, B_INT32_TYPE, 0, &value, sizeof(value));
+	value = 2;
+	file.WriteAttr(name, B_INT32_TYPE, 0, &value, sizeof(value));
+	file.WriteAttr("test:other", B_INT32_TYPE, 0, &value, sizeof(value));
+
+	BMessage events;
+	receive_events(port, events);
+	if (count_events(events, B_ATTR_CHANGED) != 2)
+		return false;
+
+	// the attribute didn't exist before the batch
+	BMessage event;
+	for (int32 i = 0; events.FindMessage("event", i, &event) == B_OK; i++) {
+		if (event_opcode(event) == B_ATTR_CHANGED
+			&& has_string(event, "attr", name)) {
+			CHECK(find_int32(event, "cause", -1) == B_ATTR_CREATED);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+
+static bool
+fold_attribute_created_and_removed(BFile& file, port_id port)
+{
+	int32 value = 1;
+	file.WriteAttr("test:transient", B_INT32_TYPE, 0, &value, sizeof(value));
+	file.RemoveAttr("test:transient");
+
+	BMessage events;
+	receive_events(port, events);
+	return count_events(events, B_ATTR_CHANGED) == 0;
+}
+
+
+static void
+test_folding(const char* directory, BMessenger& target, port_id port)
+{
+	BDirectory dir(directory);
+	node_ref directoryRef;
+	CHECK(dir.GetNodeRef(&directoryRef) == B_OK);
+	CHECK(watch_node(&directoryRef, B_WATCH_DIRECTORY | B_WATCH_BATCHED,
+		target) == B_OK);
+
+	// a file that is removed again within the batch isn't reported at all
+	bool folded = false;
+	for (int32 i = 0; i < kMaxAttempts && !folded; i++)
+		folded = fold_created_and_removed(dir, port);
+	CHECK(folded);
+
+	// a file that stays is
+	BFile file(&dir, "file", B_CREATE_FILE | B_READ_WRITE);
+	CHECK(file.InitCheck() == B_OK);
+
+	BMessage events;
+	receive_events(port, events);
+	CHECK(count_events(events, B_ENTRY_CREATED) == 1);
+
+	node_ref fileRef;
+	CHECK(file.GetNodeRef(&fileRef) == B_OK);
+	CHECK(watch_node(&fileRef, B_WATCH_STAT | B_WATCH_ATTR | B_WATCH_BATCHED,
+		target) == B_OK);
+
+	// many writes make a single stat change
+	folded = false;
+	for (int32 i = 0; i < kMaxAttempts && !folded; i++)
+		folded = fold_stat_changes(file, port);
+	CHECK(folded);
+
+	// the changes of an attribute are combined
+	folded = false;
+	for (int32 i = 0; i < kMaxAttempts && !folded; i++)
+		folded = fold_attribute_changes(file, port, i);
+	CHECK(folded);
+
+	// an attribute that is created and removed within the batch is dropped
+	folded = false;
+	for (int32 i = 0; i < kMaxAttempts && !folded; i++)
+		folded = fold_attribute_created_and_removed(file, port);
+	CHECK(folded);
+
+	// the removal of a file that was created in an earlier batch is kept
+	file.Unset();
+	CHECK(BEntry(&dir, "file").Remove() == B_OK);
+
+	receive_events(port, events);
+	CHECK(count_events(events, B_ENTRY_REMOVED) == 1);
+
+	stop_watching(target);
+}
+
+
+int
+main()
+{
+	test_parse_batch();
+	test_parse_truncated_batch();
+	test_parse_single_event();
+	test_parse_forwarded_batch();
+
+	char directory[B_PATH_NAME_LENGTH];
+	snprintf(directory, sizeof(directory), "/tmp/node_monitor_batch_test_%ld",
+		(long)find_thread(NULL));
+
+	port_id port = create_port(100, "node monitor batch test");
+	if (create_directory(directory, 0755) != B_OK || port < 0) {
+		fprintf(stderr, "Could not set up the test in %s\n", directory);
+		return 1;
+	}
+
+	thread_info info;
+	get_thread_info(find_thread(NULL), &info);
+
+	// the events are read from the port directly, so any token will do
+	BMessenger target;
+	BMessenger::Private(target).SetTo(info.team, port, 1);
+
+	test_folding(directory, target, port);
+
+	delete_port(port);
+
+	char command[B_PATH_NAME_LENGTH + 16];
+	snprintf(command, sizeof(command), "rm -rf %s", directory);
+	system(command);
+
+	if (sFailures > 0) {
+		printf("%ld checks failed.\n", (long)sFailures);
+		return 1;
+	}
+
+	printf("All tests passed.\n");
+	return 0;
+}
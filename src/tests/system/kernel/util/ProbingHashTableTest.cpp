@@ -0,0 +1,419 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <set>
+
+#include <TestUtils.h>
+#include <cppunit/Test.h>
+#include <cppunit/TestCaller.h>
+#include <cppunit/TestSuite.h>
+
+#include <ProbingHashTable.h>
+
+#include "common.h"
+#include "ProbingHashTableTest.h"
+
+
+static const int kElementCount = 4096;
+
+
+struct HashElement {
+	int		key;
+	bool	inserted;
+};
+
+
+struct HashElementDefinition {
+	typedef int			KeyType;
+	typedef HashElement	ValueType;
+
+	size_t HashKey(int key) const
+	{
+		return key;
+	}
+
+	size_t Hash(HashElement* value) const
+	{
+		return HashKey(value->key);
+	}
+
+	bool Compare(int key, HashElement* value) const
+	{
+		return value->key == key;
+	}
+};
+
+
+// Gives many elements the same hash value, so that they form long clusters.
+struct CollidingElementDefinition : HashElementDefinition {
+	size_t HashKey(int key) const
+	{
+		return key % 7;
+	}
+
+	size_t Hash(HashElement* value) const
+	{
+		return HashKey(value->key);
+	}
+};
+
+
+typedef BProbingHashTable<HashElementDefinition> HashTable;
+typedef BProbingHashTable<CollidingElementDefinition> CollidingHashTable;
+typedef BProbingHashTable<HashElementDefinition, false> ManualHashTable;
+
+
+static HashElement sElements[kElementCount];
+
+
+static void
+init_elements()
+{
+	for (int i = 0; i < kElementCount; i++) {
+		sElements[i].key = i;
+		sElements[i].inserted = false;
+	}
+}
+
+
+//! Checks the table against the set of elements that should be in it.
+template <class Table>
+static void
+check_table(const Table& table, const std::set<int>& reference)
+{
+	CHK(table.CountElements() == reference.size());
+
+	for (std::set<int>::const_iterator it = reference.begin();
+			it != reference.end(); it++) {
+		CHK(table.Lookup(*it) == &sElements[*it]);
+	}
+
+	// every element is visited exactly once
+	std::set<int> visited;
+	typename Table::Iterator iterator = table.GetIterator();
+	while (iterator.HasNext()) {
+		HashElement* element = iterator.Next();
+		CHK(element != NULL);
+		CHK(reference.find(element->key) != reference.end());
+		CHK(visited.insert(element->key).second);
+	}
+	CHK(visited.size() == reference.size());
+}
+
+
+ProbingHashTableTest::ProbingHashTableTest(std::string name)
+	: BTestCase(name)
+{
+}
+
+CppUnit::Test*
+ProbingHashTableTest::Suite()
+{
+	CppUnit::TestSuite *suite = new CppUnit::TestSuite("ProbingHashTable");
+
+	ADD_TEST4(ProbingHashTable, suite, ProbingHashTableTest, InsertLookupTest);
+	ADD_TEST4(ProbingHashTable, suite, ProbingHashTableTest, RandomTest);
+	ADD_TEST4(ProbingHashTable, suite, ProbingHashTableTest, CollisionTest);
+	ADD_TEST4(ProbingHashTable, suite, ProbingHashTableTest, GrowShrinkTest);
+	ADD_TEST4(ProbingHashTable, suite, ProbingHashTableTest,
+		RemoveCurrentTest);
+	ADD_TEST4(ProbingHashTable, suite, ProbingHashTableTest,
+		RemoveCurrentMigrationTest);
+	ADD_TEST4(ProbingHashTable, suite, ProbingHashTableTest, ManualResizeTest);
+
+	return suite;
+}
+
+/*!	Inserts, removes and looks up random elements, and compares the table
+	with a reference set after each operation.
+*/
+template <class Table>
+void
+ProbingHashTableTest::RandomOperations(Table& table, int operationCount,
+	int keyRange)
+{
+	init_elements();
+	std::set<int> reference;
+
+	for (int i = 0; i < operationCount; i++) {
+		int key = rand() % keyRange;
+		HashElement* element = &sElements[key];
+
+		switch (rand() % 3) {
+			case 0:
+				if (!element->inserted) {
+					CHK(table.Insert(element) == B_OK);
+					element->inserted = true;
+					reference.insert(key);
+				}
+				break;
+			case 1:
+				CHK(table.Remove(element) == element->inserted);
+				element->inserted = false;
+				reference.erase(key);
+				break;
+			case 2:
+				CHK(table.Lookup(key) == (element->inserted ? element : NULL));
+				break;
+		}
+
+		CHK(table.CountElements() == reference.size());
+		if (i % 256 == 0)
+			check_table(table, reference);
+	}
+
+	check_table(table, reference);
+}
+
+//! InsertLookupTest
+void
+ProbingHashTableTest::InsertLookupTest()
+{
+	init_elements();
+
+	NextSubTest();
+	HashTable table;
+	CHK(table.Init() == B_OK);
+	CHK(table.CountElements() == 0);
+	CHK(table.Lookup(1) == NULL);
+	CHK(!table.Remove(&sElements[1]));
+	CHK(!table.GetIterator().HasNext());
+
+	NextSubTest();
+	CHK(table.Insert(&sElements[1]) == B_OK);
+	CHK(table.Insert(&sElements[2]) == B_OK);
+	CHK(table.CountElements() == 2);
+	CHK(table.Lookup(1) == &sElements[1]);
+	CHK(table.Lookup(2) == &sElements[2]);
+	CHK(table.Lookup(3) == NULL);
+
+	NextSubTest();
+	CHK(table.Remove(&sElements[1]));
+	CHK(!table.Remove(&sElements[1]));
+	CHK(table.Lookup(1) == NULL);
+	CHK(table.Lookup(2) == &sElements[2]);
+
+	NextSubTest();
+	table.Clear();
+	CHK(table.CountElements() == 0);
+	CHK(table.Lookup(2) == NULL);
+}
+
+//! RandomTest
+void
+ProbingHashTableTest::RandomTest()
+{
+	srand(1);
+
+	NextSubTest();
+	HashTable table;
+	CHK(table.Init() == B_OK);
+	RandomOperations(table, 100000, 64);
+
+	NextSubTest();
+	HashTable largeTable;
+	CHK(largeTable.Init() == B_OK);
+	RandomOperations(largeTable, 100000, kElementCount);
+}
+
+//! CollisionTest
+void
+ProbingHashTableTest::CollisionTest()
+{
+	srand(2);
+
+	NextSubTest();
+	CollidingHashTable table;
+	CHK(table.Init() == B_OK);
+	RandomOperations(table, 20000, 512);
+}
+
+/*!	Grows the table from empty to many elements and back, so that it goes
+	through a number of incremental resizes in both directions, and checks
+	that no element gets lost while it is moved to the new array.
+*/
+void
+ProbingHashTableTest::GrowShrinkTest()
+{
+	init_elements();
+	std::set<int> reference;
+
+	HashTable table;
+	CHK(table.Init() == B_OK);
+
+	NextSubTest();
+	size_t lastSize = table.TableSize();
+	int resizes = 0;
+	for (int i = 0; i < kElementCount; i++) {
+		CHK(table.Insert(&sElements[i]) == B_OK);
+		reference.insert(i);
+
+		if (table.TableSize() != lastSize) {
+			CHK(table.TableSize() > lastSize);
+			lastSize = table.TableSize();
+			resizes++;
+		}
+
+		// the elements in both arrays must be found while migrating
+		for (int j = i; j >= 0 && j > i - 64; j--)
+			CHK(table.Lookup(j) == &sElements[j]);
+		if (i % 512 == 0)
+			check_table(table, reference);
+	}
+	CHK(resizes > 5);
+	check_table(table, reference);
+
+	NextSubTest();
+	resizes = 0;
+	for (int i = 0; i < kElementCount; i++) {
+		CHK(table.Remove(&sElements[i]));
+		reference.erase(i);
+
+		if (table.TableSize() != lastSize) {
+			CHK(table.TableSize() < lastSize);
+			lastSize = table.TableSize();
+			resizes++;
+		}
+
+		for (int j = i + 1; j < kElementCount && j < i + 64; j++)
+			CHK(table.Lookup(j) == &sElements[j]);
+		CHK(table.Lookup(i) == NULL);
+		if (i % 512 == 0)
+			check_table(table, reference);
+	}
+	CHK(resizes > 2);
+	CHK(table.TableSize() == HashTable::kMinimumSize);
+	check_table(table, reference);
+}
+
+//! Removes every other element while iterating.
+void
+ProbingHashTableTest::RemoveCurrentTest()
+{
+	init_elements();
+	std::set<int> reference;
+
+	NextSubTest();
+	CollidingHashTable table;
+	CHK(table.Init() == B_OK);
+	for (int i = 0; i < 1000; i++) {
+		CHK(table.Insert(&sElements[i]) == B_OK);
+		reference.insert(i);
+	}
+
+	std::set<int> visited;
+	CollidingHashTable::Iterator iterator = table.GetIterator();
+	while (iterator.HasNext()) {
+		HashElement* element = iterator.Next();
+		CHK(visited.insert(element->key).second);
+		if (element->key % 2 == 0) {
+			table.RemoveCurrent(iterator);
+			reference.erase(element->key);
+		}
+	}
+	CHK(visited.size() == 1000);
+	check_table(table, reference);
+
+	NextSubTest();
+	visited.clear();
+	iterator.Rewind();
+	while (iterator.HasNext()) {
+		HashElement* element = iterator.Next();
+		CHK(visited.insert(element->key).second);
+		table.RemoveCurrent(iterator);
+		reference.erase(element->key);
+	}
+	CHK(visited.size() == 500);
+	CHK(table.CountElements() == 0);
+	check_table(table, reference);
+}
+
+//! Removes elements while iterating, with the table in the middle of a resize.
+void
+ProbingHashTableTest::RemoveCurrentMigrationTest()
+{
+	init_elements();
+	std::set<int> reference;
+
+	HashTable table;
+	CHK(table.Init() == B_OK);
+
+	int count = 0;
+	while (count < 100) {
+		CHK(table.Insert(&sElements[count]) == B_OK);
+		reference.insert(count++);
+	}
+
+	// insert until the table grows, so that most of the elements are still
+	// in the old array
+	size_t size = table.TableSize();
+	while (table.TableSize() == size) {
+		CHK(table.Insert(&sElements[count]) == B_OK);
+		reference.insert(count++);
+	}
+
+	NextSubTest();
+	std::set<int> visited;
+	HashTable::Iterator iterator = table.GetIterator();
+	while (iterator.HasNext()) {
+		HashElement* element = iterator.Next();
+		CHK(visited.insert(element->key).second);
+		if (element->key % 3 != 0) {
+			table.RemoveCurrent(iterator);
+			reference.erase(element->key);
+		}
+	}
+	CHK(visited.size() == (size_t)count);
+	check_table(table, reference);
+
+	// the table still works normally afterwards
+	NextSubTest();
+	for (int i = count; i < count + 1000; i++) {
+		CHK(table.Insert(&sElements[i]) == B_OK);
+		reference.insert(i);
+	}
+	check_table(table, reference);
+}
+
+//! Resizes a table that doesn't allocate on its own.
+void
+ProbingHashTableTest::ManualResizeTest()
+{
+	init_elements();
+	std::set<int> reference;
+
+	ManualHashTable table;
+	CHK(table.Init() == B_OK);
+
+	NextSubTest();
+	for (int i = 0; i < 1000; i++) {
+		size_t resizeNeeded = table.ResizeNeeded();
+		if (resizeNeeded != 0) {
+			void* allocation = malloc(resizeNeeded);
+			CHK(allocation != NULL);
+			void* oldTable = NULL;
+			CHK(table.Resize(allocation, resizeNeeded, false, &oldTable));
+			free(oldTable);
+		}
+
+		CHK(table.Insert(&sElements[i]) == B_OK);
+		reference.insert(i);
+	}
+	check_table(table, reference);
+
+	NextSubTest();
+	// without resizing, the table runs full eventually
+	int i = 1000;
+	while (table.Insert(&sElements[i]) == B_OK) {
+		reference.insert(i++);
+		CHK(i < kElementCount);
+	}
+	CHK(table.CountElements() + 1 == table.TableSize());
+	check_table(table, reference);
+
+	NextSubTest();
+	// a stale size is rejected
+	size_t resizeNeeded = table.ResizeNeeded();
+	CHK(resizeNeeded != 0);
+	CHK(!table.Resize(malloc(resizeNeeded / 2), resizeNeeded / 2));
+}
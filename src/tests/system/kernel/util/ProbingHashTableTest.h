@@ -0,0 +1,25 @@
+#ifndef _probing_hash_table_test_h_
+#define _probing_hash_table_test_h_
+
+#include <TestCase.h>
+
+class ProbingHashTableTest : public BTestCase {
+public:
+	ProbingHashTableTest(std::string name = "");
+
+	static CppUnit::Test* Suite();
+
+	void InsertLookupTest();
+	void RandomTest();
+	void CollisionTest();
+	void GrowShrinkTest();
+	void RemoveCurrentTest();
+	void RemoveCurrentMigrationTest();
+	void ManualResizeTest();
+
+private:
+	template <class Table>
+	void RandomOperations(Table& table, int operationCount, int keyRange);
+};
+
+#endif // _probing_hash_table_test_h_
@@ -0,0 +1,281 @@
+/*
+ * Copyright 2010, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+/*!	Compares the insert and lookup performance of the kernel's hash tables:
+	the chained khash, BOpenHashTable, and BProbingHashTable.
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <OS.h>
+
+#include <util/khash.h>
+#include <util/OpenHashTable.h>
+#include <util/ProbingHashTable.h>
+
+
+static const int32 kElementCounts[] = { 1000, 10000, 100000, 1000000 };
+static const int32 kLookupRounds = 4;
+
+
+struct Element {
+	Element*	next;
+	int32		key;
+};
+
+
+static int
+element_compare(void* _element, const void* _key)
+{
+	Element* element = (Element*)_element;
+	const int32* key = (const int32*)_key;
+
+	return element->key == *key ? 0 : 1;
+}
+
+
+static uint32
+element_hash(void* _element, const void* _key, uint32 range)
+{
+	Element* element = (Element*)_element;
+	const int32* key = (const int32*)_key;
+
+	if (element != NULL)
+		return (uint32)element->key % range;
+
+	return (uint32)*key % range;
+}
+
+
+struct OpenHashDefinition {
+	typedef int32	KeyType;
+	typedef Element	ValueType;
+
+	size_t HashKey(int32 key) const
+	{
+		return key;
+	}
+
+	size_t Hash(Element* value) const
+	{
+		return value->key;
+	}
+
+	bool Compare(int32 key, Element* value) const
+	{
+		return value->key == key;
+	}
+
+	Element*& GetLink(Element* value) const
+	{
+		return value->next;
+	}
+};
+
+
+typedef BOpenHashTable<OpenHashDefinition> OpenHashTable;
+typedef BProbingHashTable<OpenHashDefinition> ProbingHashTable;
+
+
+class Benchmark {
+public:
+	Benchmark(const char* name, Element* elements, const int32* order,
+			int32 count)
+		:
+		fName(name),
+		fElements(elements),
+		fOrder(order),
+		fCount(count)
+	{
+	}
+
+	virtual ~Benchmark()
+	{
+	}
+
+	void Run()
+	{
+		bigtime_t start = system_time();
+		for (int32 i = 0; i < fCount; i++)
+			Insert(&fElements[i]);
+		bigtime_t insertTime = system_time() - start;
+
+		// look the elements up in random order; every other lookup misses
+		int32 found = 0;
+		start = system_time();
+		for (int32 round = 0; round < kLookupRounds; round++) {
+			for (int32 i = 0; i < fCount; i++) {
+				int32 key = fElements[fOrder[i]].key + (i & 1);
+				if (Lookup(key) != NULL)
+					found++;
+			}
+		}
+		bigtime_t lookupTime = system_time() - start;
+
+		int32 lookups = fCount * kLookupRounds;
+		if (found < lookups / 2) {
+			fprintf(stderr, "%s: only found %ld of %ld elements!\n", fName,
+				found, lookups / 2);
+		}
+
+		printf("    %-20s insert %7.1f ns, lookup %7.1f ns\n", fName,
+			1000.0 * insertTime / fCount, 1000.0 * lookupTime / lookups);
+	}
+
+	virtual void Insert(Element* element) = 0;
+	virtual Element* Lookup(int32 key) = 0;
+
+protected:
+	const char*		fName;
+	Element*		fElements;
+	const int32*	fOrder;
+	int32			fCount;
+};
+
+
+class KHashBenchmark : public Benchmark {
+public:
+	KHashBenchmark(Element* elements, const int32* order, int32 count)
+		:
+		Benchmark("khash", elements, order, count)
+	{
+		fTable = hash_init(1024, offsetof(Element, next), &element_compare,
+			&element_hash);
+	}
+
+	virtual ~KHashBenchmark()
+	{
+		uint32 cookie = 0;
+		while (hash_remove_first(fTable, &cookie) != NULL)
+			;
+
+		hash_uninit(fTable);
+	}
+
+	virtual void Insert(Element* element)
+	{
+		hash_insert_grow(fTable, element);
+	}
+
+	virtual Element* Lookup(int32 key)
+	{
+		return (Element*)hash_lookup(fTable, &key);
+	}
+
+private:
+	hash_table*	fTable;
+};
+
+
+class OpenHashBenchmark : public Benchmark {
+public:
+	OpenHashBenchmark(Element* elements, const int32* order, int32 count)
+		:
+		Benchmark("BOpenHashTable", elements, order, count)
+	{
+		fTable.Init(1024);
+	}
+
+	virtual void Insert(Element* element)
+	{
+		fTable.Insert(element);
+	}
+
+	virtual Element* Lookup(int32 key)
+	{
+		return fTable.Lookup(key);
+	}
+
+private:
+	OpenHashTable	fTable;
+};
+
+
+class ProbingHashBenchmark : public Benchmark {
+public:
+	ProbingHashBenchmark(Element* elements, const int32* order, int32 count)
+		:
+		Benchmark("BProbingHashTable", elements, order, count)
+	{
+		fTable.Init(1024);
+	}
+
+	virtual void Insert(Element* element)
+	{
+		fTable.Insert(element);
+	}
+
+	virtual Element* Lookup(int32 key)
+	{
+		return fTable.Lookup(key);
+	}
+
+private:
+	ProbingHashTable	fTable;
+};
+
+
+template<typename BenchmarkType>
+static void
+run_benchmark(Element* elements, const int32* order, int32 count)
+{
+	BenchmarkType benchmark(elements, order, count);
+	benchmark.Run();
+}
+
+
+static void
+run_benchmarks(const char* name, Element* elements, const int32* order,
+	int32 count)
+{
+	printf("  %s keys:\n", name);
+	run_benchmark<KHashBenchmark>(elements, order, count);
+	run_benchmark<OpenHashBenchmark>(elements, order, count);
+	run_benchmark<ProbingHashBenchmark>(elements, order, count);
+}
+
+
+int
+main(int argc, char** argv)
+{
+	for (size_t i = 0; i < sizeof(kElementCounts) / sizeof(kElementCounts[0]);
+			i++) {
+		int32 count = kElementCounts[i];
+		Element* elements = new Element[count];
+		int32* order = new int32[count];
+
+		srand(count);
+		for (int32 j = 0; j < count; j++)
+			order[j] = j;
+		for (int32 j = count - 1; j > 0; j--) {
+			int32 k = rand() % (j + 1);
+			int32 temp = order[j];
+			order[j] = order[k];
+			order[k] = temp;
+		}
+
+		printf("%ld elements:\n", count);
+
+		// Use even keys only, so that odd keys are guaranteed misses.
+		// Sequential keys are what thread IDs and block numbers look like.
+		for (int32 j = 0; j < count; j++)
+			elements[j].key = j * 2;
+		run_benchmarks("sequential", elements, order, count);
+
+		// multiplying with an odd number is a bijection, so the keys are
+		// still unique
+		for (int32 j = 0; j < count; j++)
+			elements[j].key = ((uint32)j * 2654435761UL & 0x3fffffff) * 2;
+		run_benchmarks("random", elements, order, count);
+
+		delete[] elements;
+		delete[] order;
+	}
+
+	return 0;
+}